@@ -41,6 +41,7 @@
 #include "cutils/log.h"
 #include "cutils/process_name.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -53,10 +54,12 @@ static const char* kClassesDex = "classes.dex";
 /*
  * Extract "classes.dex" from zipFd into "cacheFd", leaving a little space
  * up front for the DEX optimization header.
+ *
+ * "prevFd" is the .odex of a previous version of the zip file, or -1.
  */
 static int extractAndProcessZip(int zipFd, int cacheFd,
     const char* debugFileName, bool isBootstrap, const char* bootClassPath,
-    const char* dexoptFlagStr)
+    const char* dexoptFlagStr, int prevFd)
 {
     ZipArchive zippy;
     ZipEntry zipEntry;
@@ -68,6 +71,7 @@ static int extractAndProcessZip(int zipFd, int cacheFd,
     int dexoptFlags = 0;        /* bit flags, from enum DexoptFlags */
     DexClassVerifyMode verifyMode = VERIFY_MODE_ALL;
     DexOptimizerMode dexOptMode = OPTIMIZE_MODE_VERIFIED;
+    int dexOptThreads = 0;      /* one per CPU */
 
     memset(&zippy, 0, sizeof(zippy));
 
@@ -167,6 +171,11 @@ static int extractAndProcessZip(int zipFd, int cacheFd,
             default:                                            break;
             }
         }
+
+        opc = strstr(dexoptFlagStr, "t=");      /* verify/opt threads */
+        if (opc != NULL) {
+            dexOptThreads = strtol(opc+2, NULL, 10);
+        }
     }
 
     /*
@@ -174,7 +183,7 @@ static int extractAndProcessZip(int zipFd, int cacheFd,
      */
 
     if (dvmPrepForDexOpt(bootClassPath, dexOptMode, verifyMode,
-            dexoptFlags) != 0)
+            dexoptFlags, dexOptThreads) != 0)
     {
         ALOGE("DexOptZ: VM init failed");
         goto bail;
@@ -184,7 +193,7 @@ static int extractAndProcessZip(int zipFd, int cacheFd,
 
     /* do the optimization */
     if (!dvmContinueOptimization(cacheFd, dexOffset, uncompLen, debugFileName,
-            modWhen, crc32, isBootstrap))
+            modWhen, crc32, isBootstrap, prevFd))
     {
         ALOGE("Optimization failed");
         goto bail;
@@ -204,7 +213,7 @@ bail:
  * preoptimization.
  */
 static int processZipFile(int zipFd, int cacheFd, const char* zipName,
-        const char *dexoptFlags)
+        const char *dexoptFlags, int prevFd)
 {
     char* bcpCopy = NULL;
 
@@ -246,7 +255,7 @@ static int processZipFile(int zipFd, int cacheFd, const char* zipName,
     }
 
     int result = extractAndProcessZip(zipFd, cacheFd, zipName, isBootstrap,
-            bcp, dexoptFlags);
+            bcp, dexoptFlags, prevFd);
 
     free(bcpCopy);
     return result;
@@ -274,6 +283,8 @@ static int processZipFile(int zipFd, int cacheFd, const char* zipName,
  *      for comparing against BOOTCLASSPATH; does not need to be
  *      accessible or even exist)
  *   5. dexopt flags
+ *   6. (optional) fd of the .odex of a previous version of the zip file
+ *      (input, read-only); classes that haven't changed reuse its results
  *
  * The BOOTCLASSPATH environment variable is assumed to hold the correct
  * boot class path.  If the filename provided appears in the boot class
@@ -287,11 +298,12 @@ static int fromZip(int argc, char* const argv[])
 {
     int result = -1;
     int zipFd, cacheFd;
+    int prevFd = -1;
     const char* zipName;
     char* bcpCopy = NULL;
     const char* dexoptFlags;
 
-    if (argc != 6) {
+    if (argc != 6 && argc != 7) {
         ALOGE("Wrong number of args for --zip (found %d)", argc);
         goto bail;
     }
@@ -306,8 +318,10 @@ static int fromZip(int argc, char* const argv[])
     --argc;
     dexoptFlags = *++argv;
     --argc;
+    if (argc > 1)
+        GET_ARG(prevFd, strtol, "bad previous odex fd");
 
-    result = processZipFile(zipFd, cacheFd, zipName, dexoptFlags);
+    result = processZipFile(zipFd, cacheFd, zipName, dexoptFlags, prevFd);
 
 bail:
     return result;
@@ -322,6 +336,8 @@ bail:
  *   2. zipfile name
  *   3. output file name
  *   4. dexopt flags
+ *   5. (optional) name of the .odex of a previous version of the zipfile;
+ *      classes that haven't changed reuse its results
  *
  * The BOOTCLASSPATH environment variable is assumed to hold the correct
  * boot class path.  If the filename provided appears in the boot class
@@ -335,9 +351,10 @@ static int preopt(int argc, char* const argv[])
 {
     int zipFd = -1;
     int outFd = -1;
+    int prevFd = -1;
     int result = -1;
 
-    if (argc != 5) {
+    if (argc != 5 && argc != 6) {
         /*
          * Use stderr here, since this variant is meant to be called on
          * the host side.
@@ -370,13 +387,26 @@ static int preopt(int argc, char* const argv[])
         goto bail;
     }
 
-    result = processZipFile(zipFd, outFd, zipName, dexoptFlags);
+    /* without a previous odex we just do everything */
+    if (argc == 6) {
+        prevFd = open(argv[5], O_RDONLY);
+        if (prevFd < 0) {
+            fprintf(stderr, "Not using previous odex '%s': %s\n",
+                    argv[5], strerror(errno));
+        }
+    }
+
+    result = processZipFile(zipFd, outFd, zipName, dexoptFlags, prevFd);
 
 bail:
     if (zipFd >= 0) {
         close(zipFd);
     }
 
+    if (prevFd >= 0) {
+        close(prevFd);
+    }
+
     if (outFd >= 0) {
         close(outFd);
     }
@@ -510,7 +540,9 @@ static int fromDex(int argc, char* const argv[])
         dexOptMode = OPTIMIZE_MODE_NONE;
     }
 
-    if (dvmPrepForDexOpt(bootClassPath, dexOptMode, verifyMode, flags) != 0) {
+    /* one verify/opt thread per CPU */
+    if (dvmPrepForDexOpt(bootClassPath, dexOptMode, verifyMode, flags, 0) != 0)
+    {
         ALOGE("VM init failed");
         goto bail;
     }
@@ -518,8 +550,9 @@ static int fromDex(int argc, char* const argv[])
     vmStarted = true;
 
     /* do the optimization */
+    /* the VM rewrites a stale cache file in place; nothing to reuse */
     if (!dvmContinueOptimization(fd, offset, length, debugFileName,
-            modWhen, crc, (flags & DEXOPT_IS_BOOTSTRAP) != 0))
+            modWhen, crc, (flags & DEXOPT_IS_BOOTSTRAP) != 0, -1))
     {
         ALOGE("Optimization failed");
         goto bail;
@@ -17,7 +17,9 @@ LOCAL_PATH:= $(call my-dir)
 dex_src_files := \
 	CmdUtils.cpp \
 	DexCatch.cpp \
+	DexChecksum.cpp \
 	DexClass.cpp \
+	DexClassHash.cpp \
 	DexDataMap.cpp \
 	DexDebugInfo.cpp \
 	DexFile.cpp \
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Adler-32 and SHA-1 over DEX data.
+ *
+ * The x86 versions are compiled with per-function target attributes, so
+ * the rest of libdex doesn't need (and can't accidentally use) SSSE3 or
+ * the SHA extensions, and picked at run time based on CPUID.  Everywhere
+ * else, Adler-32 comes from zlib and dexSha1Blocks() declines.
+ */
+#include "DexChecksum.h"
+
+#include <zlib.h>
+
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define DEX_CHECKSUM_X86
+# include <cpuid.h>
+# include <immintrin.h>
+#endif
+
+/* largest prime below 65536, and the most bytes we can sum before taking
+ * the modulus without overflowing 32 bits (these are zlib's BASE and NMAX)
+ */
+#define kAdlerBase  65521
+#define kAdlerNMax  5552
+
+/* features in use, or -1 if we haven't looked at the CPU yet */
+static volatile int gFeatures = -1;
+
+/*
+ * Find out what the CPU can do.
+ */
+static u4 getCpuFeatures(void)
+{
+    u4 features = 0;
+
+#ifdef DEX_CHECKSUM_X86
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+        return 0;
+    if ((ecx & bit_SSSE3) != 0)
+        features |= kDexChecksumSsse3;
+
+    /* the SHA code also needs SSE4.1, for pextrd */
+    bool haveSse41 = (ecx & bit_SSE4_1) != 0;
+    if (__get_cpuid_max(0, NULL) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx & (1 << 29)) != 0 && haveSse41 &&
+            (features & kDexChecksumSsse3) != 0)
+        {
+            features |= kDexChecksumSha;
+        }
+    }
+#endif
+
+    return features;
+}
+
+u4 dexChecksumGetFeatures(void)
+{
+    int features = gFeatures;
+
+    if (features < 0) {
+        /* racing threads all get the same answer */
+        features = getCpuFeatures();
+        gFeatures = features;
+    }
+    return features;
+}
+
+void dexChecksumSetFeatures(u4 features)
+{
+    gFeatures = features & getCpuFeatures();
+}
+
+#ifdef DEX_CHECKSUM_X86
+/*
+ * Adler-32, 32 bytes at a time.
+ *
+ * For each 32-byte block, s1 grows by the sum of the bytes, and s2 grows
+ * by 32 * s1 (as it was before the block) plus each byte weighted by its
+ * distance from the end of the block.  PSADBW does the plain sums and
+ * PMADDUBSW the weighted ones; the "32 * s1" terms are collected in
+ * "prevS1" and added once per run of blocks.  A run is short enough that
+ * none of the 32-bit lanes can overflow before we reduce modulo the base.
+ */
+__attribute__((target("ssse3")))
+static u4 adler32Ssse3(u4 adler, const u1* buf, size_t len)
+{
+    const __m128i kWeightsLo = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+        24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i kWeightsHi = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+        8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i kOnes = _mm_set1_epi16(1);
+    const __m128i kZero = _mm_setzero_si128();
+    u4 s1 = adler & 0xffff;
+    u4 s2 = adler >> 16;
+    size_t blocks = len / 32;
+
+    len -= blocks * 32;
+    while (blocks != 0) {
+        size_t n = (blocks < kAdlerNMax / 32) ? blocks : kAdlerNMax / 32;
+        blocks -= n;
+
+        __m128i prevS1 = _mm_cvtsi32_si128(s1 * n);
+        __m128i sumS1 = kZero;
+        __m128i sumS2 = _mm_cvtsi32_si128(s2);
+
+        do {
+            __m128i lo = _mm_loadu_si128((const __m128i*) buf);
+            __m128i hi = _mm_loadu_si128((const __m128i*) (buf + 16));
+
+            prevS1 = _mm_add_epi32(prevS1, sumS1);
+            sumS1 = _mm_add_epi32(sumS1, _mm_sad_epu8(lo, kZero));
+            sumS1 = _mm_add_epi32(sumS1, _mm_sad_epu8(hi, kZero));
+            sumS2 = _mm_add_epi32(sumS2,
+                _mm_madd_epi16(_mm_maddubs_epi16(lo, kWeightsLo), kOnes));
+            sumS2 = _mm_add_epi32(sumS2,
+                _mm_madd_epi16(_mm_maddubs_epi16(hi, kWeightsHi), kOnes));
+            buf += 32;
+        } while (--n != 0);
+
+        sumS2 = _mm_add_epi32(sumS2, _mm_slli_epi32(prevS1, 5));
+
+        /* add up the lanes */
+        sumS1 = _mm_add_epi32(sumS1, _mm_shuffle_epi32(sumS1, 0xb1));
+        sumS1 = _mm_add_epi32(sumS1, _mm_shuffle_epi32(sumS1, 0x4e));
+        sumS2 = _mm_add_epi32(sumS2, _mm_shuffle_epi32(sumS2, 0xb1));
+        sumS2 = _mm_add_epi32(sumS2, _mm_shuffle_epi32(sumS2, 0x4e));
+        s1 = (s1 + (u4) _mm_cvtsi128_si32(sumS1)) % kAdlerBase;
+        s2 = (u4) _mm_cvtsi128_si32(sumS2) % kAdlerBase;
+    }
+
+    /* zlib can have the leftovers */
+    adler = s1 | (s2 << 16);
+    if (len != 0)
+        adler = (u4) adler32(adler, buf, len);
+    return adler;
+}
+
+/*
+ * SHA-1 with the SHA extensions.  SHA1RNDS4 does four rounds, taking E
+ * (already added to the next four message words) in the top lane of its
+ * second operand; SHA1NEXTE works out the next E from the old A and adds
+ * it to the message words.  The message schedule is computed four words
+ * at a time, three groups ahead, with SHA1MSG1 / XOR / SHA1MSG2.
+ */
+#define LOAD_MSG(_off) \
+    _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + (_off))), \
+        kByteSwap)
+
+__attribute__((target("sse4.1,ssse3,sha")))
+static void sha1BlocksSha(u4 state[5], const u1* data, size_t blocks)
+{
+    const __m128i kByteSwap =
+        _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd, e0, e1, msg0, msg1, msg2, msg3;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) state), 0x1b);
+    e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+    while (blocks-- != 0) {
+        __m128i savedAbcd = abcd;
+        __m128i savedE = e0;
+
+        /* rounds 0-3 */
+        msg0 = LOAD_MSG(0);
+        e0 = _mm_add_epi32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        /* rounds 4-7 */
+        msg1 = LOAD_MSG(16);
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+        /* rounds 8-11 */
+        msg2 = LOAD_MSG(32);
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        /* rounds 12-15 */
+        msg3 = LOAD_MSG(48);
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        /* rounds 16-19 */
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        /* rounds 20-23 */
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        /* rounds 24-27 */
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        /* rounds 28-31 */
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        /* rounds 32-35 */
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        /* rounds 36-39 */
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        /* rounds 40-43 */
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        /* rounds 44-47 */
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        /* rounds 48-51 */
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        /* rounds 52-55 */
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        /* rounds 56-59 */
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        /* rounds 60-63 */
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        /* rounds 64-67 */
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        /* rounds 68-71 */
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        /* rounds 72-75 */
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+        /* rounds 76-79 */
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+        /* add this block's result to the state */
+        e0 = _mm_sha1nexte_epu32(e0, savedE);
+        abcd = _mm_add_epi32(abcd, savedAbcd);
+        data += 64;
+    }
+
+    _mm_storeu_si128((__m128i*) state, _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = _mm_extract_epi32(e0, 3);
+}
+
+#undef LOAD_MSG
+#endif /*DEX_CHECKSUM_X86*/
+
+u4 dexAdler32(u4 adler, const u1* buf, size_t len)
+{
+#ifdef DEX_CHECKSUM_X86
+    if (len >= 64 && (dexChecksumGetFeatures() & kDexChecksumSsse3) != 0)
+        return adler32Ssse3(adler, buf, len);
+#endif
+    return (u4) adler32(adler, buf, len);
+}
+
+bool dexSha1Blocks(u4 state[5], const u1* data, size_t blocks)
+{
+#ifdef DEX_CHECKSUM_X86
+    if ((dexChecksumGetFeatures() & kDexChecksumSha) != 0) {
+        sha1BlocksSha(state, data, blocks);
+        return true;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Adler-32 and SHA-1 over DEX data, using vector or hash instructions
+ * when the CPU has them.
+ */
+#ifndef LIBDEX_DEXCHECKSUM_H_
+#define LIBDEX_DEXCHECKSUM_H_
+
+#include "DexFile.h"
+
+/*
+ * Instruction set extensions we have code for.
+ */
+enum {
+    kDexChecksumSsse3   = 0x01,     /* x86 SSSE3, for Adler-32 */
+    kDexChecksumSha     = 0x02,     /* x86 SHA extensions, for SHA-1 */
+};
+
+/*
+ * Get the set of extensions in use.  This is everything the CPU supports
+ * (that we have code for) unless dexChecksumSetFeatures() says otherwise.
+ */
+u4 dexChecksumGetFeatures(void);
+
+/*
+ * Only use the extensions in "features" (and supported by the CPU).  This
+ * is for benchmarks and tests; the results don't depend on it.
+ */
+void dexChecksumSetFeatures(u4 features);
+
+/*
+ * Update a running Adler-32 checksum with the bytes in "buf", exactly
+ * like zlib's adler32().  Start with an "adler" of 1.
+ */
+u4 dexAdler32(u4 adler, const u1* buf, size_t len);
+
+/*
+ * Run the SHA-1 compression function over "blocks" 64-byte blocks of
+ * "data".  Returns "false", having done nothing, if the CPU doesn't have
+ * the instructions for it.
+ */
+bool dexSha1Blocks(u4 state[5], const u1* data, size_t blocks);
+
+#endif  // LIBDEX_DEXCHECKSUM_H_
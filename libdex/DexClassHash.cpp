@@ -0,0 +1,492 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Per-class digests, for reusing the results of an earlier dexopt run.
+ *
+ * Everything that goes into a digest is either a fixed-size value or a
+ * NUL-terminated string, so there's no ambiguity about where one item
+ * ends and the next begins.  Indices into the DEX tables only go into the
+ * "insns" digest; everywhere else they're replaced by what they name,
+ * since they shift whenever an unrelated string or class is added.
+ */
+
+#include "DexClassHash.h"
+#include "DexCatch.h"
+#include "DexClass.h"
+#include "InstrUtils.h"
+#include "sha1.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* marks an index that's out of range; the verifier will reject the code */
+static const u4 kBadIndex = 0xfffffffe;
+
+enum {
+    kDeclUnknown = 0,
+    kDeclInProgress,
+    kDeclDone,
+};
+
+struct ClassHashState {
+    const DexFile*  pDexFile;
+    const u1*       pDataLimit;     /* end of the DEX file */
+
+    /* digest of each class's declaration, computed on demand */
+    u1*             declState;      /* kDecl*, by class def index */
+    u1*             declDigest;     /* kSHA1DigestLen per class def */
+
+    /* class def index + 1 of the last class whose deps included this one */
+    u4*             depStamp;
+};
+
+static void hashU4(SHA1_CTX* pCtx, u4 val)
+{
+    u1 buf[4];
+
+    buf[0] = val;
+    buf[1] = val >> 8;
+    buf[2] = val >> 16;
+    buf[3] = val >> 24;
+    SHA1Update(pCtx, buf, sizeof(buf));
+}
+
+static void hashString(SHA1_CTX* pCtx, const char* str)
+{
+    SHA1Update(pCtx, (const unsigned char*) str, strlen(str) + 1);
+}
+
+static const u1* getDeclDigest(ClassHashState* pState, u4 classDefIdx);
+
+/*
+ * Find the class def index for a type descriptor, ignoring any array
+ * dimensions.  Returns kDexNoIndex if the class isn't defined here.
+ */
+static u4 findClassDefIdx(const DexFile* pDexFile, const char* descriptor)
+{
+    while (*descriptor == '[')
+        descriptor++;
+    if (*descriptor != 'L')
+        return kDexNoIndex;
+
+    const DexClassDef* pClassDef = dexFindClass(pDexFile, descriptor);
+    if (pClassDef == NULL)
+        return kDexNoIndex;
+    return dexGetIndexForClassDef(pDexFile, pClassDef);
+}
+
+/*
+ * Hash the descriptor of a type into "pContent".  If "pDeps" is non-NULL
+ * and the type is (an array of) a class defined in this DEX, that class's
+ * declaration goes into "pDeps", once per "stamp".
+ */
+static void hashType(ClassHashState* pState, SHA1_CTX* pContent,
+    SHA1_CTX* pDeps, u4 stamp, u4 typeIdx)
+{
+    const DexFile* pDexFile = pState->pDexFile;
+
+    if (typeIdx >= pDexFile->pHeader->typeIdsSize) {
+        hashU4(pContent, kBadIndex);
+        hashU4(pContent, typeIdx);
+        return;
+    }
+
+    const char* descriptor = dexStringByTypeIdx(pDexFile, typeIdx);
+    hashString(pContent, descriptor);
+    if (pDeps == NULL)
+        return;
+
+    u4 classDefIdx = findClassDefIdx(pDexFile, descriptor);
+    if (classDefIdx == kDexNoIndex || pState->depStamp[classDefIdx] == stamp)
+        return;
+    pState->depStamp[classDefIdx] = stamp;
+
+    hashString(pDeps, dexStringByTypeIdx(pDexFile,
+        dexGetClassDef(pDexFile, classDefIdx)->classIdx));
+    SHA1Update(pDeps, getDeclDigest(pState, classDefIdx), kSHA1DigestLen);
+}
+
+static void hashProto(ClassHashState* pState, SHA1_CTX* pContent,
+    SHA1_CTX* pDeps, u4 stamp, u4 protoIdx)
+{
+    const DexFile* pDexFile = pState->pDexFile;
+
+    if (protoIdx >= pDexFile->pHeader->protoIdsSize) {
+        hashU4(pContent, kBadIndex);
+        hashU4(pContent, protoIdx);
+        return;
+    }
+
+    const DexProtoId* pProtoId = dexGetProtoId(pDexFile, protoIdx);
+    const DexTypeList* pParams = dexGetProtoParameters(pDexFile, pProtoId);
+    u4 count = (pParams != NULL) ? pParams->size : 0;
+
+    hashType(pState, pContent, pDeps, stamp, pProtoId->returnTypeIdx);
+    hashU4(pContent, count);
+    for (u4 i = 0; i < count; i++) {
+        hashType(pState, pContent, pDeps, stamp,
+            dexTypeListGetIdx(pParams, i));
+    }
+}
+
+static void hashFieldRef(ClassHashState* pState, SHA1_CTX* pContent,
+    SHA1_CTX* pDeps, u4 stamp, u4 fieldIdx)
+{
+    const DexFile* pDexFile = pState->pDexFile;
+
+    if (fieldIdx >= pDexFile->pHeader->fieldIdsSize) {
+        hashU4(pContent, kBadIndex);
+        hashU4(pContent, fieldIdx);
+        return;
+    }
+
+    const DexFieldId* pFieldId = dexGetFieldId(pDexFile, fieldIdx);
+    hashType(pState, pContent, pDeps, stamp, pFieldId->classIdx);
+    hashString(pContent, dexStringById(pDexFile, pFieldId->nameIdx));
+    hashType(pState, pContent, pDeps, stamp, pFieldId->typeIdx);
+}
+
+static void hashMethodRef(ClassHashState* pState, SHA1_CTX* pContent,
+    SHA1_CTX* pDeps, u4 stamp, u4 methodIdx)
+{
+    const DexFile* pDexFile = pState->pDexFile;
+
+    if (methodIdx >= pDexFile->pHeader->methodIdsSize) {
+        hashU4(pContent, kBadIndex);
+        hashU4(pContent, methodIdx);
+        return;
+    }
+
+    const DexMethodId* pMethodId = dexGetMethodId(pDexFile, methodIdx);
+    hashType(pState, pContent, pDeps, stamp, pMethodId->classIdx);
+    hashString(pContent, dexStringById(pDexFile, pMethodId->nameIdx));
+    hashProto(pState, pContent, pDeps, stamp, pMethodId->protoIdx);
+}
+
+/*
+ * Hash the code of a method.  The instructions go into "pContent" with
+ * their indices replaced by what they name, and into "pInsns" as-is.
+ */
+static void hashCode(ClassHashState* pState, SHA1_CTX* pContent,
+    SHA1_CTX* pInsns, SHA1_CTX* pDeps, u4 stamp, const DexCode* pCode)
+{
+    const DexFile* pDexFile = pState->pDexFile;
+    u4 insnsSize = pCode->insnsSize;
+    u4 i;
+
+    hashU4(pContent, pCode->registersSize);
+    hashU4(pContent, pCode->insSize);
+    hashU4(pContent, pCode->outsSize);
+    hashU4(pContent, pCode->triesSize);
+    hashU4(pContent, insnsSize);
+    hashU4(pInsns, insnsSize);
+    SHA1Update(pInsns, (const unsigned char*) pCode->insns,
+        insnsSize * sizeof(u2));
+
+    for (i = 0; i < insnsSize; /**/) {
+        const u2* insns = pCode->insns + i;
+        size_t width = dexGetWidthFromInstruction(insns);
+        if (width == 0 || width > insnsSize - i) {
+            /* the verifier will reject this; just take the rest as-is */
+            SHA1Update(pContent, (const unsigned char*) insns,
+                (insnsSize - i) * sizeof(u2));
+            break;
+        }
+        i += width;
+
+        /* switch and array payloads don't refer to anything */
+        Opcode opcode = dexOpcodeFromCodeUnit(*insns);
+        InstructionIndexType indexType = dexGetIndexTypeFromOpcode(opcode);
+        if (opcode == OP_NOP || indexType == kIndexNone ||
+            indexType == kIndexUnknown)
+        {
+            SHA1Update(pContent, (const unsigned char*) insns,
+                width * sizeof(u2));
+            continue;
+        }
+
+        /* the index is always in the second code unit (and the third) */
+        u2 units[5];
+        DecodedInstruction decInsn;
+        u4 index;
+
+        assert(width <= sizeof(units) / sizeof(units[0]));
+        memcpy(units, insns, width * sizeof(u2));
+        dexDecodeInstruction(insns, &decInsn);
+        switch (dexGetFormatFromOpcode(opcode)) {
+        case kFmt22c:
+            index = decInsn.vC;
+            units[1] = 0;
+            break;
+        case kFmt31c:
+            index = decInsn.vB;
+            units[1] = units[2] = 0;
+            break;
+        default:
+            index = decInsn.vB;
+            units[1] = 0;
+            break;
+        }
+        SHA1Update(pContent, (const unsigned char*) units,
+            width * sizeof(u2));
+
+        switch (indexType) {
+        case kIndexStringRef:
+            if (index < pDexFile->pHeader->stringIdsSize) {
+                hashString(pContent, dexStringById(pDexFile, index));
+            } else {
+                hashU4(pContent, kBadIndex);
+                hashU4(pContent, index);
+            }
+            break;
+        case kIndexTypeRef:
+            hashType(pState, pContent, pDeps, stamp, index);
+            break;
+        case kIndexFieldRef:
+            hashFieldRef(pState, pContent, pDeps, stamp, index);
+            break;
+        case kIndexMethodRef:
+            hashMethodRef(pState, pContent, pDeps, stamp, index);
+            break;
+        default:
+            /* optimized forms; not present in an unoptimized DEX */
+            hashU4(pContent, index);
+            break;
+        }
+    }
+
+    const DexTry* pTries = dexGetTries(pCode);
+    for (i = 0; i < pCode->triesSize; i++) {
+        DexCatchIterator iterator;
+
+        hashU4(pContent, pTries[i].startAddr);
+        hashU4(pContent, pTries[i].insnCount);
+        dexCatchIteratorInit(&iterator, pCode, pTries[i].handlerOff);
+        while (true) {
+            DexCatchHandler* pHandler = dexCatchIteratorNext(&iterator);
+            if (pHandler == NULL)
+                break;
+            if (pHandler->typeIdx == kDexNoIndex)
+                hashU4(pContent, kDexNoIndex);
+            else
+                hashType(pState, pContent, pDeps, stamp, pHandler->typeIdx);
+            hashU4(pContent, pHandler->address);
+        }
+        hashU4(pContent, kDexNoIndex);      /* end of handlers */
+    }
+}
+
+/*
+ * Hash the fields and methods declared in a class, and the code of the
+ * methods if "pInsns" is non-NULL.  For a declaration digest, pass NULL
+ * for "pInsns" and "pDeps".
+ */
+static bool hashClassData(ClassHashState* pState, SHA1_CTX* pContent,
+    SHA1_CTX* pInsns, SHA1_CTX* pDeps, u4 stamp,
+    const DexClassDef* pClassDef)
+{
+    const DexFile* pDexFile = pState->pDexFile;
+    const u1* pEncodedData = dexGetClassData(pDexFile, pClassDef);
+    DexClassData* pClassData =
+        dexReadAndVerifyClassData(&pEncodedData, pState->pDataLimit);
+    u4 i;
+
+    if (pClassData == NULL)
+        return false;
+
+    const DexClassDataHeader* pHeader = &pClassData->header;
+    hashU4(pContent, pHeader->staticFieldsSize);
+    for (i = 0; i < pHeader->staticFieldsSize; i++) {
+        hashFieldRef(pState, pContent, pDeps, stamp,
+            pClassData->staticFields[i].fieldIdx);
+        hashU4(pContent, pClassData->staticFields[i].accessFlags);
+    }
+    hashU4(pContent, pHeader->instanceFieldsSize);
+    for (i = 0; i < pHeader->instanceFieldsSize; i++) {
+        hashFieldRef(pState, pContent, pDeps, stamp,
+            pClassData->instanceFields[i].fieldIdx);
+        hashU4(pContent, pClassData->instanceFields[i].accessFlags);
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        const DexMethod* pMethods = (pass == 0) ?
+            pClassData->directMethods : pClassData->virtualMethods;
+        u4 count = (pass == 0) ?
+            pHeader->directMethodsSize : pHeader->virtualMethodsSize;
+
+        hashU4(pContent, count);
+        for (i = 0; i < count; i++) {
+            hashMethodRef(pState, pContent, pDeps, stamp,
+                pMethods[i].methodIdx);
+            hashU4(pContent, pMethods[i].accessFlags);
+            if (pInsns != NULL) {
+                const DexCode* pCode = dexGetCode(pDexFile, &pMethods[i]);
+                if (pCode == NULL) {
+                    hashU4(pContent, 0);
+                    hashU4(pInsns, 0);
+                } else {
+                    hashCode(pState, pContent, pInsns, pDeps, stamp, pCode);
+                }
+            }
+        }
+    }
+
+    free(pClassData);
+    return true;
+}
+
+/*
+ * Hash a superclass or interface of a declaration: its name, and its own
+ * declaration if it's defined here.
+ */
+static void hashDeclSuper(ClassHashState* pState, SHA1_CTX* pCtx, u4 typeIdx)
+{
+    hashType(pState, pCtx, NULL, 0, typeIdx);
+    if (typeIdx < pState->pDexFile->pHeader->typeIdsSize) {
+        u4 classDefIdx = findClassDefIdx(pState->pDexFile,
+            dexStringByTypeIdx(pState->pDexFile, typeIdx));
+        if (classDefIdx != kDexNoIndex) {
+            SHA1Update(pCtx, getDeclDigest(pState, classDefIdx),
+                kSHA1DigestLen);
+        }
+    }
+}
+
+/*
+ * Get the digest of what other classes can see of a class: how it's
+ * laid out, what it inherits, and what can be called on it.  This is
+ * what verifying or optimizing a class that uses it depends on.
+ */
+static const u1* getDeclDigest(ClassHashState* pState, u4 classDefIdx)
+{
+    const DexFile* pDexFile = pState->pDexFile;
+    u1* digest = pState->declDigest + classDefIdx * kSHA1DigestLen;
+
+    /*
+     * A class that is its own superclass won't load; the all-zero
+     * digest we return while it's in progress is as good as any.
+     */
+    if (pState->declState[classDefIdx] != kDeclUnknown)
+        return digest;
+    pState->declState[classDefIdx] = kDeclInProgress;
+
+    const DexClassDef* pClassDef = dexGetClassDef(pDexFile, classDefIdx);
+    SHA1_CTX ctx;
+    SHA1Init(&ctx);
+
+    hashString(&ctx, dexStringByTypeIdx(pDexFile, pClassDef->classIdx));
+    hashU4(&ctx, pClassDef->accessFlags);
+    if (pClassDef->superclassIdx == kDexNoIndex)
+        hashU4(&ctx, kDexNoIndex);
+    else
+        hashDeclSuper(pState, &ctx, pClassDef->superclassIdx);
+
+    const DexTypeList* pInterfaces = dexGetInterfacesList(pDexFile, pClassDef);
+    u4 count = (pInterfaces != NULL) ? pInterfaces->size : 0;
+    hashU4(&ctx, count);
+    for (u4 i = 0; i < count; i++)
+        hashDeclSuper(pState, &ctx, dexTypeListGetIdx(pInterfaces, i));
+
+    if (!hashClassData(pState, &ctx, NULL, NULL, 0, pClassDef))
+        hashU4(&ctx, kBadIndex);
+
+    SHA1Final(digest, &ctx);
+    pState->declState[classDefIdx] = kDeclDone;
+    return digest;
+}
+
+/*
+ * Compute the digests of every class def in an unoptimized DEX file.
+ */
+DexClassHashes* dexComputeClassHashes(const DexFile* pDexFile, u4 options)
+{
+    u4 count = pDexFile->pHeader->classDefsSize;
+    size_t size = offsetof(DexClassHashes, entries) +
+        count * sizeof(DexClassHashEntry);
+    DexClassHashes* pHashes = NULL;
+    ClassHashState state;
+    u4 idx;
+
+    assert(pDexFile->pClassLookup != NULL);
+
+    memset(&state, 0, sizeof(state));
+    state.pDexFile = pDexFile;
+    state.pDataLimit = pDexFile->baseAddr + pDexFile->pHeader->fileSize;
+    state.declState = (u1*) calloc(count + 1, 1);
+    state.declDigest = (u1*) calloc(count + 1, kSHA1DigestLen);
+    state.depStamp = (u4*) calloc(count + 1, sizeof(u4));
+    pHashes = (DexClassHashes*) calloc(1, size);
+    if (state.declState == NULL || state.declDigest == NULL ||
+        state.depStamp == NULL || pHashes == NULL)
+    {
+        goto fail;
+    }
+
+    pHashes->size = size;
+    pHashes->options = options;
+    pHashes->numEntries = count;
+
+    for (idx = 0; idx < count; idx++) {
+        const DexClassDef* pClassDef = dexGetClassDef(pDexFile, idx);
+        DexClassHashEntry* pEntry = &pHashes->entries[idx];
+        u4 stamp = idx + 1;
+        SHA1_CTX content, insns, deps;
+
+        SHA1Init(&content);
+        SHA1Init(&insns);
+        SHA1Init(&deps);
+
+        hashType(&state, &content, &deps, stamp, pClassDef->classIdx);
+        hashU4(&content, pClassDef->accessFlags);
+        if (pClassDef->superclassIdx == kDexNoIndex) {
+            hashU4(&content, kDexNoIndex);
+        } else {
+            hashType(&state, &content, &deps, stamp,
+                pClassDef->superclassIdx);
+        }
+
+        const DexTypeList* pInterfaces =
+            dexGetInterfacesList(pDexFile, pClassDef);
+        u4 interfaceCount = (pInterfaces != NULL) ? pInterfaces->size : 0;
+        hashU4(&content, interfaceCount);
+        for (u4 i = 0; i < interfaceCount; i++) {
+            hashType(&state, &content, &deps, stamp,
+                dexTypeListGetIdx(pInterfaces, i));
+        }
+
+        if (!hashClassData(&state, &content, &insns, &deps, stamp,
+                pClassDef))
+            goto fail;
+
+        SHA1Final(pEntry->content, &content);
+        SHA1Final(pEntry->insns, &insns);
+        SHA1Final(pEntry->deps, &deps);
+    }
+
+    free(state.declState);
+    free(state.declDigest);
+    free(state.depStamp);
+    return pHashes;
+
+fail:
+    free(state.declState);
+    free(state.declDigest);
+    free(state.depStamp);
+    free(pHashes);
+    return NULL;
+}
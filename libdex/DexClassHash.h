@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Per-class digests, for reusing the results of an earlier dexopt run.
+ */
+#ifndef LIBDEX_DEXCLASSHASH_H_
+#define LIBDEX_DEXCLASSHASH_H_
+
+#include "DexFile.h"
+
+/*
+ * Compute the digests of every class def in an unoptimized DEX file, in
+ * the format of the kDexChunkClassHashes chunk.  "options" is stored
+ * as-is.  The DEX file must have its class lookup table.
+ *
+ * The content digest covers the class def, the class data and the code
+ * of every method, with each string, type, field and method index
+ * replaced by what it names; two classes with the same content digest
+ * have the same code, up to the numbering of those indices.  The insns
+ * digest covers the instructions of every method exactly as they are.
+ *
+ * The deps digest covers the declarations (names, flags, superclass,
+ * interfaces, fields, methods) of every class in this DEX file that the
+ * class names, and of their superclasses and interfaces in turn.
+ * Classes that aren't defined in this DEX file are only named.
+ *
+ * Returns a newly-allocated table, or NULL on failure.
+ */
+DexClassHashes* dexComputeClassHashes(const DexFile* pDexFile, u4 options);
+
+#endif  // LIBDEX_DEXCLASSHASH_H_
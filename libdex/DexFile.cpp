@@ -19,6 +19,7 @@
  */
 
 #include "DexFile.h"
+#include "DexChecksum.h"
 #include "DexOptData.h"
 #include "DexProto.h"
 #include "DexCatch.h"
@@ -26,8 +27,6 @@
 #include "sha1.h"
 #include "ZipArchive.h"
 
-#include <zlib.h>
-
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
@@ -430,6 +429,7 @@ void dexFileFree(DexFile* pDexFile)
     if (pDexFile == NULL)
         return;
 
+    dexLazyVerifyFree(pDexFile->pLazyVerify);
     free(pDexFile);
 }
 
@@ -481,10 +481,9 @@ u4 dexComputeChecksum(const DexHeader* pHeader)
 {
     const u1* start = (const u1*) pHeader;
 
-    uLong adler = adler32(0L, Z_NULL, 0);
     const int nonSum = sizeof(pHeader->magic) + sizeof(pHeader->checksum);
 
-    return (u4) adler32(adler, start + nonSum, pHeader->fileSize - nonSum);
+    return dexAdler32(1, start + nonSum, pHeader->fileSize - nonSum);
 }
 
 /*
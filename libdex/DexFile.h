@@ -59,9 +59,12 @@
  */
 #define DEX_MAGIC_VERS_API_13  "035\0"
 
-/* same, but for optimized DEX header */
+/*
+ * same, but for optimized DEX header; "037" added the fused
+ * superinstructions and the class hash chunk
+ */
 #define DEX_OPT_MAGIC   "dey\n"
-#define DEX_OPT_MAGIC_VERS  "036\0"
+#define DEX_OPT_MAGIC_VERS  "037\0"
 
 #define DEX_DEP_MAGIC   "deps"
 
@@ -189,6 +192,7 @@ enum {
 enum {
     kDexChunkClassLookup            = 0x434c4b50,   /* CLKP */
     kDexChunkRegisterMaps           = 0x524d4150,   /* RMAP */
+    kDexChunkClassHashes            = 0x43485348,   /* CHSH */
 
     kDexChunkEnd                    = 0x41454e44,   /* AEND */
 };
@@ -463,6 +467,24 @@ struct DexClassLookup {
     } table[1];
 };
 
+/*
+ * Digests of each class, recorded by dexopt so that a later run on a new
+ * version of the DEX file can reuse the results for classes that didn't
+ * change.  Entries are in class def order.  See libdex/DexClassHash.h.
+ */
+struct DexClassHashEntry {
+    u1      content[kSHA1DigestLen];    // the class and everything it names
+    u1      insns[kSHA1DigestLen];      // its instructions, indices and all
+    u1      deps[kSHA1DigestLen];       // other classes it uses from this DEX
+};
+
+struct DexClassHashes {
+    u4      size;                       // total size, including "size"
+    u4      options;                    // dexopt settings; opaque to libdex
+    u4      numEntries;                 // same as classDefsSize
+    DexClassHashEntry entries[1];
+};
+
 /*
  * Header added by DEX optimization pass.  Values are always written in
  * local byte and structure padding.  The first field (magic + version)
@@ -491,6 +513,9 @@ struct DexOptHeader {
 
 #define DEX_INTERFACE_CACHE_SIZE    128     /* must be power of 2 */
 
+/* opaque; state for dexSwapAndVerifyLazily() */
+struct DexLazyVerify;
+
 /*
  * Structure representing a DEX file.
  *
@@ -517,10 +542,14 @@ struct DexFile {
      */
     const DexClassLookup* pClassLookup;
     const void*         pRegisterMapPool;       // RegisterMapClassPool
+    const DexClassHashes* pClassHashes;
 
     /* points to start of DEX file data */
     const u1*           baseAddr;
 
+    /* checks still to be done, if the file is being verified lazily */
+    DexLazyVerify*      pLazyVerify;
+
     /* track memory overhead for auxillary structures */
     int                 overhead;
 
@@ -556,6 +585,37 @@ enum {
  */
 int dexSwapAndVerify(u1* addr, int len);
 
+/*
+ * Like dexSwapAndVerify(), but leave the class data, code and annotation
+ * sections, which are most of the file, to be checked a class at a time
+ * by dexVerifyClassLazily() as the classes are used.  The rest of the
+ * file is checked now.  On success, "*ppLazy" is set to what's needed
+ * for the deferred checks, which the caller must store in the DexFile's
+ * "pLazyVerify"; it may be NULL, in which case everything was checked.
+ *
+ * Only for DEX data that is used in this process and then thrown away;
+ * nothing else would know to check the rest.
+ *
+ * Return 0 on success.
+ */
+int dexSwapAndVerifyLazily(u1* addr, int len, DexLazyVerify** ppLazy);
+
+/*
+ * If "pDexFile" is being verified lazily, check the class data, code and
+ * annotations of "pClassDef" (and anything they refer to) that haven't
+ * been checked yet.  Each item is only checked once, however many
+ * classes share it.  Thread-safe.
+ *
+ * Returns "false" if the class is malformed and must not be used.
+ */
+bool dexVerifyClassLazily(const DexFile* pDexFile,
+    const DexClassDef* pClassDef);
+
+/*
+ * Free the state returned by dexSwapAndVerifyLazily().
+ */
+void dexLazyVerifyFree(DexLazyVerify* pLazy);
+
 /*
  * Detect the file type of the given memory buffer via magic number.
  * Call dexSwapAndVerify() on an unoptimized DEX file, do nothing
@@ -92,12 +92,12 @@ static const char* gOpNames[kNumPackedOpcodes] = {
     "if-gez",
     "if-gtz",
     "if-lez",
-    "unused-3e",
-    "unused-3f",
-    "unused-40",
-    "unused-41",
-    "unused-42",
-    "unused-43",
+    "+iget-quick-if-eqz",
+    "+iget-quick-if-nez",
+    "+const/4-if",
+    "+move-result-return",
+    "+move-result-wide-return",
+    "+move-result-object-return",
     "aget",
     "aget-wide",
     "aget-object",
@@ -145,7 +145,7 @@ static const char* gOpNames[kNumPackedOpcodes] = {
     "invoke-direct",
     "invoke-static",
     "invoke-interface",
-    "unused-73",
+    "+aget-add-int",
     "invoke-virtual/range",
     "invoke-super/range",
     "invoke-direct/range",
@@ -130,12 +130,12 @@ enum Opcode {
     OP_IF_GEZ                       = 0x3b,
     OP_IF_GTZ                       = 0x3c,
     OP_IF_LEZ                       = 0x3d,
-    OP_UNUSED_3E                    = 0x3e,
-    OP_UNUSED_3F                    = 0x3f,
-    OP_UNUSED_40                    = 0x40,
-    OP_UNUSED_41                    = 0x41,
-    OP_UNUSED_42                    = 0x42,
-    OP_UNUSED_43                    = 0x43,
+    OP_IGET_QUICK_IF_EQZ            = 0x3e,
+    OP_IGET_QUICK_IF_NEZ            = 0x3f,
+    OP_CONST_4_IF                   = 0x40,
+    OP_MOVE_RESULT_RETURN           = 0x41,
+    OP_MOVE_RESULT_WIDE_RETURN      = 0x42,
+    OP_MOVE_RESULT_OBJECT_RETURN    = 0x43,
     OP_AGET                         = 0x44,
     OP_AGET_WIDE                    = 0x45,
     OP_AGET_OBJECT                  = 0x46,
@@ -183,7 +183,7 @@ enum Opcode {
     OP_INVOKE_DIRECT                = 0x70,
     OP_INVOKE_STATIC                = 0x71,
     OP_INVOKE_INTERFACE             = 0x72,
-    OP_UNUSED_73                    = 0x73,
+    OP_AGET_ADD_INT                 = 0x73,
     OP_INVOKE_VIRTUAL_RANGE         = 0x74,
     OP_INVOKE_SUPER_RANGE           = 0x75,
     OP_INVOKE_DIRECT_RANGE          = 0x76,
@@ -328,11 +328,21 @@ enum Opcode {
 };
 
 /*
- * Macro used to generate a computed goto table for use in implementing
- * an interpreter in C.
+ * Macros used to generate a computed goto table for use in implementing
+ * an interpreter in C.  Each entry is H(<opcode>).
+ *
+ * DEFINE_GOTO_TABLE holds handler addresses.  DEFINE_GOTO_OFFSET_TABLE
+ * holds ints, for an H() that yields the distance of each handler from a
+ * base label: such a table needs no load-time relocations in
+ * position-independent code, and is half the size on 64-bit hosts.
  */
 #define DEFINE_GOTO_TABLE(_name) \
-    static const void* _name[kNumPackedOpcodes] = {                      \
+    static const void* _name[kNumPackedOpcodes] = { GOTO_TABLE_ENTRIES };
+
+#define DEFINE_GOTO_OFFSET_TABLE(_name) \
+    static const int _name[kNumPackedOpcodes] = { GOTO_TABLE_ENTRIES };
+
+#define GOTO_TABLE_ENTRIES \
         /* BEGIN(libdex-goto-table); GENERATED AUTOMATICALLY BY opcode-gen */ \
         H(OP_NOP),                                                            \
         H(OP_MOVE),                                                           \
@@ -396,12 +406,12 @@ enum Opcode {
         H(OP_IF_GEZ),                                                         \
         H(OP_IF_GTZ),                                                         \
         H(OP_IF_LEZ),                                                         \
-        H(OP_UNUSED_3E),                                                      \
-        H(OP_UNUSED_3F),                                                      \
-        H(OP_UNUSED_40),                                                      \
-        H(OP_UNUSED_41),                                                      \
-        H(OP_UNUSED_42),                                                      \
-        H(OP_UNUSED_43),                                                      \
+        H(OP_IGET_QUICK_IF_EQZ),                                              \
+        H(OP_IGET_QUICK_IF_NEZ),                                              \
+        H(OP_CONST_4_IF),                                                     \
+        H(OP_MOVE_RESULT_RETURN),                                             \
+        H(OP_MOVE_RESULT_WIDE_RETURN),                                        \
+        H(OP_MOVE_RESULT_OBJECT_RETURN),                                      \
         H(OP_AGET),                                                           \
         H(OP_AGET_WIDE),                                                      \
         H(OP_AGET_OBJECT),                                                    \
@@ -449,7 +459,7 @@ enum Opcode {
         H(OP_INVOKE_DIRECT),                                                  \
         H(OP_INVOKE_STATIC),                                                  \
         H(OP_INVOKE_INTERFACE),                                               \
-        H(OP_UNUSED_73),                                                      \
+        H(OP_AGET_ADD_INT),                                                   \
         H(OP_INVOKE_VIRTUAL_RANGE),                                           \
         H(OP_INVOKE_SUPER_RANGE),                                             \
         H(OP_INVOKE_DIRECT_RANGE),                                            \
@@ -590,8 +600,7 @@ enum Opcode {
         H(OP_SGET_OBJECT_VOLATILE),                                           \
         H(OP_SPUT_OBJECT_VOLATILE),                                           \
         H(OP_UNUSED_FF),                                                      \
-        /* END(libdex-goto-table) */                                          \
-    };
+        /* END(libdex-goto-table) */
 
 /*
  * Return the Opcode for a given raw opcode code unit (which may
@@ -616,6 +625,44 @@ DEX_INLINE Opcode dexOpcodeFromCodeUnit(u2 codeUnit) {
     }
 }
 
+/*
+ * Superinstructions.  dexopt fuses some common instruction pairs by
+ * rewriting the opcode of the first instruction of the pair.  Its operands
+ * and the second instruction are left as they were, so everything but the
+ * interpreters can handle a fused opcode as the opcode it replaced.
+ */
+DEX_INLINE Opcode dexGetUnfusedOpcode(Opcode opcode) {
+    switch (opcode) {
+    case OP_IGET_QUICK_IF_EQZ:
+    case OP_IGET_QUICK_IF_NEZ:
+        return OP_IGET_QUICK;
+    case OP_CONST_4_IF:
+        return OP_CONST_4;
+    case OP_MOVE_RESULT_RETURN:
+        return OP_MOVE_RESULT;
+    case OP_MOVE_RESULT_WIDE_RETURN:
+        return OP_MOVE_RESULT_WIDE;
+    case OP_MOVE_RESULT_OBJECT_RETURN:
+        return OP_MOVE_RESULT_OBJECT;
+    case OP_AGET_ADD_INT:
+        return OP_AGET;
+    default:
+        return opcode;
+    }
+}
+
+/*
+ * Return the first code unit of an instruction with a fused opcode replaced
+ * by the opcode it was fused from.
+ */
+DEX_INLINE u2 dexUnfuseCodeUnit(u2 codeUnit) {
+    Opcode opcode = dexOpcodeFromCodeUnit(codeUnit);
+    Opcode unfused = dexGetUnfusedOpcode(opcode);
+    if (unfused == opcode)
+        return codeUnit;
+    return (codeUnit & 0xff00) | (u2) unfused;
+}
+
 /*
  * Return the name of an opcode.
  */
@@ -19,9 +19,8 @@
  * to optimized .dex files.
  */
 
-#include <zlib.h>
-
 #include "DexOptData.h"
+#include "DexChecksum.h"
 
 /*
  * Check to see if a given data pointer is a valid double-word-aligned
@@ -40,9 +39,7 @@ u4 dexComputeOptChecksum(const DexOptHeader* pOptHeader)
     const u1* end = (const u1*) pOptHeader +
         pOptHeader->optOffset + pOptHeader->optLength;
 
-    uLong adler = adler32(0L, Z_NULL, 0);
-
-    return (u4) adler32(adler, start, end - start);
+    return dexAdler32(1, start, end - start);
 }
 
 /* (documented in header file) */
@@ -112,6 +109,10 @@ bool dexParseOptData(const u1* data, size_t length, DexFile* pDexFile)
             ALOGV("+++ found register maps, size=%u", size);
             pDexFile->pRegisterMapPool = pOptData;
             break;
+        case kDexChunkClassHashes:
+            ALOGV("+++ found class hashes, size=%u", size);
+            pDexFile->pClassHashes = (const DexClassHashes*) pOptData;
+            break;
         default:
             ALOGI("Unknown chunk 0x%08x (%c%c%c%c), size=%d in opt data area",
                 *pOpt,
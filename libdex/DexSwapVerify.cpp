@@ -19,6 +19,7 @@
  */
 
 #include "DexFile.h"
+#include "DexChecksum.h"
 #include "DexClass.h"
 #include "DexDataMap.h"
 #include "DexProto.h"
@@ -26,8 +27,8 @@
 #include "Leb128.h"
 
 #include <safe_iop.h>
-#include <zlib.h>
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -84,6 +85,50 @@ struct CheckState {
     u4*               pDefinedClassBits;
 
     const void*       previousItem; // set during section iteration
+
+    DexLazyVerify*    pLazy;        // non-NULL if some checks are deferred
+};
+
+/*
+ * The sections whose items dexSwapAndVerifyLazily() leaves for later.
+ * These are the bulk of a DEX file, and each item in them belongs to
+ * (or is only reachable from) one or more classes.
+ */
+enum {
+    kLazyClassData = 0,
+    kLazyCode,
+    kLazyAnnotationSetRefList,
+    kLazyAnnotationSet,
+    kLazyAnnotation,
+    kLazyAnnotationsDirectory,
+    kLazySectionCount
+};
+
+/*
+ * One deferred section, with a bit for each place an item could start
+ * (every byte or every word, depending on the item alignment).  A bit
+ * is set once the item there has been checked.
+ */
+struct LazySection {
+    u4      start;          // file offset of the section
+    u4      end;            // offset of whatever follows it
+    u4      shift;          // log2 of the item alignment
+    u4*     verifiedBits;
+};
+
+/*
+ * What's left to check in a DEX file that is being verified lazily.
+ */
+struct DexLazyVerify {
+    /* held while checking, since class loading happens on many threads */
+    pthread_mutex_t lock;
+
+    u4          fileLen;
+
+    /* one bit per class_def, set once everything it refers to is checked */
+    u4*         classDefBits;
+
+    LazySection sections[kLazySectionCount];
 };
 
 /*
@@ -100,6 +145,34 @@ static inline void* filePointer(const CheckState* state, u4 offset) {
     return (void*) (state->fileStart + offset);
 }
 
+/* defined below */
+static bool lazyVerifyItem(const CheckState* state, u4 offset, u2 type);
+
+/*
+ * Verify that "offset" is that of an item of the given type.  Normally
+ * that means finding it in the data map, but if the item's section is
+ * being verified lazily it means checking the item now (if it hasn't
+ * been already), since it isn't in the map.
+ */
+static bool verifyItemRef(const CheckState* state, u4 offset, u2 type) {
+    if (state->pLazy != NULL) {
+        return lazyVerifyItem(state, offset, type);
+    }
+
+    return dexDataMapVerify(state->pDataMap, offset, type);
+}
+
+/*
+ * Like verifyItemRef(), but also accept a 0 offset as valid.
+ */
+static bool verifyItemRef0Ok(const CheckState* state, u4 offset, u2 type) {
+    if (offset == 0) {
+        return true;
+    }
+
+    return verifyItemRef(state, offset, type);
+}
+
 /*
  * Verify that a pointer range, start inclusive to end exclusive, only
  * covers bytes in the file and doesn't point beyond the end of the
@@ -964,6 +1037,35 @@ static bool verifyAnnotationsDirectoryIsForDef(const CheckState* state,
     return (annoDefiner == definerIdx) || (annoDefiner == kDexNoIndex);
 }
 
+/* Helper for crossVerifyClassDefItem() and dexVerifyClassLazily(), which
+ * checks the class_data_item and annotations_directory_item of a
+ * class_def_item. */
+static bool verifyClassDefData(const CheckState* state,
+        const DexClassDef* item) {
+    bool okay =
+        verifyItemRef0Ok(state,
+                item->annotationsOff, kDexTypeAnnotationsDirectoryItem)
+        && verifyItemRef0Ok(state,
+                item->classDataOff, kDexTypeClassDataItem);
+
+    if (!okay) {
+        return false;
+    }
+
+    if (!verifyClassDataIsForDef(state, item->classDataOff, item->classIdx)) {
+        ALOGE("Invalid class_data_item");
+        return false;
+    }
+
+    if (!verifyAnnotationsDirectoryIsForDef(state, item->annotationsOff,
+                    item->classIdx)) {
+        ALOGE("Invalid annotations_directory_item");
+        return false;
+    }
+
+    return true;
+}
+
 /* Perform cross-item verification of class_def_item. */
 static void* crossVerifyClassDefItem(const CheckState* state, void* ptr) {
     const DexClassDef* item = (const DexClassDef*) ptr;
@@ -983,10 +1085,6 @@ static void* crossVerifyClassDefItem(const CheckState* state, void* ptr) {
     bool okay =
         dexDataMapVerify0Ok(state->pDataMap,
                 item->interfacesOff, kDexTypeTypeList)
-        && dexDataMapVerify0Ok(state->pDataMap,
-                item->annotationsOff, kDexTypeAnnotationsDirectoryItem)
-        && dexDataMapVerify0Ok(state->pDataMap,
-                item->classDataOff, kDexTypeClassDataItem)
         && dexDataMapVerify0Ok(state->pDataMap,
                 item->staticValuesOff, kDexTypeEncodedArrayItem);
 
@@ -1042,14 +1140,8 @@ static void* crossVerifyClassDefItem(const CheckState* state, void* ptr) {
         }
     }
 
-    if (!verifyClassDataIsForDef(state, item->classDataOff, item->classIdx)) {
-        ALOGE("Invalid class_data_item");
-        return NULL;
-    }
-
-    if (!verifyAnnotationsDirectoryIsForDef(state, item->annotationsOff,
-                    item->classIdx)) {
-        ALOGE("Invalid annotations_directory_item");
+    /* when verifying lazily, this part waits until the class is loaded */
+    if (state->pLazy == NULL && !verifyClassDefData(state, item)) {
         return NULL;
     }
 
@@ -1191,7 +1283,7 @@ static const u1* crossVerifyFieldAnnotations(const CheckState* state, u4 count,
         if (!verifyFieldDefiner(state, definingClass, item->fieldIdx)) {
             return NULL;
         }
-        if (!dexDataMapVerify(state->pDataMap, item->annotationsOff,
+        if (!verifyItemRef(state, item->annotationsOff,
                         kDexTypeAnnotationSetItem)) {
             return NULL;
         }
@@ -1211,7 +1303,7 @@ static const u1* crossVerifyMethodAnnotations(const CheckState* state,
         if (!verifyMethodDefiner(state, definingClass, item->methodIdx)) {
             return NULL;
         }
-        if (!dexDataMapVerify(state->pDataMap, item->annotationsOff,
+        if (!verifyItemRef(state, item->annotationsOff,
                         kDexTypeAnnotationSetItem)) {
             return NULL;
         }
@@ -1232,7 +1324,7 @@ static const u1* crossVerifyParameterAnnotations(const CheckState* state,
         if (!verifyMethodDefiner(state, definingClass, item->methodIdx)) {
             return NULL;
         }
-        if (!dexDataMapVerify(state->pDataMap, item->annotationsOff,
+        if (!verifyItemRef(state, item->annotationsOff,
                         kDexTypeAnnotationSetRefList)) {
             return NULL;
         }
@@ -1280,7 +1372,7 @@ static void* crossVerifyAnnotationsDirectoryItem(const CheckState* state,
     const DexAnnotationsDirectoryItem* item = (const DexAnnotationsDirectoryItem*) ptr;
     u4 definingClass = findFirstAnnotationsDirectoryDefiner(state, item);
 
-    if (!dexDataMapVerify0Ok(state->pDataMap,
+    if (!verifyItemRef0Ok(state,
                     item->classAnnotationsOff, kDexTypeAnnotationSetItem)) {
         return NULL;
     }
@@ -1364,7 +1456,7 @@ static void* crossVerifyAnnotationSetRefList(const CheckState* state,
     int count = list->size;
 
     while (count--) {
-        if (!dexDataMapVerify0Ok(state->pDataMap,
+        if (!verifyItemRef0Ok(state,
                         item->annotationsOff, kDexTypeAnnotationSetItem)) {
             return NULL;
         }
@@ -1411,7 +1503,7 @@ static void* crossVerifyAnnotationSetItem(const CheckState* state, void* ptr) {
     int i;
 
     for (i = 0; i < count; i++) {
-        if (!dexDataMapVerify0Ok(state->pDataMap,
+        if (!verifyItemRef0Ok(state,
                         dexGetAnnotationOff(set, i), kDexTypeAnnotationItem)) {
             return NULL;
         }
@@ -1620,16 +1712,14 @@ static void* crossVerifyClassDataItem(const CheckState* state, void* ptr) {
     for (i = classData->header.directMethodsSize; okay && (i > 0); /*i*/) {
         i--;
         const DexMethod* meth = &classData->directMethods[i];
-        okay = dexDataMapVerify0Ok(state->pDataMap, meth->codeOff,
-                kDexTypeCodeItem)
+        okay = verifyItemRef0Ok(state, meth->codeOff, kDexTypeCodeItem)
             && verifyMethodDefiner(state, definingClass, meth->methodIdx);
     }
 
     for (i = classData->header.virtualMethodsSize; okay && (i > 0); /*i*/) {
         i--;
         const DexMethod* meth = &classData->virtualMethods[i];
-        okay = dexDataMapVerify0Ok(state->pDataMap, meth->codeOff,
-                kDexTypeCodeItem)
+        okay = verifyItemRef0Ok(state, meth->codeOff, kDexTypeCodeItem)
             && verifyMethodDefiner(state, definingClass, meth->methodIdx);
     }
 
@@ -2501,6 +2591,60 @@ static bool iterateDataSection(CheckState* state, u4 offset, u4 count,
     return true;
 }
 
+/*
+ * Get the index into DexLazyVerify.sections of the given map type, or
+ * -1 if items of that type are always verified up front.
+ */
+static int lazySectionIndex(int mapType) {
+    switch (mapType) {
+        case kDexTypeClassDataItem:            return kLazyClassData;
+        case kDexTypeCodeItem:                 return kLazyCode;
+        case kDexTypeAnnotationSetRefList:     return kLazyAnnotationSetRefList;
+        case kDexTypeAnnotationSetItem:        return kLazyAnnotationSet;
+        case kDexTypeAnnotationItem:           return kLazyAnnotation;
+        case kDexTypeAnnotationsDirectoryItem: return kLazyAnnotationsDirectory;
+        default:                               return -1;
+    }
+}
+
+/*
+ * Helper for swapEverythingButHeaderAndMap(), which sets up a section
+ * to be verified lazily instead of now. We won't know where the last
+ * item ends until we look at it, so the section is taken to run up to
+ * the next one (or the end of the data).
+ */
+static bool deferSection(CheckState* state, const DexMapItem* item,
+        const DexMapItem* nextItem, u4* endOffset) {
+    u4 dataStart = state->pHeader->dataOff;
+    u4 dataEnd = dataStart + state->pHeader->dataSize;
+    u4 start = item->offset;
+    u4 end = dataEnd;
+
+    if ((start < dataStart) || (start >= dataEnd)) {
+        ALOGE("Bogus offset for data subsection: %#x", start);
+        return false;
+    }
+
+    if ((nextItem != NULL) && (nextItem->offset < dataEnd)) {
+        end = nextItem->offset;
+    }
+
+    LazySection* section =
+        &state->pLazy->sections[lazySectionIndex(item->type)];
+    u4 bitCount = ((end - start) >> section->shift) + 1;
+
+    section->verifiedBits = (u4*) calloc((bitCount + 31) / 32, sizeof(u4));
+    if (section->verifiedBits == NULL) {
+        ALOGE("Unable to allocate lazy verification bits (%#x)", bitCount);
+        return false;
+    }
+
+    section->start = start;
+    section->end = end;
+    *endOffset = end;
+    return true;
+}
+
 /*
  * Byte-swap all items in the given map except the header and the map
  * itself, both of which should have already gotten swapped. This also
@@ -2545,6 +2689,16 @@ static bool swapEverythingButHeaderAndMap(CheckState* state,
             break;
         }
 
+        if ((state->pLazy != NULL) && (lazySectionIndex(type) >= 0)) {
+            okay = deferSection(state, item, (count != 0) ? item + 1 : NULL,
+                    &lastOffset);
+            if (!okay) {
+                ALOGE("Setup of lazy section type %04x failed", type);
+            }
+            item++;
+            continue;
+        }
+
         switch (type) {
             case kDexTypeHeaderItem: {
                 /*
@@ -2694,6 +2848,12 @@ static bool crossVerifyEverything(CheckState* state, DexMapList* pMap)
         u4 sectionOffset = item->offset;
         u4 sectionCount = item->size;
 
+        if ((state->pLazy != NULL) && (lazySectionIndex(item->type) >= 0)) {
+            // These get checked an item at a time, as they're used.
+            item++;
+            continue;
+        }
+
         switch (item->type) {
             case kDexTypeHeaderItem:
             case kDexTypeMapList:
@@ -2781,6 +2941,101 @@ static bool crossVerifyEverything(CheckState* state, DexMapList* pMap)
     return okay;
 }
 
+/*
+ * Check the item of the given type at "offset", which is in a section
+ * being verified lazily, unless that's been done already. The caller
+ * must hold the DexLazyVerify lock.
+ */
+static bool lazyVerifyItem(const CheckState* state, u4 offset, u2 type) {
+    int index = lazySectionIndex(type);
+
+    if (index < 0) {
+        return dexDataMapVerify(state->pDataMap, offset, type);
+    }
+
+    LazySection* section = &state->pLazy->sections[index];
+    u4 alignmentMask = (1 << section->shift) - 1;
+
+    if ((offset < section->start) || (offset >= section->end)
+            || ((offset & alignmentMask) != 0)) {
+        ALOGE("Bogus offset %#x for item of type %04x", offset, type);
+        return false;
+    }
+
+    u4 bit = (offset - section->start) >> section->shift;
+    u4* word = &section->verifiedBits[bit >> 5];
+    u4 mask = 1 << (bit & 0x1f);
+
+    if ((*word & mask) != 0) {
+        return true;
+    }
+
+    ItemVisitorFunction* intraFunc;
+    ItemVisitorFunction* crossFunc = NULL;
+
+    switch (type) {
+        case kDexTypeClassDataItem: {
+            intraFunc = intraVerifyClassDataItem;
+            crossFunc = crossVerifyClassDataItem;
+            break;
+        }
+        case kDexTypeCodeItem: {
+            intraFunc = swapCodeItem;
+            break;
+        }
+        case kDexTypeAnnotationSetRefList: {
+            intraFunc = swapAnnotationSetRefList;
+            crossFunc = crossVerifyAnnotationSetRefList;
+            break;
+        }
+        case kDexTypeAnnotationSetItem: {
+            intraFunc = swapAnnotationSetItem;
+            crossFunc = crossVerifyAnnotationSetItem;
+            break;
+        }
+        case kDexTypeAnnotationItem: {
+            intraFunc = intraVerifyAnnotationItem;
+            break;
+        }
+        case kDexTypeAnnotationsDirectoryItem: {
+            intraFunc = swapAnnotationsDirectoryItem;
+            crossFunc = crossVerifyAnnotationsDirectoryItem;
+            break;
+        }
+        default: {
+            ALOGE("Unknown map item type %04x", type);
+            return false;
+        }
+    }
+
+    void* ptr = filePointer(state, offset);
+    void* end = intraFunc(state, ptr);
+
+    if (end == NULL) {
+        ALOGE("Trouble with item of type %04x @ offset %#x", type, offset);
+        return false;
+    }
+
+    if (fileOffset(state, end) > section->end) {
+        ALOGE("Item of type %04x @ offset %#x ends out of bounds",
+                type, offset);
+        return false;
+    }
+
+    /*
+     * Anything this item refers to gets checked (and marked) along the
+     * way, so mark this one only once all of that has worked out.
+     */
+    if ((crossFunc != NULL) && (crossFunc(state, ptr) == NULL)) {
+        ALOGE("Cross-item verify of type %04x @ offset %#x failed",
+                type, offset);
+        return false;
+    }
+
+    *word |= mask;
+    return true;
+}
+
 /* (documented in header file) */
 bool dexHasValidMagic(const DexHeader* pHeader)
 {
@@ -2808,20 +3063,66 @@ bool dexHasValidMagic(const DexHeader* pHeader)
 }
 
 /*
- * Fix the byte ordering of all fields in the DEX file, and do
- * structural verification. This is only required for code that opens
- * "raw" DEX files, such as the DEX optimizer.
- *
- * Returns 0 on success, nonzero on failure.
+ * Allocate the state for verifying the given DEX file lazily.
  */
-int dexSwapAndVerify(u1* addr, int len)
+static DexLazyVerify* lazyVerifyAlloc(const DexHeader* pHeader, u4 fileLen)
+{
+    DexLazyVerify* pLazy = (DexLazyVerify*) calloc(1, sizeof(DexLazyVerify));
+
+    if (pLazy == NULL) {
+        return NULL;
+    }
+
+    pLazy->classDefBits =
+        (u4*) calloc((pHeader->classDefsSize + 31) / 32, sizeof(u4));
+    if (pLazy->classDefBits == NULL) {
+        free(pLazy);
+        return NULL;
+    }
+
+    pLazy->fileLen = fileLen;
+    pLazy->sections[kLazyClassData].shift = 0;
+    pLazy->sections[kLazyCode].shift = 2;
+    pLazy->sections[kLazyAnnotationSetRefList].shift = 2;
+    pLazy->sections[kLazyAnnotationSet].shift = 2;
+    pLazy->sections[kLazyAnnotation].shift = 0;
+    pLazy->sections[kLazyAnnotationsDirectory].shift = 2;
+    pthread_mutex_init(&pLazy->lock, NULL);
+
+    return pLazy;
+}
+
+/* (documented in header file) */
+void dexLazyVerifyFree(DexLazyVerify* pLazy)
+{
+    int i;
+
+    if (pLazy == NULL) {
+        return;
+    }
+
+    for (i = 0; i < kLazySectionCount; i++) {
+        free(pLazy->sections[i].verifiedBits);
+    }
+
+    pthread_mutex_destroy(&pLazy->lock);
+    free(pLazy->classDefBits);
+    free(pLazy);
+}
+
+/*
+ * Do the work for dexSwapAndVerify() and dexSwapAndVerifyLazily(). If
+ * "ppLazy" is non-NULL, the lazy sections are left for later and the
+ * state for checking them is returned there.
+ */
+static int swapAndVerify(u1* addr, int len, DexLazyVerify** ppLazy)
 {
     DexHeader* pHeader;
     CheckState state;
     bool okay = true;
 
     memset(&state, 0, sizeof(state));
-    ALOGV("+++ swapping and verifying");
+    ALOGV("+++ swapping and verifying%s", (ppLazy != NULL) ? " (lazy)" : "");
 
     /*
      * Note: The caller must have verified that "len" is at least as
@@ -2855,16 +3156,15 @@ int dexSwapAndVerify(u1* addr, int len)
          * This might be a big-endian system, so we need to do this before
          * we byte-swap the header.
          */
-        uLong adler = adler32(0L, Z_NULL, 0);
         const int nonSum = sizeof(pHeader->magic) + sizeof(pHeader->checksum);
         u4 storedFileSize = SWAP4(pHeader->fileSize);
         u4 expectedChecksum = SWAP4(pHeader->checksum);
 
-        adler = adler32(adler, ((const u1*) pHeader) + nonSum,
+        u4 adler = dexAdler32(1, ((const u1*) pHeader) + nonSum,
                     storedFileSize - nonSum);
 
         if (adler != expectedChecksum) {
-            ALOGE("ERROR: bad checksum (%08lx, expected %08x)",
+            ALOGE("ERROR: bad checksum (%08x, expected %08x)",
                 adler, expectedChecksum);
             okay = false;
         }
@@ -2909,6 +3209,15 @@ int dexSwapAndVerify(u1* addr, int len)
             DexMapList* pDexMap = (DexMapList*) (addr + pHeader->mapOff);
 
             okay = okay && swapMap(&state, pDexMap);
+
+            if (okay && (ppLazy != NULL)) {
+                state.pLazy = lazyVerifyAlloc(pHeader, len);
+                if (state.pLazy == NULL) {
+                    ALOGE("ERROR: Unable to allocate lazy verification state");
+                    okay = false;
+                }
+            }
+
             okay = okay && swapEverythingButHeaderAndMap(&state, pDexMap);
 
             dexFileSetupBasicPointers(&dexFile, addr);
@@ -2929,9 +3238,83 @@ int dexSwapAndVerify(u1* addr, int len)
         dexDataMapFree(state.pDataMap);
     }
 
+    if (okay && (ppLazy != NULL)) {
+        *ppLazy = state.pLazy;
+    } else {
+        dexLazyVerifyFree(state.pLazy);
+    }
+
     return !okay;       // 0 == success
 }
 
+/*
+ * Fix the byte ordering of all fields in the DEX file, and do
+ * structural verification. This is only required for code that opens
+ * "raw" DEX files, such as the DEX optimizer.
+ *
+ * Returns 0 on success, nonzero on failure.
+ */
+int dexSwapAndVerify(u1* addr, int len)
+{
+    return swapAndVerify(addr, len, NULL);
+}
+
+/* (documented in header file) */
+int dexSwapAndVerifyLazily(u1* addr, int len, DexLazyVerify** ppLazy)
+{
+    *ppLazy = NULL;
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    return swapAndVerify(addr, len, ppLazy);
+#else
+    /* nothing can be read until it's all been swapped */
+    return swapAndVerify(addr, len, NULL);
+#endif
+}
+
+/* (documented in header file) */
+bool dexVerifyClassLazily(const DexFile* pDexFile,
+        const DexClassDef* pClassDef)
+{
+    DexLazyVerify* pLazy = pDexFile->pLazyVerify;
+
+    if (pLazy == NULL) {
+        return true;
+    }
+
+    u4 idx = pClassDef - pDexFile->pClassDefs;
+    u4* word = &pLazy->classDefBits[idx >> 5];
+    u4 mask = 1 << (idx & 0x1f);
+    CheckState state;
+    bool okay = true;
+
+    assert(idx < pDexFile->pHeader->classDefsSize);
+
+    pthread_mutex_lock(&pLazy->lock);
+
+    if ((*word & mask) == 0) {
+        memset(&state, 0, sizeof(state));
+        state.pHeader = pDexFile->pHeader;
+        state.fileStart = pDexFile->baseAddr;
+        state.fileLen = pLazy->fileLen;
+        state.fileEnd = state.fileStart + state.fileLen;
+        state.pDexFile = pDexFile;
+        state.pLazy = pLazy;
+
+        okay = verifyClassDefData(&state, pClassDef);
+        if (okay) {
+            *word |= mask;
+        } else {
+            ALOGE("ERROR: Lazy verify of class_def %u ('%s') failed", idx,
+                    dexStringByTypeIdx(pDexFile, pClassDef->classIdx));
+        }
+    }
+
+    pthread_mutex_unlock(&pLazy->lock);
+
+    return okay;
+}
+
 /*
  * Detect the file type of the given memory buffer via magic number.
  * Call dexSwapAndVerify() on an unoptimized DEX file, do nothing
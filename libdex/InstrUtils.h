@@ -192,4 +192,15 @@ DEX_INLINE InstructionIndexType dexGetIndexTypeFromOpcode(Opcode opcode)
  */
 void dexDecodeInstruction(const u2* insns, DecodedInstruction* pDec);
 
+/*
+ * Decode the instruction pointed to by "insns", reporting a superinstruction
+ * as the instruction it was fused from.
+ */
+DEX_INLINE void dexDecodeUnfusedInstruction(const u2* insns,
+    DecodedInstruction* pDec)
+{
+    dexDecodeInstruction(insns, pDec);
+    pDec->opcode = dexGetUnfusedOpcode(pDec->opcode);
+}
+
 #endif  // LIBDEX_INSTRUTILS_H_
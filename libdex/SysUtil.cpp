@@ -356,3 +356,32 @@ int sysCopyFileToFile(int outFd, int inFd, size_t count)
 
     return 0;
 }
+
+/* See documentation comment in header file. */
+int sysCopyFileSegmentToFile(int outFd, int inFd, off_t start, size_t count)
+{
+#ifdef HAVE_POSIX_FILEMAP
+    MemMapping map;
+
+    /*
+     * Writing from the mapping lets the kernel copy straight out of the
+     * source's page cache.  If we can't map it (e.g. no address space for
+     * something huge), fall back to reading.
+     */
+    if (count != 0 && sysMapFileSegmentInShmem(inFd, start, count, &map) == 0) {
+        madvise(map.baseAddr, map.baseLength, MADV_SEQUENTIAL);
+        int err = sysWriteFully(outFd, map.addr, count,
+                    "sysCopyFileSegmentToFile");
+        sysReleaseShmem(&map);
+        return (err == 0) ? 0 : -1;
+    }
+#endif
+
+    if (lseek(inFd, start, SEEK_SET) != start) {
+        ALOGW("sysCopyFileSegmentToFile: lseek to %ld failed: %s",
+            (long) start, strerror(errno));
+        return -1;
+    }
+
+    return sysCopyFileToFile(outFd, inFd, count);
+}
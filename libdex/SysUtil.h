@@ -106,4 +106,12 @@ int sysWriteFully(int fd, const void* buf, size_t count, const char* logMsg);
  */
 int sysCopyFileToFile(int outFd, int inFd, size_t count);
 
+/*
+ * Copy "count" bytes, starting at offset "start" in "inFd", to "outFd".
+ * If possible the source is mapped and written straight from the
+ * mapping, rather than read through a buffer.  The file position of
+ * "inFd" is not preserved.  Returns 0 on success, -1 on failure.
+ */
+int sysCopyFileSegmentToFile(int outFd, int inFd, off_t start, size_t count);
+
 #endif  // LIBDEX_SYSUTIL_H_
@@ -26,6 +26,11 @@
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+#ifdef HAVE_POSIX_FILEMAP
+# include <sys/mman.h>
+#endif
 
 #include <JNIHelp.h>        // TEMP_FAILURE_RETRY may or may not be in unistd
 
@@ -70,6 +75,40 @@
  */
 #define kZipEntryAdj        10000
 
+/*
+ * Buffer sizes for streaming entries out.  Inflated data is handed to the
+ * consumer a kStreamBufSize chunk at a time, so the bigger this is the
+ * fewer calls (and writes) we make.
+ */
+#define kInflateReadBufSize 65536
+#define kStreamBufSize      (256 * 1024)
+
+/*
+ * Persistent name index, written by writeZipIndex().  It's the hash table
+ * built by parseZipArchive(), with each name pointer replaced by the
+ * offset of its entry in the central directory, after a header that ties
+ * it to one version of one archive.  It lives in the dalvik-cache, so we
+ * use native byte order.
+ */
+#define kZipIndexMagic      0x3178647a      // "zdx1"
+#define kZipIndexEmpty      0xffffffff      // cdeOffset of an unused slot
+
+struct ZipIndexHeader {
+    u4      magic;
+    u4      archiveSize;
+    u4      archiveModTime;
+    u4      dirOffset;
+    u4      dirSize;
+    u4      numEntries;
+    u4      tableSize;          // #of ZipIndexSlots that follow; power of 2
+    u4      reserved;
+};
+
+struct ZipIndexSlot {
+    u4      hash;               // computeHash() of the entry name
+    u4      cdeOffset;          // offset of the CDE in the central directory
+};
+
 /*
  * Convert a ZipEntry to a hash table index, verifying that it's in a
  * valid range.
@@ -77,15 +116,39 @@
 static int entryToIndex(const ZipArchive* pArchive, const ZipEntry entry)
 {
     long ent = ((long) entry) - kZipEntryAdj;
-    if (ent < 0 || ent >= pArchive->mHashTableSize ||
-        pArchive->mHashTable[ent].name == NULL)
-    {
+    bool valid = (ent >= 0 && ent < pArchive->mHashTableSize);
+
+    if (valid && pArchive->mIndexSlots != NULL) {
+        u4 cdeOffset = pArchive->mIndexSlots[ent].cdeOffset;
+        valid = (cdeOffset != kZipIndexEmpty &&
+                 (size_t) cdeOffset + kCDELen <= pArchive->mDirectoryMap.length);
+    } else if (valid) {
+        valid = (pArchive->mHashTable[ent].name != NULL);
+    }
+    if (!valid) {
         ALOGW("Zip: invalid ZipEntry %p (%ld)", entry, ent);
         return -1;
     }
     return ent;
 }
 
+/*
+ * Get the central directory entry for a valid hash table index.
+ */
+static const u1* indexToCde(const ZipArchive* pArchive, int ent)
+{
+    if (pArchive->mIndexSlots != NULL) {
+        return (const u1*) pArchive->mDirectoryMap.addr +
+            pArchive->mIndexSlots[ent].cdeOffset;
+    }
+
+    /*
+     * The filename is the first thing past the fixed-size data, so we
+     * can just subtract back from that.
+     */
+    return (const u1*) pArchive->mHashTable[ent].name - kCDELen;
+}
+
 /*
  * Simple string hash function for non-null-terminated strings.
  */
@@ -333,6 +396,174 @@ bail:
     return result;
 }
 
+/*
+ * Try to use the persistent index in "indexFd" in place of the hash
+ * table.  "pArchiveStat" describes the archive; the central directory
+ * must already be mapped.
+ *
+ * We only check the header here, so opening stays cheap.  The slots are
+ * checked as they're used: lookups compare the name in the central
+ * directory itself, so a bad slot can hide an entry but can't produce
+ * the wrong one.
+ *
+ * Returns 0 on success.
+ */
+static int mapZipIndex(ZipArchive* pArchive, int indexFd,
+    const struct stat* pArchiveStat)
+{
+    struct stat indexStat;
+    MemMapping map;
+
+    if (fstat(indexFd, &indexStat) != 0 ||
+        indexStat.st_size < (off_t) sizeof(ZipIndexHeader))
+    {
+        return -1;
+    }
+    if (sysMapFileSegmentInShmem(indexFd, 0, indexStat.st_size, &map) != 0)
+        return -1;
+
+    const ZipIndexHeader* pHeader = (const ZipIndexHeader*) map.addr;
+    u4 tableSize = pHeader->tableSize;
+    if (pHeader->magic != kZipIndexMagic ||
+        pHeader->archiveSize != (u4) pArchiveStat->st_size ||
+        pHeader->archiveModTime != (u4) pArchiveStat->st_mtime ||
+        pHeader->dirOffset != (u4) pArchive->mDirectoryOffset ||
+        pHeader->dirSize != pArchive->mDirectoryMap.length ||
+        pHeader->numEntries != (u4) pArchive->mNumEntries ||
+        tableSize <= pHeader->numEntries ||
+        (tableSize & (tableSize - 1)) != 0 ||
+        map.length != sizeof(ZipIndexHeader) + tableSize * sizeof(ZipIndexSlot))
+    {
+        ALOGV("Zip: index is stale or damaged");
+        sysReleaseShmem(&map);
+        return -1;
+    }
+
+    pArchive->mIndexMap = map;
+    pArchive->mIndexSlots = (const ZipIndexSlot*) (pHeader + 1);
+    pArchive->mHashTableSize = tableSize;
+    return 0;
+}
+
+/*
+ * Write the hash table built by parseZipArchive() to "indexFileName".
+ * We write a temporary file and rename it into place, so a process
+ * opening the archive at the same time sees the old index or the new
+ * one, never part of one.
+ *
+ * This is an optimization, so failure is quietly ignored.
+ */
+static void writeZipIndex(const ZipArchive* pArchive,
+    const char* indexFileName, const struct stat* pArchiveStat)
+{
+    const u1* cdPtr = (const u1*) pArchive->mDirectoryMap.addr;
+    int tableSize = pArchive->mHashTableSize;
+    size_t indexLen = sizeof(ZipIndexHeader) + tableSize * sizeof(ZipIndexSlot);
+    char tmpName[PATH_MAX];
+    int fd = -1;
+
+    u1* buf = (u1*) malloc(indexLen);
+    if (buf == NULL)
+        return;
+
+    ZipIndexHeader* pHeader = (ZipIndexHeader*) buf;
+    memset(pHeader, 0, sizeof(*pHeader));
+    pHeader->magic = kZipIndexMagic;
+    pHeader->archiveSize = (u4) pArchiveStat->st_size;
+    pHeader->archiveModTime = (u4) pArchiveStat->st_mtime;
+    pHeader->dirOffset = (u4) pArchive->mDirectoryOffset;
+    pHeader->dirSize = pArchive->mDirectoryMap.length;
+    pHeader->numEntries = pArchive->mNumEntries;
+    pHeader->tableSize = tableSize;
+
+    ZipIndexSlot* slots = (ZipIndexSlot*) (pHeader + 1);
+    for (int ent = 0; ent < tableSize; ent++) {
+        const ZipHashEntry* pEntry = &pArchive->mHashTable[ent];
+        if (pEntry->name == NULL) {
+            slots[ent].hash = 0;
+            slots[ent].cdeOffset = kZipIndexEmpty;
+        } else {
+            slots[ent].hash = computeHash(pEntry->name, pEntry->nameLen);
+            slots[ent].cdeOffset =
+                (const u1*) pEntry->name - kCDELen - cdPtr;
+        }
+    }
+
+    if ((size_t) snprintf(tmpName, sizeof(tmpName), "%s.%d", indexFileName,
+            (int) getpid()) >= sizeof(tmpName))
+    {
+        goto bail;
+    }
+    fd = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (fd < 0) {
+        ALOGV("Zip: can't create index '%s': %s", tmpName, strerror(errno));
+        goto bail;
+    }
+    if (sysWriteFully(fd, buf, indexLen, "Zip index") != 0 ||
+        close(fd) != 0 || rename(tmpName, indexFileName) != 0)
+    {
+        ALOGV("Zip: unable to write index '%s'", indexFileName);
+        unlink(tmpName);
+    } else {
+        ALOGV("Zip: wrote index '%s' (%d entries)", indexFileName,
+            pArchive->mNumEntries);
+    }
+
+bail:
+    free(buf);
+}
+
+/*
+ * Prepare to access a ZipArchive through an open file descriptor, using
+ * the persistent index in "indexFileName" if it's non-NULL.
+ *
+ * On success, we fill out the contents of "pArchive" and return 0.
+ */
+static int prepArchive(int fd, const char* debugFileName,
+    const char* indexFileName, ZipArchive* pArchive)
+{
+    struct stat archiveStat;
+    int result = -1;
+
+    memset(pArchive, 0, sizeof(*pArchive));
+    pArchive->mFd = fd;
+
+    if (mapCentralDirectory(fd, debugFileName, pArchive) != 0)
+        goto bail;
+
+    if (indexFileName != NULL && fstat(fd, &archiveStat) != 0)
+        indexFileName = NULL;
+
+    if (indexFileName != NULL) {
+        int indexFd = open(indexFileName, O_RDONLY | O_BINARY, 0);
+        if (indexFd >= 0) {
+            int err = mapZipIndex(pArchive, indexFd, &archiveStat);
+            close(indexFd);
+            if (err == 0) {
+                ALOGV("Zip: using index '%s'", indexFileName);
+                result = 0;
+                goto bail;
+            }
+        }
+    }
+
+    if (parseZipArchive(pArchive) != 0) {
+        ALOGV("Zip: parsing '%s' failed", debugFileName);
+        goto bail;
+    }
+
+    if (indexFileName != NULL)
+        writeZipIndex(pArchive, indexFileName, &archiveStat);
+
+    /* success */
+    result = 0;
+
+bail:
+    if (result != 0)
+        dexZipCloseArchive(pArchive);
+    return result;
+}
+
 /*
  * Open the specified file read-only.  We examine the contents and verify
  * that it appears to be a valid zip file.
@@ -363,32 +594,39 @@ int dexZipOpenArchive(const char* fileName, ZipArchive* pArchive)
 }
 
 /*
- * Prepare to access a ZipArchive through an open file descriptor.
+ * Open the specified file read-only, with a persistent name index.
  *
- * On success, we fill out the contents of "pArchive" and return 0.
+ * On success, we fill out the contents of "pArchive" and return 0.  On
+ * failure we return the errno value.
  */
-int dexZipPrepArchive(int fd, const char* debugFileName, ZipArchive* pArchive)
+int dexZipOpenArchiveIndexed(const char* fileName, const char* indexFileName,
+    ZipArchive* pArchive)
 {
-    int result = -1;
+    int fd, err;
 
-    memset(pArchive, 0, sizeof(*pArchive));
-    pArchive->mFd = fd;
+    ALOGV("Opening as zip '%s' %p (index '%s')", fileName, pArchive,
+        indexFileName);
 
-    if (mapCentralDirectory(fd, debugFileName, pArchive) != 0)
-        goto bail;
+    memset(pArchive, 0, sizeof(ZipArchive));
 
-    if (parseZipArchive(pArchive) != 0) {
-        ALOGV("Zip: parsing '%s' failed", debugFileName);
-        goto bail;
+    fd = open(fileName, O_RDONLY | O_BINARY, 0);
+    if (fd < 0) {
+        err = errno ? errno : -1;
+        ALOGV("Unable to open '%s': %s", fileName, strerror(err));
+        return err;
     }
 
-    /* success */
-    result = 0;
+    return prepArchive(fd, fileName, indexFileName, pArchive);
+}
 
-bail:
-    if (result != 0)
-        dexZipCloseArchive(pArchive);
-    return result;
+/*
+ * Prepare to access a ZipArchive through an open file descriptor.
+ *
+ * On success, we fill out the contents of "pArchive" and return 0.
+ */
+int dexZipPrepArchive(int fd, const char* debugFileName, ZipArchive* pArchive)
+{
+    return prepArchive(fd, debugFileName, NULL, pArchive);
 }
 
 
@@ -407,6 +645,7 @@ void dexZipCloseArchive(ZipArchive* pArchive)
     sysReleaseShmem(&pArchive->mDirectoryMap);
 
     free(pArchive->mHashTable);
+    sysReleaseShmem(&pArchive->mIndexMap);
 
     /* ensure nobody tries to use the ZipArchive after it's closed */
     pArchive->mDirectoryOffset = -1;
@@ -414,9 +653,48 @@ void dexZipCloseArchive(ZipArchive* pArchive)
     pArchive->mNumEntries = -1;
     pArchive->mHashTableSize = -1;
     pArchive->mHashTable = NULL;
+    pArchive->mIndexSlots = NULL;
 }
 
 
+/*
+ * Find a matching entry in the persistent index.  The slots haven't been
+ * checked, so we don't trust anything but the central directory, and we
+ * give up after visiting every slot once.
+ */
+static ZipEntry findIndexedEntry(const ZipArchive* pArchive,
+    const char* entryName, int nameLen, unsigned int hash)
+{
+    const ZipIndexSlot* slots = pArchive->mIndexSlots;
+    const u1* cdPtr = (const u1*) pArchive->mDirectoryMap.addr;
+    size_t cdLength = pArchive->mDirectoryMap.length;
+    const int hashTableSize = pArchive->mHashTableSize;
+    int ent = hash & (hashTableSize-1);
+
+    for (int probes = 0; probes < hashTableSize; probes++) {
+        u4 cdeOffset = slots[ent].cdeOffset;
+        if (cdeOffset == kZipIndexEmpty)
+            break;
+
+        if (slots[ent].hash == hash &&
+            (size_t) cdeOffset + kCDELen + nameLen <= cdLength)
+        {
+            const u1* ptr = cdPtr + cdeOffset;
+            if (get4LE(ptr) == kCDESignature &&
+                get2LE(ptr + kCDENameLen) == nameLen &&
+                memcmp(ptr + kCDELen, entryName, nameLen) == 0)
+            {
+                /* match */
+                return (ZipEntry)(long)(ent + kZipEntryAdj);
+            }
+        }
+
+        ent = (ent + 1) & (hashTableSize-1);
+    }
+
+    return NULL;
+}
+
 /*
  * Find a matching entry.
  *
@@ -426,6 +704,10 @@ ZipEntry dexZipFindEntry(const ZipArchive* pArchive, const char* entryName)
 {
     int nameLen = strlen(entryName);
     unsigned int hash = computeHash(entryName, nameLen);
+
+    if (pArchive->mIndexSlots != NULL)
+        return findIndexedEntry(pArchive, entryName, nameLen, hash);
+
     const int hashTableSize = pArchive->mHashTableSize;
     int ent = hash & (hashTableSize-1);
 
@@ -484,19 +766,9 @@ int dexZipGetEntryInfo(const ZipArchive* pArchive, ZipEntry entry,
     if (ent < 0)
         return -1;
 
-    /*
-     * Recover the start of the central directory entry from the filename
-     * pointer.  The filename is the first entry past the fixed-size data,
-     * so we can just subtract back from that.
-     */
-    const unsigned char* basePtr = (const unsigned char*)
-        pArchive->mDirectoryMap.addr;
-    const unsigned char* ptr = (const unsigned char*)
-        pArchive->mHashTable[ent].name;
+    const unsigned char* ptr = indexToCde(pArchive, ent);
     off_t cdOffset = pArchive->mDirectoryOffset;
 
-    ptr -= kCDELen;
-
     int method = get2LE(ptr + kCDEMethod);
     if (pMethod != NULL)
         *pMethod = method;
@@ -535,13 +807,10 @@ int dexZipGetEntryInfo(const ZipArchive* pArchive, ZipEntry entry,
             return -1;
         }
 
+        /* pread() leaves the file position alone, so threads can share it */
         u1 lfhBuf[kLFHLen];
-        if (lseek(pArchive->mFd, localHdrOffset, SEEK_SET) != localHdrOffset) {
-            ALOGW("Zip: failed seeking to lfh at offset %ld", localHdrOffset);
-            return -1;
-        }
-        ssize_t actual =
-            TEMP_FAILURE_RETRY(read(pArchive->mFd, lfhBuf, sizeof(lfhBuf)));
+        ssize_t actual = TEMP_FAILURE_RETRY(pread(pArchive->mFd, lfhBuf,
+            sizeof(lfhBuf), localHdrOffset));
         if (actual != sizeof(lfhBuf)) {
             ALOGW("Zip: failed reading lfh from offset %ld", localHdrOffset);
             return -1;
@@ -581,15 +850,64 @@ int dexZipGetEntryInfo(const ZipArchive* pArchive, ZipEntry entry,
 }
 
 /*
- * Uncompress "deflate" data from the archive's file to an open file
- * descriptor.
+ * Pass "len" bytes of stored data, starting at "offset" in the archive's
+ * file, to "func".  Normally we hand it the pages of a read-only mapping;
+ * if we can't map it, we pread() it through a buffer.
+ */
+static int streamStored(int inFd, off_t offset, size_t len,
+    ZipStreamFunc func, void* arg)
+{
+    MemMapping map;
+
+    if (len == 0)
+        return 0;
+
+    if (sysMapFileSegmentInShmem(inFd, offset, len, &map) == 0) {
+#ifdef HAVE_POSIX_FILEMAP
+        madvise(map.baseAddr, map.baseLength, MADV_SEQUENTIAL);
+#endif
+        int result = (*func)((const u1*) map.addr, len, arg);
+        sysReleaseShmem(&map);
+        return (result == 0) ? 0 : -1;
+    }
+
+    u1* buf = (u1*) malloc(kStreamBufSize);
+    if (buf == NULL)
+        return -1;
+
+    int result = -1;
+    while (len != 0) {
+        size_t getSize = (len > kStreamBufSize) ? kStreamBufSize : len;
+
+        ssize_t actual =
+            TEMP_FAILURE_RETRY(pread(inFd, buf, getSize, offset));
+        if (actual != (ssize_t) getSize) {
+            ALOGW("Zip: stored read failed (%d vs %zd)", (int) actual, getSize);
+            goto bail;
+        }
+        if ((*func)(buf, getSize, arg) != 0)
+            goto bail;
+
+        offset += getSize;
+        len -= getSize;
+    }
+    result = 0;
+
+bail:
+    free(buf);
+    return result;
+}
+
+/*
+ * Uncompress "deflate" data, starting at "offset" in the archive's file,
+ * and pass it to "func" a buffer-full at a time.
  */
-static int inflateToFile(int outFd, int inFd, size_t uncompLen, size_t compLen)
+static int streamDeflated(int inFd, off_t offset, size_t uncompLen,
+    size_t compLen, ZipStreamFunc func, void* arg)
 {
     int result = -1;
-    const size_t kBufSize = 32768;
-    unsigned char* readBuf = (unsigned char*) malloc(kBufSize);
-    unsigned char* writeBuf = (unsigned char*) malloc(kBufSize);
+    unsigned char* readBuf = (unsigned char*) malloc(kInflateReadBufSize);
+    unsigned char* writeBuf = (unsigned char*) malloc(kStreamBufSize);
     z_stream zstream;
     int zerr;
 
@@ -606,7 +924,7 @@ static int inflateToFile(int outFd, int inFd, size_t uncompLen, size_t compLen)
     zstream.next_in = NULL;
     zstream.avail_in = 0;
     zstream.next_out = (Bytef*) writeBuf;
-    zstream.avail_out = kBufSize;
+    zstream.avail_out = kStreamBufSize;
     zstream.data_type = Z_UNKNOWN;
 
     /*
@@ -630,15 +948,18 @@ static int inflateToFile(int outFd, int inFd, size_t uncompLen, size_t compLen)
     do {
         /* read as much as we can */
         if (zstream.avail_in == 0) {
-            size_t getSize = (compLen > kBufSize) ? kBufSize : compLen;
+            size_t getSize =
+                (compLen > kInflateReadBufSize) ? kInflateReadBufSize : compLen;
 
-            ssize_t actual = TEMP_FAILURE_RETRY(read(inFd, readBuf, getSize));
+            ssize_t actual =
+                TEMP_FAILURE_RETRY(pread(inFd, readBuf, getSize, offset));
             if (actual != (ssize_t) getSize) {
                 ALOGW("Zip: inflate read failed (%d vs %zd)",
                     (int)actual, getSize);
                 goto z_bail;
             }
 
+            offset += getSize;
             compLen -= getSize;
 
             zstream.next_in = readBuf;
@@ -654,16 +975,16 @@ static int inflateToFile(int outFd, int inFd, size_t uncompLen, size_t compLen)
             goto z_bail;
         }
 
-        /* write when we're full or when we're done */
+        /* hand it over when we're full or when we're done */
         if (zstream.avail_out == 0 ||
-            (zerr == Z_STREAM_END && zstream.avail_out != kBufSize))
+            (zerr == Z_STREAM_END && zstream.avail_out != kStreamBufSize))
         {
             size_t writeSize = zstream.next_out - writeBuf;
-            if (sysWriteFully(outFd, writeBuf, writeSize, "Zip inflate") != 0)
+            if ((*func)(writeBuf, writeSize, arg) != 0)
                 goto z_bail;
 
             zstream.next_out = writeBuf;
-            zstream.avail_out = kBufSize;
+            zstream.avail_out = kStreamBufSize;
         }
     } while (zerr == Z_OK);
 
@@ -688,19 +1009,15 @@ bail:
 }
 
 /*
- * Uncompress an entry, in its entirety, to an open file descriptor.
- *
- * TODO: this doesn't verify the data's CRC, but probably should (especially
- * for uncompressed data).
+ * Stream an entry's uncompressed contents to a consumer.
  */
-int dexZipExtractEntryToFile(const ZipArchive* pArchive,
-    const ZipEntry entry, int fd)
+int dexZipStreamEntry(const ZipArchive* pArchive, const ZipEntry entry,
+    ZipStreamFunc func, void* arg)
 {
-    int result = -1;
     int ent = entryToIndex(pArchive, entry);
     if (ent < 0) {
-        ALOGW("Zip: extract can't find entry %p", entry);
-        goto bail;
+        ALOGW("Zip: stream can't find entry %p", entry);
+        return -1;
     }
 
     int method;
@@ -710,23 +1027,68 @@ int dexZipExtractEntryToFile(const ZipArchive* pArchive,
     if (dexZipGetEntryInfo(pArchive, entry, &method, &uncompLen, &compLen,
             &dataOffset, NULL, NULL) != 0)
     {
-        goto bail;
-    }
-    if (lseek(pArchive->mFd, dataOffset, SEEK_SET) != dataOffset) {
-        ALOGW("Zip: lseek to data at %ld failed", (long) dataOffset);
-        goto bail;
+        return -1;
     }
 
     if (method == kCompressStored) {
-        if (sysCopyFileToFile(fd, pArchive->mFd, uncompLen) != 0)
-            goto bail;
+        return streamStored(pArchive->mFd, dataOffset, uncompLen, func, arg);
     } else {
-        if (inflateToFile(fd, pArchive->mFd, uncompLen, compLen) != 0)
-            goto bail;
+        return streamDeflated(pArchive->mFd, dataOffset, uncompLen, compLen,
+            func, arg);
     }
+}
 
-    result = 0;
+/*
+ * State for extracting to a file: where it goes, and the CRC so far.
+ */
+struct ExtractToFileState {
+    int     fd;
+    u4      crc;
+};
 
-bail:
-    return result;
+static int writeExtractedChunk(const u1* data, size_t len, void* arg)
+{
+    ExtractToFileState* pState = (ExtractToFileState*) arg;
+
+    pState->crc = dexComputeCrc32(pState->crc, data, len);
+    return sysWriteFully(pState->fd, data, len, "Zip extract");
+}
+
+/*
+ * Uncompress an entry, in its entirety, to an open file descriptor.
+ *
+ * The CRC is computed as the data goes by, and checked against the one
+ * in the central directory once it's all out.
+ */
+int dexZipExtractEntryToFile(const ZipArchive* pArchive,
+    const ZipEntry entry, int fd)
+{
+    ExtractToFileState state;
+    state.fd = fd;
+    state.crc = dexInitCrc32();
+
+    if (dexZipStreamEntry(pArchive, entry, writeExtractedChunk, &state) != 0)
+        return -1;
+
+    u4 expectedCrc = (u4) dexGetZipEntryCrc32(pArchive, entry);
+    if (state.crc != expectedCrc) {
+        ALOGW("Zip: CRC mismatch on extracted entry (%08x vs %08x)",
+            state.crc, expectedCrc);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Utility function to compute a CRC-32.
+ */
+u4 dexInitCrc32()
+{
+    return crc32(0L, Z_NULL, 0);
+}
+
+u4 dexComputeCrc32(u4 crc, const void* buf, size_t len)
+{
+    return crc32(crc, (const Bytef*) buf, len);
 }
@@ -29,6 +29,8 @@
  */
 typedef void* ZipEntry;
 
+struct ZipIndexSlot;
+
 /*
  * One entry in the hash table.
  */
@@ -73,6 +75,14 @@ struct ZipArchive {
      */
     int         mHashTableSize;
     ZipHashEntry* mHashTable;
+
+    /*
+     * If we opened with a valid persistent index (see
+     * dexZipOpenArchiveIndexed), mHashTable is NULL and lookups use the
+     * mHashTableSize slots of the mapped index instead.
+     */
+    MemMapping  mIndexMap;
+    const ZipIndexSlot* mIndexSlots;
 };
 
 /* Zip compression methods we support */
@@ -99,6 +109,20 @@ int dexZipOpenArchive(const char* fileName, ZipArchive* pArchive);
  */
 int dexZipPrepArchive(int fd, const char* debugFileName, ZipArchive* pArchive);
 
+/*
+ * Like dexZipOpenArchive, but keeps the name hash table in a file,
+ * "indexFileName", so later opens can map it instead of scanning the
+ * whole central directory.  Mapped read-only, the pages are shared by
+ * every process that has the archive open.
+ *
+ * The index is tied to the archive's size and modification time and the
+ * position, size and entry count of its central directory.  If it
+ * doesn't match, or doesn't exist, we scan as usual and try to write a
+ * new one; failing to write it (e.g. no permission) is not an error.
+ */
+int dexZipOpenArchiveIndexed(const char* fileName, const char* indexFileName,
+    ZipArchive* pArchive);
+
 /*
  * Close archive, releasing resources associated with it.
  *
@@ -164,7 +188,28 @@ DEX_INLINE long dexGetZipEntryCrc32(const ZipArchive* pArchive,
 }
 
 /*
- * Uncompress and write an entry to a file descriptor.
+ * Consumer for dexZipStreamEntry().  Called with successive pieces of the
+ * uncompressed entry, in order; "data" is only valid during the call.
+ * Return 0 to keep going, nonzero to abandon the extraction.
+ */
+typedef int (*ZipStreamFunc)(const u1* data, size_t len, void* arg);
+
+/*
+ * Pass an entry's uncompressed contents to "func", a piece at a time,
+ * without ever holding all of it in memory.  Stored entries are handed
+ * over straight from a mapping of the archive; deflated entries are
+ * inflated into a 256K buffer.
+ *
+ * The archive is read with pread(), so several threads may stream
+ * entries out of the same archive at once.
+ *
+ * Returns 0 on success, -1 on failure or if "func" asked to stop.
+ */
+int dexZipStreamEntry(const ZipArchive* pArchive, const ZipEntry entry,
+    ZipStreamFunc func, void* arg);
+
+/*
+ * Uncompress and write an entry to a file descriptor, checking its CRC.
  *
  * Returns 0 on success.
  */
@@ -6,6 +6,9 @@
  *    trashing the input.
  *  - Include <endian.h> to get endian info.
  *  - Split a small piece into a header file.
+ *  - Made the SHA1HANDSOFF workspace a local, so threads can hash at the
+ *    same time, and hand runs of whole blocks to dexSha1Blocks(), which
+ *    uses the x86 SHA instructions if it can.
  */
 
 /*
@@ -95,6 +98,7 @@ A million repetitions of "a"
 //# include <endian.h>
 
 #include "DexFile.h"    // want common byte ordering def
+#include "DexChecksum.h"
 
 # if __BYTE_ORDER == __LITTLE_ENDIAN
 #  define X_LITTLE_ENDIAN
@@ -142,7 +146,7 @@ union CHAR64LONG16 {
 };
 CHAR64LONG16* block;
 #ifdef SHA1HANDSOFF
-static unsigned char workspace[64];
+unsigned char workspace[64];
     block = (CHAR64LONG16*)workspace;
     memcpy(block, buffer, 64);
 #else
@@ -196,6 +200,29 @@ warning. */
 }
 
 
+/* Hash whole blocks, with the SHA instructions if we can (Android) */
+
+static void SHA1TransformBlocks(unsigned long state[5],
+    const unsigned char* data, unsigned long blocks)
+{
+    u4 state32[5];
+    int i;
+
+    for (i = 0; i < 5; i++)
+        state32[i] = state[i];
+    if (dexSha1Blocks(state32, data, blocks)) {
+        for (i = 0; i < 5; i++)
+            state[i] = state32[i];
+        return;
+    }
+
+    while (blocks-- != 0) {
+        SHA1Transform(state, data);
+        data += 64;
+    }
+}
+
+
 /* SHA1Init - Initialize new context */
 
 void SHA1Init(SHA1_CTX* context)
@@ -224,9 +251,10 @@ void SHA1Update(SHA1_CTX* context, const unsigned char* data,
     if ((j + len) > 63)
     {
         memcpy(&context->buffer[j], data, (i = 64-j));
-        SHA1Transform(context->state, context->buffer);
-        for ( ; i + 63 < len; i += 64) {
-            SHA1Transform(context->state, &data[i]);
+        SHA1TransformBlocks(context->state, context->buffer, 1);
+        if (i + 63 < len) {
+            SHA1TransformBlocks(context->state, &data[i], (len - i) / 64);
+            i += ((len - i) / 64) * 64;
         }
         j = 0;
     }
@@ -265,10 +293,6 @@ unsigned char finalcount[8];
     memset(context->state, 0, HASHSIZE);
     memset(context->count, 0, 8);
     memset(&finalcount, 0, 8);
-#ifdef SHA1HANDSOFF
-    /* make SHA1Transform overwrite it's own static vars */
-    SHA1Transform(context->state, context->buffer);
-#endif
 }
 
 
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Each loop reloads a field (or array length) after something that may or
+ * may not have changed it.  The loops run long enough to be compiled.
+ */
+public class Main {
+    int value;
+    byte small;
+    long wide;
+
+    static final int ITERATIONS = 1000;
+
+    void bump() {
+        value++;
+    }
+
+    /* A store through an alias must be seen by the second load */
+    static int aliasTest(Main a, Main b) {
+        int sum = 0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            int first = a.value;
+            b.value = first + 1;
+            sum += a.value + first;
+        }
+        return sum;
+    }
+
+    /* An invoke in between may modify the field */
+    static int invokeTest(Main a) {
+        int sum = 0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            int first = a.value;
+            a.bump();
+            sum += a.value + first;
+        }
+        return sum;
+    }
+
+    /* A byte store must not be forwarded untruncated */
+    static int byteTest(Main a) {
+        int sum = 0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            int wideValue = 255;
+            a.small = (byte) wideValue;
+            sum += a.small;
+        }
+        return sum;
+    }
+
+    /* Wide stores are forwarded and reloads must see the latest value */
+    static long wideTest(Main a) {
+        long sum = 0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            a.wide = i;
+            sum += a.wide + a.wide;
+            a.wide = 0;
+            sum += a.wide;
+        }
+        return sum + ITERATIONS * 1001L;
+    }
+
+    static int lengthTest(int[] array) {
+        int sum = 0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            sum += array.length + array.length + array.length;
+        }
+        return sum / 3;
+    }
+
+    public static void main(String[] args) {
+        Main m = new Main();
+        System.out.println("alias: " + aliasTest(m, m));
+        m.value = 0;
+        System.out.println("invoke: " + invokeTest(m));
+        System.out.println("byte: " + byteTest(m));
+        m.wide = 0;
+        System.out.println("wide: " + wideTest(m));
+        System.out.println("length: " + lengthTest(new int[3]));
+        System.out.println("done");
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Exercise invoke-virtual and invoke-interface call sites with an
+ * increasing number of receiver classes.
+ */
+public class Main {
+    interface Shape {
+        int sides();
+    }
+
+    static class Triangle implements Shape {
+        public int sides() { return 3; }
+    }
+
+    static class Square implements Shape {
+        public int sides() { return 4; }
+    }
+
+    static class Pentagon implements Shape {
+        public int sides() { return 5; }
+    }
+
+    static class Hexagon implements Shape {
+        public int sides() { return 6; }
+    }
+
+    static class Heptagon implements Shape {
+        public int sides() { return 7; }
+    }
+
+    static class Base {
+        int value() { return 1; }
+    }
+
+    static class Derived1 extends Base {
+        int value() { return 10; }
+    }
+
+    static class Derived2 extends Base {
+        int value() { return 100; }
+    }
+
+    /* Inherits Base.value() - same target as Base */
+    static class Derived3 extends Base {
+    }
+
+    static int sumSides(Shape[] shapes, int iterations) {
+        int sum = 0;
+        for (int i = 0; i < iterations; i++) {
+            sum += shapes[i % shapes.length].sides();
+        }
+        return sum;
+    }
+
+    static int sumValues(Base[] objs, int iterations) {
+        int sum = 0;
+        for (int i = 0; i < iterations; i++) {
+            sum += objs[i % objs.length].value();
+        }
+        return sum;
+    }
+
+    public static void main(String[] args) {
+        final int N = 100000;
+
+        Shape[] mono = { new Square() };
+        Shape[] bi = { new Triangle(), new Square() };
+        Shape[] poly = { new Triangle(), new Square(), new Pentagon(),
+                         new Hexagon() };
+        Shape[] mega = { new Triangle(), new Square(), new Pentagon(),
+                         new Hexagon(), new Heptagon() };
+
+        System.out.println("interface mono: " + sumSides(mono, N));
+        System.out.println("interface bi: " + sumSides(bi, N));
+        System.out.println("interface poly: " + sumSides(poly, N));
+        System.out.println("interface mega: " + sumSides(mega, N));
+
+        /* Run the bimorphic site again after its profile has settled */
+        System.out.println("interface bi again: " + sumSides(bi, N));
+
+        Base[] virt = { new Base(), new Derived1(), new Derived2(),
+                        new Derived3() };
+        System.out.println("virtual poly: " + sumValues(virt, N));
+
+        System.out.println("done");
+    }
+}
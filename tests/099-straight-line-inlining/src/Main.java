@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Call small leaf methods from hot loops so that they get spliced into the
+ * caller's traces.
+ */
+public class Main {
+    static int sScale = 3;
+
+    int mBias = 7;
+    int[] mTable = { 1, 2, 3, 4 };
+
+    static int madd(int a, int b, int c) {
+        return a * b + c;
+    }
+
+    static long mix(long a, int b) {
+        return (a << 3) ^ b;
+    }
+
+    static int half(int a) {
+        return a / 2;
+    }
+
+    static int scaled(int a) {
+        return a * sScale;
+    }
+
+    static int divide(int a, int b) {
+        return a / b;
+    }
+
+    static Object pick(Object a, Object b) {
+        return b;
+    }
+
+    int biased(int a) {
+        return a + mBias;
+    }
+
+    int lookup(int i) {
+        return mTable[i] + 1;
+    }
+
+    static int testMadd() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            sum = madd(sum, 1, i);          /* result overlaps an argument */
+        }
+        return sum;
+    }
+
+    static long testMix() {
+        long value = 1;
+        for (int i = 0; i < 1000; i++) {
+            value = mix(value, i) & 0xffffffffffL;
+        }
+        return value;
+    }
+
+    static int testHalfAndScale() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            sum += half(i) + scaled(i);
+        }
+        return sum;
+    }
+
+    static int testDivide() {
+        int sum = 0;
+        int i = 0;
+        try {
+            for (i = 0; i < 1000; i++) {
+                sum += divide(1000, 999 - i);
+            }
+        } catch (ArithmeticException expected) {
+            StackTraceElement top = expected.getStackTrace()[0];
+            System.out.println("divide threw at i=" + i + " in " +
+                               top.getMethodName());
+        }
+        return sum;
+    }
+
+    static String testPick() {
+        Object result = null;
+        String[] names = { "a", "b", "c" };
+        for (int i = 0; i < 1000; i++) {
+            result = pick(result, names[i % names.length]);
+        }
+        return (String) result;
+    }
+
+    int testVirtual() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            sum += biased(i) + lookup(i & 3);
+        }
+        return sum;
+    }
+
+    public static void main(String[] args) {
+        System.out.println("madd: " + testMadd());
+        System.out.println("mix: " + testMix());
+        System.out.println("half+scale: " + testHalfAndScale());
+        System.out.println("divide: " + testDivide());
+        System.out.println("pick: " + testPick());
+        System.out.println("virtual: " + new Main().testVirtual());
+
+        Main m = null;
+        try {
+            m.biased(1);
+        } catch (NullPointerException expected) {
+            System.out.println("null receiver caught");
+        }
+        System.out.println("done");
+    }
+}
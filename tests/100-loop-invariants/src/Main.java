@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Hot loops with values that only need to be computed once per loop entry.
+ */
+public class Main {
+    static int sFactor = 4;
+
+    int mBase = 5;
+    int mCounter = 0;
+    long mWide = 1L << 33;
+    int[] mData;
+
+    static class Holder {
+        int value = 11;
+    }
+
+    Main() {
+        mData = new int[2000];
+        for (int i = 0; i < mData.length; i++) {
+            mData[i] = i;
+        }
+    }
+
+    int testFieldLoad() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            sum += mBase + i;
+        }
+        return sum;
+    }
+
+    static int testStaticArithmetic() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            sum += sFactor * 3 + i;
+        }
+        return sum;
+    }
+
+    long testWide() {
+        long total = 0;
+        for (int i = 0; i < 1000; i++) {
+            total += mWide * 2 + i;
+        }
+        return total;
+    }
+
+    /* The field is written in the loop and has to be reloaded every time */
+    int testStoreInLoop() {
+        int sum = 0;
+        mCounter = 0;
+        for (int i = 0; i < 1000; i++) {
+            mCounter += i;
+            sum += mCounter & 0xff;
+        }
+        return sum;
+    }
+
+    int testStride() {
+        int[] data = mData;
+        int sum = 0;
+        for (int i = 0; i < 1000; i += 3) {
+            sum += data[i];
+        }
+        for (int i = 0; i < data.length; i += 200) {
+            sum += data[i];
+        }
+        return sum;
+    }
+
+    /* Leaves the loop either on a match or at the end of the array */
+    int testSearch(int target) {
+        int[] data = mData;
+        int limit = data.length / 2;
+        for (int i = 0; i < limit; i++) {
+            if (data[i] * 3 == target) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static int sumWithHolder(Holder h) {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            sum += h.value + i;
+        }
+        return sum;
+    }
+
+    public static void main(String[] args) {
+        Main m = new Main();
+        System.out.println("field: " + m.testFieldLoad());
+        System.out.println("static: " + testStaticArithmetic());
+        System.out.println("wide: " + m.testWide());
+        System.out.println("store: " + m.testStoreInLoop());
+        System.out.println("stride: " + m.testStride());
+        System.out.println("search: " + m.testSearch(300) + " " +
+                           m.testSearch(2997) + " " + m.testSearch(1));
+
+        System.out.println("holder: " + sumWithHolder(new Holder()));
+        try {
+            sumWithHolder(null);
+        } catch (NullPointerException expected) {
+            System.out.println("null holder caught");
+        }
+        System.out.println("done");
+    }
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.reflect.Method;
+
+/**
+ * Hot loops that allocate small value objects.
+ */
+public class Main {
+    /* calls made before counting, so the loops get compiled */
+    private static final int BENCH_WARMUP = 200;
+    /* calls counted */
+    private static final int BENCH_CALLS = 100;
+    /* VMDebug.KIND_GLOBAL_ALLOCATED_OBJECTS */
+    private static final int KIND_GLOBAL_ALLOCATED_OBJECTS = 1;
+
+    static class Point {
+        final int x;
+        final int y;
+
+        Point(int x, int y) {
+            this.x = x;
+            this.y = y;
+        }
+    }
+
+    static class LongPair {
+        long first;
+        long second;
+
+        LongPair(long first, long second) {
+            this.first = first;
+            this.second = second;
+        }
+    }
+
+    static class Counter {
+        volatile int value;
+
+        Counter(int value) {
+            this.value = value;
+        }
+    }
+
+    static int testPoint() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            Point p = new Point(i, i + 1);
+            sum += p.x * p.y;
+        }
+        return sum;
+    }
+
+    static int testEscaped() {
+        Point[] points = new Point[1000];
+        for (int i = 0; i < 1000; i++) {
+            points[i] = new Point(i, i + 1);
+        }
+        int sum = 0;
+        for (int i = 0; i < points.length; i++) {
+            sum += points[i].x + points[i].y;
+        }
+        return sum;
+    }
+
+    static int testLast() {
+        Point p = null;
+        for (int i = 0; i < 1000; i++) {
+            p = new Point(i, i + 1);
+        }
+        return p.x + p.y;
+    }
+
+    static long testWide() {
+        long sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            LongPair pair = new LongPair((long) i << 32, i * 3);
+            sum += pair.first + pair.second;
+        }
+        return sum;
+    }
+
+    static int testVolatile() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            Counter c = new Counter(i);
+            sum += c.value + 7;
+        }
+        return sum;
+    }
+
+    static int testHandler() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            Point p = new Point(10, i % 10);
+            try {
+                sum += p.x / p.y + i;
+            } catch (ArithmeticException expected) {
+                sum -= 1;
+            }
+        }
+        return sum;
+    }
+
+    private static long runKernel(int which) {
+        switch (which) {
+            case 0:  return testPoint();
+            case 1:  return testEscaped();
+            case 2:  return testLast();
+            case 3:  return testWide();
+            case 4:  return testVolatile();
+            default: return testHandler();
+        }
+    }
+
+    /**
+     * Reports the objects each kernel allocates per call once it has been
+     * warmed up, as counted by VMDebug.  Not part of the test; run with
+     * "bench" as the argument, once as is and once with
+     * -Xjitdisableopt:200 (the kEscapeAnalysis bit) to compare.
+     */
+    private static void bench() throws Exception {
+        String[] names = { "point", "escaped", "last", "wide", "volatile",
+            "handler" };
+        Class<?> vmDebug = Class.forName("dalvik.system.VMDebug");
+        Method start = vmDebug.getMethod("startAllocCounting");
+        Method stop = vmDebug.getMethod("stopAllocCounting");
+        Method reset = vmDebug.getMethod("resetAllocCount", int.class);
+        Method count = vmDebug.getMethod("getAllocCount", int.class);
+        long sink = 0;
+
+        for (int which = 0; which < names.length; which++) {
+            for (int i = 0; i < BENCH_WARMUP; i++) {
+                sink += runKernel(which);
+            }
+            reset.invoke(null, KIND_GLOBAL_ALLOCATED_OBJECTS);
+            start.invoke(null);
+            for (int i = 0; i < BENCH_CALLS; i++) {
+                sink += runKernel(which);
+            }
+            stop.invoke(null);
+            int allocs = (Integer) count.invoke(null,
+                KIND_GLOBAL_ALLOCATED_OBJECTS);
+            System.out.println(names[which] + ": " + allocs + " objects in "
+                + BENCH_CALLS + " calls");
+        }
+        System.out.println("(" + sink + ")");
+    }
+
+    public static void main(String[] args) throws Exception {
+        if (args.length > 0 && args[0].equals("bench")) {
+            bench();
+            return;
+        }
+        System.out.println("point: " + testPoint());
+        System.out.println("escaped: " + testEscaped());
+        System.out.println("last: " + testLast());
+        System.out.println("wide: " + testWide());
+        System.out.println("volatile: " + testVolatile());
+        System.out.println("handler: " + testHandler());
+        System.out.println("done");
+    }
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Hot loops that combine array elements lane by lane.
+ */
+public class Main {
+    static final int N = 1003;
+
+    static int checksum(int[] array) {
+        int sum = 0;
+        for (int i = 0; i < array.length; i++) {
+            sum = sum * 31 + array[i];
+        }
+        return sum;
+    }
+
+    static int[] makeArray(int length, int seed) {
+        int[] array = new int[length];
+        for (int i = 0; i < length; i++) {
+            array[i] = i * seed - 500;
+        }
+        return array;
+    }
+
+    static void add(int[] dst, int[] a, int[] b, int n) {
+        for (int i = 0; i < n; i++) {
+            dst[i] = a[i] + b[i];
+        }
+    }
+
+    static void mix(int[] dst, int[] a, int k) {
+        for (int i = 0; i < dst.length; i++) {
+            dst[i] = ((a[i] << 3) ^ 0x55) - (a[i] >>> 2) + (a[i] >> 1)
+                    + (100 - a[i]) + (k & a[i]);
+        }
+    }
+
+    static void scale(float[] dst, float[] x, float[] y, float factor) {
+        for (int i = 0; i < dst.length; i++) {
+            dst[i] = x[i] * factor + y[i] / 4.0f - 1.5f;
+        }
+    }
+
+    /* The last value of the temporary is visible after the loop */
+    static int lastTemp(int[] dst, int[] a) {
+        int t = 0;
+        for (int i = 0; i < dst.length; i++) {
+            t = a[i] | 1;
+            dst[i] = t;
+        }
+        return t;
+    }
+
+    static int testTripCounts() {
+        int[] a = makeArray(16, 7);
+        int[] b = makeArray(16, -3);
+        int sum = 0;
+        for (int n = 0; n <= 16; n++) {
+            int[] dst = new int[16];
+            add(dst, a, b, n);
+            sum = sum * 31 + checksum(dst);
+        }
+        return sum;
+    }
+
+    static int testOffset() {
+        int[] a = makeArray(N, 5);
+        int[] dst = new int[N];
+        for (int i = 7; i < N - 2; i++) {
+            dst[i] = a[i] - 9;
+        }
+        return checksum(dst);
+    }
+
+    static int testAlias() {
+        int[] a = makeArray(N, 3);
+        add(a, a, a, N);
+        return checksum(a);
+    }
+
+    static int testRangeCheck() {
+        int[] a = makeArray(10, 2);
+        int[] dst = new int[12];
+        try {
+            add(dst, a, a, 12);
+        } catch (ArrayIndexOutOfBoundsException expected) {
+            return checksum(dst);
+        }
+        return -1;
+    }
+
+    public static void main(String[] args) {
+        int[] a = makeArray(N, 11);
+        int[] b = makeArray(N, -13);
+        int[] dst = new int[N];
+
+        add(dst, a, b, N);
+        System.out.println("add: " + checksum(dst));
+        mix(dst, a, 0x3c);
+        System.out.println("mix: " + checksum(dst));
+        System.out.println("last: " + lastTemp(dst, a) + " " + checksum(dst));
+
+        float[] x = new float[N];
+        float[] y = new float[N];
+        float[] f = new float[N];
+        for (int i = 0; i < N; i++) {
+            x[i] = i * 0.5f;
+            y[i] = i;
+        }
+        scale(f, x, y, 3.0f);
+        System.out.println("scale: " + f[0] + " " + f[1] + " " + f[N - 1]);
+
+        System.out.println("trip counts: " + testTripCounts());
+        System.out.println("offset: " + testOffset());
+        System.out.println("alias: " + testAlias());
+        System.out.println("range check: " + testRangeCheck());
+        System.out.println("done");
+    }
+}
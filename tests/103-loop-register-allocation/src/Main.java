@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Hot loops with several blocks that carry values around the back edge.
+ */
+public class Main {
+    static int evenOdd(int n) {
+        int even = 0;
+        int odd = 0;
+        for (int i = 0; i < n; i++) {
+            if ((i & 1) == 0) {
+                even += i;
+            } else {
+                odd -= i * 3;
+            }
+        }
+        return even * 7 + odd;
+    }
+
+    static int collatzSteps(int limit) {
+        int total = 0;
+        for (int start = 1; start < limit; start++) {
+            int x = start;
+            while (x != 1) {
+                if ((x & 1) == 0) {
+                    x >>= 1;
+                } else {
+                    x = x * 3 + 1;
+                }
+                total++;
+            }
+        }
+        return total;
+    }
+
+    static int hash;
+
+    /* Leaves the loop with an exception once i reaches the array length */
+    static int sumPastEnd(int[] array) {
+        int sum = 0;
+        int i = 0;
+        try {
+            while (true) {
+                sum = sum * 31 + array[i];
+                hash = sum;
+                i++;
+            }
+        } catch (ArrayIndexOutOfBoundsException e) {
+            return sum ^ i;
+        }
+    }
+
+    static volatile boolean started;
+
+    static int spin(int n) {
+        int a = 1;
+        int b = 0;
+        for (int i = 0; i < n; i++) {
+            int t = a + b;
+            if (t < 0) {
+                t &= 0xffff;
+            }
+            b = a;
+            a = t;
+        }
+        return a ^ b;
+    }
+
+    public static void main(String[] args) throws Exception {
+        for (int round = 0; round < 3; round++) {
+            System.out.println("evenOdd: " + evenOdd(1000) + " " + evenOdd(7) +
+                               " " + evenOdd(0));
+        }
+        System.out.println("collatzSteps: " + collatzSteps(3000));
+
+        int[] array = new int[257];
+        for (int i = 0; i < array.length; i++) {
+            array[i] = i * 17 - 1000;
+        }
+        for (int round = 0; round < 3; round++) {
+            hash = 0;
+            int result = sumPastEnd(array);
+            System.out.println("sumPastEnd: " + result + " " + hash);
+        }
+
+        /* Suspend the spinning thread for a few collections */
+        final int[] result = new int[1];
+        Thread spinner = new Thread() {
+            public void run() {
+                started = true;
+                result[0] = spin(20000000);
+            }
+        };
+        spinner.start();
+        while (!started) {
+            Thread.yield();
+        }
+        for (int i = 0; i < 5; i++) {
+            System.gc();
+        }
+        spinner.join();
+        System.out.println("spin: " + result[0] + " " + spin(20000000));
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Branches that change direction once their traces have been compiled.
+ */
+public class Main {
+    static int mix(int x, int limit) {
+        int y = x * 5;
+        if (x < limit) {
+            y += 3;
+        } else {
+            y ^= 0x5a5a;
+            y -= x >> 2;
+        }
+        return y * 31 + 7;
+    }
+
+    static int phases(int n) {
+        int sum = 0;
+        /* Compiled with the first side of the branch... */
+        for (int i = 0; i < n; i++) {
+            sum = sum * 17 + mix(i, n);
+        }
+        /* ...then run through the other one */
+        for (int i = 0; i < n; i++) {
+            sum = sum * 17 + mix(i + n, n);
+        }
+        return sum;
+    }
+
+    static int select(int kind, int x) {
+        switch (kind) {
+            case 0:
+                return x + 1;
+            case 1:
+                return x * 3;
+            case 2:
+                return x - 7;
+            default:
+                return x ^ kind;
+        }
+    }
+
+    static int switchPhases(int n) {
+        int sum = 0;
+        for (int kind = 0; kind < 5; kind++) {
+            for (int i = 0; i < n; i++) {
+                sum = sum * 13 + select(kind, i);
+            }
+        }
+        return sum;
+    }
+
+    /* Side exit taken only every few iterations */
+    static int rareExit(int n) {
+        int sum = 0;
+        for (int i = 0; i < n; i++) {
+            if (i % 7 == 0) {
+                sum -= i;
+            }
+            sum += i & 0xff;
+        }
+        return sum;
+    }
+
+    public static void main(String[] args) {
+        for (int i = 0; i < 3; i++) {
+            System.out.println("phases: " + phases(20000));
+        }
+        for (int i = 0; i < 3; i++) {
+            System.out.println("switchPhases: " + switchPhases(5000));
+        }
+        System.out.println("rareExit: " + rareExit(100000));
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Loops that run long enough to be compiled during their only invocation.
+ */
+public class Main {
+    static int batch(int n) {
+        int acc = 1;
+        int i = 0;
+        while (i < n) {
+            acc = acc * 1103515245 + 12345;
+            i++;
+        }
+        return acc;
+    }
+
+    static int firstMatch(int[] data, int key) {
+        int i = 0;
+        while (i < data.length) {
+            if (data[i] == key) {
+                break;
+            }
+            i++;
+        }
+        return i;
+    }
+
+    static long countDown(long n) {
+        long sum = 0;
+        while (n > 0) {
+            sum += n ^ (n >> 3);
+            n--;
+        }
+        return sum;
+    }
+
+    static int overrun(int[] data) {
+        int sum = 0;
+        int i = 0;
+        try {
+            while (true) {
+                sum += data[i] * (i + 1);
+                i++;
+            }
+        } catch (ArrayIndexOutOfBoundsException expected) {
+            return sum ^ i;
+        }
+    }
+
+    public static void main(String[] args) {
+        System.out.println("batch: " + batch(3000000));
+
+        int[] data = new int[200000];
+        for (int i = 0; i < data.length; i++) {
+            data[i] = i * 7;
+        }
+        System.out.println("firstMatch: " + firstMatch(data, 7 * 150000));
+        System.out.println("firstMatch: " + firstMatch(data, -1));
+        System.out.println("countDown: " + countDown(1000000L));
+        System.out.println("overrun: " + overrun(data));
+    }
+}
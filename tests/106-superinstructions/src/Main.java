@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Loops built from the instruction pairs dexopt turns into
+ * superinstructions.
+ */
+public class Main {
+    static final int ITERATIONS = 200;
+
+    int value;
+
+    /* iget-quick + if-nez */
+    static int countZeroes(Main[] objs) {
+        int zeroes = 0;
+        for (int i = 0; i < objs.length; i++) {
+            if (objs[i].value == 0) {
+                zeroes++;
+            }
+        }
+        return zeroes;
+    }
+
+    /* const/4 + if-ge, const/4 + if-eq */
+    static int countSmall(int[] data) {
+        int small = 0;
+        for (int i = 0; i < data.length; i++) {
+            int d = data[i];
+            if (d < 3) {
+                small++;
+            }
+            if (d != 7) {
+                small += 2;
+            }
+        }
+        return small;
+    }
+
+    /* aget + add-int/2addr */
+    static int sum(int[] data) {
+        int total = 0;
+        for (int i = 0; i < data.length; i++) {
+            total += data[i];
+        }
+        return total;
+    }
+
+    /* aget + add-int */
+    static int sumPair(int[] data, int idx) {
+        return data[idx] + data[idx - 1];
+    }
+
+    static int twice(int x) {
+        return x * 2;
+    }
+
+    static long scale(long x) {
+        return x * 3000000000L;
+    }
+
+    static String describe(int x) {
+        return "#" + x;
+    }
+
+    /* move-result + return, in all three widths */
+    static int callTwice(int x) {
+        return twice(x);
+    }
+
+    static long callScale(long x) {
+        return scale(x);
+    }
+
+    static String callDescribe(int x) {
+        return describe(x);
+    }
+
+    public static void main(String[] args) {
+        int[] data = new int[1000];
+        Main[] objs = new Main[1000];
+        for (int i = 0; i < data.length; i++) {
+            data[i] = (i * 37 + 11) % 10;
+            objs[i] = new Main();
+            objs[i].value = i % 3;
+        }
+
+        int zeroes = 0;
+        int small = 0;
+        int total = 0;
+        int calls = 0;
+        long scaled = 0;
+        String last = null;
+        for (int iter = 0; iter < ITERATIONS; iter++) {
+            zeroes += countZeroes(objs);
+            small += countSmall(data);
+            total += sum(data);
+            for (int i = 0; i < data.length; i++) {
+                calls += callTwice(i);
+                scaled += callScale(i);
+            }
+            last = callDescribe(iter);
+        }
+        System.out.println("countZeroes: " + zeroes);
+        System.out.println("countSmall: " + small);
+        System.out.println("sum: " + total);
+        System.out.println("callTwice: " + calls);
+        System.out.println("callScale: " + scaled);
+        System.out.println("callDescribe: " + last);
+        System.out.println("sumPair: " + sumPair(data, 999));
+
+        objs[500] = null;
+        try {
+            countZeroes(objs);
+            System.out.println("countZeroes: no exception");
+        } catch (NullPointerException npe) {
+            System.out.println("countZeroes: NullPointerException");
+        }
+        try {
+            sumPair(data, data.length);
+            System.out.println("sumPair: no exception");
+        } catch (ArrayIndexOutOfBoundsException aioobe) {
+            System.out.println("sumPair: ArrayIndexOutOfBoundsException");
+        }
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Interface call sites with one, several and changing receiver classes.
+ */
+public class Main {
+    interface Shape {
+        int area();
+    }
+
+    static class Square implements Shape {
+        final int side;
+        Square(int side) { this.side = side; }
+        public int area() { return side * side; }
+    }
+
+    static class Rect implements Shape {
+        final int w, h;
+        Rect(int w, int h) { this.w = w; this.h = h; }
+        public int area() { return w * h; }
+    }
+
+    static class Triangle implements Shape {
+        final int b, h;
+        Triangle(int b, int h) { this.b = b; this.h = h; }
+        public int area() { return b * h / 2; }
+    }
+
+    /* Subclass overriding the method the cache found for Square */
+    static class Frame extends Square {
+        Frame(int side) { super(side); }
+        public int area() { return side * 4 - 4; }
+    }
+
+    static long sumAreas(Shape[] shapes, int rounds) {
+        long total = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < shapes.length; i++) {
+                total += shapes[i].area();
+            }
+        }
+        return total;
+    }
+
+    public static void main(String[] args) {
+        Shape[] mono = new Shape[10];
+        Shape[] poly = new Shape[10];
+        Shape[] frames = new Shape[10];
+        for (int i = 0; i < mono.length; i++) {
+            mono[i] = new Square(i);
+            switch (i % 3) {
+                case 0: poly[i] = new Square(i); break;
+                case 1: poly[i] = new Rect(i, i + 1); break;
+                default: poly[i] = new Triangle(i, i + 2); break;
+            }
+            frames[i] = new Frame(i + 1);
+        }
+
+        System.out.println("mono: " + sumAreas(mono, 10000));
+        System.out.println("poly: " + sumAreas(poly, 10000));
+        System.out.println("frames: " + sumAreas(frames, 10000));
+        System.out.println("mono again: " + sumAreas(mono, 10000));
+
+        try {
+            sumAreas(new Shape[] { new Square(2), null }, 1);
+            System.out.println("null: no exception");
+        } catch (NullPointerException npe) {
+            System.out.println("null: NullPointerException");
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Loops whose cost is dominated by instruction dispatch.
+ */
+public class Main {
+    static final int OP_ADD = 0;
+    static final int OP_XOR = 1;
+    static final int OP_ROT = 2;
+    static final int OP_DEC = 3;
+    static final int OP_JNZ = 4;
+    static final int OP_HALT = 5;
+
+    static int mixInt(int n) {
+        int a = 1, b = 2, c = 3;
+        for (int i = 0; i < n; i++) {
+            a += b;
+            b ^= a;
+            c = (c << 1) | (c >>> 31);
+            a -= c;
+            b += i;
+            c ^= b >> 3;
+        }
+        return a ^ b ^ c;
+    }
+
+    static long mixLong(int n) {
+        long x = 1;
+        for (int i = 0; i < n; i++) {
+            x = x * 6364136223846793005L + 1442695040888963407L;
+            x ^= x >>> 17;
+        }
+        return x;
+    }
+
+    /* A tiny register machine: each op is {opcode, dst, src} */
+    static int execute(int[] code, int[] regs) {
+        int pc = 0;
+        int steps = 0;
+        while (true) {
+            int op = code[pc];
+            int dst = code[pc + 1];
+            int src = code[pc + 2];
+            pc += 3;
+            steps++;
+            switch (op) {
+                case OP_ADD: regs[dst] += regs[src]; break;
+                case OP_XOR: regs[dst] ^= regs[src]; break;
+                case OP_ROT: regs[dst] = (regs[dst] << 7) | (regs[dst] >>> 25);
+                             break;
+                case OP_DEC: regs[dst]--; break;
+                case OP_JNZ: if (regs[dst] != 0) pc = src * 3; break;
+                case OP_HALT: return steps;
+            }
+        }
+    }
+
+    public static void main(String[] args) {
+        System.out.println("mixInt: " + mixInt(3000000));
+        System.out.println("mixLong: " + mixLong(1000000));
+
+        int[] code = {
+            OP_ADD, 1, 2,
+            OP_ROT, 1, 0,
+            OP_XOR, 2, 1,
+            OP_ADD, 2, 3,
+            OP_DEC, 0, 0,
+            OP_JNZ, 0, 0,
+            OP_HALT, 0, 0,
+        };
+        int[] regs = { 200000, 1, 2, 3 };
+        int steps = execute(code, regs);
+        System.out.println("execute: " + steps + " steps, r1=" + regs[1] +
+            " r2=" + regs[2]);
+    }
+}
@@ -0,0 +1,28 @@
+# Copyright (C) 2012 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+#
+# dexchecksum-bench, which times the DEX checksum code against zlib and
+# the portable SHA-1.  Host only, since that's where libdex has SHA-1.
+#
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := dexchecksum-bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := ChecksumBench.cpp
+LOCAL_C_INCLUDES := dalvik
+LOCAL_STATIC_LIBRARIES := libdex liblog
+LOCAL_LDLIBS += -lpthread -lz
+include $(BUILD_HOST_EXECUTABLE)
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Time the DEX checksum code.  Adler-32 is compared against zlib, and
+ * SHA-1 with and without the SHA instructions, on either the contents of
+ * a file (e.g. a large classes.dex) or a buffer of pseudo-random bytes.
+ * The results must match; if they don't, we say so and exit with 1.
+ */
+#include "libdex/DexFile.h"
+#include "libdex/DexChecksum.h"
+#include "libdex/sha1.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <zlib.h>
+
+static const char* gProgName = "dexchecksum-bench";
+
+static u8 getTimeNsec(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u8) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * Read all of "fileName" into a new buffer.  Returns NULL on failure.
+ */
+static u1* readFile(const char* fileName, size_t* pLength)
+{
+    FILE* fp = fopen(fileName, "rb");
+    u1* buf = NULL;
+    long length;
+
+    if (fp == NULL) {
+        fprintf(stderr, "%s: unable to open '%s'\n", gProgName, fileName);
+        return NULL;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0 || (length = ftell(fp)) <= 0 ||
+        fseek(fp, 0, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "%s: unable to size '%s'\n", gProgName, fileName);
+        goto bail;
+    }
+
+    buf = (u1*) malloc(length);
+    if (buf == NULL || fread(buf, 1, length, fp) != (size_t) length) {
+        fprintf(stderr, "%s: unable to read '%s'\n", gProgName, fileName);
+        free(buf);
+        buf = NULL;
+        goto bail;
+    }
+    *pLength = length;
+
+bail:
+    fclose(fp);
+    return buf;
+}
+
+static void report(const char* what, u8 nsec, size_t length, int iterations)
+{
+    double mb = (double) length * iterations / (1024.0 * 1024.0);
+    printf("  %-22s %8.1f MB/s  (%.3f ms/pass)\n", what,
+        mb / (nsec / 1e9), nsec / 1e6 / iterations);
+}
+
+static u4 timeZlibAdler(const u1* buf, size_t length, int iterations)
+{
+    uLong adler = 0;
+    u8 start = getTimeNsec();
+    for (int i = 0; i < iterations; i++)
+        adler = adler32(adler32(0L, Z_NULL, 0), buf, length);
+    report("adler32 (zlib)", getTimeNsec() - start, length, iterations);
+    return (u4) adler;
+}
+
+static u4 timeDexAdler(const u1* buf, size_t length, int iterations)
+{
+    u4 adler = 0;
+    u8 start = getTimeNsec();
+    for (int i = 0; i < iterations; i++)
+        adler = dexAdler32(1, buf, length);
+    report("adler32 (dexAdler32)", getTimeNsec() - start, length, iterations);
+    return adler;
+}
+
+static void timeSha1(const char* what, const u1* buf, size_t length,
+    int iterations, unsigned char digest[kSHA1DigestLen])
+{
+    u8 start = getTimeNsec();
+    for (int i = 0; i < iterations; i++) {
+        SHA1_CTX context;
+        SHA1Init(&context);
+        SHA1Update(&context, buf, length);
+        SHA1Final(digest, &context);
+    }
+    report(what, getTimeNsec() - start, length, iterations);
+}
+
+/*
+ * Show usage.
+ */
+void usage(void)
+{
+    fprintf(stderr, "Copyright (C) 2012 The Android Open Source Project\n\n");
+    fprintf(stderr, "%s: [-n iterations] [-s megabytes] [file]\n", gProgName);
+    fprintf(stderr, "\n");
+    fprintf(stderr, " -n : passes over the data (default 20)\n");
+    fprintf(stderr, " -s : size of the random data, if no file (default 8)\n");
+}
+
+int main(int argc, char* const argv[])
+{
+    bool wantUsage = false;
+    int iterations = 20;
+    int megabytes = 8;
+    int ic;
+
+    while (1) {
+        ic = getopt(argc, argv, "n:s:");
+        if (ic < 0)
+            break;
+
+        switch (ic) {
+        case 'n':
+            iterations = atoi(optarg);
+            if (iterations <= 0)
+                wantUsage = true;
+            break;
+        case 's':
+            megabytes = atoi(optarg);
+            if (megabytes <= 0)
+                wantUsage = true;
+            break;
+        default:
+            wantUsage = true;
+            break;
+        }
+    }
+    if (argc - optind > 1)
+        wantUsage = true;
+
+    if (wantUsage) {
+        usage();
+        return 2;
+    }
+
+    u1* buf;
+    size_t length;
+    if (optind < argc) {
+        buf = readFile(argv[optind], &length);
+        if (buf == NULL)
+            return 1;
+    } else {
+        length = (size_t) megabytes * 1024 * 1024;
+        buf = (u1*) malloc(length);
+        if (buf == NULL) {
+            fprintf(stderr, "%s: out of memory\n", gProgName);
+            return 1;
+        }
+        u4 seed = 0x2545f491;
+        for (size_t i = 0; i < length; i++) {
+            seed = seed * 1103515245 + 12345;
+            buf[i] = (u1) (seed >> 16);
+        }
+    }
+
+    u4 features = dexChecksumGetFeatures();
+    printf("%s: %zu bytes, %d passes, features:%s%s%s\n", gProgName,
+        length, iterations,
+        (features & kDexChecksumSsse3) ? " ssse3" : "",
+        (features & kDexChecksumSha) ? " sha" : "",
+        (features == 0) ? " none" : "");
+
+    int result = 0;
+
+    u4 zlibAdler = timeZlibAdler(buf, length, iterations);
+    u4 dexAdler = timeDexAdler(buf, length, iterations);
+    if (zlibAdler != dexAdler) {
+        fprintf(stderr, "%s: adler32 mismatch (%08x vs %08x)\n",
+            gProgName, zlibAdler, dexAdler);
+        result = 1;
+    }
+
+    unsigned char portable[kSHA1DigestLen], accel[kSHA1DigestLen];
+    dexChecksumSetFeatures(0);
+    timeSha1("SHA-1 (portable)", buf, length, iterations, portable);
+    dexChecksumSetFeatures(features);
+    if ((features & kDexChecksumSha) != 0) {
+        timeSha1("SHA-1 (SHA extensions)", buf, length, iterations, accel);
+        if (memcmp(portable, accel, kSHA1DigestLen) != 0) {
+            fprintf(stderr, "%s: SHA-1 mismatch\n", gProgName);
+            result = 1;
+        }
+    }
+
+    free(buf);
+    return result;
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Time the extraction of DEX entries from an APK/JAR: the whole way to a
+ * file (as dexopt prep does), streamed into an Adler-32 without touching
+ * the disk, and streamed from several threads at once.  Point it at an
+ * archive with a large classes.dex.
+ */
+#include "libdex/DexFile.h"
+#include "libdex/DexChecksum.h"
+#include "libdex/ZipArchive.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+static const char* gProgName = "dexzip-bench";
+
+static u8 getTimeNsec(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u8) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void report(const char* what, u8 nsec, u8 bytes, int passes)
+{
+    double mb = (double) bytes / (1024.0 * 1024.0);
+    printf("  %-24s %8.1f MB/s  (%.3f ms/pass)\n", what,
+        mb / (nsec / 1e9), nsec / 1e6 / passes);
+}
+
+/*
+ * What to extract.
+ */
+struct BenchState {
+    ZipArchive      archive;
+    ZipEntry*       entries;
+    int             numEntries;
+    u8              totalLen;       /* uncompressed, one pass */
+    int             passes;
+};
+
+static int adlerChunk(const u1* data, size_t len, void* arg)
+{
+    u4* pAdler = (u4*) arg;
+    *pAdler = dexAdler32(*pAdler, data, len);
+    return 0;
+}
+
+/*
+ * Stream every entry "passes" times.  Returns 0 on success.
+ */
+static int streamAll(BenchState* pState)
+{
+    for (int i = 0; i < pState->passes; i++) {
+        for (int j = 0; j < pState->numEntries; j++) {
+            u4 adler = 1;
+            if (dexZipStreamEntry(&pState->archive, pState->entries[j],
+                    adlerChunk, &adler) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void* streamThreadStart(void* arg)
+{
+    return (void*) (long) streamAll((BenchState*) arg);
+}
+
+static int timeExtractToFile(BenchState* pState)
+{
+    FILE* fp = tmpfile();
+    if (fp == NULL) {
+        fprintf(stderr, "%s: unable to create temp file\n", gProgName);
+        return -1;
+    }
+    int fd = fileno(fp);
+    int result = 0;
+
+    u8 start = getTimeNsec();
+    for (int i = 0; i < pState->passes && result == 0; i++) {
+        for (int j = 0; j < pState->numEntries; j++) {
+            if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0 ||
+                dexZipExtractEntryToFile(&pState->archive,
+                    pState->entries[j], fd) != 0)
+            {
+                result = -1;
+                break;
+            }
+        }
+    }
+    if (result == 0) {
+        report("extract to file", getTimeNsec() - start,
+            pState->totalLen * pState->passes, pState->passes);
+    }
+
+    fclose(fp);
+    return result;
+}
+
+static int timeStream(BenchState* pState)
+{
+    u8 start = getTimeNsec();
+    if (streamAll(pState) != 0)
+        return -1;
+    report("stream (adler32)", getTimeNsec() - start,
+        pState->totalLen * pState->passes, pState->passes);
+    return 0;
+}
+
+static int timeParallelStream(BenchState* pState, int numThreads)
+{
+    pthread_t* threads = (pthread_t*) malloc(numThreads * sizeof(pthread_t));
+    int started = 0;
+    int result = 0;
+
+    if (threads == NULL)
+        return -1;
+
+    u8 start = getTimeNsec();
+    for ( ; started < numThreads; started++) {
+        if (pthread_create(&threads[started], NULL, streamThreadStart,
+                pState) != 0)
+        {
+            result = -1;
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        void* threadResult;
+        pthread_join(threads[i], &threadResult);
+        if (threadResult != NULL)
+            result = -1;
+    }
+    if (result == 0) {
+        char what[32];
+        snprintf(what, sizeof(what), "stream x %d threads", numThreads);
+        report(what, getTimeNsec() - start,
+            pState->totalLen * pState->passes * numThreads, pState->passes);
+    }
+
+    free(threads);
+    return result;
+}
+
+/*
+ * Show usage.
+ */
+void usage(void)
+{
+    fprintf(stderr, "Copyright (C) 2012 The Android Open Source Project\n\n");
+    fprintf(stderr, "%s: [-n passes] [-j threads] archive [entry ...]\n",
+        gProgName);
+    fprintf(stderr, "\n");
+    fprintf(stderr, " -n : passes over the entries (default 10)\n");
+    fprintf(stderr, " -j : threads for the parallel run (default 4)\n");
+    fprintf(stderr, " entry defaults to classes.dex\n");
+}
+
+int main(int argc, char* const argv[])
+{
+    bool wantUsage = false;
+    int numThreads = 4;
+    int ic;
+
+    BenchState state;
+    memset(&state, 0, sizeof(state));
+    state.passes = 10;
+
+    while (1) {
+        ic = getopt(argc, argv, "n:j:");
+        if (ic < 0)
+            break;
+
+        switch (ic) {
+        case 'n':
+            state.passes = atoi(optarg);
+            if (state.passes <= 0)
+                wantUsage = true;
+            break;
+        case 'j':
+            numThreads = atoi(optarg);
+            if (numThreads <= 0)
+                wantUsage = true;
+            break;
+        default:
+            wantUsage = true;
+            break;
+        }
+    }
+    if (optind >= argc)
+        wantUsage = true;
+
+    if (wantUsage) {
+        usage();
+        return 2;
+    }
+
+    const char* fileName = argv[optind++];
+    if (dexZipOpenArchive(fileName, &state.archive) != 0) {
+        fprintf(stderr, "%s: unable to open '%s'\n", gProgName, fileName);
+        return 1;
+    }
+
+    static const char* kDefaultEntry = "classes.dex";
+    const char* const* names = (optind < argc) ? &argv[optind] : &kDefaultEntry;
+    state.numEntries = (optind < argc) ? argc - optind : 1;
+    state.entries = (ZipEntry*) malloc(state.numEntries * sizeof(ZipEntry));
+
+    int result = 1;
+    for (int i = 0; i < state.numEntries; i++) {
+        state.entries[i] = dexZipFindEntry(&state.archive, names[i]);
+        if (state.entries[i] == NULL) {
+            fprintf(stderr, "%s: no '%s' in '%s'\n", gProgName, names[i],
+                fileName);
+            goto bail;
+        }
+        state.totalLen +=
+            dexGetZipEntryUncompLen(&state.archive, state.entries[i]);
+    }
+
+    printf("%s: %d entries, %llu bytes, %d passes\n", gProgName,
+        state.numEntries, (unsigned long long) state.totalLen, state.passes);
+
+    if (timeExtractToFile(&state) != 0 || timeStream(&state) != 0 ||
+        timeParallelStream(&state, numThreads) != 0)
+    {
+        fprintf(stderr, "%s: extraction failed\n", gProgName);
+        goto bail;
+    }
+    result = 0;
+
+bail:
+    free(state.entries);
+    dexZipCloseArchive(&state.archive);
+    return result;
+}
@@ -81,6 +81,7 @@
 #include "oo/TypeCheck.h"
 #include "Atomic.h"
 #include "interp/Interp.h"
+#include "interp/InlineCache.h"
 #include "InlineNative.h"
 #include "oo/ObjectInlines.h"
 
@@ -124,6 +124,7 @@ LOCAL_SRC_FILES := \
 	analysis/Liveness.cpp \
 	analysis/Optimize.cpp \
 	analysis/RegisterMap.cpp \
+	analysis/VerifyCache.cpp \
 	analysis/VerifySubs.cpp \
 	analysis/VfyBasicBlock.cpp \
 	hprof/Hprof.cpp \
@@ -131,6 +132,7 @@ LOCAL_SRC_FILES := \
 	hprof/HprofHeap.cpp \
 	hprof/HprofOutput.cpp \
 	hprof/HprofString.cpp \
+	interp/InlineCache.cpp \
 	interp/Interp.cpp.arm \
 	interp/Stack.cpp \
 	jdwp/ExpandBuf.cpp \
@@ -213,10 +215,15 @@ ifeq ($(WITH_JIT),true)
 	compiler/Frontend.cpp \
 	compiler/Utility.cpp \
 	compiler/InlineTransformation.cpp \
+	compiler/ReceiverProfile.cpp \
+	compiler/PerfMap.cpp \
+	compiler/TraceExit.cpp \
 	compiler/IntermediateRep.cpp \
 	compiler/Dataflow.cpp \
 	compiler/SSATransformation.cpp \
 	compiler/Loop.cpp \
+	compiler/RedundantLoadElimination.cpp \
+	compiler/EscapeAnalysis.cpp \
 	compiler/Ralloc.cpp \
 	interp/Jit.cpp
 endif
@@ -39,6 +39,7 @@
 struct GcHeap;
 struct BreakpointSet;
 struct InlineSub;
+struct VerifyCache;
 
 /*
  * One of these for each -ea/-da/-esa/-dsa on the command line.
@@ -85,6 +86,7 @@ struct DvmGlobals {
      * Some options from the command line or environment.
      */
     char*       bootClassPathStr;
+    int         bootClassPathThreads;   // openers; 0 means one per CPU
     char*       classPathStr;
 
     size_t      heapStartingSize;
@@ -142,6 +144,7 @@ struct DvmGlobals {
     bool        monitorVerification;
 
     bool        dexOptForSmp;
+    int         dexOptThreads;      // verify/opt workers; 0 means one per CPU
 
     /*
      * GC option flags.
@@ -181,6 +184,8 @@ struct DvmGlobals {
     /* used by the DEX optimizer to load classes from an unfinished DEX */
     DvmDex*     bootClassPathOptExtra;
     bool        optimizingBootstrapClass;
+    /* memoized verifier lookups while the DEX optimizer verifies classes */
+    VerifyCache* verifyCache;
 
     /*
      * Loaded classes, hashed by class name.  Each entry is a ClassObject*,
@@ -802,6 +807,19 @@ struct DvmJitGlobals {
     /* How many entries in the JitEntryTable are in use */
     unsigned int jitTableEntriesUsed;
 
+    /*
+     * Incremental resize state.  While a resize is in progress, lookups
+     * that miss in pJitEntryTable fall back to pJitEntryTableOld, whose
+     * entries are copied over in batches by the compiler thread.  Once
+     * drained, the old table is parked in pJitEntryTableRetired until the
+     * next safe point, when no thread can still be walking it.
+     */
+    struct JitEntry *pJitEntryTableOld;
+    unsigned int jitTableSizeOld;
+    unsigned int jitTableMaskOld;
+    unsigned int jitTableMigrateIndex;
+    struct JitEntry *pJitEntryTableRetired;
+
     /* Bytes allocated for the code cache */
     unsigned int codeCacheSize;
 
@@ -825,6 +843,32 @@ struct DvmJitGlobals {
     int                compilerWorkDequeueIndex;
     int                compilerICPatchIndex;
 
+    /* Receiver profiles of predicted chaining cells (compilerICPatchLock) */
+    ReceiverProfileSite *pReceiverProfiles;
+
+    /* Exit profiles of the installed traces, by code address */
+    pthread_mutex_t    traceExitLock;
+    TraceExitProfile   **pTraceExitProfiles;
+    int                numTraceExitProfiles;
+    int                maxTraceExitProfiles;
+
+    /* Baseline traces and optimized builds waiting to replace them */
+    JitBaselineTrace   *pBaselineTraces;        // compilerLock
+    int                numBaselineTraces;
+    int                maxBaselineTraces;
+    JitTierUp          tierUpQueue[JIT_TIER_UP_QUEUE_SIZE];  // compilerLock
+    int                numTierUps;
+
+    /* Compilation time charged to the current budget window, in us */
+    u8                 budgetWindowStart;
+    u8                 budgetWindowUsed;
+
+    /* Builds and time spent in each compiler tier */
+    int                tierCompilations[kJitTierLast];
+    u8                 tierTime[kJitTierLast];
+    int                tierUpsInstalled;
+    int                budgetStalls;
+
     /* JIT internal stats */
     int                compilerMaxQueued;
     int                translationChains;
@@ -898,6 +942,21 @@ struct DvmJitGlobals {
     /* Flag to dump compiled binary code in bytes */
     bool printBinary;
 
+    /* Flag to describe the code cache in /tmp/perf-<pid>.map */
+    bool perfMap;
+
+    /* Flag to profile trace exits and start traces at hot side exits */
+    bool exitProfile;
+
+    /* Flag to build traces with the baseline tier and rebuild the hot ones */
+    bool tieredCompilation;
+
+    /* Entries into a baseline trace before it is rebuilt */
+    int tierUpThreshold;
+
+    /* Compilation time allowed per second, in ms (0 - no limit) */
+    int compileBudget;
+
     /* Per-process debug flag toggled when receiving a SIGUSR2 */
     bool receivedSIGUSR2;
 
@@ -943,6 +1002,10 @@ struct DvmJitGlobals {
     /* Performance tuning counters */
     int                addrLookupsFound;
     int                addrLookupsNotFound;
+    int                addrLookupsOldTable;
+    int                addrLookupProbes[JIT_PROBE_HISTOGRAM_SIZE];
+    int                jitTableResizes;
+    int                jitTableEntriesMigrated;
     int                noChainExit[kNoChainExitLast];
     int                normalExit;
     int                puntExit;
@@ -953,12 +1016,25 @@ struct DvmJitGlobals {
     int                invokeMonoSetterInlined;
     int                invokePolyGetterInlined;
     int                invokePolySetterInlined;
+    int                invokeMonoStraightLineInlined;
+    int                invokePolyStraightLineInlined;
+    int                invokeConstructorInlined;
+    int                redundantLoadsEliminated;
+    int                loopInvariantsHoisted;
+    int                allocationsEliminated;
+    int                loopsVectorized;
+    int                loopGlobalVRs;
+    int                vrSpillStores;
+    int                tempSpills;
     int                returnOp;
     int                icPatchInit;
     int                icPatchLockFree;
     int                icPatchQueued;
     int                icPatchRejected;
     int                icPatchDropped;
+    int                icPatchKept;
+    int                icPatchMegamorphic;
+    int                icProfileOverflow;
     int                codeCachePatches;
     int                numCompilerThreadBlockGC;
     u8                 jitTime;
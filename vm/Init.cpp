@@ -122,6 +122,7 @@ static void usage(const char* progName)
     dvmFprintf(stderr, "  -Xjniopts:{warnonly,forcecopy}\n");
     dvmFprintf(stderr, "  -Xjnitrace:substring (eg NativeClass or nativeMethod)\n");
     dvmFprintf(stderr, "  -Xstacktracefile:<filename>\n");
+    dvmFprintf(stderr, "  -Xbootclasspaththreads:N  (0 means one per CPU)\n");
     dvmFprintf(stderr, "  -Xgc:[no]precise\n");
     dvmFprintf(stderr, "  -Xgc:[no]preverify\n");
     dvmFprintf(stderr, "  -Xgc:[no]postverify\n");
@@ -145,6 +146,11 @@ static void usage(const char* progName)
     dvmFprintf(stderr, "  -Xjitconfig:filename\n");
     dvmFprintf(stderr, "  -Xjitcheckcg\n");
     dvmFprintf(stderr, "  -Xjitverbose\n");
+    dvmFprintf(stderr, "  -Xjitperfmap\n");
+    dvmFprintf(stderr, "  -Xjitexitprofile\n");
+    dvmFprintf(stderr, "  -Xjittiers\n");
+    dvmFprintf(stderr, "  -Xjittierthreshold:decimalvalue\n");
+    dvmFprintf(stderr, "  -Xjitcompilebudget:ms-per-second\n");
     dvmFprintf(stderr, "  -Xjitprofile\n");
     dvmFprintf(stderr, "  -Xjitdisableopt\n");
     dvmFprintf(stderr, "  -Xjitsuspendpoll\n");
@@ -1134,6 +1140,16 @@ static int processOptions(int argc, const char* const argv[],
           gDvmJit.printBinary = true;
         } else if (strncmp(argv[i], "-Xjitverbose", 12) == 0) {
           gDvmJit.printMe = true;
+        } else if (strncmp(argv[i], "-Xjitperfmap", 12) == 0) {
+          gDvmJit.perfMap = true;
+        } else if (strncmp(argv[i], "-Xjitexitprofile", 16) == 0) {
+          gDvmJit.exitProfile = true;
+        } else if (strncmp(argv[i], "-Xjittierthreshold:", 19) == 0) {
+          gDvmJit.tierUpThreshold = atoi(argv[i] + 19);
+        } else if (strncmp(argv[i], "-Xjittiers", 10) == 0) {
+          gDvmJit.tieredCompilation = true;
+        } else if (strncmp(argv[i], "-Xjitcompilebudget:", 19) == 0) {
+          gDvmJit.compileBudget = atoi(argv[i] + 19);
         } else if (strncmp(argv[i], "-Xjitprofile", 12) == 0) {
           gDvmJit.profileMode = kTraceProfilingContinuous;
         } else if (strncmp(argv[i], "-Xjitdisableopt", 15) == 0) {
@@ -1151,6 +1167,9 @@ static int processOptions(int argc, const char* const argv[],
         } else if (strncmp(argv[i], "-Xstacktracefile:", 17) == 0) {
             gDvm.stackTraceFile = strdup(argv[i]+17);
 
+        } else if (strncmp(argv[i], "-Xbootclasspaththreads:", 23) == 0) {
+            gDvm.bootClassPathThreads = atoi(argv[i] + 23);
+
         } else if (strcmp(argv[i], "-Xgenregmap") == 0) {
             gDvm.generateRegisterMaps = true;
         } else if (strcmp(argv[i], "-Xnogenregmap") == 0) {
@@ -1851,7 +1870,7 @@ static bool initJdwp()
  * Returns 0 on success.
  */
 int dvmPrepForDexOpt(const char* bootClassPath, DexOptimizerMode dexOptMode,
-    DexClassVerifyMode verifyMode, int dexoptFlags)
+    DexClassVerifyMode verifyMode, int dexoptFlags, int dexOptThreads)
 {
     gDvm.initializing = true;
     gDvm.optimizing = true;
@@ -1876,6 +1895,7 @@ int dvmPrepForDexOpt(const char* bootClassPath, DexOptimizerMode dexOptMode,
     } else {
         gDvm.dexOptForSmp = (ANDROID_SMP != 0);
     }
+    gDvm.dexOptThreads = dexOptThreads;
 
     /*
      * Initialize the heap, some basic thread control mutexes, and
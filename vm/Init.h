@@ -36,9 +36,12 @@ void dvmLateEnableAssertions(void);
 /*
  * Partial VM initialization; only used as part of "dexopt", which may be
  * asked to optimize a DEX file holding fundamental classes.
+ *
+ * "dexOptThreads" is the number of threads that verify and optimize
+ * classes; zero picks one per online CPU.
  */
 int dvmPrepForDexOpt(const char* bootClassPath, DexOptimizerMode dexOptMode,
-    DexClassVerifyMode verifyMode, int dexoptFlags);
+    DexClassVerifyMode verifyMode, int dexoptFlags, int dexOptThreads);
 
 /*
  * Look up the set of classes and members used directly by the VM,
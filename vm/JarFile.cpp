@@ -30,8 +30,10 @@
 #include <zlib.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/file.h>
 
 static const char* kDexInJarName = "classes.dex";
+static const char* kZipIndexName = "zipindex";
 
 /*
  * Attempt to open a file whose name is similar to <fileName>,
@@ -79,6 +81,28 @@ bail:
     return -1;
 }
 
+/*
+ * Open the archive.  Bootstrap jars are opened at every VM start, dexopt
+ * included, can hold tens of thousands of resources, and don't come and
+ * go with app installs, so we keep their entry-name index in the cache
+ * to avoid scanning the whole central directory each time.
+ *
+ * Returns 0 on success.
+ */
+static int openArchive(const char* fileName, bool isBootstrap,
+    ZipArchive* pArchive)
+{
+    if (!isBootstrap)
+        return dexZipOpenArchive(fileName, pArchive);
+
+    char* indexName = dexOptGenerateCacheFileName(fileName, kZipIndexName);
+    int err = (indexName != NULL) ?
+        dexZipOpenArchiveIndexed(fileName, indexName, pArchive) :
+        dexZipOpenArchive(fileName, pArchive);
+    free(indexName);
+    return err;
+}
+
 /*
  * Checks the dependencies of the dex cache file corresponding
  * to the jar file at the absolute path "fileName".
@@ -204,7 +228,7 @@ int dvmJarFileOpen(const char* fileName, const char* odexOutputName,
     /* Even if we're not going to look at the archive, we need to
      * open it so we can stuff it into ppJarFile.
      */
-    if (dexZipOpenArchive(fileName, &archive) != 0)
+    if (openArchive(fileName, isBootstrap, &archive) != 0)
         goto bail;
     archiveOpen = true;
 
@@ -363,6 +387,89 @@ bail:
     return result;
 }
 
+/*
+ * Open a bootstrap Jar file's optimized DEX, if it has an up-to-date one,
+ * leaving the check of its dependencies on the rest of the bootstrap
+ * class path to the caller.
+ *
+ * This follows dvmJarFileOpen(), but never creates or rewrites anything:
+ * the odex alongside the jar or the one in the cache must already be
+ * there and look good.  It only takes a shared lock on the cache file,
+ * which is enough to keep a dexopt in another process from rewriting it
+ * while we check and map it.  Nothing here touches the VM's state.
+ */
+int dvmJarFileOpenDeferDeps(const char* fileName, JarFile** ppJarFile,
+    u1** ppDepData, u4* pDepsLength)
+{
+    ZipArchive archive;
+    DvmDex* pDvmDex = NULL;
+    char* cachedName = NULL;
+    bool archiveOpen = false;
+    u1* depData = NULL;
+    u4 depsLength = 0;
+    int fd = -1;
+    int result = -1;
+
+    if (openArchive(fileName, true, &archive) != 0)
+        goto bail;
+    archiveOpen = true;
+    dvmSetCloseOnExec(dexZipGetArchiveFd(&archive));
+
+    fd = openAlternateSuffix(fileName, "odex", O_RDONLY, &cachedName);
+    if (fd >= 0 &&
+        !dvmCheckOptHeader(fd, false, 0, 0, &depData, &depsLength))
+    {
+        free(cachedName);
+        cachedName = NULL;
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0) {
+        ZipEntry entry = dexZipFindEntry(&archive, kDexInJarName);
+        if (entry == NULL)
+            goto bail;
+
+        cachedName = dexOptGenerateCacheFileName(fileName, kDexInJarName);
+        if (cachedName == NULL)
+            goto bail;
+        fd = open(cachedName, O_RDONLY, 0);
+        if (fd < 0)
+            goto bail;
+
+        if (flock(fd, LOCK_SH) != 0 ||
+            !dvmCheckOptHeader(fd, true,
+                dexGetZipEntryModTime(&archive, entry),
+                dexGetZipEntryCrc32(&archive, entry),
+                &depData, &depsLength))
+        {
+            goto bail;
+        }
+    }
+
+    if (dvmDexFileOpenFromFd(fd, &pDvmDex) != 0)
+        goto bail;
+
+    *ppJarFile = (JarFile*) calloc(1, sizeof(JarFile));
+    (*ppJarFile)->archive = archive;
+    (*ppJarFile)->cacheFileName = cachedName;
+    (*ppJarFile)->pDvmDex = pDvmDex;
+    *ppDepData = depData;
+    *pDepsLength = depsLength;
+    cachedName = NULL;      // don't free these below
+    depData = NULL;
+    result = 0;
+
+bail:
+    if (archiveOpen && result != 0)
+        dexZipCloseArchive(&archive);
+    free(cachedName);
+    free(depData);
+    if (fd >= 0)
+        close(fd);          // also drops the lock
+    return result;
+}
+
 /*
  * Close a Jar file and free the struct.
  */
@@ -39,6 +39,20 @@ struct JarFile {
 int dvmJarFileOpen(const char* fileName, const char* odexOutputName,
     JarFile** ppJarFile, bool isBootstrap);
 
+/*
+ * Open a bootstrap class path Jar file whose optimized DEX is already up
+ * to date, without checking its dependencies on the other bootstrap
+ * class path entries.  Fails (without trying to fix anything) if there is
+ * no usable optimized DEX.  May be called from a thread that isn't
+ * attached to the VM.
+ *
+ * On success, returns 0, sets "*ppJarFile", and returns the dependency
+ * data in "*ppDepData" (free() it) for dvmCheckBootClassPathDeps().  The
+ * caller must check that before using the JarFile.
+ */
+int dvmJarFileOpenDeferDeps(const char* fileName, JarFile** ppJarFile,
+    u1** ppDepData, u4* pDepsLength);
+
 /*
  * Free a JarFile structure, along with any associated structures.
  */
@@ -27,17 +27,11 @@
 #include <unistd.h>
 
 /*
- * Copy the given number of bytes from one fd to another, first
- * seeking the source fd to the start of the file.
+ * Copy the given number of bytes from the start of one fd to another.
  */
 static int copyFileToFile(int destFd, int srcFd, size_t size)
 {
-    if (lseek(srcFd, 0, SEEK_SET) != 0) {
-        ALOGE("lseek failure: %s", strerror(errno));
-        return -1;
-    }
-
-    return sysCopyFileToFile(destFd, srcFd, size);
+    return sysCopyFileSegmentToFile(destFd, srcFd, 0, size);
 }
 
 /*
@@ -431,6 +431,7 @@ static const char* getSuspendCauseStr(SuspendCause why)
     case SUSPEND_FOR_IC_PATCH:      return "inline-cache-patch";
     case SUSPEND_FOR_CC_RESET:      return "reset-code-cache";
     case SUSPEND_FOR_REFRESH:       return "refresh jit status";
+    case SUSPEND_FOR_TIER_UP:       return "jit-tier-up";
 #endif
     default:                        return "UNKNOWN";
     }
@@ -2168,6 +2169,76 @@ void dvmDetachCurrentThread()
     freeThread(self);
 }
 
+/*
+ * Attach the current thread to a VM that was started with
+ * dvmPrepForDexOpt().  There is no java.lang.Thread or thread group to
+ * join at that point -- the main thread doesn't have one either -- so we
+ * just set up a Thread struct and add it to the thread list.  That is
+ * enough to load classes, lock monitors, throw and catch exceptions, and
+ * take part in suspend-all for the GC.
+ */
+bool dvmAttachOptimizerThread()
+{
+    Thread* self;
+    bool ok;
+
+    assert(gDvm.optimizing);
+
+    self = allocThread(gDvm.stackSize);
+    if (self == NULL)
+        return false;
+    setThreadSelf(self);
+
+    dvmLockThreadList(self);
+    ok = prepareThread(self);
+    if (ok) {
+        LOG_THREAD("threadid=%d: adding to list (optimizer)", self->threadId);
+        self->next = gDvm.threadList->next;
+        if (self->next != NULL)
+            self->next->prev = self;
+        self->prev = gDvm.threadList;
+        gDvm.threadList->next = self;
+    } else {
+        releaseThreadId(self);
+    }
+    dvmUnlockThreadList();
+    if (!ok) {
+        setThreadSelf(NULL);
+        freeThread(self);
+        return false;
+    }
+
+    /* stall here if a GC started before we were on the list */
+    assert(self->status == THREAD_INITIALIZING);
+    dvmChangeStatus(self, THREAD_VMWAIT);
+    dvmLockMutex(&gDvm.gcHeapLock);
+    dvmUnlockMutex(&gDvm.gcHeapLock);
+    dvmChangeStatus(self, THREAD_RUNNING);
+    return true;
+}
+
+/*
+ * Undo dvmAttachOptimizerThread().  The thread must not hold any
+ * monitors.
+ */
+void dvmDetachOptimizerThread()
+{
+    Thread* self = dvmThreadSelf();
+
+    assert(!dvmCheckException(self));
+
+    /* don't hold up a GC while we wait for the thread list lock */
+    dvmChangeStatus(self, THREAD_VMWAIT);
+    dvmLockThreadList(self);
+    self->status = THREAD_ZOMBIE;
+    unlinkThread(self);
+    releaseThreadId(self);
+    dvmUnlockThreadList();
+
+    setThreadSelf(NULL);
+    freeThread(self);
+}
+
 
 /*
  * Suspend a single thread.  Do not use to suspend yourself.
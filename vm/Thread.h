@@ -363,6 +363,7 @@ enum SuspendCause {
     SUSPEND_FOR_IC_PATCH,    // polymorphic callsite inline-cache patch
     SUSPEND_FOR_CC_RESET,    // code-cache reset
     SUSPEND_FOR_REFRESH,     // Reload data cached in interpState
+    SUSPEND_FOR_TIER_UP,     // install optimized translations
 #endif
 };
 void dvmSuspendThread(Thread* thread);
@@ -502,6 +503,13 @@ bool dvmCreateInternalThread(pthread_t* pHandle, const char* name,
 bool dvmAttachCurrentThread(const JavaVMAttachArgs* pArgs, bool isDaemon);
 void dvmDetachCurrentThread(void);
 
+/*
+ * Attach or detach a helper thread in the "dexopt" process.  No
+ * java.lang.Thread is created for it.
+ */
+bool dvmAttachOptimizerThread(void);
+void dvmDetachOptimizerThread(void);
+
 /*
  * Get the "main" or "system" thread group.
  */
@@ -18,14 +18,15 @@
  * Dalvik bytecode structural verifier.  The only public entry point
  * (except for a few shared utility functions) is dvmVerifyCodeFlow().
  *
- * TODO: might benefit from a signature-->class lookup cache.  Could avoid
- * some string-peeling and wouldn't need to compute hashes.
+ * During dexopt, class lookups by descriptor and reference type merges
+ * go through gDvm.verifyCache (see VerifyCache.h).
  */
 #include "Dalvik.h"
 #include "analysis/Liveness.h"
 #include "analysis/CodeVerify.h"
 #include "analysis/Optimize.h"
 #include "analysis/RegisterMap.h"
+#include "analysis/VerifyCache.h"
 #include "libdex/DexCatch.h"
 #include "libdex/InstrUtils.h"
 
@@ -68,6 +69,14 @@ static bool gDebugVerbose = false;
 #define kExtraRegs  2
 #define RESULT_REGISTER(_insnRegCount)  (_insnRegCount)
 
+/*
+ * A block of RegChunks, allocated together.
+ */
+struct RegChunkBlock {
+    RegChunkBlock*  next;
+    RegChunk        chunks[1];
+};
+
 /*
  * Big fat collection of register data.
  */
@@ -85,6 +94,26 @@ typedef struct RegisterTable {
      */
     size_t      insnRegCountPlus;
 
+    /*
+     * Number of RegChunks needed to hold insnRegCountPlus registers.
+     */
+    size_t      chunksPerLine;
+
+    /*
+     * Chunks that aren't in use, and the blocks all chunks came from.  The
+     * blocks get bigger as the method needs more of them.
+     */
+    RegChunk*   freeChunks;
+    RegChunkBlock* chunkBlocks;
+    size_t      nextBlockSize;
+
+    /*
+     * Chunks in use, now and at most, and the size of everything else.
+     */
+    size_t      liveChunks;
+    size_t      peakChunks;
+    size_t      fixedSize;
+
     /*
      * Storage for a register line we're currently working on.
      */
@@ -97,7 +126,8 @@ typedef struct RegisterTable {
 
     /*
      * A single large alloc, with all of the storage needed for RegisterLine
-     * data (RegType array, MonitorEntries array, monitor stack).
+     * data (RegChunk pointers, MonitorEntries array, monitor stack, and for
+     * workLine and savedLine the RegType array and dirty flags).
      */
     void*       lineAlloc;
 } RegisterTable;
@@ -631,9 +661,8 @@ static ClassObject* lookupClassByDescriptor(const Method* meth,
 
     //ALOGI("Looking up '%s'", typeStr);
     ClassObject* clazz;
-    clazz = dvmFindClassNoInit(pDescriptor, meth->clazz->classLoader);
+    clazz = dvmVerifyFindClass(pDescriptor, meth->clazz->classLoader, NULL);
     if (clazz == NULL) {
-        dvmClearOptException(dvmThreadSelf());
         if (strchr(pDescriptor, '$') != NULL) {
             ALOGV("VFY: unable to find class referenced in signature (%s)",
                 pDescriptor);
@@ -662,8 +691,8 @@ static ClassObject* lookupClassByDescriptor(const Method* meth,
              * have a problem loading those.  (I'm not convinced this
              * is correct or even useful.  Just use Object here?)
              */
-            clazz = dvmFindClassNoInit("[Ljava/lang/Object;",
-                meth->clazz->classLoader);
+            clazz = dvmVerifyFindClass("[Ljava/lang/Object;",
+                meth->clazz->classLoader, NULL);
         } else if (pDescriptor[0] == 'L') {
             /*
              * We are looking at a non-array reference descriptor;
@@ -1380,14 +1409,13 @@ static ClassObject* getFieldClass(const Method* meth, const Field* field)
     const char* signature = field->signature;
 
     if ((*signature == 'L') || (*signature == '[')) {
-        fieldClass = dvmFindClassNoInit(signature,
-                meth->clazz->classLoader);
+        fieldClass = dvmVerifyFindClass(signature,
+                meth->clazz->classLoader, NULL);
     } else {
         return NULL;
     }
 
     if (fieldClass == NULL) {
-        dvmClearOptException(dvmThreadSelf());
         ALOGV("VFY: unable to find class '%s' for field %s.%s, trying Object",
             field->signature, meth->clazz->descriptor, field->name);
         fieldClass = gDvm.classJavaLangObject;
@@ -1415,6 +1443,17 @@ static inline RegType getRegisterType(const RegisterLine* registerLine, u4 vsrc)
     return registerLine->regTypes[vsrc];
 }
 
+/*
+ * Store a type in register N, and note that its chunk no longer matches
+ * the one the line was copied from.
+ */
+static inline void storeRegisterType(RegisterLine* registerLine, u4 vdst,
+    RegType newType)
+{
+    registerLine->regTypes[vdst] = newType;
+    registerLine->dirtyChunks[vdst >> kRegChunkShift] = 1;
+}
+
 /*
  * Get the value from a register, and cast it to a ClassObject.  Sets
  * "*pFailure" if something fails.
@@ -1501,8 +1540,6 @@ bail:
 static void setRegisterType(RegisterLine* registerLine, u4 vdst,
     RegType newType)
 {
-    RegType* insnRegs = registerLine->regTypes;
-
     switch (newType) {
     case kRegTypeUnknown:
     case kRegTypeBoolean:
@@ -1522,13 +1559,13 @@ static void setRegisterType(RegisterLine* registerLine, u4 vdst,
     case kRegTypeFloat:
     case kRegTypeZero:
     case kRegTypeUninit:
-        insnRegs[vdst] = newType;
+        storeRegisterType(registerLine, vdst, newType);
         break;
     case kRegTypeConstLo:
     case kRegTypeLongLo:
     case kRegTypeDoubleLo:
-        insnRegs[vdst] = newType;
-        insnRegs[vdst+1] = newType+1;
+        storeRegisterType(registerLine, vdst, newType);
+        storeRegisterType(registerLine, vdst+1, newType+1);
         break;
     case kRegTypeConstHi:
     case kRegTypeLongHi:
@@ -1541,7 +1578,7 @@ static void setRegisterType(RegisterLine* registerLine, u4 vdst,
     default:
         /* can't switch for ref types, so we check explicitly */
         if (regTypeIsReference(newType)) {
-            insnRegs[vdst] = newType;
+            storeRegisterType(registerLine, vdst, newType);
 
             /*
              * In most circumstances we won't see a reference to a primitive
@@ -1721,7 +1758,7 @@ static void setResultRegisterType(RegisterLine* registerLine,
 static void markRefsAsInitialized(RegisterLine* registerLine, int insnRegCount,
     UninitInstanceMap* uninitMap, RegType uninitType, VerifyError* pFailure)
 {
-    RegType* insnRegs = registerLine->regTypes;
+    const RegType* insnRegs = registerLine->regTypes;
     ClassObject* clazz;
     RegType initType;
     int i, changed;
@@ -1738,7 +1775,7 @@ static void markRefsAsInitialized(RegisterLine* registerLine, int insnRegCount,
     changed = 0;
     for (i = 0; i < insnRegCount; i++) {
         if (insnRegs[i] == uninitType) {
-            insnRegs[i] = initType;
+            storeRegisterType(registerLine, i, initType);
             changed++;
         }
     }
@@ -1758,13 +1795,13 @@ static void markRefsAsInitialized(RegisterLine* registerLine, int insnRegCount,
 static void markUninitRefsAsInvalid(RegisterLine* registerLine,
     int insnRegCount, UninitInstanceMap* uninitMap, RegType uninitType)
 {
-    RegType* insnRegs = registerLine->regTypes;
+    const RegType* insnRegs = registerLine->regTypes;
     int i, changed;
 
     changed = 0;
     for (i = 0; i < insnRegCount; i++) {
         if (insnRegs[i] == uninitType) {
-            insnRegs[i] = kRegTypeConflict;
+            storeRegisterType(registerLine, i, kRegTypeConflict);
             if (registerLine->monitorEntries != NULL)
                 registerLine->monitorEntries[i] = 0;
             changed++;
@@ -1785,13 +1822,96 @@ static inline RegisterLine* getRegisterLine(const RegisterTable* regTable,
 }
 
 /*
- * Copy a register line.
+ * Get an unused chunk, with a reference count of 1 and unspecified
+ * contents.  Returns NULL if we run out of memory.
  */
-static inline void copyRegisterLine(RegisterLine* dst, const RegisterLine* src,
-    size_t numRegs)
+static RegChunk* allocRegChunk(RegisterTable* regTable)
 {
-    memcpy(dst->regTypes, src->regTypes, numRegs * sizeof(RegType));
+    RegChunk* chunk = regTable->freeChunks;
+
+    if (chunk == NULL) {
+        size_t count = regTable->nextBlockSize;
+        RegChunkBlock* block = (RegChunkBlock*) malloc(sizeof(RegChunkBlock) +
+            (count - 1) * sizeof(RegChunk));
+        if (block == NULL) {
+            ALOGE("VFY: unable to allocate %zd register chunks", count);
+            return NULL;
+        }
+        block->next = regTable->chunkBlocks;
+        regTable->chunkBlocks = block;
+        if (count < 4096)
+            regTable->nextBlockSize = count * 2;
 
+        for (size_t i = 0; i < count; i++) {
+            block->chunks[i].nextFree = chunk;
+            chunk = &block->chunks[i];
+        }
+    }
+
+    regTable->freeChunks = chunk->nextFree;
+    chunk->refCount = 1;
+    if (++regTable->liveChunks > regTable->peakChunks)
+        regTable->peakChunks = regTable->liveChunks;
+    return chunk;
+}
+
+/*
+ * Add and drop references to a chunk.  NULL is allowed.
+ */
+static inline void retainRegChunk(RegChunk* chunk)
+{
+    if (chunk != NULL)
+        chunk->refCount++;
+}
+static inline void releaseRegChunk(RegisterTable* regTable, RegChunk* chunk)
+{
+    if (chunk != NULL && --chunk->refCount == 0) {
+        chunk->nextFree = regTable->freeChunks;
+        regTable->freeChunks = chunk;
+        regTable->liveChunks--;
+    }
+}
+
+/*
+ * Replace chunk "idx" of "line" with "chunk", which the caller has
+ * already retained.
+ */
+static inline void replaceRegChunk(RegisterTable* regTable,
+    RegisterLine* line, size_t idx, RegChunk* chunk)
+{
+    releaseRegChunk(regTable, line->regChunks[idx]);
+    line->regChunks[idx] = chunk;
+}
+
+/*
+ * Get chunk "idx" of a line in the table so we can change it, making a
+ * private copy if it's shared.  Returns NULL if we run out of memory.
+ */
+static RegChunk* unshareRegChunk(RegisterTable* regTable, RegisterLine* line,
+    size_t idx)
+{
+    RegChunk* chunk = line->regChunks[idx];
+
+    if (chunk != NULL && chunk->refCount == 1)
+        return chunk;
+
+    RegChunk* newChunk = allocRegChunk(regTable);
+    if (newChunk == NULL)
+        return NULL;
+    if (chunk != NULL)
+        memcpy(newChunk->regs, chunk->regs, sizeof(newChunk->regs));
+    else
+        memset(newChunk->regs, 0, sizeof(newChunk->regs));
+    replaceRegChunk(regTable, line, idx, newChunk);
+    return newChunk;
+}
+
+/*
+ * Copy the monitor state of a register line.
+ */
+static inline void copyLineMonitors(RegisterLine* dst, const RegisterLine* src,
+    size_t numRegs)
+{
     assert((src->monitorEntries == NULL && dst->monitorEntries == NULL) ||
            (src->monitorEntries != NULL && dst->monitorEntries != NULL));
     if (dst->monitorEntries != NULL) {
@@ -1805,25 +1925,115 @@ static inline void copyRegisterLine(RegisterLine* dst, const RegisterLine* src,
 }
 
 /*
- * Copy a register line into the table.
+ * Copy one working register line to another.  Chunks that both lines
+ * still share are already the same.
  */
-static inline void copyLineToTable(RegisterTable* regTable, int insnIdx,
+static void copyRegisterLine(RegisterTable* regTable, RegisterLine* dst,
     const RegisterLine* src)
+{
+    size_t idx;
+
+    for (idx = 0; idx < regTable->chunksPerLine; idx++) {
+        RegChunk* chunk = src->regChunks[idx];
+
+        if (chunk == dst->regChunks[idx] &&
+            !src->dirtyChunks[idx] && !dst->dirtyChunks[idx])
+        {
+            continue;
+        }
+        memcpy(dst->regTypes + (idx << kRegChunkShift),
+            src->regTypes + (idx << kRegChunkShift),
+            kRegChunkSize * sizeof(RegType));
+        retainRegChunk(chunk);
+        replaceRegChunk(regTable, dst, idx, chunk);
+        dst->dirtyChunks[idx] = src->dirtyChunks[idx];
+    }
+
+    copyLineMonitors(dst, src, regTable->insnRegCountPlus);
+}
+
+/*
+ * Copy a working register line into the table, at an address we haven't
+ * stored anything for yet.  Clean chunks are shared with the line they
+ * came from; the dirty ones get new chunks, which "src" then shares too,
+ * so the copies we make further along only need the registers that
+ * change after this point.
+ *
+ * Returns "false" if we run out of memory.
+ */
+static bool copyLineToTable(RegisterTable* regTable, int insnIdx,
+    RegisterLine* src)
 {
     RegisterLine* dst = getRegisterLine(regTable, insnIdx);
-    assert(dst->regTypes != NULL);
-    copyRegisterLine(dst, src, regTable->insnRegCountPlus);
+    size_t idx;
+
+    assert(dst->regChunks != NULL);
+
+    for (idx = 0; idx < regTable->chunksPerLine; idx++) {
+        RegChunk* chunk = src->regChunks[idx];
+
+        if (src->dirtyChunks[idx]) {
+            chunk = allocRegChunk(regTable);
+            if (chunk == NULL)
+                return false;
+            memcpy(chunk->regs, src->regTypes + (idx << kRegChunkShift),
+                sizeof(chunk->regs));
+            replaceRegChunk(regTable, src, idx, chunk);
+            src->dirtyChunks[idx] = 0;
+        }
+        retainRegChunk(chunk);
+        replaceRegChunk(regTable, dst, idx, chunk);
+    }
+
+    copyLineMonitors(dst, src, regTable->insnRegCountPlus);
+    return true;
 }
 
 /*
- * Copy a register line out of the table.
+ * Copy a register line out of the table.  We only need to touch the
+ * chunks the working line doesn't already have.
  */
-static inline void copyLineFromTable(RegisterLine* dst,
-    const RegisterTable* regTable, int insnIdx)
+static void copyLineFromTable(RegisterLine* dst, RegisterTable* regTable,
+    int insnIdx)
 {
-    RegisterLine* src = getRegisterLine(regTable, insnIdx);
-    assert(src->regTypes != NULL);
-    copyRegisterLine(dst, src, regTable->insnRegCountPlus);
+    const RegisterLine* src = getRegisterLine(regTable, insnIdx);
+    size_t idx;
+
+    assert(src->regChunks != NULL);
+
+    for (idx = 0; idx < regTable->chunksPerLine; idx++) {
+        RegChunk* chunk = src->regChunks[idx];
+        RegType* regs = dst->regTypes + (idx << kRegChunkShift);
+
+        if (chunk == dst->regChunks[idx] && !dst->dirtyChunks[idx])
+            continue;
+        if (chunk != NULL)
+            memcpy(regs, chunk->regs, sizeof(chunk->regs));
+        else
+            memset(regs, 0, sizeof(chunk->regs));
+        retainRegChunk(chunk);
+        replaceRegChunk(regTable, dst, idx, chunk);
+        dst->dirtyChunks[idx] = 0;
+    }
+
+    copyLineMonitors(dst, src, regTable->insnRegCountPlus);
+}
+
+/*
+ * Free every chunk, when we're done with the method.
+ */
+static void freeRegChunks(RegisterTable* regTable)
+{
+    RegChunkBlock* block = regTable->chunkBlocks;
+
+    while (block != NULL) {
+        RegChunkBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    regTable->chunkBlocks = NULL;
+    regTable->freeChunks = NULL;
+    regTable->liveChunks = 0;
 }
 
 
@@ -1861,8 +2071,15 @@ static inline int compareLineToTable(const RegisterTable* regTable,
             return result;
         }
     }
-    return memcmp(line1->regTypes, line2->regTypes,
-            regTable->insnRegCountPlus * sizeof(RegType));
+
+    size_t idx;
+    for (idx = 0; idx < regTable->insnRegCountPlus; idx++) {
+        RegType type1 = dvmRegisterLineGetType(line1, idx);
+        RegType type2 = dvmRegisterLineGetType(line2, idx);
+        if (type1 != type2)
+            return (type1 < type2) ? -1 : 1;
+    }
+    return 0;
 }
 #endif
 
@@ -2486,6 +2703,27 @@ static ClassObject* findCommonSuperclass(ClassObject* c1, ClassObject* c2)
     return digForSuperclass(c1, c2);
 }
 
+/*
+ * Like findCommonSuperclass(), but uses the merge cache in dexopt.
+ */
+static ClassObject* findCommonSuperclassCached(ClassObject* c1,
+    ClassObject* c2)
+{
+    VerifyCache* pCache = gDvm.verifyCache;
+
+    if (pCache == NULL || c1 == c2)
+        return findCommonSuperclass(c1, c2);
+
+    android_atomic_inc(&pCache->mergeLookups);
+#define ATOMIC_CACHE_CALC \
+    (android_atomic_inc(&pCache->mergeMisses), findCommonSuperclass(c1, c2))
+#define ATOMIC_CACHE_NULL_ALLOWED false
+    return (ClassObject*) ATOMIC_CACHE_LOOKUP(pCache->merges,
+                VERIFY_MERGE_CACHE_SIZE, c1, c2);
+#undef ATOMIC_CACHE_CALC
+#undef ATOMIC_CACHE_NULL_ALLOWED
+}
+
 /*
  * Merge two RegType values.
  *
@@ -2539,7 +2777,7 @@ static RegType mergeTypes(RegType type1, RegType type2, bool* pChanged)
                 ClassObject* clazz2 = regTypeInitializedReferenceToClass(type2);
                 ClassObject* mergedClass;
 
-                mergedClass = findCommonSuperclass(clazz1, clazz2);
+                mergedClass = findCommonSuperclassCached(clazz1, clazz2);
                 assert(mergedClass != NULL);
                 result = regTypeFromClass(mergedClass);
             }
@@ -2575,14 +2813,18 @@ static MonitorEntries mergeMonitorEntries(MonitorEntries ents1,
  * set the "changed" flag on the target address if any of the registers
  * has changed.
  *
- * Returns "false" if we detect mis-matched monitor stacks.
+ * Only the chunks where the two lines might differ are merged: a chunk
+ * the work line hasn't written since it was copied from or to the very
+ * chunk the target holds can't change anything.
+ *
+ * Returns "false" if we detect mis-matched monitor stacks, or run out of
+ * memory.
  */
 static bool updateRegisters(const Method* meth, InsnFlags* insnFlags,
-    RegisterTable* regTable, int nextInsn, const RegisterLine* workLine)
+    RegisterTable* regTable, int nextInsn, RegisterLine* workLine)
 {
     const size_t insnRegCountPlus = regTable->insnRegCountPlus;
     assert(workLine != NULL);
-    const RegType* workRegs = workLine->regTypes;
 
     if (!dvmInsnIsVisitedOrChanged(insnFlags, nextInsn)) {
         /*
@@ -2593,7 +2835,8 @@ static bool updateRegisters(const Method* meth, InsnFlags* insnFlags,
          * just an optimization.)
          */
         LOGVV("COPY into 0x%04x", nextInsn);
-        copyLineToTable(regTable, nextInsn, workLine);
+        if (!copyLineToTable(regTable, nextInsn, workLine))
+            return false;
         dvmInsnSetChanged(insnFlags, nextInsn, true);
 #ifdef VERIFIER_STATS
         gDvm.verifierStats.copyRegCount++;
@@ -2606,13 +2849,12 @@ static bool updateRegisters(const Method* meth, InsnFlags* insnFlags,
         }
         /* merge registers, set Changed only if different */
         RegisterLine* targetLine = getRegisterLine(regTable, nextInsn);
-        RegType* targetRegs = targetLine->regTypes;
         MonitorEntries* workMonEnts = workLine->monitorEntries;
         MonitorEntries* targetMonEnts = targetLine->monitorEntries;
         bool changed = false;
         unsigned int idx;
 
-        assert(targetRegs != NULL);
+        assert(targetLine->regChunks != NULL);
 
         if (targetMonEnts != NULL) {
             /*
@@ -2632,18 +2874,50 @@ static bool updateRegisters(const Method* meth, InsnFlags* insnFlags,
                     nextInsn);
                 return false;
             }
-        }
 
-        for (idx = 0; idx < insnRegCountPlus; idx++) {
-            targetRegs[idx] =
-                    mergeTypes(targetRegs[idx], workRegs[idx], &changed);
-
-            if (targetMonEnts != NULL) {
+            for (idx = 0; idx < insnRegCountPlus; idx++) {
                 targetMonEnts[idx] = mergeMonitorEntries(targetMonEnts[idx],
                     workMonEnts[idx], &changed);
             }
         }
 
+        for (idx = 0; idx < regTable->chunksPerLine; idx++) {
+            RegChunk* chunk = targetLine->regChunks[idx];
+            const RegType* workRegs =
+                workLine->regTypes + (idx << kRegChunkShift);
+            int i;
+
+            if (chunk == workLine->regChunks[idx] &&
+                !workLine->dirtyChunks[idx])
+            {
+#ifdef VERIFIER_STATS
+                gDvm.verifierStats.mergeChunksSkipped++;
+#endif
+                continue;
+            }
+
+            for (i = 0; i < kRegChunkSize; i++) {
+                RegType targetType =
+                    (chunk != NULL) ? chunk->regs[i] : kRegTypeUnknown;
+                bool regChanged = false;
+                RegType newType =
+                    mergeTypes(targetType, workRegs[i], &regChanged);
+
+                if (regChanged) {
+                    if (chunk == NULL || chunk->refCount != 1) {
+                        chunk = unshareRegChunk(regTable, targetLine, idx);
+                        if (chunk == NULL)
+                            return false;
+                    }
+                    chunk->regs[i] = newType;
+                    changed = true;
+                }
+            }
+#ifdef VERIFIER_STATS
+            gDvm.verifierStats.mergeChunksExamined++;
+#endif
+        }
+
         if (gDebugVerbose) {
             //ALOGI(" RESULT (changed=%d)", changed);
             //dumpRegTypes(vdata, targetRegs, 0, "rslt", NULL, 0);
@@ -2984,15 +3258,24 @@ static ClassObject* getCaughtExceptionType(const Method* meth, int insnIdx,
 }
 
 /*
- * Helper for initRegisterTable.
+ * Helper for initRegisterTable.  Lines in the table get no RegType array
+ * or dirty flags ("regTypeSize" and "dirtySize" are zero).
  *
  * Returns an updated copy of "storage".
  */
 static u1* assignLineStorage(u1* storage, RegisterLine* line,
-    bool trackMonitors, size_t regTypeSize, size_t monEntSize, size_t stackSize)
+    bool trackMonitors, size_t chunkPtrSize, size_t regTypeSize,
+    size_t dirtySize, size_t monEntSize, size_t stackSize)
 {
-    line->regTypes = (RegType*) storage;
-    storage += regTypeSize;
+    line->regChunks = (RegChunk**) storage;
+    storage += chunkPtrSize;
+
+    if (regTypeSize != 0) {
+        line->regTypes = (RegType*) storage;
+        storage += regTypeSize;
+        line->dirtyChunks = storage;
+        storage += dirtySize;
+    }
 
     if (trackMonitors) {
         line->monitorEntries = (MonitorEntries*) storage;
@@ -3013,7 +3296,7 @@ static u1* assignLineStorage(u1* storage, RegisterLine* line,
  * what's in which register, but for verification purposes we only need to
  * store it at branch target addresses (because we merge into that).
  *
- * By zeroing out the regType storage we are effectively initializing the
+ * By zeroing out the RegChunk pointers we are effectively initializing the
  * register information to kRegTypeUnknown.
  *
  * We jump through some hoops here to minimize the total number of
@@ -3034,6 +3317,9 @@ static bool initRegisterTable(const VerifierData* vdata,
      * indirection.
      */
     regTable->insnRegCountPlus = meth->registersSize + kExtraRegs;
+    regTable->chunksPerLine =
+        (regTable->insnRegCountPlus + kRegChunkSize - 1) >> kRegChunkShift;
+    regTable->nextBlockSize = regTable->chunksPerLine * 2;
     regTable->registerLines =
         (RegisterLine*) calloc(insnsSize, sizeof(RegisterLine));
     if (regTable->registerLines == NULL)
@@ -3079,11 +3365,19 @@ static bool initRegisterTable(const VerifierData* vdata,
     }
 
     /*
-     * Allocate storage for the register type arrays.
+     * Allocate storage for the register lines.  The work lines have a
+     * RegType array that's a whole number of chunks, and each line has a
+     * RegChunk pointer per chunk.  The sizes are rounded up to keep the
+     * pointers aligned.
      * TODO: set trackMonitors based on global config option
      */
-    size_t regTypeSize = regTable->insnRegCountPlus * sizeof(RegType);
-    size_t monEntSize = regTable->insnRegCountPlus * sizeof(MonitorEntries);
+    const size_t kPtrAlign = sizeof(void*) - 1;
+    size_t chunkPtrSize = regTable->chunksPerLine * sizeof(RegChunk*);
+    size_t regTypeSize =
+        regTable->chunksPerLine * kRegChunkSize * sizeof(RegType);
+    size_t dirtySize = (regTable->chunksPerLine + kPtrAlign) & ~kPtrAlign;
+    size_t monEntSize = (regTable->insnRegCountPlus * sizeof(MonitorEntries)
+        + kPtrAlign) & ~kPtrAlign;
     size_t stackSize = kMaxMonitorStackDepth * sizeof(u4);
     bool trackMonitors;
 
@@ -3093,18 +3387,15 @@ static bool initRegisterTable(const VerifierData* vdata,
         trackMonitors = false;
     }
 
-    size_t spacePerEntry = regTypeSize +
+    size_t spacePerEntry = chunkPtrSize +
         (trackMonitors ? monEntSize + stackSize : 0);
-    regTable->lineAlloc = calloc(interestingCount, spacePerEntry);
+    size_t totalSpace = interestingCount * spacePerEntry +
+        kExtraLines * (regTypeSize + dirtySize);
+    regTable->lineAlloc = calloc(1, totalSpace);
     if (regTable->lineAlloc == NULL)
         return false;
 
-#ifdef VERIFIER_STATS
-    size_t totalSpace = interestingCount * spacePerEntry +
-        insnsSize * sizeof(RegisterLine);
-    if (gDvm.verifierStats.biggestAlloc < totalSpace)
-        gDvm.verifierStats.biggestAlloc = totalSpace;
-#endif
+    regTable->fixedSize = totalSpace + insnsSize * sizeof(RegisterLine);
 
     /*
      * Populate the sparse register line table.
@@ -3134,7 +3425,7 @@ static bool initRegisterTable(const VerifierData* vdata,
 
         if (interesting) {
             storage = assignLineStorage(storage, &regTable->registerLines[i],
-                trackMonitors, regTypeSize, monEntSize, stackSize);
+                trackMonitors, chunkPtrSize, 0, 0, monEntSize, stackSize);
         }
     }
 
@@ -3142,16 +3433,17 @@ static bool initRegisterTable(const VerifierData* vdata,
      * Grab storage for our "temporary" register lines.
      */
     storage = assignLineStorage(storage, &regTable->workLine,
-        trackMonitors, regTypeSize, monEntSize, stackSize);
+        trackMonitors, chunkPtrSize, regTypeSize, dirtySize, monEntSize,
+        stackSize);
     storage = assignLineStorage(storage, &regTable->savedLine,
-        trackMonitors, regTypeSize, monEntSize, stackSize);
+        trackMonitors, chunkPtrSize, regTypeSize, dirtySize, monEntSize,
+        stackSize);
 
     //ALOGD("Tracking registers for [%d], total %d in %d units",
     //    trackRegsFor, interestingCount-kExtraLines, insnsSize);
 
-    assert(storage - (u1*)regTable->lineAlloc ==
-        (int) (interestingCount * spacePerEntry));
-    assert(regTable->registerLines[0].regTypes != NULL);
+    assert(storage - (u1*)regTable->lineAlloc == (int) totalSpace);
+    assert(regTable->registerLines[0].regChunks != NULL);
     return true;
 }
 
@@ -3455,6 +3747,8 @@ bool dvmVerifyCodeFlow(VerifierData* vdata)
     const int insnsSize = vdata->insnsSize;
     const bool generateRegisterMap = gDvm.generateRegisterMaps;
     RegisterTable regTable;
+    bool isHuge = false;
+    u8 startWhen = 0;
 
     memset(&regTable, 0, sizeof(regTable));
 
@@ -3472,6 +3766,8 @@ bool dvmVerifyCodeFlow(VerifierData* vdata)
             "VFY: warning: method is huge (regs=%d insnsSize=%d)",
             meth->registersSize, insnsSize);
         /* might be bogus data, might be some huge generated method */
+        isHuge = true;
+        startWhen = dvmGetRelativeTimeUsec();
     }
 
     /*
@@ -3515,10 +3811,15 @@ bool dvmVerifyCodeFlow(VerifierData* vdata)
     /*
      * Initialize the types of the registers that correspond to the
      * method arguments.  We can determine this from the method signature.
+     * The first instruction is a branch target, so it has a table line
+     * to start from.
      */
-    if (!setTypesFromSignature(meth, regTable.registerLines[0].regTypes,
+    if (!setTypesFromSignature(meth, regTable.workLine.regTypes,
             vdata->uninitMap))
         goto bail;
+    memset(regTable.workLine.dirtyChunks, 1, regTable.chunksPerLine);
+    if (!copyLineToTable(&regTable, 0, &regTable.workLine))
+        goto bail;
 
     /*
      * Run the verifier.
@@ -3547,7 +3848,23 @@ bool dvmVerifyCodeFlow(VerifierData* vdata)
     result = true;
 
 bail:
+    if (isHuge) {
+        /* report what the biggest methods cost us */
+        ALOGD("VFY: %s.%s: %dms, %zd bytes of register data (%zd chunks)",
+            meth->clazz->descriptor, meth->name,
+            (int) ((dvmGetRelativeTimeUsec() - startWhen) / 1000),
+            regTable.fixedSize + regTable.peakChunks * sizeof(RegChunk),
+            regTable.peakChunks);
+    }
+#ifdef VERIFIER_STATS
+    size_t totalSpace =
+        regTable.fixedSize + regTable.peakChunks * sizeof(RegChunk);
+    if (gDvm.verifierStats.biggestAlloc < totalSpace)
+        gDvm.verifierStats.biggestAlloc = totalSpace;
+#endif
+
     freeRegisterLineInnards(vdata);
+    freeRegChunks(&regTable);
     free(regTable.registerLines);
     free(regTable.lineAlloc);
     return result;
@@ -3681,7 +3998,7 @@ static bool doCodeVerification(VerifierData* vdata, RegisterTable* regTable)
              * a full table) and make sure it actually matches.
              */
             RegisterLine* registerLine = getRegisterLine(regTable, insnIdx);
-            if (registerLine->regTypes != NULL &&
+            if (registerLine->regChunks != NULL &&
                 compareLineToTable(regTable, insnIdx, &regTable->workLine) != 0)
             {
                 char* desc = dexProtoCopyMethodDescriptor(&meth->prototype);
@@ -3854,12 +4171,12 @@ static bool verifyInstruction(const Method* meth, InsnFlags* insnFlags,
      */
     if ((nextFlags & kInstrCanThrow) != 0 && dvmInsnIsInTry(insnFlags, insnIdx))
     {
-        copyRegisterLine(&regTable->savedLine, workLine,
-            regTable->insnRegCountPlus);
+        copyRegisterLine(regTable, &regTable->savedLine, workLine);
     } else {
 #ifndef NDEBUG
         memset(regTable->savedLine.regTypes, 0xdd,
             regTable->insnRegCountPlus * sizeof(RegType));
+        memset(regTable->savedLine.dirtyChunks, 1, regTable->chunksPerLine);
 #endif
     }
 
@@ -5779,6 +6096,13 @@ sput_1nr_common:
     case OP_INVOKE_VIRTUAL_QUICK_RANGE:
     case OP_INVOKE_SUPER_QUICK:
     case OP_INVOKE_SUPER_QUICK_RANGE:
+    case OP_IGET_QUICK_IF_EQZ:
+    case OP_IGET_QUICK_IF_NEZ:
+    case OP_CONST_4_IF:
+    case OP_MOVE_RESULT_RETURN:
+    case OP_MOVE_RESULT_WIDE_RETURN:
+    case OP_MOVE_RESULT_OBJECT_RETURN:
+    case OP_AGET_ADD_INT:
         /* fall through to failure */
 
     /*
@@ -5805,13 +6129,6 @@ sput_1nr_common:
         /* fall through to failure */
 
     /* these should never appear during verification */
-    case OP_UNUSED_3E:
-    case OP_UNUSED_3F:
-    case OP_UNUSED_40:
-    case OP_UNUSED_41:
-    case OP_UNUSED_42:
-    case OP_UNUSED_43:
-    case OP_UNUSED_73:
     case OP_UNUSED_79:
     case OP_UNUSED_7A:
     case OP_BREAKPOINT:
@@ -5880,7 +6197,7 @@ sput_1nr_common:
         if (!checkMoveException(meth, insnIdx+insnWidth, "next"))
             goto bail;
 
-        if (getRegisterLine(regTable, insnIdx+insnWidth)->regTypes != NULL) {
+        if (getRegisterLine(regTable, insnIdx+insnWidth)->regChunks != NULL) {
             /*
              * Merge registers into what we have for the next instruction,
              * and set the "changed" flag if needed.
@@ -6087,7 +6404,6 @@ static void dumpRegTypes(const VerifierData* vdata,
 {
     const Method* meth = vdata->method;
     const InsnFlags* insnFlags = vdata->insnFlags;
-    const RegType* addrRegs = registerLine->regTypes;
     int regCount = meth->registersSize;
     int fullRegCount = regCount + kExtraRegs;
     bool branchTarget = dvmInsnIsBranchTarget(insnFlags, addr);
@@ -6106,9 +6422,10 @@ static void dumpRegTypes(const VerifierData* vdata,
     regChars[regCharSize] = '\0';
 
     for (i = 0; i < regCount + kExtraRegs; i++) {
+        RegType type = dvmRegisterLineGetType(registerLine, i);
         char tch;
 
-        switch (addrRegs[i]) {
+        switch (type) {
         case kRegTypeUnknown:       tch = '.';  break;
         case kRegTypeConflict:      tch = 'X';  break;
         case kRegTypeZero:          tch = '0';  break;
@@ -6134,8 +6451,8 @@ static void dumpRegTypes(const VerifierData* vdata,
         case kRegTypeDoubleLo:      tch = 'D';  break;
         case kRegTypeDoubleHi:      tch = 'd';  break;
         default:
-            if (regTypeIsReference(addrRegs[i])) {
-                if (regTypeIsUninitReference(addrRegs[i]))
+            if (regTypeIsReference(type)) {
+                if (regTypeIsUninitReference(type))
                     tch = 'U';
                 else
                     tch = 'L';
@@ -6182,19 +6499,20 @@ static void dumpRegTypes(const VerifierData* vdata,
 
     if (displayFlags & DRT_SHOW_REF_TYPES) {
         for (i = 0; i < regCount + kExtraRegs; i++) {
-            if (regTypeIsReference(addrRegs[i]) && addrRegs[i] != kRegTypeZero)
+            RegType type = dvmRegisterLineGetType(registerLine, i);
+            if (regTypeIsReference(type) && type != kRegTypeZero)
             {
-                ClassObject* clazz = regTypeReferenceToClass(addrRegs[i], uninitMap);
+                ClassObject* clazz = regTypeReferenceToClass(type, uninitMap);
                 assert(dvmIsHeapAddress((Object*)clazz));
                 if (i < regCount) {
                     ALOGI("        %2d: 0x%08x %s%s",
-                        i, addrRegs[i],
-                        regTypeIsUninitReference(addrRegs[i]) ? "[U]" : "",
+                        i, type,
+                        regTypeIsUninitReference(type) ? "[U]" : "",
                         clazz->descriptor);
                 } else {
                     ALOGI("        RS: 0x%08x %s%s",
-                        addrRegs[i],
-                        regTypeIsUninitReference(addrRegs[i]) ? "[U]" : "",
+                        type,
+                        regTypeIsUninitReference(type) ? "[U]" : "",
                         clazz->descriptor);
                 }
             }
@@ -122,12 +122,33 @@ typedef u4 RegType;
 typedef u4 MonitorEntries;
 #define kMaxMonitorStackDepth   (sizeof(MonitorEntries) * 8)
 
+/*
+ * The types of kRegChunkSize consecutive registers.  Register lines share
+ * chunks until one of them needs a different type in that range, so lines
+ * that mostly agree (which is most of them) don't each need a full copy.
+ * A chunk with more than one reference must not be modified.
+ */
+#define kRegChunkShift  4
+#define kRegChunkSize   (1 << kRegChunkShift)
+struct RegChunk {
+    u4              refCount;
+    RegChunk*       nextFree;
+    RegType         regs[kRegChunkSize];
+};
+
 /*
  * During verification, we associate one of these with every "interesting"
  * instruction.  We track the status of all registers, and (if the method
  * has any monitor-enter instructions) maintain a stack of entered monitors
  * (identified by code unit offset).
  *
+ * Lines in the register table keep their types in "regChunks", with a
+ * NULL chunk meaning every register in it is kRegTypeUnknown, and have
+ * no "regTypes".  The line the verifier is working on keeps a plain
+ * "regTypes" array, along with the chunks it was last copied from or to;
+ * "dirtyChunks" flags the ones it has written since, so the others can be
+ * shared or skipped without looking at the registers.
+ *
  * If live-precise register maps are enabled, the "liveRegs" vector will
  * be populated.  Unlike the other lists of registers here, we do not
  * track the liveness of the method result register (which is not visible
@@ -135,6 +156,8 @@ typedef u4 MonitorEntries;
  */
 struct RegisterLine {
     RegType*        regTypes;
+    RegChunk**      regChunks;
+    u1*             dirtyChunks;
     MonitorEntries* monitorEntries;
     u4*             monitorStack;
     unsigned int    monitorStackTop;
@@ -214,6 +237,18 @@ struct VerifierData {
 extern const char gDvmMergeTab[kRegTypeMAX][kRegTypeMAX];
 
 
+/*
+ * Get the type of register "reg" in any register line.
+ */
+INLINE RegType dvmRegisterLineGetType(const RegisterLine* line, u4 reg) {
+    if (line->regTypes != NULL)
+        return line->regTypes[reg];
+    const RegChunk* chunk = line->regChunks[reg >> kRegChunkShift];
+    if (chunk == NULL)
+        return kRegTypeUnknown;
+    return chunk->regs[reg & (kRegChunkSize - 1)];
+}
+
 /*
  * Returns "true" if the flags indicate that this address holds the start
  * of an instruction.
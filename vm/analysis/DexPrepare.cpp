@@ -25,9 +25,14 @@
  * more rigorously structured.
  */
 #include "Dalvik.h"
+#include "libdex/DexChecksum.h"
+#include "libdex/DexClass.h"
+#include "libdex/DexClassHash.h"
+#include "libdex/InstrUtils.h"
 #include "libdex/OptInvocation.h"
 #include "analysis/RegisterMap.h"
 #include "analysis/Optimize.h"
+#include "analysis/VerifyCache.h"
 
 #include <string>
 
@@ -43,20 +48,26 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
-#include <zlib.h>
 
 /* fwd */
 static bool rewriteDex(u1* addr, int len, bool doVerify, bool doOpt,
-    DexClassLookup** ppClassLookup, DvmDex** ppDvmDex);
+    const DexFile* pPrevDexFile, DexClassLookup** ppClassLookup,
+    DexClassHashes** ppClassHashes, DvmDex** ppDvmDex);
+static u4 getClassHashOptions(bool doVerify, bool doOpt);
+static DvmDex* openPrevOdex(int fd, bool doVerify, bool doOpt);
+static u1* reusePrevResults(DexFile* pDexFile,
+    const DexClassHashes* pClassHashes, const DexFile* pPrevDexFile);
 static bool loadAllClasses(DvmDex* pDvmDex);
 static void verifyAndOptimizeClasses(DexFile* pDexFile, bool doVerify,
-    bool doOpt);
+    bool doOpt, const u1* reuse);
 static void verifyAndOptimizeClass(DexFile* pDexFile, ClassObject* clazz,
-    const DexClassDef* pClassDef, bool doVerify, bool doOpt);
+    const DexClassDef* pClassDef, bool doVerify, bool doOpt,
+    bool reuseVerify, u8* pVerifyCpu, u8* pOptCpu);
 static void updateChecksum(u1* addr, int len, DexHeader* pHeader);
 static int writeDependencies(int fd, u4 modWhen, u4 crc);
 static bool writeOptData(int fd, const DexClassLookup* pClassLookup,\
-    const RegisterMapBuilder* pRegMapBuilder);
+    const RegisterMapBuilder* pRegMapBuilder,
+    const DexClassHashes* pClassHashes);
 static bool computeFileChecksum(int fd, off_t start, size_t length, u4* pSum);
 
 /*
@@ -522,13 +533,19 @@ bool dvmOptimizeDexFile(int fd, off_t dexOffset, long dexLength,
  * is currently correct for all platforms, and this isn't expected to
  * change, so we should be okay with having it already extracted.)
  *
+ * If "prevFd" is not -1, it's the .odex from an earlier run on a previous
+ * version of the DEX file.  Classes that haven't changed since then take
+ * the results from there instead of being verified and optimized again.
+ *
  * Returns "true" on success.
  */
 bool dvmContinueOptimization(int fd, off_t dexOffset, long dexLength,
-    const char* fileName, u4 modWhen, u4 crc, bool isBootstrap)
+    const char* fileName, u4 modWhen, u4 crc, bool isBootstrap, int prevFd)
 {
     DexClassLookup* pClassLookup = NULL;
+    DexClassHashes* pClassHashes = NULL;
     RegisterMapBuilder* pRegMapBuilder = NULL;
+    DvmDex* pPrevDvmDex = NULL;
 
     assert(gDvm.optimizing);
 
@@ -588,6 +605,13 @@ bool dvmContinueOptimization(int fd, off_t dexOffset, long dexLength,
             doOpt = true;
         }
 
+        /*
+         * The earlier .odex stays mapped until we're done, since the
+         * register maps we take from it are used in place.
+         */
+        if (prevFd >= 0 && (doVerify || doOpt))
+            pPrevDvmDex = openPrevOdex(prevFd, doVerify, doOpt);
+
         /*
          * Rewrite the file.  Byte reordering, structure realigning,
          * class verification, and bytecode optimization are all performed
@@ -600,7 +624,9 @@ bool dvmContinueOptimization(int fd, off_t dexOffset, long dexLength,
          * This creates the class lookup table as part of doing the processing.
          */
         success = rewriteDex(((u1*) mapAddr) + dexOffset, dexLength,
-                    doVerify, doOpt, &pClassLookup, NULL);
+                    doVerify, doOpt,
+                    (pPrevDvmDex != NULL) ? pPrevDvmDex->pDexFile : NULL,
+                    &pClassLookup, &pClassHashes, NULL);
 
         if (success) {
             DvmDex* pDvmDex = NULL;
@@ -693,7 +719,7 @@ bool dvmContinueOptimization(int fd, off_t dexOffset, long dexLength,
     /*
      * Append any optimized pre-computed data structures.
      */
-    if (!writeOptData(fd, pClassLookup, pRegMapBuilder)) {
+    if (!writeOptData(fd, pClassLookup, pRegMapBuilder, pClassHashes)) {
         ALOGW("Failed writing opt data");
         goto bail;
     }
@@ -742,6 +768,8 @@ bool dvmContinueOptimization(int fd, off_t dexOffset, long dexLength,
 
 bail:
     dvmFreeRegisterMapBuilder(pRegMapBuilder);
+    dvmDexFileFree(pPrevDvmDex);
+    free(pClassHashes);
     free(pClassLookup);
     return result;
 }
@@ -768,7 +796,9 @@ bool dvmPrepareDexInMemory(u1* addr, size_t len, DvmDex** ppDvmDex)
      * also need to be changed, or we will try to verify the class twice,
      * and possibly reject it when optimized opcodes are encountered.)
      */
-    if (!rewriteDex(addr, len, false, false, &pClassLookup, ppDvmDex)) {
+    if (!rewriteDex(addr, len, false, false, NULL, &pClassLookup, NULL,
+            ppDvmDex))
+    {
         return false;
     }
 
@@ -785,24 +815,42 @@ bool dvmPrepareDexInMemory(u1* addr, size_t len, DvmDex** ppDvmDex)
  * called to prepare classes provided in a byte array, we may want to
  * be more conservative.
  *
+ * If "pPrevDexFile" is non-NULL, it's the DEX from an earlier .odex of
+ * this file, and classes that haven't changed take its results.
+ *
  * If "ppClassLookup" is non-NULL, a pointer to a newly-allocated
  * DexClassLookup will be returned on success.
  *
+ * If "ppClassHashes" is non-NULL, a pointer to a newly-allocated
+ * DexClassHashes (or NULL, if there was no work to do or the hashes
+ * couldn't be computed) will be returned on success.
+ *
  * If "ppDvmDex" is non-NULL, a newly-allocated DvmDex struct will be
- * returned on success.
+ * returned on success.  The DEX is then only being prepared for use in
+ * this process, so its class data, code and annotations are verified as
+ * each class is loaded, rather than all up front.
  */
 static bool rewriteDex(u1* addr, int len, bool doVerify, bool doOpt,
-    DexClassLookup** ppClassLookup, DvmDex** ppDvmDex)
+    const DexFile* pPrevDexFile, DexClassLookup** ppClassLookup,
+    DexClassHashes** ppClassHashes, DvmDex** ppDvmDex)
 {
     DexClassLookup* pClassLookup = NULL;
+    DexClassHashes* pClassHashes = NULL;
+    u1* reuse = NULL;
     u8 prepWhen, loadWhen, verifyOptWhen;
+    DexLazyVerify* pLazyVerify = NULL;
     DvmDex* pDvmDex = NULL;
     bool result = false;
     const char* msgStr = "???";
 
     /* if the DEX is in the wrong byte order, swap it now */
-    if (dexSwapAndVerify(addr, len) != 0)
-        goto bail;
+    if (ppDvmDex != NULL) {
+        if (dexSwapAndVerifyLazily(addr, len, &pLazyVerify) != 0)
+            goto bail;
+    } else {
+        if (dexSwapAndVerify(addr, len) != 0)
+            goto bail;
+    }
 
     /*
      * Now that the DEX file can be read directly, create a DexFile struct
@@ -812,6 +860,8 @@ static bool rewriteDex(u1* addr, int len, bool doVerify, bool doOpt,
         ALOGE("Unable to create DexFile");
         goto bail;
     }
+    pDvmDex->pDexFile->pLazyVerify = pLazyVerify;
+    pLazyVerify = NULL;
 
     /*
      * Create the class lookup table.  This will eventually be appended
@@ -836,6 +886,18 @@ static bool rewriteDex(u1* addr, int len, bool doVerify, bool doOpt,
 
     prepWhen = dvmGetRelativeTimeUsec();
 
+    /*
+     * Record what each class looks like, so that a later run on a new
+     * version of this DEX file can tell which classes haven't changed.
+     * Without these the next run just does everything, so carry on.
+     */
+    if (ppClassHashes != NULL) {
+        pClassHashes = dexComputeClassHashes(pDvmDex->pDexFile,
+            getClassHashOptions(doVerify, doOpt));
+        if (pClassHashes == NULL)
+            ALOGW("DexOpt: unable to compute class hashes");
+    }
+
     /*
      * Load all classes found in this DEX file.  If they fail to load for
      * some reason, they won't get verified (which is as it should be).
@@ -854,6 +916,12 @@ static bool rewriteDex(u1* addr, int len, bool doVerify, bool doOpt,
     if (!dvmCreateInlineSubsTable())
         goto bail;
 
+    /*
+     * Take what we can from the earlier run.
+     */
+    if (pPrevDexFile != NULL && pClassHashes != NULL)
+        reuse = reusePrevResults(pDvmDex->pDexFile, pClassHashes, pPrevDexFile);
+
     /*
      * Verify and optimize all classes in the DEX file (command-line
      * options permitting).
@@ -861,7 +929,7 @@ static bool rewriteDex(u1* addr, int len, bool doVerify, bool doOpt,
      * This is best-effort, so there's really no way for dexopt to
      * fail at this point.
      */
-    verifyAndOptimizeClasses(pDvmDex->pDexFile, doVerify, doOpt);
+    verifyAndOptimizeClasses(pDvmDex->pDexFile, doVerify, doOpt, reuse);
     verifyOptWhen = dvmGetRelativeTimeUsec();
 
     if (doVerify && doOpt)
@@ -900,9 +968,300 @@ bail:
         *ppClassLookup = pClassLookup;
     }
 
+    if (ppClassHashes == NULL || !result) {
+        free(pClassHashes);
+    } else {
+        *ppClassHashes = pClassHashes;
+    }
+
+    dexLazyVerifyFree(pLazyVerify);
+    free(reuse);
+    return result;
+}
+
+/*
+ * What a class takes from an earlier run, by class def index.
+ */
+enum {
+    kReuseNone = 0,     /* verify and optimize as usual */
+    kReuseVerify,       /* verification outcome and register maps; optimize */
+    kReuseAll,          /* all of the above plus the optimized code */
+};
+
+/*
+ * Get the settings that affect what we write for a class.  Results from
+ * an earlier run are only reused if it had the same ones.
+ */
+static u4 getClassHashOptions(bool doVerify, bool doOpt)
+{
+    u4 options = 0;
+
+    if (doVerify)
+        options |= 0x01;
+    if (doOpt)
+        options |= 0x02;
+    if (gDvm.dexOptForSmp)
+        options |= 0x04;
+    if (gDvm.generateRegisterMaps)
+        options |= 0x08;
+    if (gDvm.optimizingBootstrapClass)
+        options |= 0x10;
+    options |= (u4) gDvm.dexOptMode << 8;
+    options |= (u4) gDvm.registerMapMode << 16;
+    return options;
+}
+
+/*
+ * Open the .odex from an earlier run on a previous version of the DEX
+ * file.  It has to be current with respect to the bootstrap class path,
+ * since optimized code depends on the layout of the classes there, and
+ * it has to have class hashes.
+ *
+ * Returns NULL if there's nothing to reuse.
+ */
+static DvmDex* openPrevOdex(int fd, bool doVerify, bool doOpt)
+{
+    DvmDex* pDvmDex = NULL;
+
+    if (!dvmCheckOptHeaderAndDependencies(fd, false, 0, 0, doVerify, doOpt)) {
+        ALOGI("DexOpt: previous odex is out of date, not reusing it");
+        return NULL;
+    }
+    if (dvmDexFileOpenFromFd(fd, &pDvmDex) != 0) {
+        ALOGW("DexOpt: unable to open previous odex");
+        return NULL;
+    }
+
+    const DexFile* pDexFile = pDvmDex->pDexFile;
+    const DexClassHashes* pClassHashes = pDexFile->pClassHashes;
+    u4 count = pDexFile->pHeader->classDefsSize;
+    if (pClassHashes == NULL) {
+        ALOGI("DexOpt: previous odex has no class hashes, not reusing it");
+        dvmDexFileFree(pDvmDex);
+        return NULL;
+    }
+    if (pClassHashes->numEntries != count ||
+        pClassHashes->size != offsetof(DexClassHashes, entries) +
+            count * sizeof(DexClassHashEntry))
+    {
+        ALOGW("DexOpt: bad class hashes in previous odex, not reusing it");
+        dvmDexFileFree(pDvmDex);
+        return NULL;
+    }
+
+    return pDvmDex;
+}
+
+/*
+ * Returns "true" if the verifier replaced any instructions in the code of
+ * an earlier run, i.e. the optimized code has throw-verification-error.
+ */
+static bool hasVerifyErrorRewrites(const DexFile* pDexFile,
+    const DexMethod* pMethods, u4 count)
+{
+    for (u4 i = 0; i < count; i++) {
+        const DexCode* pCode = dexGetCode(pDexFile, &pMethods[i]);
+        if (pCode == NULL)
+            continue;
+
+        u4 insnsSize = pCode->insnsSize;
+        for (u4 offset = 0; offset < insnsSize; /**/) {
+            const u2* insns = pCode->insns + offset;
+            if (dexOpcodeFromCodeUnit(*insns) == OP_THROW_VERIFICATION_ERROR)
+                return true;
+
+            size_t width = dexGetWidthFromInstruction(insns);
+            if (width == 0)
+                return true;        /* shouldn't happen; assume the worst */
+            offset += width;
+        }
+    }
+    return false;
+}
+
+/*
+ * Check that the code of an earlier run lines up with "methods", and if
+ * "copy" is set, copy it over.
+ */
+static bool copyPrevCode(const DexFile* pPrevDexFile,
+    const DexMethod* pPrevMethods, Method* methods, u4 count, bool copy)
+{
+    for (u4 i = 0; i < count; i++) {
+        const DexCode* pPrevCode = dexGetCode(pPrevDexFile, &pPrevMethods[i]);
+        u4 insnsSize = dvmGetMethodInsnsSize(&methods[i]);
+
+        if (pPrevCode == NULL) {
+            if (insnsSize != 0)
+                return false;
+            continue;
+        }
+        if (pPrevCode->insnsSize != insnsSize)
+            return false;
+        if (copy) {
+            memcpy((u2*) methods[i].insns, pPrevCode->insns,
+                insnsSize * sizeof(u2));
+        }
+    }
+    return true;
+}
+
+/*
+ * Take what an earlier run did for a class whose content and deps digests
+ * match.  The verification outcome and register maps carry over as they
+ * are.  The optimized code does too if the instructions are identical,
+ * indices and all; otherwise the class gets optimized again, which we
+ * can only allow if the verifier didn't rewrite anything.
+ *
+ * Returns one of the kReuse* values.
+ */
+static u1 reuseClassResults(ClassObject* clazz, const DexClassDef* pClassDef,
+    const DexFile* pPrevDexFile, const DexClassDef* pPrevClassDef,
+    bool sameInsns)
+{
+    const u1* pEncodedData = dexGetClassData(pPrevDexFile, pPrevClassDef);
+    DexClassData* pPrevData = dexReadAndVerifyClassData(&pEncodedData,
+        pPrevDexFile->baseAddr + pPrevDexFile->pHeader->fileSize);
+    bool preverified =
+        (pPrevClassDef->accessFlags & CLASS_ISPREVERIFIED) != 0;
+    u1 result = kReuseNone;
+    u4 directCount, virtualCount, i;
+
+    if (pPrevData == NULL)
+        return kReuseNone;
+
+    /* the digests guarantee these, barring a collision */
+    directCount = pPrevData->header.directMethodsSize;
+    virtualCount = pPrevData->header.virtualMethodsSize;
+    if (directCount != (u4) clazz->directMethodCount ||
+        virtualCount > (u4) clazz->virtualMethodCount ||
+        !copyPrevCode(pPrevDexFile, pPrevData->directMethods,
+            clazz->directMethods, directCount, false) ||
+        !copyPrevCode(pPrevDexFile, pPrevData->virtualMethods,
+            clazz->virtualMethods, virtualCount, false))
+    {
+        ALOGW("DexOpt: '%s' doesn't match its class hashes",
+            clazz->descriptor);
+        goto bail;
+    }
+
+    if (!sameInsns &&
+        (hasVerifyErrorRewrites(pPrevDexFile, pPrevData->directMethods,
+            directCount) ||
+         hasVerifyErrorRewrites(pPrevDexFile, pPrevData->virtualMethods,
+            virtualCount)))
+    {
+        goto bail;
+    }
+
+    /*
+     * The maps are in the order dvmGenerateRegisterMaps() wrote them,
+     * which is the order of the DEX file, with miranda methods at the end
+     * of the virtual methods (and not in the pool).
+     */
+    if (preverified && gDvm.generateRegisterMaps) {
+        u4 numMaps;
+        const void* pMapData = dvmRegisterMapGetClassData(pPrevDexFile,
+            dexGetIndexForClassDef(pPrevDexFile, pPrevClassDef), &numMaps);
+        if (pMapData == NULL || numMaps != directCount + virtualCount)
+            goto bail;
+
+        for (i = 0; i < directCount + virtualCount; i++) {
+            Method* meth = (i < directCount) ?
+                &clazz->directMethods[i] :
+                &clazz->virtualMethods[i - directCount];
+            const RegisterMap* pMap = dvmRegisterMapGetNext(&pMapData);
+            if (dvmRegisterMapGetFormat(pMap) != kRegMapFormatNone)
+                dvmSetRegisterMap(meth, pMap);
+        }
+    }
+
+    if (sameInsns) {
+        copyPrevCode(pPrevDexFile, pPrevData->directMethods,
+            clazz->directMethods, directCount, true);
+        copyPrevCode(pPrevDexFile, pPrevData->virtualMethods,
+            clazz->virtualMethods, virtualCount, true);
+        ((DexClassDef*) pClassDef)->accessFlags |= pPrevClassDef->accessFlags &
+            (CLASS_ISPREVERIFIED | CLASS_ISOPTIMIZED);
+        result = kReuseAll;
+    } else {
+        ((DexClassDef*) pClassDef)->accessFlags |= pPrevClassDef->accessFlags &
+            CLASS_ISPREVERIFIED;
+        result = kReuseVerify;
+    }
+
+bail:
+    free(pPrevData);
     return result;
 }
 
+/*
+ * Work out which classes are unchanged since the earlier run that wrote
+ * "pPrevDexFile", and take its results for them.  A class qualifies if it
+ * was loaded from this DEX and its content and deps digests match; see
+ * libdex/DexClassHash.h.
+ *
+ * Returns a newly-allocated array of kReuse* values by class def index,
+ * or NULL if nothing can be reused.
+ */
+static u1* reusePrevResults(DexFile* pDexFile,
+    const DexClassHashes* pClassHashes, const DexFile* pPrevDexFile)
+{
+    const DexClassHashes* pPrevHashes = pPrevDexFile->pClassHashes;
+    u4 count = pClassHashes->numEntries;
+    int numVerify = 0, numAll = 0;
+
+    if (pPrevHashes->options != pClassHashes->options) {
+        ALOGI("DexOpt: previous odex has other settings (0x%x vs 0x%x)",
+            pPrevHashes->options, pClassHashes->options);
+        return NULL;
+    }
+
+    u1* reuse = (u1*) calloc(count, sizeof(u1));
+    if (reuse == NULL)
+        return NULL;
+
+    for (u4 idx = 0; idx < count; idx++) {
+        const DexClassDef* pClassDef = dexGetClassDef(pDexFile, idx);
+        const char* classDescriptor =
+            dexStringByTypeIdx(pDexFile, pClassDef->classIdx);
+        const DexClassDef* pPrevClassDef =
+            dexFindClass(pPrevDexFile, classDescriptor);
+        if (pPrevClassDef == NULL)
+            continue;
+
+        const DexClassHashEntry* pEntry = &pClassHashes->entries[idx];
+        const DexClassHashEntry* pPrevEntry = &pPrevHashes->entries[
+            dexGetIndexForClassDef(pPrevDexFile, pPrevClassDef)];
+        if (memcmp(pEntry->content, pPrevEntry->content, kSHA1DigestLen) != 0 ||
+            memcmp(pEntry->deps, pPrevEntry->deps, kSHA1DigestLen) != 0)
+        {
+            continue;
+        }
+
+        /* as in verifyAndOptimizeClass(), leave other definitions alone */
+        ClassObject* clazz = dvmLookupClass(classDescriptor, NULL, false);
+        if (clazz == NULL || clazz->pDvmDex == NULL ||
+            clazz->pDvmDex->pDexFile != pDexFile)
+        {
+            continue;
+        }
+
+        bool sameInsns =
+            memcmp(pEntry->insns, pPrevEntry->insns, kSHA1DigestLen) == 0;
+        reuse[idx] = reuseClassResults(clazz, pClassDef, pPrevDexFile,
+            pPrevClassDef, sameInsns);
+        if (reuse[idx] == kReuseAll)
+            numAll++;
+        else if (reuse[idx] == kReuseVerify)
+            numVerify++;
+    }
+
+    ALOGD("DexOpt: reusing %d of %d classes from previous odex"
+          " (%d reoptimized)",
+        numAll + numVerify, count, numVerify);
+    return reuse;
+}
+
 /*
  * Try to load all classes in the specified DEX.  If they have some sort
  * of broken dependency, e.g. their superclass lives in a different DEX
@@ -993,35 +1352,277 @@ static bool loadAllClasses(DvmDex* pDvmDex)
     return true;
 }
 
+/* upper bound on the verify/optimize threads, whatever the CPU count */
+static const int kMaxVerifyOptThreads = 16;
+
+static const u4 kNoClassIdx = (u4) -1;
+
 /*
- * Verify and/or optimize all classes that were successfully loaded from
- * this DEX file.
+ * State shared by the threads that verify and optimize the classes of one
+ * DEX file.  Everything but the counters is indexed by class def index.
+ *
+ * Each class only touches its own class def flags and its own code, so
+ * the .odex comes out the same whatever the thread count or scheduling.
+ * We still process a class only after its superclass (if it's defined in
+ * this DEX) is finished, the order in which the VM itself verifies
+ * classes at run time.  Classes are handed out by depth in the hierarchy,
+ * so a thread never waits on a class that hasn't already been claimed.
  */
-static void verifyAndOptimizeClasses(DexFile* pDexFile, bool doVerify,
-    bool doOpt)
+struct VerifyOptState {
+    DexFile*        pDexFile;
+    bool            doVerify;
+    bool            doOpt;
+
+    u4              count;
+    ClassObject**   classes;        /* NULL if the class didn't load */
+    u4*             superIdx;       /* kNoClassIdx if not in this DEX */
+    u4*             order;          /* class def indices, shallowest first */
+    bool*           done;
+    const u1*       reuse;          /* kReuse* values, or NULL */
+
+    pthread_mutex_t lock;           /* guards the fields below and "done" */
+    pthread_cond_t  cond;           /* broadcast when a class is done */
+    u4              next;           /* next entry in "order" */
+    u8              verifyCpuNsec;
+    u8              optCpuNsec;
+};
+
+/*
+ * Work out the order in which classes are handed out, and what each one
+ * waits for.  Returns "false" on allocation failure.
+ */
+static bool prepVerifyOptState(VerifyOptState* pState)
 {
-    u4 count = pDexFile->pHeader->classDefsSize;
-    u4 idx;
+    DexFile* pDexFile = pState->pDexFile;
+    u4 count = pState->count;
+    u4 idx, depthIdx, maxDepth = 0;
+
+    pState->classes = (ClassObject**) calloc(count, sizeof(ClassObject*));
+    pState->superIdx = (u4*) malloc(count * sizeof(u4));
+    pState->order = (u4*) malloc(count * sizeof(u4));
+    pState->done = (bool*) calloc(count, sizeof(bool));
+    u4* depth = (u4*) calloc(count, sizeof(u4));
+    if (pState->classes == NULL || pState->superIdx == NULL ||
+        pState->order == NULL || pState->done == NULL || depth == NULL)
+    {
+        free(depth);
+        return false;
+    }
 
     for (idx = 0; idx < count; idx++) {
-        const DexClassDef* pClassDef;
-        const char* classDescriptor;
-        ClassObject* clazz;
-
-        pClassDef = dexGetClassDef(pDexFile, idx);
-        classDescriptor = dexStringByTypeIdx(pDexFile, pClassDef->classIdx);
+        const DexClassDef* pClassDef = dexGetClassDef(pDexFile, idx);
+        const char* classDescriptor =
+            dexStringByTypeIdx(pDexFile, pClassDef->classIdx);
 
         /* all classes are loaded into the bootstrap class loader */
-        clazz = dvmLookupClass(classDescriptor, NULL, false);
-        if (clazz != NULL) {
-            verifyAndOptimizeClass(pDexFile, clazz, pClassDef, doVerify, doOpt);
+        pState->classes[idx] = dvmLookupClass(classDescriptor, NULL, false);
+        pState->superIdx[idx] = kNoClassIdx;
+
+        ClassObject* super = (pState->classes[idx] != NULL) ?
+            pState->classes[idx]->super : NULL;
+        if (super != NULL && super->pDvmDex != NULL &&
+            super->pDvmDex->pDexFile == pDexFile)
+        {
+            const DexClassDef* pSuperDef =
+                dexFindClass(pDexFile, super->descriptor);
+            if (pSuperDef != NULL)
+                pState->superIdx[idx] = pSuperDef - dexGetClassDef(pDexFile, 0);
+        }
+    }
+
+    /* depth within this DEX; superclass chains are known to be acyclic */
+    for (idx = 0; idx < count; idx++) {
+        u4 d = 0;
+        for (u4 cur = pState->superIdx[idx]; cur != kNoClassIdx;
+                cur = pState->superIdx[cur])
+        {
+            d++;
+        }
+        depth[idx] = d;
+        maxDepth = MAX(maxDepth, d);
+    }
+
+    /* stable: within a depth, classes keep their class def order */
+    u4 pos = 0;
+    for (depthIdx = 0; depthIdx <= maxDepth; depthIdx++) {
+        for (idx = 0; idx < count; idx++) {
+            if (depth[idx] == depthIdx)
+                pState->order[pos++] = idx;
+        }
+    }
+    assert(pos == count);
+
+    free(depth);
+    return true;
+}
+
+static void freeVerifyOptState(VerifyOptState* pState)
+{
+    free(pState->classes);
+    free(pState->superIdx);
+    free(pState->order);
+    free(pState->done);
+}
 
+/*
+ * Claim classes and process them until there are none left.  Runs on the
+ * main thread as well as on the helpers.
+ *
+ * We go through VMWAIT while holding the state lock, so every class
+ * boundary is also a suspend point for the GC.
+ */
+static void verifyOptWorker(VerifyOptState* pState)
+{
+    Thread* self = dvmThreadSelf();
+    u8 verifyCpu = 0, optCpu = 0;
+
+    while (true) {
+        ThreadStatus oldStatus = dvmChangeStatus(self, THREAD_VMWAIT);
+        dvmLockMutex(&pState->lock);
+        if (pState->next == pState->count) {
+            pState->verifyCpuNsec += verifyCpu;
+            pState->optCpuNsec += optCpu;
+            dvmUnlockMutex(&pState->lock);
+            dvmChangeStatus(self, oldStatus);
+            break;
+        }
+        u4 idx = pState->order[pState->next++];
+        u4 superIdx = pState->superIdx[idx];
+        while (superIdx != kNoClassIdx && !pState->done[superIdx])
+            pthread_cond_wait(&pState->cond, &pState->lock);
+        dvmUnlockMutex(&pState->lock);
+        dvmChangeStatus(self, oldStatus);
+
+        ClassObject* clazz = pState->classes[idx];
+        u1 reuse = (pState->reuse != NULL) ? pState->reuse[idx] : kReuseNone;
+        if (reuse == kReuseAll) {
+            /* everything was taken from the previous odex */
+        } else if (clazz != NULL) {
+            verifyAndOptimizeClass(pState->pDexFile, clazz,
+                dexGetClassDef(pState->pDexFile, idx),
+                pState->doVerify, pState->doOpt, reuse == kReuseVerify,
+                &verifyCpu, &optCpu);
         } else {
             // TODO: log when in verbose mode
             ALOGV("DexOpt: not optimizing unavailable class '%s'",
-                classDescriptor);
+                dexStringByTypeIdx(pState->pDexFile,
+                    dexGetClassDef(pState->pDexFile, idx)->classIdx));
         }
+
+        dvmLockMutex(&pState->lock);
+        pState->done[idx] = true;
+        pthread_cond_broadcast(&pState->cond);
+        dvmUnlockMutex(&pState->lock);
+    }
+}
+
+/*
+ * Entry point for the helper threads.
+ */
+static void* verifyOptThreadStart(void* arg)
+{
+    VerifyOptState* pState = (VerifyOptState*) arg;
+
+    /* if we can't attach, the other threads pick up the slack */
+    if (!dvmAttachOptimizerThread()) {
+        ALOGW("DexOpt: unable to attach verify/opt thread");
+        return NULL;
     }
+    verifyOptWorker(pState);
+    dvmDetachOptimizerThread();
+    return NULL;
+}
+
+/*
+ * Decide how many threads to use for "count" classes.
+ */
+static int getVerifyOptThreadCount(u4 count)
+{
+    int threads = gDvm.dexOptThreads;
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int) cpus : 1;
+    }
+#ifdef VERIFIER_STATS
+    threads = 1;        /* the counters aren't updated atomically */
+#endif
+    threads = MIN(threads, kMaxVerifyOptThreads);
+    if ((u4) threads > count)
+        threads = MAX((int) count, 1);
+    return threads;
+}
+
+/*
+ * Verify and/or optimize all classes that were successfully loaded from
+ * this DEX file, using gDvm.dexOptThreads threads.
+ *
+ * If "reuse" is non-NULL, it says what each class already took from a
+ * previous odex (see reusePrevResults()).
+ */
+static void verifyAndOptimizeClasses(DexFile* pDexFile, bool doVerify,
+    bool doOpt, const u1* reuse)
+{
+    VerifyOptState state;
+    pthread_t handles[kMaxVerifyOptThreads];
+    int threads, started, i;
+    u8 startWhen, endWhen;
+
+    memset(&state, 0, sizeof(state));
+    state.pDexFile = pDexFile;
+    state.doVerify = doVerify;
+    state.doOpt = doOpt;
+    state.reuse = reuse;
+    state.count = pDexFile->pHeader->classDefsSize;
+    if (state.count == 0)
+        return;
+    if (!prepVerifyOptState(&state)) {
+        ALOGE("DexOpt: unable to allocate verify/opt state");
+        freeVerifyOptState(&state);
+        return;
+    }
+    dvmInitMutex(&state.lock);
+    pthread_cond_init(&state.cond, NULL);
+
+    /* without the cache we're merely slower */
+    if (!dvmVerifyCacheStartup())
+        ALOGW("DexOpt: unable to allocate verify cache");
+
+    startWhen = dvmGetRelativeTimeUsec();
+    threads = getVerifyOptThreadCount(state.count);
+
+    /* the main thread is one of the workers */
+    started = 0;
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&handles[started], NULL, verifyOptThreadStart,
+                &state) != 0)
+        {
+            ALOGW("DexOpt: unable to start verify/opt thread: %s",
+                strerror(errno));
+            break;
+        }
+        started++;
+    }
+
+    verifyOptWorker(&state);
+
+    ThreadStatus oldStatus = dvmChangeStatus(NULL, THREAD_VMWAIT);
+    for (i = 0; i < started; i++)
+        pthread_join(handles[i], NULL);
+    dvmChangeStatus(NULL, oldStatus);
+    endWhen = dvmGetRelativeTimeUsec();
+
+    ALOGD("DexOpt: %d classes on %d threads: %dms wall, verify %dms cpu,"
+          " opt %dms cpu",
+        state.count, started + 1,
+        (int) ((endWhen - startWhen) / 1000),
+        (int) (state.verifyCpuNsec / 1000000),
+        (int) (state.optCpuNsec / 1000000));
+    dvmVerifyCacheShutdown();
+
+    pthread_cond_destroy(&state.cond);
+    dvmDestroyMutex(&state.lock);
+    freeVerifyOptState(&state);
 
 #ifdef VERIFIER_STATS
     ALOGI("Verifier stats:");
@@ -1032,16 +1633,23 @@ static void verifyAndOptimizeClasses(DexFile* pDexFile, bool doVerify,
     ALOGI(" copying of register sets: %u", gDvm.verifierStats.copyRegCount);
     ALOGI(" merging of register sets: %u", gDvm.verifierStats.mergeRegCount);
     ALOGI(" ...that caused changes  : %u", gDvm.verifierStats.mergeRegChanged);
+    ALOGI(" register chunks merged  : %u", gDvm.verifierStats.mergeChunksExamined);
+    ALOGI(" ...skipped as unchanged : %u", gDvm.verifierStats.mergeChunksSkipped);
     ALOGI(" uninit searches         : %u", gDvm.verifierStats.uninitSearches);
     ALOGI(" max memory required     : %u", gDvm.verifierStats.biggestAlloc);
 #endif
 }
 
 /*
- * Verify and/or optimize a specific class.
+ * Verify and/or optimize a specific class, adding the thread CPU time
+ * spent on each phase to *pVerifyCpu and *pOptCpu.
+ *
+ * If "reuseVerify" is set, the class def already has the verification
+ * outcome of a previous run, and we only optimize.
  */
 static void verifyAndOptimizeClass(DexFile* pDexFile, ClassObject* clazz,
-    const DexClassDef* pClassDef, bool doVerify, bool doOpt)
+    const DexClassDef* pClassDef, bool doVerify, bool doOpt,
+    bool reuseVerify, u8* pVerifyCpu, u8* pOptCpu)
 {
 #ifndef LOG_NDEBUG
     const char* classDescriptor;
@@ -1068,8 +1676,13 @@ static void verifyAndOptimizeClass(DexFile* pDexFile, ClassObject* clazz,
     /*
      * First, try to verify it.
      */
-    if (doVerify) {
-        if (dvmVerifyClass(clazz)) {
+    if (reuseVerify) {
+        verified = (pClassDef->accessFlags & CLASS_ISPREVERIFIED) != 0;
+    } else if (doVerify) {
+        u8 cpuStart = dvmGetThreadCpuTimeNsec();
+        bool ok = dvmVerifyClass(clazz);
+        *pVerifyCpu += dvmGetThreadCpuTimeNsec() - cpuStart;
+        if (ok) {
             /*
              * Set the "is preverified" flag in the DexClassDef.  We
              * do it here, rather than in the ClassObject structure,
@@ -1092,7 +1705,9 @@ static void verifyAndOptimizeClass(DexFile* pDexFile, ClassObject* clazz,
             ALOGV("DexOpt: not optimizing '%s': not verified",
                 classDescriptor);
         } else {
+            u8 cpuStart = dvmGetThreadCpuTimeNsec();
             dvmOptimizeClass(clazz, false);
+            *pOptCpu += dvmGetThreadCpuTimeNsec() - cpuStart;
 
             /* set the flag whether or not we actually changed anything */
             ((DexClassDef*)pClassDef)->accessFlags |= CLASS_ISOPTIMIZED;
@@ -1160,19 +1775,20 @@ static const size_t kMinDepSize = 4 * 4;
 static const size_t kMaxDepSize = 4 * 4 + 2048;     // sanity check
 
 /*
- * Read the "opt" header, verify it, then read the dependencies section
- * and verify that data as well.
+ * Read the "opt" header and verify it, then read the dependencies section
+ * and verify everything in it but the list of bootstrap class path
+ * entries, which dvmCheckBootClassPathDeps() does.
  *
  * If "sourceAvail" is "true", this will verify that "modWhen" and "crc"
  * match up with what is stored in the header.  If they don't, we reject
  * the file so that it can be recreated from the updated original.  If
  * "sourceAvail" isn't set, e.g. for a .odex file, we ignore these arguments.
  *
- * On successful return, the file will be seeked immediately past the
- * "opt" header.
+ * On success, "*ppDepData" points to a malloc()ed copy of the dependency
+ * data, "*pDepsLength" bytes long.
  */
-bool dvmCheckOptHeaderAndDependencies(int fd, bool sourceAvail, u4 modWhen,
-    u4 crc, bool expectVerify, bool expectOpt)
+bool dvmCheckOptHeader(int fd, bool sourceAvail, u4 modWhen, u4 crc,
+    u1** ppDepData, u4* pDepsLength)
 {
     DexOptHeader optHdr;
     u1* depData = NULL;
@@ -1293,12 +1909,27 @@ bool dvmCheckOptHeaderAndDependencies(int fd, bool sourceAvail, u4 modWhen,
         goto bail;
     }
 
-    /*
-     * Verify dependencies on other cached DEX files.  It must match
-     * exactly with what is currently defined in the bootclasspath.
-     */
+    *ppDepData = depData;
+    *pDepsLength = optHdr.depsLength;
+    depData = NULL;
+    result = true;
+
+bail:
+    free(depData);
+    return result;
+}
+
+/*
+ * Verify the dependencies on other cached DEX files, in dependency data
+ * from dvmCheckOptHeader().  They must match exactly with the bootstrap
+ * class path entries opened so far.
+ */
+bool dvmCheckBootClassPathDeps(const u1* depData, u4 depsLength)
+{
+    const u1* ptr = depData + 3 * 4;    /* skip the items checked already */
     ClassPathEntry* cpe;
     u4 numDeps;
+    bool result = false;
 
     numDeps = read4LE(&ptr);
     ALOGV("+++ DexOpt: numDeps = %d", numDeps);
@@ -1346,15 +1977,37 @@ bool dvmCheckOptHeaderAndDependencies(int fd, bool sourceAvail, u4 modWhen,
     }
 
     // consumed all data and no more?
-    if (ptr != depData + optHdr.depsLength) {
+    if (ptr != depData + depsLength) {
         ALOGW("DexOpt: Spurious dep data? %d vs %d",
-            (int) (ptr - depData), optHdr.depsLength);
+            (int) (ptr - depData), depsLength);
         assert(false);
     }
 
     result = true;
 
 bail:
+    return result;
+}
+
+/*
+ * Read the "opt" header, verify it, then read the dependencies section
+ * and verify that data as well.
+ *
+ * See dvmCheckOptHeader() for the meaning of "sourceAvail".
+ */
+bool dvmCheckOptHeaderAndDependencies(int fd, bool sourceAvail, u4 modWhen,
+    u4 crc, bool expectVerify, bool expectOpt)
+{
+    u1* depData;
+    u4 depsLength;
+
+    if (!dvmCheckOptHeader(fd, sourceAvail, modWhen, crc, &depData,
+            &depsLength))
+    {
+        return false;
+    }
+
+    bool result = dvmCheckBootClassPathDeps(depData, depsLength);
     free(depData);
     return result;
 }
@@ -1484,7 +2137,8 @@ static bool writeChunk(int fd, u4 type, const void* data, size_t size)
  * so it can be used directly when the file is mapped for reading.
  */
 static bool writeOptData(int fd, const DexClassLookup* pClassLookup,
-    const RegisterMapBuilder* pRegMapBuilder)
+    const RegisterMapBuilder* pRegMapBuilder,
+    const DexClassHashes* pClassHashes)
 {
     /* pre-computed class lookup hash table */
     if (!writeChunk(fd, (u4) kDexChunkClassLookup,
@@ -1502,6 +2156,15 @@ static bool writeOptData(int fd, const DexClassLookup* pClassLookup,
         }
     }
 
+    /* class hashes, for the next incremental run (optional) */
+    if (pClassHashes != NULL) {
+        if (!writeChunk(fd, (u4) kDexChunkClassHashes,
+                pClassHashes, pClassHashes->size))
+        {
+            return false;
+        }
+    }
+
     /* write the end marker */
     if (!writeChunk(fd, (u4) kDexChunkEnd, NULL, 0)) {
         return false;
@@ -1519,9 +2182,11 @@ static bool writeOptData(int fd, const DexClassLookup* pClassLookup,
  */
 static bool computeFileChecksum(int fd, off_t start, size_t length, u4* pSum)
 {
-    unsigned char readBuf[8192];
+    /* big enough that the vector code isn't mostly loop setup */
+    const size_t kReadBufSize = 65536;
+    u1* readBuf;
     ssize_t actual;
-    uLong adler;
+    u4 adler;
 
     if (lseek(fd, start, SEEK_SET) != start) {
         ALOGE("Unable to seek to start of checksum area (%ld): %s",
@@ -1529,22 +2194,28 @@ static bool computeFileChecksum(int fd, off_t start, size_t length, u4* pSum)
         return false;
     }
 
-    adler = adler32(0L, Z_NULL, 0);
+    readBuf = (u1*) malloc(kReadBufSize);
+    if (readBuf == NULL)
+        return false;
+
+    adler = 1;
 
     while (length != 0) {
-        size_t wanted = (length < sizeof(readBuf)) ? length : sizeof(readBuf);
+        size_t wanted = (length < kReadBufSize) ? length : kReadBufSize;
         actual = read(fd, readBuf, wanted);
         if (actual <= 0) {
             ALOGE("Read failed (%d) while computing checksum (len=%zu): %s",
                 (int) actual, length, strerror(errno));
+            free(readBuf);
             return false;
         }
 
-        adler = adler32(adler, readBuf, actual);
+        adler = dexAdler32(adler, readBuf, actual);
 
         length -= actual;
     }
 
+    free(readBuf);
     *pSum = adler;
     return true;
 }
@@ -1559,9 +2230,7 @@ static void updateChecksum(u1* addr, int len, DexHeader* pHeader)
     /*
      * Rewrite the checksum.  We leave the SHA-1 signature alone.
      */
-    uLong adler = adler32(0L, Z_NULL, 0);
     const int nonSum = sizeof(pHeader->magic) + sizeof(pHeader->checksum);
 
-    adler = adler32(adler, addr + nonSum, len - nonSum);
-    pHeader->checksum = adler;
+    pHeader->checksum = dexAdler32(1, addr + nonSum, len - nonSum);
 }
@@ -108,6 +108,17 @@ bool dvmUnlockCachedDexFile(int fd);
 bool dvmCheckOptHeaderAndDependencies(int fd, bool sourceAvail, u4 modWhen,
     u4 crc, bool expectVerify, bool expectOpt);
 
+/*
+ * The two halves of dvmCheckOptHeaderAndDependencies(), for callers that
+ * check a file before the bootstrap class path entries it depends on are
+ * open.  The first doesn't look at the VM state, and may be called from
+ * a thread that isn't attached to the VM.  On success it returns the
+ * dependency data in "*ppDepData", to be free()d by the caller.
+ */
+bool dvmCheckOptHeader(int fd, bool sourceAvail, u4 modWhen, u4 crc,
+    u1** ppDepData, u4* pDepsLength);
+bool dvmCheckBootClassPathDeps(const u1* depData, u4 depsLength);
+
 /*
  * Optimize a DEX file.  The file must start with the "opt" header, followed
  * by the plain DEX data.  It must be mmap()able.
@@ -119,9 +130,13 @@ bool dvmOptimizeDexFile(int fd, off_t dexOffset, long dexLen,
 
 /*
  * Continue the optimization process on the other side of a fork/exec.
+ *
+ * "prevFd" is an open .odex from an earlier run on a previous version of
+ * the same DEX file, whose results are reused for unchanged classes, or
+ * -1 if there isn't one.
  */
 bool dvmContinueOptimization(int fd, off_t dexOffset, long dexLength,
-    const char* fileName, u4 modWhen, u4 crc, bool isBootstrap);
+    const char* fileName, u4 modWhen, u4 crc, bool isBootstrap, int prevFd);
 
 /*
  * Prepare DEX data that is only available to the VM as in-memory data.
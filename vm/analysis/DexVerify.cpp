@@ -1169,13 +1169,13 @@ static bool verifyInstructions(VerifierData* vdata)
         case OP_INVOKE_VIRTUAL_QUICK_RANGE:
         case OP_INVOKE_SUPER_QUICK:
         case OP_INVOKE_SUPER_QUICK_RANGE:
-        case OP_UNUSED_3E:
-        case OP_UNUSED_3F:
-        case OP_UNUSED_40:
-        case OP_UNUSED_41:
-        case OP_UNUSED_42:
-        case OP_UNUSED_43:
-        case OP_UNUSED_73:
+        case OP_IGET_QUICK_IF_EQZ:
+        case OP_IGET_QUICK_IF_NEZ:
+        case OP_CONST_4_IF:
+        case OP_MOVE_RESULT_RETURN:
+        case OP_MOVE_RESULT_WIDE_RETURN:
+        case OP_MOVE_RESULT_OBJECT_RETURN:
+        case OP_AGET_ADD_INT:
         case OP_UNUSED_79:
         case OP_UNUSED_7A:
         case OP_UNUSED_FF:
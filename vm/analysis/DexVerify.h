@@ -41,8 +41,10 @@ struct VerifierStats {
     size_t copyRegCount;       /* calls from updateRegisters->copyRegisters */
     size_t mergeRegCount;      /* calls from updateRegisters->merge */
     size_t mergeRegChanged;    /* calls from updateRegisters->merge, changed */
+    size_t mergeChunksExamined; /* register chunks merged one by one */
+    size_t mergeChunksSkipped; /* register chunks known to be the same */
     size_t uninitSearches;     /* times we've had to search the uninit table */
-    size_t biggestAlloc;       /* largest RegisterLine table alloc */
+    size_t biggestAlloc;       /* most register data held for one method */
 };
 
 /*
@@ -695,6 +695,13 @@ static bool processInstruction(VerifierData* vdata, u4 insnIdx,
     case OP_INVOKE_VIRTUAL_QUICK_RANGE:
     case OP_INVOKE_SUPER_QUICK:
     case OP_INVOKE_SUPER_QUICK_RANGE:
+    case OP_IGET_QUICK_IF_EQZ:
+    case OP_IGET_QUICK_IF_NEZ:
+    case OP_CONST_4_IF:
+    case OP_MOVE_RESULT_RETURN:
+    case OP_MOVE_RESULT_WIDE_RETURN:
+    case OP_MOVE_RESULT_OBJECT_RETURN:
+    case OP_AGET_ADD_INT:
         /* fall through to failure */
 
     /* correctness fixes, not expected to appear */
@@ -715,13 +722,6 @@ static bool processInstruction(VerifierData* vdata, u4 insnIdx,
         /* fall through to failure */
 
     /* these should never appear during verification */
-    case OP_UNUSED_3E:
-    case OP_UNUSED_3F:
-    case OP_UNUSED_40:
-    case OP_UNUSED_41:
-    case OP_UNUSED_42:
-    case OP_UNUSED_43:
-    case OP_UNUSED_73:
     case OP_UNUSED_79:
     case OP_UNUSED_7A:
     case OP_BREAKPOINT:
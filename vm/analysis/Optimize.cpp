@@ -21,6 +21,7 @@
 #include "Dalvik.h"
 #include "libdex/InstrUtils.h"
 #include "Optimize.h"
+#include "VerifyCache.h"
 
 #include <zlib.h>
 
@@ -49,6 +50,7 @@ static bool rewriteExecuteInlineRange(Method* method, u2* insns,
     MethodType methodType);
 static void rewriteReturnVoid(Method* method, u2* insns);
 static bool needsReturnBarrier(Method* method);
+static void fuseInstructions(Method* method);
 
 
 /*
@@ -345,6 +347,12 @@ rewrite_static_field:
     }
 
     assert(insnsSize == 0);
+
+    /*
+     * non-essential: superinstructions, once the "-quick" forms are in
+     */
+    if (!essentialOnly)
+        fuseInstructions(method);
 }
 
 /*
@@ -388,42 +396,38 @@ static inline void updateOpcode(const Method* meth, u2* ptr, Opcode opcode)
 }
 
 /*
- * If "referrer" and "resClass" don't come from the same DEX file, and
- * the DEX we're working on is not destined for the bootstrap class path,
- * tweak the class loader so package-access checks work correctly.
+ * dexopt loads every class with the bootstrap class loader.  If the DEX
+ * we're working on is not destined for the bootstrap class path, classes
+ * from other DEX files will have a different loader at run time, so
+ * package-private and unrelated protected access to them is refused.
  *
- * Only do this if we're doing pre-verification or optimization.
- */
-static void tweakLoader(ClassObject* referrer, ClassObject* resClass)
-{
-    if (!gDvm.optimizing)
-        return;
-    assert(referrer->classLoader == NULL);
-    assert(resClass->classLoader == NULL);
-
-    if (!gDvm.optimizingBootstrapClass) {
-        /* class loader for an array class comes from element type */
-        if (dvmIsArrayClass(resClass))
-            resClass = resClass->elementClass;
-        if (referrer->pDvmDex != resClass->pDvmDex)
-            resClass->classLoader = (Object*) 0xdead3333;
-    }
-}
-
-/*
- * Undo the effects of tweakLoader.
+ * (This used to be done by temporarily changing the class loader of the
+ * target class, but classes are verified and optimized on several
+ * threads, and they all see the same ClassObject.)
+ *
+ * Only applies if we're doing pre-verification or optimization.
  */
-static void untweakLoader(ClassObject* referrer, ClassObject* resClass)
+static bool isAccessRefusedAcrossDex(const ClassObject* referrer,
+    const ClassObject* accessTo, u4 accessFlags)
 {
     if (!gDvm.optimizing || gDvm.optimizingBootstrapClass)
-        return;
+        return false;
+    assert(referrer->classLoader == NULL);
+    assert(accessTo->classLoader == NULL);
 
-    if (dvmIsArrayClass(resClass))
-        resClass = resClass->elementClass;
-    resClass->classLoader = NULL;
+    /* an array class's own loader is compared, which we don't change */
+    if (dvmIsArrayClass(accessTo) || referrer->pDvmDex == accessTo->pDvmDex)
+        return false;
+    if ((accessFlags & ACC_PUBLIC) != 0)
+        return false;
+    if ((accessFlags & ACC_PROTECTED) != 0 &&
+        dvmIsSubClass(referrer, accessTo))
+    {
+        return false;
+    }
+    return true;
 }
 
-
 /*
  * Alternate version of dvmResolveClass for use with verification and
  * optimization.  Performs access checks on every resolve, and refuses
@@ -449,32 +453,17 @@ ClassObject* dvmOptResolveClass(ClassObject* referrer, u4 classIdx,
         if (className[0] != '\0' && className[1] == '\0') {
             /* primitive type */
             resClass = dvmFindPrimitiveClass(className[0]);
+            if (resClass == NULL && pFailure != NULL)
+                *pFailure = VERIFY_ERROR_NO_CLASS;
         } else {
-            resClass = dvmFindClassNoInit(className, referrer->classLoader);
+            resClass = dvmVerifyFindClass(className, referrer->classLoader,
+                pFailure);
         }
         if (resClass == NULL) {
-            /* not found, exception should be raised */
+            /* not found; failures are cached too, so this is cheap */
             ALOGV("DexOpt: class %d (%s) not found",
                 classIdx,
                 dexStringByTypeIdx(pDvmDex->pDexFile, classIdx));
-            if (pFailure != NULL) {
-                /* dig through the wrappers to find the original failure */
-                Object* excep = dvmGetException(dvmThreadSelf());
-                while (true) {
-                    Object* cause = dvmGetExceptionCause(excep);
-                    if (cause == NULL)
-                        break;
-                    excep = cause;
-                }
-                if (strcmp(excep->clazz->descriptor,
-                    "Ljava/lang/IncompatibleClassChangeError;") == 0)
-                {
-                    *pFailure = VERIFY_ERROR_CLASS_CHANGE;
-                } else {
-                    *pFailure = VERIFY_ERROR_NO_CLASS;
-                }
-            }
-            dvmClearOptException(dvmThreadSelf());
             return NULL;
         }
 
@@ -494,9 +483,9 @@ ClassObject* dvmOptResolveClass(ClassObject* referrer, u4 classIdx,
     }
 
     /* access allowed? */
-    tweakLoader(referrer, resClass);
-    bool allowed = dvmCheckClassAccess(referrer, resClass);
-    untweakLoader(referrer, resClass);
+    bool allowed = dvmCheckClassAccess(referrer, resClass) &&
+        !isAccessRefusedAcrossDex(referrer, resClass,
+            resClass->accessFlags & ACC_PUBLIC);
     if (!allowed) {
         ALOGW("DexOpt: resolve class illegal access: %s -> %s",
             referrer->descriptor, resClass->descriptor);
@@ -564,9 +553,9 @@ InstField* dvmOptResolveInstField(ClassObject* referrer, u4 ifieldIdx,
     }
 
     /* access allowed? */
-    tweakLoader(referrer, resField->clazz);
-    bool allowed = dvmCheckFieldAccess(referrer, (Field*)resField);
-    untweakLoader(referrer, resField->clazz);
+    bool allowed = dvmCheckFieldAccess(referrer, (Field*)resField) &&
+        !isAccessRefusedAcrossDex(referrer, resField->clazz,
+            resField->accessFlags);
     if (!allowed) {
         ALOGI("DexOpt: access denied from %s to field %s.%s",
             referrer->descriptor, resField->clazz->descriptor,
@@ -642,9 +631,9 @@ StaticField* dvmOptResolveStaticField(ClassObject* referrer, u4 sfieldIdx,
     }
 
     /* access allowed? */
-    tweakLoader(referrer, resField->clazz);
-    bool allowed = dvmCheckFieldAccess(referrer, (Field*)resField);
-    untweakLoader(referrer, resField->clazz);
+    bool allowed = dvmCheckFieldAccess(referrer, (Field*)resField) &&
+        !isAccessRefusedAcrossDex(referrer, resField->clazz,
+            resField->accessFlags);
     if (!allowed) {
         ALOGI("DexOpt: access denied from %s to field %s.%s",
             referrer->descriptor, resField->clazz->descriptor,
@@ -858,9 +847,9 @@ Method* dvmOptResolveMethod(ClassObject* referrer, u4 methodIdx,
         methodIdx, resMethod->clazz->descriptor, resMethod->name);
 
     /* access allowed? */
-    tweakLoader(referrer, resMethod->clazz);
-    bool allowed = dvmCheckMethodAccess(referrer, resMethod);
-    untweakLoader(referrer, resMethod->clazz);
+    bool allowed = dvmCheckMethodAccess(referrer, resMethod) &&
+        !isAccessRefusedAcrossDex(referrer, resMethod->clazz,
+            resMethod->accessFlags);
     if (!allowed) {
         IF_ALOGI() {
             char* desc = dexProtoCopyMethodDescriptor(&resMethod->prototype);
@@ -1185,3 +1174,74 @@ static void rewriteReturnVoid(Method* method, u2* insns)
     assert((insns[0] & 0xff) == OP_RETURN_VOID);
     updateOpcode(method, insns, OP_RETURN_VOID_BARRIER);
 }
+
+/*
+ * Fuse common instruction pairs into superinstructions:
+ *
+ *  iget-quick + if-{eqz,nez} --> iget-quick-if-{eqz,nez}
+ *  const/4 + if-{eq,ne,lt,ge,gt,le} --> const/4-if
+ *  move-result[-wide,-object] + return[-wide,-object] of the same
+ *    register --> move-result[-wide,-object]-return
+ *  aget + add-int[/2addr] --> aget-add-int
+ *
+ * Only the opcode of the first instruction changes.  The second one stays
+ * where it is, so a branch to it, the debugger and the JIT still see the
+ * original instruction stream; the interpreter executes both halves in one
+ * dispatch.
+ */
+static void fuseInstructions(Method* method)
+{
+    u2* insns = (u2*) method->insns;
+    u4 insnsSize = dvmGetMethodInsnsSize(method);
+
+    while (insnsSize > 0) {
+        size_t width = dexGetWidthFromInstruction(insns);
+        assert(width > 0 && width <= insnsSize);
+        if (width == insnsSize)
+            break;
+
+        Opcode opc = dexOpcodeFromCodeUnit(insns[0]);
+        Opcode nextOpc = dexOpcodeFromCodeUnit(insns[width]);
+        bool sameReg = (insns[0] >> 8) == (insns[width] >> 8);
+        Opcode fusedOpc = OP_NOP;
+
+        switch (opc) {
+        case OP_IGET_QUICK:
+            if (nextOpc == OP_IF_EQZ)
+                fusedOpc = OP_IGET_QUICK_IF_EQZ;
+            else if (nextOpc == OP_IF_NEZ)
+                fusedOpc = OP_IGET_QUICK_IF_NEZ;
+            break;
+        case OP_CONST_4:
+            if (nextOpc >= OP_IF_EQ && nextOpc <= OP_IF_LE)
+                fusedOpc = OP_CONST_4_IF;
+            break;
+        case OP_MOVE_RESULT:
+            if (nextOpc == OP_RETURN && sameReg)
+                fusedOpc = OP_MOVE_RESULT_RETURN;
+            break;
+        case OP_MOVE_RESULT_WIDE:
+            if (nextOpc == OP_RETURN_WIDE && sameReg)
+                fusedOpc = OP_MOVE_RESULT_WIDE_RETURN;
+            break;
+        case OP_MOVE_RESULT_OBJECT:
+            if (nextOpc == OP_RETURN_OBJECT && sameReg)
+                fusedOpc = OP_MOVE_RESULT_OBJECT_RETURN;
+            break;
+        case OP_AGET:
+            if (nextOpc == OP_ADD_INT || nextOpc == OP_ADD_INT_2ADDR)
+                fusedOpc = OP_AGET_ADD_INT;
+            break;
+        default:
+            break;
+        }
+
+        if (fusedOpc != OP_NOP) {
+            assert(dexGetUnfusedOpcode(fusedOpc) == opc);
+            updateOpcode(method, insns, fusedOpc);
+        }
+
+        insns += width;
+        insnsSize -= width;
+    }
+}
@@ -39,7 +39,8 @@
 //#define REGISTER_MAP_STATS
 
 // fwd
-static void outputTypeVector(const RegType* regs, int insnRegCount, u1* data);
+static void outputTypeVector(const RegisterLine* line, int insnRegCount,
+    u1* data);
 static bool verifyMap(VerifierData* vdata, const RegisterMap* pMap);
 static int compareMaps(const RegisterMap* pMap1, const RegisterMap* pMap2);
 
@@ -257,14 +258,14 @@ RegisterMap* dvmGenerateRegisterMapV(VerifierData* vdata)
     mapData = pMap->data;
     for (i = 0; i < (int) vdata->insnsSize; i++) {
         if (dvmInsnIsGcPoint(vdata->insnFlags, i)) {
-            assert(vdata->registerLines[i].regTypes != NULL);
+            assert(vdata->registerLines[i].regChunks != NULL);
             if (format == kRegMapFormatCompact8) {
                 *mapData++ = i;
             } else /*kRegMapFormatCompact16*/ {
                 *mapData++ = i & 0xff;
                 *mapData++ = i >> 8;
             }
-            outputTypeVector(vdata->registerLines[i].regTypes,
+            outputTypeVector(&vdata->registerLines[i],
                 vdata->insnRegCount, mapData);
             mapData += regWidth;
         }
@@ -370,13 +371,14 @@ static inline bool isReferenceType(RegType type)
  * value, uninitialized data, merge conflict).  Register 0 will be found
  * in the low bit of the first byte.
  */
-static void outputTypeVector(const RegType* regs, int insnRegCount, u1* data)
+static void outputTypeVector(const RegisterLine* line, int insnRegCount,
+    u1* data)
 {
     u1 val = 0;
     int i;
 
     for (i = 0; i < insnRegCount; i++) {
-        RegType type = *regs++;
+        RegType type = dvmRegisterLineGetType(line, i);
         val >>= 1;
         if (isReferenceType(type))
             val |= 0x80;        /* set hi bit */
@@ -510,8 +512,8 @@ static bool verifyMap(VerifierData* vdata, const RegisterMap* pMap)
             dvmAbort();
         }
 
-        const RegType* regs = vdata->registerLines[addr].regTypes;
-        if (regs == NULL) {
+        const RegisterLine* line = &vdata->registerLines[addr];
+        if (line->regChunks == NULL) {
             ALOGE("GLITCH: addr %d has no data", addr);
             return false;
         }
@@ -530,7 +532,7 @@ static bool verifyMap(VerifierData* vdata, const RegisterMap* pMap)
 
             bitIsRef = val & 0x01;
 
-            RegType type = regs[i];
+            RegType type = dvmRegisterLineGetType(line, i);
             regIsRef = isReferenceType(type);
 
             if (bitIsRef != regIsRef) {
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Memoized class lookups and type merges for the bytecode verifier.
+ */
+#include "Dalvik.h"
+#include "analysis/VerifyCache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* initial size of the class table; it grows as needed */
+#define VERIFY_CLASS_CACHE_SIZE 512
+
+/*
+ * Outcome of one class lookup.  "descriptor" points just past the struct.
+ */
+struct VerifyCacheClass {
+    Object*         loader;
+    const char*     descriptor;
+    ClassObject*    clazz;          /* NULL if the lookup failed */
+    VerifyError     failure;        /* if it did, why */
+};
+
+static u4 computeClassHash(const char* descriptor, const Object* loader)
+{
+    return dvmComputeUtf8Hash(descriptor) ^ ((u4) loader >> 3);
+}
+
+/*
+ * Hash table compare function.  The loose item doesn't have to come from
+ * the table, so lookups can use a key on the stack.
+ */
+static int compareClassEntries(const void* vtableItem, const void* vlooseItem)
+{
+    const VerifyCacheClass* pTableItem = (const VerifyCacheClass*) vtableItem;
+    const VerifyCacheClass* pLooseItem = (const VerifyCacheClass*) vlooseItem;
+
+    if (pTableItem->loader != pLooseItem->loader)
+        return 1;
+    return strcmp(pTableItem->descriptor, pLooseItem->descriptor);
+}
+
+bool dvmVerifyCacheStartup()
+{
+    VerifyCache* pCache;
+
+    assert(gDvm.verifyCache == NULL);
+
+    pCache = (VerifyCache*) calloc(1, sizeof(VerifyCache));
+    if (pCache == NULL)
+        return false;
+
+    pCache->classes = dvmHashTableCreate(VERIFY_CLASS_CACHE_SIZE, free);
+    pCache->merges = dvmAllocAtomicCache(VERIFY_MERGE_CACHE_SIZE);
+    if (pCache->classes == NULL || pCache->merges == NULL) {
+        dvmHashTableFree(pCache->classes);
+        dvmFreeAtomicCache(pCache->merges);
+        free(pCache);
+        return false;
+    }
+
+    gDvm.verifyCache = pCache;
+    return true;
+}
+
+void dvmVerifyCacheShutdown()
+{
+    VerifyCache* pCache = gDvm.verifyCache;
+
+    if (pCache == NULL)
+        return;
+
+    ALOGD("DexOpt: verify cache: %d/%d class lookups hit (%d classes,"
+          " %d missing), %d/%d merges hit",
+        pCache->classLookups - pCache->classMisses, pCache->classLookups,
+        pCache->classMisses, pCache->classFailures,
+        pCache->mergeLookups - pCache->mergeMisses, pCache->mergeLookups);
+
+    gDvm.verifyCache = NULL;
+    dvmHashTableFree(pCache->classes);
+    dvmFreeAtomicCache(pCache->merges);
+    free(pCache);
+}
+
+/*
+ * Do the lookup for real.
+ */
+static ClassObject* findClass(const char* descriptor, Object* loader,
+    VerifyError* pFailure)
+{
+    ClassObject* clazz = dvmFindClassNoInit(descriptor, loader);
+
+    if (clazz == NULL) {
+        /* dig through the wrappers to find the original failure */
+        Object* excep = dvmGetException(dvmThreadSelf());
+        while (excep != NULL) {
+            Object* cause = dvmGetExceptionCause(excep);
+            if (cause == NULL)
+                break;
+            excep = cause;
+        }
+        if (excep != NULL && strcmp(excep->clazz->descriptor,
+                "Ljava/lang/IncompatibleClassChangeError;") == 0)
+        {
+            *pFailure = VERIFY_ERROR_CLASS_CHANGE;
+        } else {
+            *pFailure = VERIFY_ERROR_NO_CLASS;
+        }
+        dvmClearOptException(dvmThreadSelf());
+    }
+    return clazz;
+}
+
+ClassObject* dvmVerifyFindClass(const char* descriptor, Object* loader,
+    VerifyError* pFailure)
+{
+    VerifyCache* pCache = gDvm.verifyCache;
+    VerifyCacheClass key, *pEntry;
+    VerifyError failure = VERIFY_ERROR_NONE;
+    ClassObject* clazz;
+    u4 hash;
+
+    if (pCache == NULL) {
+        clazz = findClass(descriptor, loader, &failure);
+        if (clazz == NULL && pFailure != NULL)
+            *pFailure = failure;
+        return clazz;
+    }
+
+    android_atomic_inc(&pCache->classLookups);
+    hash = computeClassHash(descriptor, loader);
+    key.loader = loader;
+    key.descriptor = descriptor;
+
+    dvmHashTableLock(pCache->classes);
+    pEntry = (VerifyCacheClass*) dvmHashTableLookup(pCache->classes, hash,
+        &key, compareClassEntries, false);
+    dvmHashTableUnlock(pCache->classes);
+
+    if (pEntry == NULL) {
+        /*
+         * Look it up outside the table lock; class loading can take a
+         * while.  If another thread gets there first we just use its
+         * entry, which has the same outcome.
+         */
+        clazz = findClass(descriptor, loader, &failure);
+
+        size_t len = strlen(descriptor) + 1;
+        VerifyCacheClass* pNewEntry =
+            (VerifyCacheClass*) malloc(sizeof(VerifyCacheClass) + len);
+        if (pNewEntry == NULL) {
+            if (clazz == NULL && pFailure != NULL)
+                *pFailure = failure;
+            return clazz;
+        }
+        memcpy(pNewEntry + 1, descriptor, len);
+        pNewEntry->loader = loader;
+        pNewEntry->descriptor = (const char*) (pNewEntry + 1);
+        pNewEntry->clazz = clazz;
+        pNewEntry->failure = failure;
+
+        dvmHashTableLock(pCache->classes);
+        pEntry = (VerifyCacheClass*) dvmHashTableLookup(pCache->classes,
+            hash, pNewEntry, compareClassEntries, true);
+        dvmHashTableUnlock(pCache->classes);
+
+        if (pEntry != pNewEntry) {
+            free(pNewEntry);
+        } else {
+            android_atomic_inc(&pCache->classMisses);
+            if (clazz == NULL)
+                android_atomic_inc(&pCache->classFailures);
+        }
+    }
+
+    if (pEntry->clazz == NULL && pFailure != NULL)
+        *pFailure = pEntry->failure;
+    return pEntry->clazz;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Memoized class lookups and type merges for the bytecode verifier.
+ */
+#ifndef DALVIK_VERIFYCACHE_H_
+#define DALVIK_VERIFYCACHE_H_
+
+/*
+ * Number of entries in the merge cache.  MUST be a power of 2.
+ */
+#define VERIFY_MERGE_CACHE_SIZE 4096
+
+/*
+ * Results the verifier would otherwise compute over and over, shared by
+ * all of the threads verifying classes in one dexopt run.
+ *
+ * Class lookups are only stable while the set of classes the loaders can
+ * see doesn't change, which holds in dexopt (everything comes from the
+ * bootstrap class path and the DEX being optimized) but not in a running
+ * VM, so the cache only exists while the DEX optimizer is verifying.
+ */
+struct VerifyCache {
+    /* VerifyCacheClass entries, keyed by (loader, descriptor) */
+    HashTable*      classes;
+
+    /* (class, class) -> common superclass, for register type merges */
+    AtomicCache*    merges;
+
+    /* stats; the verifier threads share them, so use android_atomic_inc() */
+    volatile s4     classLookups;
+    volatile s4     classMisses;
+    volatile s4     classFailures;
+    volatile s4     mergeLookups;
+    volatile s4     mergeMisses;
+};
+
+/*
+ * Create gDvm.verifyCache, for the duration of one dexopt verify pass.
+ * Returns "false" on allocation failure, in which case there's no cache.
+ */
+bool dvmVerifyCacheStartup(void);
+
+/*
+ * Log the stats and discard gDvm.verifyCache.  No other thread may be
+ * verifying.
+ */
+void dvmVerifyCacheShutdown(void);
+
+/*
+ * Find a class for the verifier or optimizer, like dvmFindClassNoInit(),
+ * but without leaving an exception pending.  On failure, returns NULL and
+ * sets "*pFailure" (if non-NULL) to VERIFY_ERROR_CLASS_CHANGE if the class
+ * was found but couldn't be linked, VERIFY_ERROR_NO_CLASS otherwise.
+ *
+ * While gDvm.verifyCache exists, the outcome for each (loader, descriptor)
+ * is remembered, failures included, so each class is only looked for once.
+ */
+ClassObject* dvmVerifyFindClass(const char* descriptor, Object* loader,
+    VerifyError* pFailure);
+
+#endif  // DALVIK_VERIFYCACHE_H_
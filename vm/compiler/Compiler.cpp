@@ -86,27 +86,18 @@ void dvmCompilerForceWorkEnqueue(const u2 *pc, WorkOrderKind kind, void* info)
     } while (!success);
 }
 
-/*
- * Attempt to enqueue a work order, returning true if successful.
- *
- * NOTE: Make sure that the caller frees the info pointer if the return value
- * is false.
- */
-bool dvmCompilerWorkEnqueue(const u2 *pc, WorkOrderKind kind, void* info)
+/* Add a work order to the queue.  Caller holds gDvmJit.compilerLock. */
+static bool workEnqueue(const u2 *pc, WorkOrderKind kind, void* info)
 {
     int cc;
     int i;
     int numWork;
-    bool result = true;
-
-    dvmLockMutex(&gDvmJit.compilerLock);
 
     /*
      * Return if queue or code cache is full.
      */
     if (gDvmJit.compilerQueueLength == COMPILER_WORK_QUEUE_SIZE ||
         gDvmJit.codeCacheFull == true) {
-        dvmUnlockMutex(&gDvmJit.compilerLock);
         return false;
     }
 
@@ -116,7 +107,6 @@ bool dvmCompilerWorkEnqueue(const u2 *pc, WorkOrderKind kind, void* info)
          numWork--) {
         /* Already enqueued */
         if (gDvmJit.compilerWorkQueue[i++].pc == pc) {
-            dvmUnlockMutex(&gDvmJit.compilerLock);
             return true;
         }
         /* Wrap around */
@@ -135,6 +125,8 @@ bool dvmCompilerWorkEnqueue(const u2 *pc, WorkOrderKind kind, void* info)
         (kind == kWorkOrderTraceDebug) ? true : false;
     newOrder->result.cacheVersion = gDvmJit.cacheVersion;
     newOrder->result.requestingThread = dvmThreadSelf();
+    newOrder->result.traceCounter = NULL;
+    newOrder->result.baselineTier = false;
 
     gDvmJit.compilerWorkEnqueueIndex++;
     if (gDvmJit.compilerWorkEnqueueIndex == COMPILER_WORK_QUEUE_SIZE)
@@ -145,7 +137,21 @@ bool dvmCompilerWorkEnqueue(const u2 *pc, WorkOrderKind kind, void* info)
 #ifdef NDEBUG
     (void)cc; // prevent error on -Werror
 #endif
+    return true;
+}
 
+/*
+ * Attempt to enqueue a work order, returning true if successful.
+ *
+ * NOTE: Make sure that the caller frees the info pointer if the return value
+ * is false.
+ */
+bool dvmCompilerWorkEnqueue(const u2 *pc, WorkOrderKind kind, void* info)
+{
+    bool result;
+
+    dvmLockMutex(&gDvmJit.compilerLock);
+    result = workEnqueue(pc, kind, info);
     dvmUnlockMutex(&gDvmJit.compilerLock);
     return result;
 }
@@ -169,6 +175,270 @@ void dvmCompilerDrainQueue(void)
     dvmUnlockMutex(&gDvmJit.compilerLock);
 }
 
+/*
+ * Tiered compilation (-Xjittiers).
+ *
+ * A trace that just crossed the JIT threshold is built by the baseline tier,
+ * which skips loop formation, inlining and the MIR and LIR optimizations.
+ * Its JitTable entry is set up without the profile prefix offset, so every
+ * entry into it - chained or not - bumps the trace counter.  Whenever the
+ * compiler thread runs out of work it checks the counters and rebuilds the
+ * traces that reached gDvmJit.tierUpThreshold entries with the full pipeline.
+ *
+ * The JitTable entry of a trace cannot be pointed at new code while other
+ * threads may be running it, so optimized translations wait in tierUpQueue
+ * for the next safe point, which also cuts the chains into the baseline code.
+ * A GC provides one, but a hot loop that doesn't allocate may never cause a
+ * GC, so once the compiler thread has nothing left to build it suspends all
+ * threads itself to install them.
+ * The baseline code itself stays in the code cache until the next reset.
+ *
+ * The baseline traces and the tier-up queue are protected by
+ * gDvmJit.compilerLock.
+ */
+
+/* Duplicate a trace description up to the code run that ends it */
+static JitTraceDescription *copyTraceDescription(
+    const JitTraceDescription *desc)
+{
+    int numRuns = 0;
+
+    while (!desc->trace[numRuns].isCode ||
+           !desc->trace[numRuns].info.frag.runEnd) {
+        numRuns++;
+    }
+    size_t size = sizeof(JitTraceDescription) +
+                  sizeof(JitTraceRun) * (numRuns + 1);
+    JitTraceDescription *copy = (JitTraceDescription *) malloc(size);
+    if (copy != NULL) {
+        memcpy(copy, desc, size);
+    }
+    return copy;
+}
+
+/* Watch the counter of a trace built by the baseline tier */
+static void addBaselineTrace(const u2 *dPC, JitTraceDescription *desc,
+                             const s4 *counter)
+{
+    if (gDvmJit.numBaselineTraces == gDvmJit.maxBaselineTraces) {
+        int newMax = gDvmJit.maxBaselineTraces == 0 ?
+                     64 : gDvmJit.maxBaselineTraces * 2;
+        JitBaselineTrace *newTraces = (JitBaselineTrace *)
+            realloc(gDvmJit.pBaselineTraces,
+                    newMax * sizeof(JitBaselineTrace));
+        if (newTraces == NULL) {
+            /* Not fatal - the trace just stays at the baseline tier */
+            free(desc);
+            return;
+        }
+        gDvmJit.pBaselineTraces = newTraces;
+        gDvmJit.maxBaselineTraces = newMax;
+    }
+    JitBaselineTrace *trace =
+        &gDvmJit.pBaselineTraces[gDvmJit.numBaselineTraces++];
+    trace->dPC = dPC;
+    trace->desc = desc;
+    trace->counter = counter;
+    trace->tierUpRequested = false;
+}
+
+/*
+ * Queue optimizing builds of the baseline traces that stayed hot, and return
+ * the number of work orders queued.
+ */
+static int requestTierUps(void)
+{
+    int queued = 0;
+    int i;
+
+    for (i = 0; i < gDvmJit.numBaselineTraces; i++) {
+        JitBaselineTrace *trace = &gDvmJit.pBaselineTraces[i];
+        if (trace->tierUpRequested ||
+            *trace->counter < gDvmJit.tierUpThreshold) {
+            continue;
+        }
+        /* Every build needs a slot to wait for the safe point in */
+        if (gDvmJit.numTierUps + workQueueLength() >= JIT_TIER_UP_QUEUE_SIZE)
+            break;
+        /* The work order owns its copy, the code cache may be reset first */
+        JitTraceDescription *desc = copyTraceDescription(trace->desc);
+        if (desc == NULL)
+            break;
+        if (!workEnqueue(trace->dPC, kWorkOrderTraceOptimize, desc)) {
+            free(desc);
+            break;
+        }
+        trace->tierUpRequested = true;
+        queued++;
+    }
+    return queued;
+}
+
+/* Hold an optimized translation until the next safe point */
+static void queueTierUp(const CompilerWorkOrder *work)
+{
+    if (gDvmJit.numTierUps == JIT_TIER_UP_QUEUE_SIZE) {
+        /* Shouldn't happen, see requestTierUps - keep the baseline code */
+        return;
+    }
+    JitTierUp *tierUp = &gDvmJit.tierUpQueue[gDvmJit.numTierUps++];
+    tierUp->dPC = work->pc;
+    tierUp->codeAddress = work->result.codeAddress;
+    tierUp->instructionSet = work->result.instructionSet;
+    tierUp->profileCodeSize = work->result.profileCodeSize;
+}
+
+/* Switch the JitTable to the optimized translations.  Safe point only. */
+static void installTierUps(void)
+{
+    int numInstalled;
+    int i;
+
+    dvmLockMutex(&gDvmJit.compilerLock);
+    numInstalled = gDvmJit.numTierUps;
+    for (i = 0; i < numInstalled; i++) {
+        JitTierUp *tierUp = &gDvmJit.tierUpQueue[i];
+        dvmJitSetCodeAddr(tierUp->dPC, tierUp->codeAddress,
+                          tierUp->instructionSet,
+                          false, /* not method entry */
+                          tierUp->profileCodeSize);
+    }
+    gDvmJit.numTierUps = 0;
+    gDvmJit.tierUpsInstalled += numInstalled;
+    dvmUnlockMutex(&gDvmJit.compilerLock);
+
+    /* Chaining cells still branch straight into the baseline code */
+    if (numInstalled != 0) {
+        dvmJitUnchainAll();
+    }
+}
+
+/*
+ * Stop the world to install the pending tier-ups.  Called by the compiler
+ * thread, which must not hold compilerLock.
+ */
+static void installTierUpsAtSafePoint(void)
+{
+    dvmSuspendAllThreads(SUSPEND_FOR_TIER_UP);
+    /* A GC may have installed them while we were waiting */
+    if (gDvmJit.numTierUps != 0) {
+        installTierUps();
+    }
+    dvmResumeAllThreads(SUSPEND_FOR_TIER_UP);
+}
+
+/*
+ * Free the JitTable left behind by an incremental resize.  Lookups walk it
+ * without a lock, so it has to wait until every thread is suspended.
+ */
+static void releaseRetiredJitTableAtSafePoint(void)
+{
+    dvmSuspendAllThreads(SUSPEND_FOR_TBL_RESIZE);
+    /* A GC may have released it while we were waiting */
+    if (gDvmJit.pJitEntryTableRetired != NULL) {
+        dvmJitReleaseRetiredJitTable();
+    }
+    dvmResumeAllThreads(SUSPEND_FOR_TBL_RESIZE);
+}
+
+/* Move another batch of a pending resize, freeing the old table when done */
+static void migrateJitTable(void)
+{
+    dvmJitMigrateJitTable();
+    if (gDvmJit.pJitEntryTableRetired != NULL) {
+        releaseRetiredJitTableAtSafePoint();
+    }
+}
+
+/*
+ * Double the JitTable.  A resize still in progress is completed first, since
+ * only one old table can be pending at a time.  Returns true on failure.
+ */
+static bool growJitTable(void)
+{
+    if (gDvmJit.pJitEntryTableOld != NULL) {
+        dvmLockMutex(&gDvmJit.tableLock);
+        dvmJitFinishJitTableMigration();
+        dvmUnlockMutex(&gDvmJit.tableLock);
+    }
+    migrateJitTable();
+    return dvmJitResizeJitTable(gDvmJit.jitTableSize * 2);
+}
+
+/* Forget the baseline traces of a code cache being wiped out */
+static void resetTiers(void)
+{
+    int i;
+
+    for (i = 0; i < gDvmJit.numBaselineTraces; i++) {
+        free(gDvmJit.pBaselineTraces[i].desc);
+    }
+    gDvmJit.numBaselineTraces = 0;
+    gDvmJit.numTierUps = 0;
+}
+
+/*
+ * Compile-time budget (-Xjitcompilebudget).  Compilation time is charged to
+ * one second windows, and once gDvmJit.compileBudget ms have been spent in a
+ * window the compiler thread waits for the next one.  A compilation that
+ * overruns the budget is paid back from the windows that follow.
+ *
+ * Returns the number of ms to wait before starting the next compilation.
+ */
+static int compileBudgetDelay(void)
+{
+    u8 budget = (u8) gDvmJit.compileBudget * 1000;
+    u8 now;
+    u8 elapsedWindows;
+
+    /* Don't hold up threads waiting for their own compilations */
+    if (budget == 0 || gDvmJit.blockingMode)
+        return 0;
+
+    now = dvmGetRelativeTimeUsec();
+    if (gDvmJit.budgetWindowStart == 0)
+        gDvmJit.budgetWindowStart = now;
+    elapsedWindows = (now - gDvmJit.budgetWindowStart) / 1000000;
+    if (elapsedWindows != 0) {
+        gDvmJit.budgetWindowStart += elapsedWindows * 1000000;
+        gDvmJit.budgetWindowUsed =
+            gDvmJit.budgetWindowUsed > elapsedWindows * budget ?
+            gDvmJit.budgetWindowUsed - elapsedWindows * budget : 0;
+    }
+    if (gDvmJit.budgetWindowUsed < budget)
+        return 0;
+    return (int) ((gDvmJit.budgetWindowStart + 1000000 - now) / 1000) + 1;
+}
+
+/* Charge a finished work order to its tier and to the budget */
+static void chargeCompilation(const CompilerWorkOrder *work, u8 usec)
+{
+    if (work->kind == kWorkOrderProfileMode)
+        return;
+    gDvmJit.budgetWindowUsed += usec;
+    if (work->result.codeAddress != NULL) {
+        JitTier tier = work->result.baselineTier ?
+                       kJitTierBaseline : kJitTierOptimized;
+        gDvmJit.tierCompilations[tier]++;
+        gDvmJit.tierTime[tier] += usec;
+    }
+}
+
+void dvmCompilerDumpTierStats(void)
+{
+    ALOGD("JIT: Baseline tier: %d traces in %llu ms",
+         gDvmJit.tierCompilations[kJitTierBaseline],
+         gDvmJit.tierTime[kJitTierBaseline] / 1000);
+    ALOGD("JIT: Optimizing tier: %d traces in %llu ms, %d tier-ups installed",
+         gDvmJit.tierCompilations[kJitTierOptimized],
+         gDvmJit.tierTime[kJitTierOptimized] / 1000,
+         gDvmJit.tierUpsInstalled);
+    if (gDvmJit.compileBudget != 0) {
+        ALOGD("JIT: Compile budget: %d ms/s, %d stalls",
+             gDvmJit.compileBudget, gDvmJit.budgetStalls);
+    }
+}
+
 bool dvmCompilerSetupCodeCache(void)
 {
     int fd;
@@ -235,6 +505,8 @@ bool dvmCompilerSetupCodeCache(void)
     ALOGV("stream = %p after initJIT", stream);
 #endif
 
+    dvmCompilerPerfMapReset();
+
     return true;
 }
 
@@ -350,11 +622,23 @@ static void resetCodeCache(void)
     gDvmJit.compilerWorkEnqueueIndex = gDvmJit.compilerWorkDequeueIndex = 0;
     gDvmJit.compilerQueueLength = 0;
 
+    /* Nothing left to tier up */
+    resetTiers();
+
     /* Reset the IC patch work queue */
     dvmLockMutex(&gDvmJit.compilerICPatchLock);
     gDvmJit.compilerICPatchIndex = 0;
     dvmUnlockMutex(&gDvmJit.compilerICPatchLock);
 
+    /* The receiver profiles are keyed by the cells just wiped out */
+    dvmJitResetReceiverProfiles();
+
+    /* So are the exit profiles */
+    dvmJitResetTraceExits();
+
+    /* Drop the symbols of the translations just wiped out */
+    dvmCompilerPerfMapReset();
+
     /*
      * Reset the inflight compilation address (can only be done in safe points
      * or by the compiler thread when its thread state is RUNNING).
@@ -378,6 +662,8 @@ static void resetCodeCache(void)
  * 1) Check if the code cache is full. If so reset it and restart populating it
  *    from scratch.
  * 2) Patch predicted chaining cells by consuming recorded work orders.
+ * 3) Install the optimized translations of hot baseline traces.
+ * 4) Free a JitTable left behind by an incremental resize.
  */
 void dvmCompilerPerformSafePointChecks(void)
 {
@@ -385,6 +671,12 @@ void dvmCompilerPerformSafePointChecks(void)
         resetCodeCache();
     }
     dvmCompilerPatchInlineCache();
+    if (gDvmJit.numTierUps != 0) {
+        installTierUps();
+    }
+    if (gDvmJit.pJitEntryTableRetired != NULL) {
+        dvmJitReleaseRetiredJitTable();
+    }
 }
 
 static bool compilerThreadStartup(void)
@@ -423,6 +715,17 @@ static bool compilerThreadStartup(void)
     gDvm.verboseShutdown = true;
 #endif
 
+#if defined(ARCH_IA32)
+    /* x86 translations have no trace counter to tier up on */
+    if (gDvmJit.tieredCompilation) {
+        ALOGW("Jit: tiered compilation is not supported on x86");
+        gDvmJit.tieredCompilation = false;
+    }
+#endif
+    if (gDvmJit.tierUpThreshold <= 0) {
+        gDvmJit.tierUpThreshold = JIT_TIER_UP_THRESHOLD;
+    }
+
     dvmUnlockMutex(&gDvmJit.compilerLock);
 
     /* Set up the JitTable */
@@ -457,10 +760,10 @@ static bool compilerThreadStartup(void)
     }
     memset(pJitProfTable, gDvmJit.threshold, JIT_PROF_SIZE);
     for (i=0; i < gDvmJit.jitTableSize; i++) {
-       pJitTable[i].u.info.chain = gDvmJit.jitTableSize;
+       pJitTable[i].u.info.chain = JIT_ENTRY_CHAIN_END;
     }
-    /* Is chain field wide enough for termination pattern? */
-    assert(pJitTable[0].u.info.chain == gDvmJit.jitTableSize);
+    /* Is chain field wide enough for every index and the terminator? */
+    assert(gDvmJit.jitTableSize <= JIT_ENTRY_CHAIN_END);
 
     /* Allocate the trace profiling structure */
     pJitTraceProfCounters = (JitTraceProfCounters*)
@@ -659,26 +962,58 @@ static void *compilerThreadStart(void *arg)
     while (!gDvmJit.haltCompilerThread) {
         if (workQueueLength() == 0) {
             int cc;
+            /* Use idle time to finish an incremental JitTable resize */
+            if (gDvmJit.pJitEntryTableOld != NULL) {
+                dvmUnlockMutex(&gDvmJit.compilerLock);
+                migrateJitTable();
+                dvmLockMutex(&gDvmJit.compilerLock);
+                continue;
+            }
+            /* Use idle time to rebuild the baseline traces that got hot */
+            if (gDvmJit.tieredCompilation && requestTierUps() != 0) {
+                continue;
+            }
+            /* All built - don't wait for a GC to put them in place */
+            if (gDvmJit.numTierUps != 0) {
+                dvmUnlockMutex(&gDvmJit.compilerLock);
+                installTierUpsAtSafePoint();
+                dvmLockMutex(&gDvmJit.compilerLock);
+                continue;
+            }
             cc = pthread_cond_signal(&gDvmJit.compilerQueueEmpty);
             assert(cc == 0);
 #ifdef NDEBUG
             (void)cc; // prevent bug on -Werror
 #endif
-            pthread_cond_wait(&gDvmJit.compilerQueueActivity,
-                              &gDvmJit.compilerLock);
+            if (gDvmJit.numBaselineTraces != 0) {
+                /* Wake up now and then to check the trace counters */
+                dvmRelativeCondWait(&gDvmJit.compilerQueueActivity,
+                                    &gDvmJit.compilerLock,
+                                    JIT_TIER_UP_POLL_MS, 0);
+            } else {
+                pthread_cond_wait(&gDvmJit.compilerQueueActivity,
+                                  &gDvmJit.compilerLock);
+            }
             continue;
         } else {
             do {
+                /* Out of compilation time for this second */
+                int budgetDelay = compileBudgetDelay();
+                if (budgetDelay != 0) {
+                    gDvmJit.budgetStalls++;
+                    dvmRelativeCondWait(&gDvmJit.compilerQueueActivity,
+                                        &gDvmJit.compilerLock,
+                                        budgetDelay, 0);
+                    break;
+                }
                 CompilerWorkOrder work = workDequeue();
                 dvmUnlockMutex(&gDvmJit.compilerLock);
-#if defined(WITH_JIT_TUNING)
                 /*
                  * This is live across setjmp().  Mark it volatile to suppress
                  * a gcc warning.  We should not need this since it is assigned
                  * only once but gcc is not smart enough.
                  */
                 volatile u8 startTime = dvmGetRelativeTimeUsec();
-#endif
                 /*
                  * Check whether there is a suspend request on me.  This
                  * is necessary to allow a clean shutdown.
@@ -691,11 +1026,12 @@ static void *compilerThreadStart(void *arg)
                  */
                 if (!gDvmJit.blockingMode)
                     dvmCheckSuspendPending(dvmThreadSelf());
+                /* Move another batch of a pending JitTable resize */
+                migrateJitTable();
                 /* Is JitTable filling up? */
                 if (gDvmJit.jitTableEntriesUsed >
                     (gDvmJit.jitTableSize - gDvmJit.jitTableSize/4)) {
-                    bool resizeFail =
-                        dvmJitResizeJitTable(gDvmJit.jitTableSize * 2);
+                    bool resizeFail = growJitTable();
                     /*
                      * If the jit table is full, consider it's time to reset
                      * the code cache too.
@@ -721,20 +1057,40 @@ static void *compilerThreadStart(void *arg)
                              codeCompiled &&
                              !work.result.discardResult &&
                              work.result.codeAddress) {
-                            dvmJitSetCodeAddr(work.pc, work.result.codeAddress,
-                                              work.result.instructionSet,
-                                              false, /* not method entry */
-                                              work.result.profileCodeSize);
+                            if (work.kind == kWorkOrderTraceOptimize) {
+                                /* Replaces the baseline code at a safe point */
+                                queueTierUp(&work);
+                            } else if (work.result.baselineTier &&
+                                       work.result.traceCounter != NULL) {
+                                /* Always enter through the counter */
+                                dvmJitSetCodeAddr(work.pc,
+                                                  work.result.codeAddress,
+                                                  work.result.instructionSet,
+                                                  false, /* not method entry */
+                                                  0);
+                                addBaselineTrace(work.pc,
+                                    (JitTraceDescription *) work.info,
+                                    work.result.traceCounter);
+                                work.info = NULL;
+                            } else {
+                                dvmJitSetCodeAddr(work.pc,
+                                                  work.result.codeAddress,
+                                                  work.result.instructionSet,
+                                                  false, /* not method entry */
+                                                  work.result.profileCodeSize);
+                            }
                         }
                         dvmUnlockMutex(&gDvmJit.compilerLock);
                     }
                     dvmCompilerArenaReset();
                 }
                 free(work.info);
+                u8 workTime = dvmGetRelativeTimeUsec() - startTime;
 #if defined(WITH_JIT_TUNING)
-                gDvmJit.jitTime += dvmGetRelativeTimeUsec() - startTime;
+                gDvmJit.jitTime += workTime;
 #endif
                 dvmLockMutex(&gDvmJit.compilerLock);
+                chargeCompilation(&work, workTime);
             } while (workQueueLength() != 0);
         }
     }
@@ -758,6 +1114,7 @@ bool dvmCompilerStartup(void)
 
     dvmInitMutex(&gDvmJit.compilerLock);
     dvmInitMutex(&gDvmJit.compilerICPatchLock);
+    dvmInitMutex(&gDvmJit.traceExitLock);
     dvmInitMutex(&gDvmJit.codeCacheProtectionLock);
     dvmLockMutex(&gDvmJit.compilerLock);
     pthread_cond_init(&gDvmJit.compilerQueueActivity, NULL);
@@ -810,6 +1167,8 @@ void dvmCompilerShutdown(void)
     /* Break loops within the translation cache */
     dvmJitUnchainAll();
 
+    dvmCompilerPerfMapShutdown();
+
     /*
      * NOTE: our current implementatation doesn't allow for the compiler
      * thread to be restarted after it exits here.  We aren't freeing
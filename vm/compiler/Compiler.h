@@ -29,6 +29,12 @@
 #define COMPILER_IC_PATCH_QUEUE_SIZE    64
 #define COMPILER_PC_OFFSET_SIZE         100
 
+/*
+ * Buckets of the JitTable probe length histogram.  The last bucket collects
+ * every lookup that visited this many entries or more.
+ */
+#define JIT_PROBE_HISTOGRAM_SIZE        8
+
 /* Architectural-independent parameters for predicted chains */
 #define PREDICTED_CHAIN_CLAZZ_INIT       0
 #define PREDICTED_CHAIN_METHOD_INIT      0
@@ -88,6 +94,8 @@ typedef struct JitTranslationInfo {
     bool methodCompilationAborted;  // Cannot compile the whole method
     Thread *requestingThread;   // For debugging purpose
     int cacheVersion;           // Used to identify stale trace requests
+    s4 *traceCounter;           // Entry counter in the profile prefix
+    bool baselineTier;          // Built by the baseline tier
 } JitTranslationInfo;
 
 typedef enum WorkOrderKind {
@@ -96,6 +104,7 @@ typedef enum WorkOrderKind {
     kWorkOrderTrace = 2,        // Work is to compile code fragment(s)
     kWorkOrderTraceDebug = 3,   // Work is to compile/debug code fragment(s)
     kWorkOrderProfileMode = 4,  // Change profiling mode
+    kWorkOrderTraceOptimize = 5,  // Rebuild a hot baseline trace
 } WorkOrderKind;
 
 typedef struct CompilerWorkOrder {
@@ -128,6 +137,74 @@ typedef struct ICPatchWorkOrder {
     u4 serialNumber;                    /* Serial # (for verification only) */
 } ICPatchWorkOrder;
 
+/*
+ * Receiver profile of a predicted chaining cell.  This is not a polymorphic
+ * inline cache: the generated code still carries a single prediction per
+ * call site.  The profile remembers up to RECEIVER_PROFILE_ENTRIES receiver
+ * classes observed on the miss path so that a bimorphic or trimorphic site
+ * keeps its hottest receiver chained instead of being re-patched for every
+ * class it sees.  Sites that exceed the limit are marked megamorphic and are
+ * left to the vtable/itable fallback.
+ */
+#define RECEIVER_PROFILE_ENTRIES        4
+/* Times a polymorphic site may be re-targeted before its cell is frozen */
+#define RECEIVER_PROFILE_REPATCHES      RECEIVER_PROFILE_ENTRIES
+/* Number of call sites tracked - has to be a power of 2 */
+#define RECEIVER_PROFILE_TABLE_SIZE     1024
+
+typedef struct ReceiverProfileEntry {
+    const ClassObject *clazz;           /* Receiver class - compared only */
+    const Method *method;               /* Resolved callee for the class */
+    u4 samples;                         /* Times seen on the miss path */
+    char *descriptor;                   /* Copy of clazz->descriptor */
+} ReceiverProfileEntry;
+
+typedef struct ReceiverProfileSite {
+    const PredictedChainingCell *cell;  /* Key - NULL if the slot is free */
+    char *callee;                       /* Copy of the first callee's name */
+    ReceiverProfileEntry entries[RECEIVER_PROFILE_ENTRIES];
+    u2 numEntries;
+    u2 repatches;
+    u4 misses;                          /* Miss-path samples of this site */
+    bool megamorphic;
+} ReceiverProfileSite;
+
+typedef enum ReceiverProfileAction {
+    kReceiverPatch = 0,     // Go ahead and patch the cell
+    kReceiverKeep,          // Current prediction is the better one
+    kReceiverMegamorphic,   // Too many receivers - leave it to the fallback
+} ReceiverProfileAction;
+
+/*
+ * Exit profile of a trace, collected with -Xjitexitprofile.  Every normal
+ * chaining cell gets a TraceExit.  The cells are kept unchained until
+ * TRACE_EXIT_PROFILE_WINDOW exits have been counted, and a side exit found to
+ * be hotter than the end of the trace then becomes the head of a trace of its
+ * own.
+ */
+#define TRACE_EXIT_PROFILE_WINDOW       128
+
+typedef struct TraceExit {
+    const u2 *targetPC;                 /* Where the cell resumes execution */
+    const void *cell;                   /* Cell address, once it was taken */
+    u4 count;                           /* Times taken while unchained */
+    bool isSideExit;                    /* Leaves before the end of the trace */
+    bool isHot;                         /* Hotter than the end of the trace */
+    bool reformed;                      /* Trace requested at targetPC */
+} TraceExit;
+
+typedef struct TraceExitProfile {
+    const char *codeStart;              /* Translation in the code cache */
+    u4 codeSize;
+    const Method *method;
+    const u2 *headPC;                   /* Dalvik PC of the trace head */
+    bool isLoop;                        /* Loop traces are only counted */
+    bool settled;                       /* Profiling window is over */
+    u4 samples;                         /* Exits counted in the window */
+    u2 numExits;
+    TraceExit exits[0];                 // Variable-length, one per target
+} TraceExitProfile;
+
 /*
  * Trace description as will appear in the translation cache.  Note
  * flexible array at end, as these will be of variable size.  To
@@ -139,6 +216,36 @@ typedef struct {
     JitTraceRun trace[0];       // Variable-length trace descriptors
 } JitTraceDescription;
 
+/*
+ * Tiered compilation (-Xjittiers).  A trace is first built by the baseline
+ * tier, which keeps counting the entries into it, and is rebuilt by the
+ * optimizing tier once gDvmJit.tierUpThreshold entries have been counted.
+ */
+typedef enum JitTier {
+    kJitTierBaseline = 0,       // Quick build of a trace that just got hot
+    kJitTierOptimized,          // Full pipeline
+    kJitTierLast,
+} JitTier;
+
+#define JIT_TIER_UP_THRESHOLD           2000
+#define JIT_TIER_UP_POLL_MS             100
+#define JIT_TIER_UP_QUEUE_SIZE          64
+
+typedef struct JitBaselineTrace {
+    const u2 *dPC;                      /* Trace head */
+    JitTraceDescription *desc;          /* Kept for the optimizing build */
+    const s4 *counter;                  /* Entry counter of the translation */
+    bool tierUpRequested;
+} JitBaselineTrace;
+
+/* Optimized translation waiting for a safe point to be installed */
+typedef struct JitTierUp {
+    const u2 *dPC;
+    void *codeAddress;
+    JitInstructionSetType instructionSet;
+    int profileCodeSize;
+} JitTierUp;
+
 typedef enum JitMethodAttributes {
     kIsCallee = 0,      /* Code is part of a callee (invoked by a hot trace) */
     kIsHot,             /* Code is part of a hot trace */
@@ -148,6 +255,7 @@ typedef enum JitMethodAttributes {
     kIsGetter,          /* Method fits the getter pattern */
     kIsSetter,          /* Method fits the setter pattern */
     kCannotCompile,     /* Method cannot be compiled */
+    kIsStraightLine,    /* Method is a short branch-free computation */
 } JitMethodAttributes;
 
 #define METHOD_IS_CALLEE        (1 << kIsCallee)
@@ -158,13 +266,22 @@ typedef enum JitMethodAttributes {
 #define METHOD_IS_GETTER        (1 << kIsGetter)
 #define METHOD_IS_SETTER        (1 << kIsSetter)
 #define METHOD_CANNOT_COMPILE   (1 << kCannotCompile)
+#define METHOD_IS_STRAIGHT_LINE (1 << kIsStraightLine)
+
+/* Size limits of a straight-line callee that can be spliced into a trace */
+#define JIT_MAX_INLINE_CODE_UNITS   16
+#define JIT_MAX_INLINE_INSNS        8
 
 /* Vectors to provide optimization hints */
 typedef enum JitOptimizationHints {
     kJitOptNoLoop = 0,          // Disable loop formation/optimization
+    kJitOptBaseline,            // Baseline tier - skip the optimizations
+    kJitOptRecompile,           // Replace an existing translation
 } JitOptimizationHints;
 
 #define JIT_OPT_NO_LOOP         (1 << kJitOptNoLoop)
+#define JIT_OPT_BASELINE        (1 << kJitOptBaseline)
+#define JIT_OPT_RECOMPILE       (1 << kJitOptRecompile)
 
 /* Customized node traversal orders for different needs */
 typedef enum DataFlowAnalysisMode {
@@ -195,6 +312,10 @@ bool dvmCompilerArchInit(void);
 void dvmCompilerArchDump(void);
 bool dvmCompilerStartup(void);
 void dvmCompilerShutdown(void);
+void dvmCompilerPerfMapReset(void);
+void dvmCompilerPerfMapAddTranslation(struct CompilationUnit *cUnit,
+                                      const void *codeStart, int codeSize);
+void dvmCompilerPerfMapShutdown(void);
 void dvmCompilerForceWorkEnqueue(const u2* pc, WorkOrderKind kind, void* info);
 bool dvmCompilerWorkEnqueue(const u2* pc, WorkOrderKind kind, void* info);
 void *dvmCheckCodeCache(void *method);
@@ -211,11 +332,24 @@ void dvmJitUnchainAll(void);
 void dvmJitScanAllClassPointers(void (*callback)(void *ptr));
 void dvmCompilerSortAndPrintTraceProfiles(void);
 void dvmCompilerPerformSafePointChecks(void);
+ReceiverProfileAction dvmJitProfileReceiver(const PredictedChainingCell *cell,
+                                            const ClassObject *clazz,
+                                            const Method *method);
+void dvmJitResetReceiverProfiles(void);
+void dvmJitDumpReceiverProfiles(void);
+void dvmCompilerTraceExitAddTranslation(struct CompilationUnit *cUnit,
+                                        const void *codeStart, int codeSize);
+bool dvmJitTraceExitCanChain(const void *chainAddr);
+void dvmJitResetTraceExits(void);
+void dvmJitDumpTraceExits(void);
+void dvmCompilerDumpTierStats(void);
 void dvmCompilerInlineMIR(struct CompilationUnit *cUnit,
                           JitTranslationInfo *info);
 void dvmInitializeSSAConversion(struct CompilationUnit *cUnit);
 int dvmConvertSSARegToDalvik(const struct CompilationUnit *cUnit, int ssaReg);
 bool dvmCompilerLoopOpt(struct CompilationUnit *cUnit);
+void dvmCompilerRedundantLoadElimination(struct CompilationUnit *cUnit);
+void dvmCompilerEscapeAnalysis(struct CompilationUnit *cUnit);
 void dvmCompilerInsertBackwardChaining(struct CompilationUnit *cUnit);
 void dvmCompilerNonLoopAnalysis(struct CompilationUnit *cUnit);
 bool dvmCompilerFindLocalLiveIn(struct CompilationUnit *cUnit,
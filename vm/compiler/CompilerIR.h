@@ -93,6 +93,8 @@ enum ExtendedMIROpcode {
     kMirOpLowerBound,
     kMirOpPunt,
     kMirOpCheckInlinePrediction,        // Gen checks for predicted inlining
+    kMirOpMemBarrier,                   // Store barrier of an inlined <init>
+    kMirOpVectorLoop,                   // SSE version of an element-wise loop
     kMirOpLast,
 };
 
@@ -139,6 +141,8 @@ typedef struct MIR {
         const Method *calleeMethod;
         // Used by the inlined invoke to find the class and method pointers
         CallsiteInfo *callsiteInfo;
+        // Used by kMirOpVectorLoop to find the loop body
+        struct VectorLoopInfo *vectorLoopInfo;
     } meta;
 } MIR;
 
@@ -228,6 +232,8 @@ typedef struct CompilationUnit {
     bool heapMemOp;                     // Mark mem ops for self verification
     bool usesLinkRegister;              // For self-verification only
     int profileCodeSize;                // Size of the profile prefix in bytes
+    s4 *traceCounter;                   // Counter bumped by the prefix
+    bool baselineTier;                  // Skip the optional optimizations
     int numChainingCells[kChainingCellGap];
     LIR *firstChainingLIR[kChainingCellGap];
     LIR *chainingCellBottom;
@@ -216,22 +216,22 @@ int dvmCompilerDataFlowAttributes[kMirOpLast] = {
     // 3D OP_IF_LEZ vAA, +BBBB
     DF_UA,
 
-    // 3E OP_UNUSED_3E
+    // 3E OP_IGET_QUICK_IF_EQZ
     DF_NOP,
 
-    // 3F OP_UNUSED_3F
+    // 3F OP_IGET_QUICK_IF_NEZ
     DF_NOP,
 
-    // 40 OP_UNUSED_40
+    // 40 OP_CONST_4_IF
     DF_NOP,
 
-    // 41 OP_UNUSED_41
+    // 41 OP_MOVE_RESULT_RETURN
     DF_NOP,
 
-    // 42 OP_UNUSED_42
+    // 42 OP_MOVE_RESULT_WIDE_RETURN
     DF_NOP,
 
-    // 43 OP_UNUSED_43
+    // 43 OP_MOVE_RESULT_OBJECT_RETURN
     DF_NOP,
 
     // 44 OP_AGET vAA, vBB, vCC
@@ -375,7 +375,7 @@ int dvmCompilerDataFlowAttributes[kMirOpLast] = {
     // 72 OP_INVOKE_INTERFACE {vD, vE, vF, vG, vA}
     DF_FORMAT_35C,
 
-    // 73 OP_UNUSED_73
+    // 73 OP_AGET_ADD_INT
     DF_NOP,
 
     // 74 OP_INVOKE_VIRTUAL_RANGE {vCCCC .. vNNNN}
@@ -559,10 +559,10 @@ int dvmCompilerDataFlowAttributes[kMirOpLast] = {
     DF_DA_WIDE | DF_UB_WIDE | DF_UC_WIDE | DF_FP_A | DF_FP_B | DF_FP_C,
 
     // B0 OP_ADD_INT_2ADDR vA, vB
-    DF_DA | DF_UA | DF_UB,
+    DF_DA | DF_UA | DF_UB | DF_IS_LINEAR,
 
     // B1 OP_SUB_INT_2ADDR vA, vB
-    DF_DA | DF_UA | DF_UB,
+    DF_DA | DF_UA | DF_UB | DF_IS_LINEAR,
 
     // B2 OP_MUL_INT_2ADDR vA, vB
     DF_DA | DF_UA | DF_UB,
@@ -655,7 +655,7 @@ int dvmCompilerDataFlowAttributes[kMirOpLast] = {
     DF_DA_WIDE | DF_UA_WIDE | DF_UB_WIDE | DF_FP_A | DF_FP_B,
 
     // D0 OP_ADD_INT_LIT16 vA, vB, #+CCCC
-    DF_DA | DF_UB,
+    DF_DA | DF_UB | DF_IS_LINEAR,
 
     // D1 OP_RSUB_INT vA, vB, #+CCCC
     DF_DA | DF_UB,
@@ -1416,6 +1416,19 @@ bool dvmCompilerDoConstantPropagation(CompilationUnit *cUnit, BasicBlock *bb)
     return true;
 }
 
+static bool isBasicInductionVariable(const GrowableList *ivList, int ssaReg)
+{
+    unsigned int i;
+    for (i = 0; i < ivList->numUsed; i++) {
+        InductionVariableInfo *ivInfo =
+            (InductionVariableInfo *) ivList->elemList[i];
+        if (ivInfo->ssaReg == ssaReg) {
+            return ivInfo->ssaReg == ivInfo->basicSSAReg;
+        }
+    }
+    return false;
+}
+
 bool dvmCompilerFindInductionVariables(struct CompilationUnit *cUnit,
                                        struct BasicBlock *bb)
 {
@@ -1458,6 +1471,7 @@ bool dvmCompilerFindInductionVariables(struct CompilationUnit *cUnit,
 
                 switch (mir->dalvikInsn.opcode) {
                     case OP_ADD_INT:
+                    case OP_ADD_INT_2ADDR:
                         if (dvmIsBitSet(isConstantV,
                                         mir->ssaRep->uses[1])) {
                             deltaValue =
@@ -1466,6 +1480,7 @@ bool dvmCompilerFindInductionVariables(struct CompilationUnit *cUnit,
                         }
                         break;
                     case OP_SUB_INT:
+                    case OP_SUB_INT_2ADDR:
                         if (dvmIsBitSet(isConstantV,
                                         mir->ssaRep->uses[1])) {
                             deltaValue =
@@ -1474,6 +1489,7 @@ bool dvmCompilerFindInductionVariables(struct CompilationUnit *cUnit,
                         }
                         break;
                     case OP_ADD_INT_LIT8:
+                    case OP_ADD_INT_LIT16:
                         deltaValue = mir->dalvikInsn.vC;
                         deltaIsConstant = true;
                         break;
@@ -1525,6 +1541,7 @@ bool dvmCompilerFindInductionVariables(struct CompilationUnit *cUnit,
 
             switch (mir->dalvikInsn.opcode) {
                 case OP_ADD_INT:
+                case OP_ADD_INT_2ADDR:
                     if (dvmIsBitSet(isConstantV,
                                     mir->ssaRep->uses[1])) {
                         c = cUnit->constantValues[mir->ssaRep->uses[1]];
@@ -1532,6 +1549,7 @@ bool dvmCompilerFindInductionVariables(struct CompilationUnit *cUnit,
                     }
                     break;
                 case OP_SUB_INT:
+                case OP_SUB_INT_2ADDR:
                     if (dvmIsBitSet(isConstantV,
                                     mir->ssaRep->uses[1])) {
                         c = -cUnit->constantValues[mir->ssaRep->uses[1]];
@@ -1539,6 +1557,7 @@ bool dvmCompilerFindInductionVariables(struct CompilationUnit *cUnit,
                     }
                     break;
                 case OP_ADD_INT_LIT8:
+                case OP_ADD_INT_LIT16:
                     c = mir->dalvikInsn.vC;
                     cIsConstant = true;
                     break;
@@ -1546,8 +1565,13 @@ bool dvmCompilerFindInductionVariables(struct CompilationUnit *cUnit,
                     break;
             }
 
-            /* Ignore the update to the basic induction variable itself */
-            if (DECODE_REG(srcDalvikReg) == DECODE_REG(dstDalvikReg))  {
+            /*
+             * Ignore the update to the basic induction variable itself. With
+             * the 2addr forms the source and destination are always the same
+             * register, so make sure the source is the BIV.
+             */
+            if (DECODE_REG(srcDalvikReg) == DECODE_REG(dstDalvikReg) &&
+                isBasicInductionVariable(ivList, mir->ssaRep->uses[0])) {
                 cUnit->loopAnalysis->ssaBIV = mir->ssaRep->defs[0];
                 cIsConstant = false;
             }
@@ -0,0 +1,436 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Escape analysis and allocation removal for traces.
+ *
+ * Once the constructor of a new object has been inlined and its fields have
+ * been forwarded to the loads that follow (see RedundantLoadElimination.cpp),
+ * the object is often only written and never read.  Such an allocation is
+ * removed when:
+ *
+ *   - every use of the new-instance result is the base of a non-volatile
+ *     iput or an argument of the inlined constructor call, all in the same
+ *     block as the allocation;
+ *   - nothing between the allocation and its last use can leave the trace,
+ *     so the interpreter never sees the object half built;
+ *   - on every way out of the trace before the register is redefined, the
+ *     register holding the object is dead in the bytecode.
+ *
+ * The new-instance is then turned into "const/16 vX, #0" so that the frame
+ * never holds a stale reference, and the stores are dropped.  Objects that
+ * escape on some path are left alone - they are not rematerialized on the
+ * exit.
+ */
+
+#include "Dalvik.h"
+#include "Dataflow.h"
+#include "libdex/DexOpcodes.h"
+
+/* Bytecode instructions visited per liveness query before giving up */
+#define MAX_LIVENESS_STEPS 512
+
+/* Nested blocks of the bytecode liveness walk */
+#define MAX_LIVENESS_DEPTH 64
+
+/* Does the instruction read Dalvik register "reg"? */
+static bool insnUsesReg(const DecodedInstruction *insn, u4 reg)
+{
+    int dfFlags = dvmCompilerDataFlowAttributes[insn->opcode];
+    u4 i;
+
+    if (((dfFlags & DF_UA) && insn->vA == reg) ||
+        ((dfFlags & DF_UA_WIDE) && (insn->vA == reg || insn->vA + 1 == reg)) ||
+        ((dfFlags & DF_UB) && insn->vB == reg) ||
+        ((dfFlags & DF_UB_WIDE) && (insn->vB == reg || insn->vB + 1 == reg)) ||
+        ((dfFlags & DF_UC) && insn->vC == reg) ||
+        ((dfFlags & DF_UC_WIDE) && (insn->vC == reg || insn->vC + 1 == reg))) {
+        return true;
+    }
+    if (dfFlags & DF_FORMAT_35C) {
+        for (i = 0; i < insn->vA; i++) {
+            if (insn->arg[i] == reg) return true;
+        }
+    }
+    if ((dfFlags & DF_FORMAT_3RC) ||
+        insn->opcode == OP_INVOKE_OBJECT_INIT_RANGE) {
+        if (reg >= insn->vC && reg < insn->vC + insn->vA) return true;
+    }
+    return false;
+}
+
+/* Does the instruction overwrite Dalvik register "reg"? */
+static bool insnDefinesReg(const DecodedInstruction *insn, u4 reg)
+{
+    int dfFlags = dvmCompilerDataFlowAttributes[insn->opcode];
+
+    return ((dfFlags & DF_DA) && insn->vA == reg) ||
+           ((dfFlags & DF_DA_WIDE) && (insn->vA == reg || insn->vA + 1 == reg));
+}
+
+/*
+ * Conservatively decide whether Dalvik register "reg" may be read before it
+ * is written when the method resumes at "offset".  Exception edges are not
+ * modeled, so methods with try blocks always answer true.
+ */
+static bool isDalvikRegLive(const Method *method, unsigned int offset, u4 reg)
+{
+    const DexCode *dexCode = dvmGetMethodCode(method);
+    unsigned int insnsSize = dvmGetMethodInsnsSize(method);
+    unsigned int worklist[MAX_LIVENESS_DEPTH];
+    int numPending = 0;
+    int steps = 0;
+
+    if (dexCode->triesSize != 0 || offset >= insnsSize)
+        return true;
+
+    BitVector *visited = dvmCompilerAllocBitVector(insnsSize, false);
+
+    worklist[numPending++] = offset;
+    while (numPending > 0) {
+        unsigned int curOffset = worklist[--numPending];
+        const u2 *codePtr = method->insns + curOffset;
+        DecodedInstruction insn;
+
+        if (curOffset >= insnsSize || ++steps > MAX_LIVENESS_STEPS)
+            return true;
+        if (dvmIsBitSet(visited, curOffset))
+            continue;
+        dvmCompilerSetBit(visited, curOffset);
+
+        dexDecodeUnfusedInstruction(codePtr, &insn);
+        if (insnUsesReg(&insn, reg))
+            return true;
+        if (insnDefinesReg(&insn, reg))
+            continue;
+
+        int flags = dexGetFlagsFromOpcode(insn.opcode);
+        unsigned int targets[2];
+        int numTargets = 0;
+
+        if (flags & kInstrCanContinue) {
+            targets[numTargets++] = curOffset + dexGetWidthFromInstruction(
+                                                    codePtr);
+        }
+        if (flags & kInstrCanBranch) {
+            switch (dexGetFormatFromOpcode(insn.opcode)) {
+                case kFmt10t:
+                case kFmt20t:
+                case kFmt30t:
+                    targets[numTargets++] = curOffset + (s4) insn.vA;
+                    break;
+                case kFmt21t:
+                    targets[numTargets++] = curOffset + (s4) insn.vB;
+                    break;
+                case kFmt22t:
+                    targets[numTargets++] = curOffset + (s4) insn.vC;
+                    break;
+                default:
+                    return true;
+            }
+        }
+        if (flags & kInstrCanSwitch) {
+            const u2 *switchData = codePtr + (s4) insn.vB;
+            int size = switchData[1];
+            const s4 *caseTargets = (const s4 *) (switchData + 2 +
+                (insn.opcode == OP_PACKED_SWITCH ? 2 : size * 2));
+            int i;
+
+            if (numPending + size > MAX_LIVENESS_DEPTH)
+                return true;
+            for (i = 0; i < size; i++) {
+                worklist[numPending++] = curOffset + caseTargets[i];
+            }
+        }
+
+        if (numPending + numTargets > MAX_LIVENESS_DEPTH)
+            return true;
+        while (numTargets > 0) {
+            worklist[numPending++] = targets[--numTargets];
+        }
+    }
+    return false;
+}
+
+/* Can the MIR transfer control out of the compiled code? */
+static bool isTraceExit(const MIR *mir)
+{
+    int opcode = mir->dalvikInsn.opcode;
+
+    /* Inlined invokes are not executed */
+    if (mir->OptimizationFlags & MIR_INLINED)
+        return false;
+    if (opcode >= kMirOpFirst)
+        return opcode == kMirOpCheckInlinePrediction;
+    return (dexGetFlagsFromOpcode((Opcode) opcode) &
+            (kInstrCanThrow | kInstrCanBranch | kInstrCanSwitch |
+             kInstrCanReturn | kInstrInvoke)) != 0;
+}
+
+/* A non-volatile store to a field of the object in SSA register "sReg" */
+static bool isStoreToObject(const CompilationUnit *cUnit, const MIR *mir,
+                            int sReg)
+{
+    bool isQuick = false;
+    int baseIdx;
+    int i;
+
+    switch (mir->dalvikInsn.opcode) {
+        case OP_IPUT_WIDE_QUICK:
+            isQuick = true;
+            // NOTE: intentional fallthrough
+        case OP_IPUT_WIDE:
+            baseIdx = 2;
+            break;
+        case OP_IPUT_QUICK:
+        case OP_IPUT_OBJECT_QUICK:
+            isQuick = true;
+            // NOTE: intentional fallthrough
+        case OP_IPUT:
+        case OP_IPUT_OBJECT:
+        case OP_IPUT_BOOLEAN:
+        case OP_IPUT_BYTE:
+        case OP_IPUT_CHAR:
+        case OP_IPUT_SHORT:
+            baseIdx = 1;
+            break;
+        default:
+            return false;
+    }
+
+    if (mir->ssaRep->numUses != baseIdx + 1 ||
+        mir->ssaRep->uses[baseIdx] != sReg) {
+        return false;
+    }
+    /* Storing the object itself publishes it */
+    for (i = 0; i < baseIdx; i++) {
+        if (mir->ssaRep->uses[i] == sReg) return false;
+    }
+
+    if (isQuick)
+        return true;
+    const Method *method = (mir->OptimizationFlags & MIR_CALLEE) ?
+        mir->meta.calleeMethod : cUnit->method;
+    InstField *fieldPtr = (InstField *)
+        method->clazz->pDvmDex->pResFields[mir->dalvikInsn.vC];
+    return fieldPtr != NULL && !dvmIsVolatileField(fieldPtr);
+}
+
+/*
+ * Check that Dalvik register "reg" is dead wherever control can leave the
+ * trace after "mir" (exclusive) until the register is redefined.
+ */
+static bool isDeadOnExits(CompilationUnit *cUnit, BasicBlock *bb, MIR *mir,
+                          int reg, BitVector *visitedBlocks)
+{
+    int i;
+
+    for (mir = mir ? mir->next : bb->firstMIRInsn; mir; mir = mir->next) {
+        if (isTraceExit(mir) &&
+            isDalvikRegLive(cUnit->method, mir->offset, reg)) {
+            return false;
+        }
+        if (mir->ssaRep == NULL) continue;
+        for (i = 0; i < mir->ssaRep->numDefs; i++) {
+            if (DECODE_REG(dvmConvertSSARegToDalvik(cUnit,
+                    mir->ssaRep->defs[i])) == reg) {
+                return true;
+            }
+        }
+    }
+
+    BasicBlock *succs[2] = { bb->taken, bb->fallThrough };
+    for (i = 0; i < 2; i++) {
+        BasicBlock *succ = succs[i];
+        if (succ == NULL) continue;
+        switch (succ->blockType) {
+            case kDalvikByteCode:
+                if (dvmIsBitSet(visitedBlocks, succ->id)) break;
+                dvmCompilerSetBit(visitedBlocks, succ->id);
+                if (!isDeadOnExits(cUnit, succ, NULL, reg, visitedBlocks))
+                    return false;
+                break;
+            case kChainingCellNormal:
+            case kChainingCellHot:
+            case kChainingCellBackwardBranch:
+                if (isDalvikRegLive(cUnit->method, succ->startOffset, reg))
+                    return false;
+                break;
+            default:
+                /* Reached through an invoke or a punt, covered above */
+                break;
+        }
+    }
+    return true;
+}
+
+/* Unlink a MIR from its block */
+static void removeMIR(BasicBlock *bb, MIR *mir)
+{
+    if (mir->prev) {
+        mir->prev->next = mir->next;
+    } else {
+        bb->firstMIRInsn = mir->next;
+    }
+    if (mir->next) {
+        mir->next->prev = mir->prev;
+    } else {
+        bb->lastMIRInsn = mir->prev;
+    }
+    mir->prev = mir->next = NULL;
+}
+
+/* Try to remove the allocation made by "newInstanceMIR" */
+static bool eliminateAllocation(CompilationUnit *cUnit, BasicBlock *bb,
+                                MIR *newInstanceMIR)
+{
+    ClassObject *clazz = (ClassObject *)
+        cUnit->method->clazz->pDvmDex->pResClasses[
+            newInstanceMIR->dalvikInsn.vB];
+    int objSReg = newInstanceMIR->ssaRep->defs[0];
+    int objReg = newInstanceMIR->dalvikInsn.vA;
+    MIR *lastUse = newInstanceMIR;
+    MIR *initMIR = NULL;
+    bool exitSeen = false;
+    MIR *mir;
+    int i;
+
+    /* Finalizers and instantiation errors have to be observed */
+    if (clazz == NULL || !dvmIsClassInitialized(clazz) ||
+        IS_CLASS_FLAG_SET(clazz, CLASS_ISFINALIZABLE) ||
+        dvmIsAbstractClass(clazz) || dvmIsInterfaceClass(clazz)) {
+        return false;
+    }
+
+    /* Classify the uses in the allocating block */
+    for (mir = newInstanceMIR->next; mir; mir = mir->next) {
+        bool isUse = false;
+
+        if (mir->ssaRep == NULL) return false;
+        for (i = 0; i < mir->ssaRep->numUses; i++) {
+            if (mir->ssaRep->uses[i] == objSReg) isUse = true;
+        }
+        if (!isUse) {
+            if (isTraceExit(mir)) exitSeen = true;
+            continue;
+        }
+        if (exitSeen) return false;
+
+        if ((mir->OptimizationFlags & MIR_INLINED) &&
+            (dexGetFlagsFromOpcode(mir->dalvikInsn.opcode) & kInstrInvoke)) {
+            initMIR = mir;
+        } else if (!isStoreToObject(cUnit, mir, objSReg)) {
+            return false;
+        }
+        lastUse = mir;
+    }
+
+    /* Any use outside of the block escapes */
+    GrowableListIterator iterator;
+    dvmGrowableListIteratorInit(&cUnit->blockList, &iterator);
+    while (true) {
+        BasicBlock *otherBB =
+            (BasicBlock *) dvmGrowableListIteratorNext(&iterator);
+        if (otherBB == NULL) break;
+        if (otherBB == bb || otherBB->blockType != kDalvikByteCode) continue;
+        for (mir = otherBB->firstMIRInsn; mir; mir = mir->next) {
+            if (mir->ssaRep == NULL) continue;
+            for (i = 0; i < mir->ssaRep->numUses; i++) {
+                if (mir->ssaRep->uses[i] == objSReg) return false;
+            }
+        }
+    }
+
+    BitVector *visitedBlocks =
+        dvmCompilerAllocBitVector(cUnit->numBlocks, false);
+    dvmCompilerSetBit(visitedBlocks, bb->id);
+    if (!isDeadOnExits(cUnit, bb, lastUse, objReg, visitedBlocks))
+        return false;
+
+    /* Drop the stores and the store barrier of the inlined constructor */
+    MIR *nextMIR;
+    for (mir = newInstanceMIR->next; mir; mir = nextMIR) {
+        nextMIR = mir->next;
+        if (mir == initMIR) continue;
+        if (initMIR != NULL &&
+            (int) mir->dalvikInsn.opcode == (int) kMirOpMemBarrier &&
+            mir->meta.calleeMethod == initMIR->meta.callsiteInfo->method) {
+            removeMIR(bb, mir);
+            continue;
+        }
+        if (mir->ssaRep == NULL) continue;
+        for (i = 0; i < mir->ssaRep->numUses; i++) {
+            if (mir->ssaRep->uses[i] == objSReg) {
+                removeMIR(bb, mir);
+                break;
+            }
+        }
+    }
+
+    /* Keep the register holding a valid (null) reference */
+    newInstanceMIR->dalvikInsn.opcode = OP_CONST_16;
+    newInstanceMIR->dalvikInsn.vB = 0;
+
+    if (cUnit->printMe) {
+        ALOGD("Escape analysis: removed allocation of %s at %#x",
+              clazz->descriptor, newInstanceMIR->offset);
+    }
+    return true;
+}
+
+/*
+ * Main entry point.  Runs on the SSA form of a trace after redundant load
+ * elimination, before register allocation and code generation.
+ */
+void dvmCompilerEscapeAnalysis(CompilationUnit *cUnit)
+{
+    GrowableListIterator iterator;
+    int numEliminated = 0;
+
+    /*
+     * The IA32 backend lowers each MIR from the bytecode at its Dalvik PC
+     * and doesn't inline constructors, so there is nothing to remove.
+     */
+#if defined(ARCH_IA32)
+    return;
+#endif
+
+    dvmGrowableListIteratorInit(&cUnit->blockList, &iterator);
+    while (true) {
+        BasicBlock *bb = (BasicBlock *) dvmGrowableListIteratorNext(&iterator);
+        if (bb == NULL) break;
+        if (bb->hidden == true) continue;
+        if (bb->blockType != kDalvikByteCode || bb->dataFlowInfo == NULL)
+            continue;
+
+        MIR *mir;
+        for (mir = bb->firstMIRInsn; mir; mir = mir->next) {
+            if (mir->dalvikInsn.opcode == OP_NEW_INSTANCE &&
+                mir->ssaRep != NULL &&
+                !(mir->OptimizationFlags & MIR_CALLEE) &&
+                eliminateAllocation(cUnit, bb, mir)) {
+                numEliminated++;
+            }
+        }
+    }
+
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.allocationsEliminated += numEliminated;
+#endif
+    if (cUnit->printMe && numEliminated) {
+        ALOGD("Escape analysis: %d allocations removed", numEliminated);
+    }
+}
@@ -46,7 +46,8 @@ static inline int parseInsn(const u2 *codePtr, DecodedInstruction *decInsn,
     u2 instr = *codePtr;
     Opcode opcode = dexOpcodeFromCodeUnit(instr);
 
-    dexDecodeInstruction(codePtr, decInsn);
+    /* Superinstructions are compiled as their two separate instructions */
+    dexDecodeUnfusedInstruction(codePtr, decInsn);
     if (printMe) {
         char *decodedString = dvmCompilerGetDalvikDisassembly(decInsn, NULL);
         ALOGD("%p: %#06x %s", codePtr, opcode, decodedString);
@@ -198,15 +199,78 @@ static int compareMethod(const CompilerMethodStats *m1,
     return (int) m1->method - (int) m2->method;
 }
 
+/*
+ * Instructions that can be spliced into the caller as part of a straight-line
+ * callee.  They neither branch nor write memory, and the backends resolve
+ * their constant pool references (if any) through the callee method.
+ */
+static bool isStraightLineOpcode(Opcode opcode)
+{
+    switch (opcode) {
+        case OP_MOVE:
+        case OP_MOVE_FROM16:
+        case OP_MOVE_16:
+        case OP_MOVE_WIDE:
+        case OP_MOVE_WIDE_FROM16:
+        case OP_MOVE_WIDE_16:
+        case OP_MOVE_OBJECT:
+        case OP_MOVE_OBJECT_FROM16:
+        case OP_MOVE_OBJECT_16:
+        case OP_CONST_4:
+        case OP_CONST_16:
+        case OP_CONST:
+        case OP_CONST_HIGH16:
+        case OP_CONST_WIDE_16:
+        case OP_CONST_WIDE_32:
+        case OP_CONST_WIDE:
+        case OP_CONST_WIDE_HIGH16:
+        case OP_CMPL_FLOAT:
+        case OP_CMPG_FLOAT:
+        case OP_CMPL_DOUBLE:
+        case OP_CMPG_DOUBLE:
+        case OP_CMP_LONG:
+        case OP_ARRAY_LENGTH:
+        case OP_AGET:
+        case OP_AGET_WIDE:
+        case OP_AGET_OBJECT:
+        case OP_AGET_BOOLEAN:
+        case OP_AGET_BYTE:
+        case OP_AGET_CHAR:
+        case OP_AGET_SHORT:
+        case OP_IGET:
+        case OP_IGET_WIDE:
+        case OP_IGET_OBJECT:
+        case OP_IGET_BOOLEAN:
+        case OP_IGET_BYTE:
+        case OP_IGET_CHAR:
+        case OP_IGET_SHORT:
+        case OP_IGET_QUICK:
+        case OP_IGET_WIDE_QUICK:
+        case OP_IGET_OBJECT_QUICK:
+        case OP_SGET:
+        case OP_SGET_WIDE:
+        case OP_SGET_OBJECT:
+        case OP_SGET_BOOLEAN:
+        case OP_SGET_BYTE:
+        case OP_SGET_CHAR:
+        case OP_SGET_SHORT:
+        case OP_RETURN:
+        case OP_RETURN_WIDE:
+        case OP_RETURN_OBJECT:
+            return true;
+        default:
+            /* Unary and binary arithmetic, including the literal forms */
+            return opcode >= OP_NEG_INT && opcode <= OP_USHR_INT_LIT8;
+    }
+}
+
 /*
  * Analyze the body of the method to collect high-level information regarding
  * inlining:
  * - is empty method?
  * - is getter/setter?
+ * - is a short branch-free computation?
  * - can throw exception?
- *
- * Currently the inliner only handles getters and setters. When its capability
- * becomes more sophisticated more information will be retrieved here.
  */
 static int analyzeInlineTarget(DecodedInstruction *dalvikInsn, int attributes,
                                int offset)
@@ -214,6 +278,10 @@ static int analyzeInlineTarget(DecodedInstruction *dalvikInsn, int attributes,
     int flags = dexGetFlagsFromOpcode(dalvikInsn->opcode);
     int dalvikOpcode = dalvikInsn->opcode;
 
+    if (!isStraightLineOpcode(dalvikInsn->opcode)) {
+        attributes &= ~METHOD_IS_STRAIGHT_LINE;
+    }
+
     if (flags & kInstrInvoke) {
         attributes &= ~METHOD_IS_LEAF;
     }
@@ -257,7 +325,8 @@ static int analyzeInlineTarget(DecodedInstruction *dalvikInsn, int attributes,
      * interpreter to single-step through the instruction.
      */
     if (SINGLE_STEP_OP(dalvikOpcode)) {
-        attributes &= ~(METHOD_IS_GETTER | METHOD_IS_SETTER);
+        attributes &= ~(METHOD_IS_GETTER | METHOD_IS_SETTER |
+                        METHOD_IS_STRAIGHT_LINE);
     }
 
     return attributes;
@@ -320,7 +389,8 @@ CompilerMethodStats *dvmCompilerAnalyzeMethodBody(const Method *method,
     if (isCallee) {
         /* Aggressively set the attributes until proven otherwise */
         attributes = METHOD_IS_LEAF | METHOD_IS_THROW_FREE | METHOD_IS_CALLEE |
-                     METHOD_IS_GETTER | METHOD_IS_SETTER;
+                     METHOD_IS_GETTER | METHOD_IS_SETTER |
+                     METHOD_IS_STRAIGHT_LINE;
     } else {
         attributes = METHOD_IS_HOT;
     }
@@ -351,6 +421,16 @@ CompilerMethodStats *dvmCompilerAnalyzeMethodBody(const Method *method,
         attributes &= ~(METHOD_IS_GETTER | METHOD_IS_SETTER);
     }
 
+    /*
+     * Getters and setters have dedicated inliners.  Otherwise keep the
+     * straight-line bodies small enough to be worth splicing into a trace.
+     */
+    if ((attributes & (METHOD_IS_GETTER | METHOD_IS_SETTER | METHOD_IS_EMPTY)) ||
+        insnSize > JIT_MAX_INLINE_CODE_UNITS ||
+        dvmIsSynchronizedMethod(method)) {
+        attributes &= ~METHOD_IS_STRAIGHT_LINE;
+    }
+
     realMethodEntry->dalvikSize = insnSize * 2;
     realMethodEntry->attributes |= attributes;
 
@@ -1448,6 +1528,65 @@ static bool exhaustTrace(CompilationUnit *cUnit, BasicBlock *curBlock)
     return true;
 }
 
+/*
+ * Check if "offset" is the target of a backward branch in the method, ie the
+ * header of a loop.  The interpreter counts the branches to a loop header, so
+ * a trace that starts there is how a long-running loop gets compiled.
+ */
+static bool isLoopHeader(const Method *method, unsigned int offset)
+{
+    const DexCode *dexCode = dvmGetMethodCode(method);
+    const u2 *codePtr = dexCode->insns + offset;
+    const u2 *codeEnd = dexCode->insns + dexCode->insnsSize;
+    unsigned int curOffset = offset;
+
+    /* Only branches at or after the header can jump back to it */
+    while (codePtr < codeEnd) {
+        DecodedInstruction insn;
+        int width = parseInsn(codePtr, &insn, false);
+        int branchOffset;
+
+        /* Terminate when the data section is seen */
+        if (width == 0)
+            break;
+
+        switch (insn.opcode) {
+            case OP_GOTO:
+            case OP_GOTO_16:
+            case OP_GOTO_32:
+                branchOffset = (int) insn.vA;
+                break;
+            case OP_IF_EQ:
+            case OP_IF_NE:
+            case OP_IF_LT:
+            case OP_IF_GE:
+            case OP_IF_GT:
+            case OP_IF_LE:
+                branchOffset = (int) insn.vC;
+                break;
+            case OP_IF_EQZ:
+            case OP_IF_NEZ:
+            case OP_IF_LTZ:
+            case OP_IF_GEZ:
+            case OP_IF_GTZ:
+            case OP_IF_LEZ:
+                branchOffset = (int) insn.vB;
+                break;
+            default:
+                /* Not a branch - treat it as a forward one */
+                branchOffset = width;
+                break;
+        }
+        if (branchOffset <= 0 &&
+            (int) curOffset + branchOffset == (int) offset) {
+            return true;
+        }
+        codePtr += width;
+        curOffset += width;
+    }
+    return false;
+}
+
 /* Compile a loop */
 static bool compileLoop(CompilationUnit *cUnit, unsigned int startOffset,
                         JitTraceDescription *desc, int numMaxInsts,
@@ -1530,6 +1669,10 @@ static bool compileLoop(CompilationUnit *cUnit, unsigned int startOffset,
     if (!dvmCompilerBuildLoop(cUnit))
         goto bail;
 
+    if (!(gDvmJit.disableOpt & (1 << kRedundantLoadElimination))) {
+        dvmCompilerRedundantLoadElimination(cUnit);
+    }
+
     dvmCompilerLoopOpt(cUnit);
 
     /*
@@ -1654,8 +1797,12 @@ bool dvmCompileTrace(JitTraceDescription *desc, int numMaxInsts,
     CompilerMethodStats *methodStats;
 #endif
 
-    /* If we've already compiled this trace, just return success */
-    if (dvmJitGetTraceAddr(startCodePtr) && !info->discardResult) {
+    /*
+     * If we've already compiled this trace, just return success.  The
+     * optimizing tier rebuilds traces which already have a translation.
+     */
+    if ((optHints & JIT_OPT_RECOMPILE) == 0 &&
+        dvmJitGetTraceAddr(startCodePtr) && !info->discardResult) {
         /*
          * Make sure the codeAddress is NULL so that it won't clobber the
          * existing entry.
@@ -1672,6 +1819,16 @@ bool dvmCompileTrace(JitTraceDescription *desc, int numMaxInsts,
     compilationId++;
     memset(&cUnit, 0, sizeof(CompilationUnit));
 
+    /*
+     * The baseline tier goes straight from MIR to machine code: no loop
+     * formation, inlining or redundancy elimination at either level.
+     */
+    if (optHints & JIT_OPT_BASELINE) {
+        optHints |= JIT_OPT_NO_LOOP;
+        cUnit.baselineTier = true;
+    }
+    info->baselineTier = cUnit.baselineTier;
+
 #if defined(WITH_JIT_TUNING)
     /* Locate the entry to store compilation statistics for this method */
     methodStats = dvmCompilerAnalyzeMethodBody(desc->method, false);
@@ -1882,6 +2039,22 @@ bool dvmCompileTrace(JitTraceDescription *desc, int numMaxInsts,
     methodStats->compiledDalvikSize += traceSize * 2;
 #endif
 
+    /*
+     * A trace selected at a loop header ends at the first conditional branch,
+     * which is usually the loop test, so the back edge would only be found in
+     * a later trace that happens to start inside the loop.  Compile the loop
+     * from the method's code right away instead - the interpreter enters the
+     * translation at the header through the JitTable, with its frame as is.
+     * If the loop cannot be formed, compileLoop falls back to the trace.
+     */
+    if ((optHints & JIT_OPT_NO_LOOP) == 0 &&
+        !(gDvmJit.disableOpt & (1 << kOnStackReplacement)) &&
+        isLoopHeader(desc->method, startOffset)) {
+        dvmCompilerArenaReset();
+        return compileLoop(&cUnit, startOffset, desc, numMaxInsts,
+                           info, bailPtr, optHints);
+    }
+
     /*
      * Now scan basic blocks containing real code to connect the
      * taken/fallthrough links. Also create chaining cells for code not included
@@ -2095,7 +2268,8 @@ bool dvmCompileTrace(JitTraceDescription *desc, int numMaxInsts,
     cUnit.instructionSet = dvmCompilerInstructionSet();
 
     /* Inline transformation @ the MIR level */
-    if (cUnit.hasInvoke && !(gDvmJit.disableOpt & (1 << kMethodInlining))) {
+    if (cUnit.hasInvoke && !cUnit.baselineTier &&
+        !(gDvmJit.disableOpt & (1 << kMethodInlining))) {
         dvmCompilerInlineMIR(&cUnit, info);
     }
 
@@ -2106,6 +2280,16 @@ bool dvmCompileTrace(JitTraceDescription *desc, int numMaxInsts,
 
     dvmCompilerNonLoopAnalysis(&cUnit);
 
+    if (!cUnit.baselineTier &&
+        !(gDvmJit.disableOpt & (1 << kRedundantLoadElimination))) {
+        dvmCompilerRedundantLoadElimination(&cUnit);
+    }
+
+    if (!cUnit.baselineTier &&
+        !(gDvmJit.disableOpt & (1 << kEscapeAnalysis))) {
+        dvmCompilerEscapeAnalysis(&cUnit);
+    }
+
 #ifndef ARCH_IA32
     dvmCompilerInitializeRegAlloc(&cUnit);  // Needs to happen after SSA naming
 #endif
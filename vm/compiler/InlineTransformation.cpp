@@ -53,7 +53,7 @@ static bool inlineGetter(CompilationUnit *cUnit,
      */
     getterInsn.vC = 0;
 
-    dexDecodeInstruction(calleeMethod->insns, &getterInsn);
+    dexDecodeUnfusedInstruction(calleeMethod->insns, &getterInsn);
 
     if (!dvmCompilerCanIncludeThisInstruction(calleeMethod, &getterInsn))
         return false;
@@ -151,7 +151,7 @@ static bool inlineSetter(CompilationUnit *cUnit,
      */
     setterInsn.vC = 0;
 
-    dexDecodeInstruction(calleeMethod->insns, &setterInsn);
+    dexDecodeUnfusedInstruction(calleeMethod->insns, &setterInsn);
 
     if (!dvmCompilerCanIncludeThisInstruction(calleeMethod, &setterInsn))
         return false;
@@ -222,6 +222,425 @@ static bool inlineSetter(CompilationUnit *cUnit,
     return true;
 }
 
+/*
+ * Map a register of a straight-line callee onto the caller's frame.  The
+ * callee's ins live in the caller's argument registers and are read-only.
+ * The callee's locals borrow the register(s) of the move-result that follows
+ * the invoke, which are dead until the result is written.  Returns -1 if the
+ * register cannot be mapped.
+ */
+static int mapCalleeReg(const DecodedInstruction *invoke,
+                        const Method *calleeMethod,
+                        int calleeReg, bool isWide, bool isDef,
+                        int resultReg, int numResultRegs, bool isRange)
+{
+    int numLocals = calleeMethod->registersSize - calleeMethod->insSize;
+
+    if (calleeReg < numLocals) {
+        if (calleeReg + (isWide ? 1 : 0) >= numResultRegs)
+            return -1;
+        return resultReg + calleeReg;
+    }
+
+    /* Writing an argument would clobber the caller's register */
+    if (isDef)
+        return -1;
+
+    int reg = convertRegId(invoke, calleeMethod, calleeReg, isRange);
+    /* The halves of a wide argument have to stay adjacent */
+    if (isWide && !isRange &&
+        convertRegId(invoke, calleeMethod, calleeReg + 1, isRange) !=
+        (u4) reg + 1) {
+        return -1;
+    }
+    return reg;
+}
+
+/*
+ * Rename the operands of a callee instruction in place.  Only vA/vB/vC are
+ * register operands for the opcodes admitted by METHOD_IS_STRAIGHT_LINE.
+ */
+static bool renameCalleeInsn(DecodedInstruction *insn,
+                             const DecodedInstruction *invoke,
+                             const Method *calleeMethod,
+                             int resultReg, int numResultRegs, bool isRange)
+{
+    int dfFlags = dvmCompilerDataFlowAttributes[insn->opcode];
+    int reg;
+
+    if (dfFlags & (DF_UB | DF_UB_WIDE)) {
+        reg = mapCalleeReg(invoke, calleeMethod, insn->vB,
+                           dfFlags & DF_UB_WIDE, false, resultReg,
+                           numResultRegs, isRange);
+        if (reg < 0) return false;
+        insn->vB = reg;
+    }
+    if (dfFlags & (DF_UC | DF_UC_WIDE)) {
+        reg = mapCalleeReg(invoke, calleeMethod, insn->vC,
+                           dfFlags & DF_UC_WIDE, false, resultReg,
+                           numResultRegs, isRange);
+        if (reg < 0) return false;
+        insn->vC = reg;
+    }
+    if (dfFlags & (DF_DA | DF_DA_WIDE | DF_UA | DF_UA_WIDE)) {
+        bool isDef = dfFlags & (DF_DA | DF_DA_WIDE);
+        reg = mapCalleeReg(invoke, calleeMethod, insn->vA,
+                           dfFlags & (DF_DA_WIDE | DF_UA_WIDE), isDef,
+                           resultReg, numResultRegs, isRange);
+        if (reg < 0) return false;
+        insn->vA = reg;
+    }
+    return true;
+}
+
+/* Division by a non-zero literal cannot throw */
+static bool calleeInsnCanThrow(const DecodedInstruction *insn)
+{
+    switch (insn->opcode) {
+        case OP_DIV_INT_LIT16:
+        case OP_REM_INT_LIT16:
+        case OP_DIV_INT_LIT8:
+        case OP_REM_INT_LIT8:
+            return insn->vC == 0;
+        default:
+            return dexGetFlagsFromOpcode(insn->opcode) & kInstrCanThrow;
+    }
+}
+
+/* Call-site specific conditions for splicing a straight-line callee */
+static bool canSpliceStraightLineCallee(const MIR *invokeMIR,
+                                        const Method *calleeMethod)
+{
+#if defined(ARCH_IA32)
+    /* The IA32 backend lowers from the bytecode rather than from the MIR */
+    return false;
+#else
+    switch (invokeMIR->dalvikInsn.opcode) {
+        case OP_INVOKE_STATIC:
+        case OP_INVOKE_STATIC_RANGE:
+            /* The invoke would have run the class initializer */
+            return dvmIsClassInitialized(calleeMethod->clazz);
+        case OP_INVOKE_DIRECT:
+        case OP_INVOKE_DIRECT_RANGE:
+        case OP_INVOKE_SUPER:
+        case OP_INVOKE_SUPER_RANGE:
+        case OP_INVOKE_SUPER_QUICK:
+        case OP_INVOKE_SUPER_QUICK_RANGE:
+            /* Nothing would null-check "this" */
+            return false;
+        default:
+            /* Virtual/interface - "this" is checked with the prediction */
+            return true;
+    }
+#endif
+}
+
+/*
+ * Splice the body of a short branch-free callee into the invoke block.
+ *
+ * If an instruction of the callee raises an exception the trace punts to the
+ * interpreter at the invoke, which is then re-executed with a real frame.
+ * For that to be safe the caller-visible state has to be unchanged at every
+ * point that can throw, so no instruction that can throw may follow the
+ * first write to a borrowed register.  The callee doesn't write memory.
+ */
+static bool inlineStraightLineCallee(CompilationUnit *cUnit,
+                                     const Method *calleeMethod,
+                                     MIR *invokeMIR,
+                                     BasicBlock *invokeBB,
+                                     bool isPredicted,
+                                     bool isRange)
+{
+    BasicBlock *moveResultBB = invokeBB->fallThrough;
+    MIR *moveResultMIR = moveResultBB->firstMIRInsn;
+    const DecodedInstruction *invoke = &invokeMIR->dalvikInsn;
+    MIR *calleeMIRs[JIT_MAX_INLINE_INSNS + 1];
+    int numCalleeMIRs = 0;
+    bool localWritten = false;
+    bool returned = false;
+    int i;
+
+    if ((moveResultMIR == NULL) ||
+        (moveResultMIR->dalvikInsn.opcode != OP_MOVE_RESULT &&
+         moveResultMIR->dalvikInsn.opcode != OP_MOVE_RESULT_OBJECT &&
+         moveResultMIR->dalvikInsn.opcode != OP_MOVE_RESULT_WIDE)) {
+        return false;
+    }
+
+    int resultReg = moveResultMIR->dalvikInsn.vA;
+    int numResultRegs =
+        (moveResultMIR->dalvikInsn.opcode == OP_MOVE_RESULT_WIDE) ? 2 : 1;
+
+    if (calleeMethod->registersSize - calleeMethod->insSize > numResultRegs)
+        return false;
+
+    /* The borrowed registers must not overlap the arguments */
+    for (i = 0; i < calleeMethod->insSize; i++) {
+        int argReg = isRange ? invoke->vC + i : invoke->arg[i];
+        if (argReg >= resultReg && argReg < resultReg + numResultRegs)
+            return false;
+    }
+
+    const u2 *codePtr = calleeMethod->insns;
+    const u2 *codeEnd =
+        calleeMethod->insns + dvmGetMethodInsnsSize(calleeMethod);
+
+    while (codePtr < codeEnd && !returned) {
+        DecodedInstruction insn;
+        MIR *newMIR;
+
+        /* Not all instructions have vC - keep Valgrind happy */
+        insn.vC = 0;
+        dexDecodeUnfusedInstruction(codePtr, &insn);
+        codePtr += dexGetWidthFromOpcode(insn.opcode);
+
+        if (dexGetFlagsFromOpcode(insn.opcode) & kInstrCanReturn) {
+            bool isWide = (insn.opcode == OP_RETURN_WIDE);
+            int reg = mapCalleeReg(invoke, calleeMethod, insn.vA, isWide,
+                                   false, resultReg, numResultRegs, isRange);
+            if (reg < 0 || isWide != (numResultRegs == 2))
+                return false;
+            returned = true;
+            /* Result is already in place */
+            if (reg == resultReg)
+                break;
+            insn.opcode = (insn.opcode == OP_RETURN_WIDE) ? OP_MOVE_WIDE_16 :
+                          (insn.opcode == OP_RETURN_OBJECT) ?
+                              OP_MOVE_OBJECT_16 : OP_MOVE_16;
+            insn.vA = resultReg;
+            insn.vB = reg;
+        } else {
+            if (numCalleeMIRs == JIT_MAX_INLINE_INSNS)
+                return false;
+            if (!dvmCompilerCanIncludeThisInstruction(calleeMethod, &insn))
+                return false;
+            if (localWritten && calleeInsnCanThrow(&insn))
+                return false;
+            if (!renameCalleeInsn(&insn, invoke, calleeMethod, resultReg,
+                                  numResultRegs, isRange))
+                return false;
+            if (dvmCompilerDataFlowAttributes[insn.opcode] &
+                (DF_DA | DF_DA_WIDE)) {
+                localWritten = true;
+            }
+        }
+
+        newMIR = (MIR *)dvmCompilerNew(sizeof(MIR), true);
+        newMIR->dalvikInsn = insn;
+        newMIR->width = dexGetWidthFromOpcode(insn.opcode);
+        newMIR->OptimizationFlags |= MIR_CALLEE;
+        /* Exceptions punt to the interpreter and re-execute the invoke */
+        newMIR->offset = invokeMIR->offset;
+        newMIR->meta.calleeMethod = calleeMethod;
+        calleeMIRs[numCalleeMIRs++] = newMIR;
+    }
+
+    if (!returned)
+        return false;
+
+    /* All checks passed - now splice the callee body after the invoke */
+    MIR *lastMIR = invokeMIR;
+    for (i = 0; i < numCalleeMIRs; i++) {
+        dvmCompilerInsertMIRAfter(invokeBB, lastMIR, calleeMIRs[i]);
+        lastMIR = calleeMIRs[i];
+    }
+
+    if (isPredicted) {
+        MIR *invokeMIRSlow = (MIR *)dvmCompilerNew(sizeof(MIR), true);
+        *invokeMIRSlow = *invokeMIR;
+        invokeMIR->dalvikInsn.opcode = (Opcode)kMirOpCheckInlinePrediction;
+
+        /* Use vC to denote the first argument (ie this) */
+        if (!isRange) {
+            invokeMIR->dalvikInsn.vC = invokeMIRSlow->dalvikInsn.arg[0];
+        }
+
+        moveResultMIR->OptimizationFlags |= MIR_INLINED_PRED;
+
+        dvmCompilerInsertMIRAfter(invokeBB, lastMIR, invokeMIRSlow);
+        invokeMIRSlow->OptimizationFlags |= MIR_INLINED_PRED;
+#if defined(WITH_JIT_TUNING)
+        gDvmJit.invokePolyStraightLineInlined++;
+#endif
+    } else {
+        invokeMIR->OptimizationFlags |= MIR_INLINED;
+        moveResultMIR->OptimizationFlags |= MIR_INLINED;
+#if defined(WITH_JIT_TUNING)
+        gDvmJit.invokeMonoStraightLineInlined++;
+#endif
+    }
+
+    return true;
+}
+
+/*
+ * Find the new-instance that defines the receiver of a constructor call.  It
+ * has to be in the same block with no redefinition of the register in between
+ * so that "this" is known to be a fresh, non-null instance of the class.
+ */
+static MIR *findReceiverAllocation(const MIR *invokeMIR, bool isRange)
+{
+    const DecodedInstruction *invoke = &invokeMIR->dalvikInsn;
+    u4 thisReg = isRange ? invoke->vC : invoke->arg[0];
+    MIR *mir;
+
+    for (mir = invokeMIR->prev; mir; mir = mir->prev) {
+        int dfFlags = dvmCompilerDataFlowAttributes[mir->dalvikInsn.opcode];
+        u4 vA = mir->dalvikInsn.vA;
+
+        if (((dfFlags & DF_DA) && vA == thisReg) ||
+            ((dfFlags & DF_DA_WIDE) && (vA == thisReg || vA + 1 == thisReg))) {
+            return (mir->dalvikInsn.opcode == OP_NEW_INSTANCE) ? mir : NULL;
+        }
+    }
+    return NULL;
+}
+
+/* Is this the call to Object.<init> that starts the constructor body? */
+static bool isObjectInitCall(const Method *calleeMethod,
+                             const DecodedInstruction *insn, int thisReg)
+{
+    if (insn->opcode == OP_INVOKE_OBJECT_INIT_RANGE) {
+        return insn->vA == 1 && (int) insn->vC == thisReg;
+    }
+    if (insn->opcode == OP_INVOKE_DIRECT) {
+        const Method *method =
+            dvmDexGetResolvedMethod(calleeMethod->clazz->pDvmDex, insn->vB);
+        return insn->vA == 1 && (int) insn->arg[0] == thisReg &&
+               method != NULL && method->clazz == gDvm.classJavaLangObject;
+    }
+    return false;
+}
+
+/*
+ * Inline a constructor of a direct subclass of Object that only copies its
+ * arguments into the fields of the new instance:
+ *
+ *     invoke-object-init/range {this}
+ *     iput* vArg, this, field          (zero or more)
+ *     return-void[-barrier]
+ *
+ * The receiver has to come from a new-instance of the same class earlier in
+ * the block, which guarantees it is not null and that the object isn't a
+ * subclass instance whose finalizer Object.<init> would have to register.
+ * Once the stores are visible as plain MIRs the escape analysis can remove
+ * the allocation altogether.
+ */
+static bool inlineConstructor(CompilationUnit *cUnit,
+                              const Method *calleeMethod,
+                              MIR *invokeMIR,
+                              BasicBlock *invokeBB,
+                              bool isRange)
+{
+#if defined(ARCH_IA32)
+    /* The IA32 backend lowers from the bytecode rather than from the MIR */
+    return false;
+#else
+    const DecodedInstruction *invoke = &invokeMIR->dalvikInsn;
+    ClassObject *clazz = calleeMethod->clazz;
+    MIR *calleeMIRs[JIT_MAX_INLINE_INSNS + 1];
+    int numCalleeMIRs = 0;
+    int thisReg = calleeMethod->registersSize - calleeMethod->insSize;
+    bool returned = false;
+    int i;
+
+    if (clazz->super != gDvm.classJavaLangObject ||
+        IS_CLASS_FLAG_SET(clazz, CLASS_ISFINALIZABLE) ||
+        dvmIsSynchronizedMethod(calleeMethod)) {
+        return false;
+    }
+
+    MIR *newInstanceMIR = findReceiverAllocation(invokeMIR, isRange);
+    if (newInstanceMIR == NULL ||
+        dvmDexGetResolvedClass(cUnit->method->clazz->pDvmDex,
+                               newInstanceMIR->dalvikInsn.vB) != clazz) {
+        return false;
+    }
+
+    const u2 *codePtr = calleeMethod->insns;
+    const u2 *codeEnd =
+        calleeMethod->insns + dvmGetMethodInsnsSize(calleeMethod);
+    DecodedInstruction insn;
+
+    insn.vC = 0;
+    dexDecodeUnfusedInstruction(codePtr, &insn);
+    if (!isObjectInitCall(calleeMethod, &insn, thisReg))
+        return false;
+    codePtr += dexGetWidthFromOpcode(insn.opcode);
+
+    while (codePtr < codeEnd && !returned) {
+        MIR *newMIR;
+
+        /* Not all instructions have vC - keep Valgrind happy */
+        insn.vC = 0;
+        dexDecodeUnfusedInstruction(codePtr, &insn);
+        codePtr += dexGetWidthFromOpcode(insn.opcode);
+
+        switch (insn.opcode) {
+            case OP_RETURN_VOID:
+                returned = true;
+                continue;
+            case OP_RETURN_VOID_BARRIER:
+                /* Keep the ordering of the final field stores */
+                insn.opcode = (Opcode) kMirOpMemBarrier;
+                returned = true;
+                break;
+            case OP_IPUT:
+            case OP_IPUT_WIDE:
+            case OP_IPUT_OBJECT:
+            case OP_IPUT_BOOLEAN:
+            case OP_IPUT_BYTE:
+            case OP_IPUT_CHAR:
+            case OP_IPUT_SHORT: {
+                InstField *field = (InstField *)
+                    dvmDexGetResolvedField(clazz->pDvmDex, insn.vC);
+                if (field == NULL || dvmIsVolatileField(field))
+                    return false;
+            }
+            // Intentional fallthrough
+            case OP_IPUT_QUICK:
+            case OP_IPUT_WIDE_QUICK:
+            case OP_IPUT_OBJECT_QUICK:
+                if ((int) insn.vB != thisReg ||
+                    numCalleeMIRs == JIT_MAX_INLINE_INSNS)
+                    return false;
+                /* No locals to borrow - the value has to be an argument */
+                if (!renameCalleeInsn(&insn, invoke, calleeMethod, 0, 0,
+                                      isRange))
+                    return false;
+                break;
+            default:
+                return false;
+        }
+
+        newMIR = (MIR *)dvmCompilerNew(sizeof(MIR), true);
+        newMIR->dalvikInsn = insn;
+        newMIR->width = (insn.opcode < kNumPackedOpcodes) ?
+                        dexGetWidthFromOpcode(insn.opcode) : 0;
+        newMIR->OptimizationFlags |= MIR_CALLEE;
+        newMIR->offset = invokeMIR->offset;
+        newMIR->meta.calleeMethod = calleeMethod;
+        calleeMIRs[numCalleeMIRs++] = newMIR;
+    }
+
+    if (!returned)
+        return false;
+
+    MIR *lastMIR = invokeMIR;
+    for (i = 0; i < numCalleeMIRs; i++) {
+        dvmCompilerInsertMIRAfter(invokeBB, lastMIR, calleeMIRs[i]);
+        lastMIR = calleeMIRs[i];
+    }
+
+    invokeMIR->OptimizationFlags |= MIR_INLINED;
+    invokeBB->needFallThroughBranch = true;
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.invokeConstructorInlined++;
+#endif
+    return true;
+#endif
+}
+
 static bool tryInlineSingletonCallsite(CompilationUnit *cUnit,
                                        const Method *calleeMethod,
                                        MIR *invokeMIR,
@@ -246,12 +665,23 @@ static bool tryInlineSingletonCallsite(CompilationUnit *cUnit,
         return true;
     }
 
+    if (dvmIsConstructorMethod(calleeMethod) &&
+        (invokeMIR->dalvikInsn.opcode == OP_INVOKE_DIRECT ||
+         invokeMIR->dalvikInsn.opcode == OP_INVOKE_DIRECT_RANGE)) {
+        return inlineConstructor(cUnit, calleeMethod, invokeMIR, invokeBB,
+                                 isRange);
+    }
+
     if (methodStats->attributes & METHOD_IS_GETTER) {
         return inlineGetter(cUnit, calleeMethod, invokeMIR, invokeBB, false,
                             isRange);
     } else if (methodStats->attributes & METHOD_IS_SETTER) {
         return inlineSetter(cUnit, calleeMethod, invokeMIR, invokeBB, false,
                             isRange);
+    } else if ((methodStats->attributes & METHOD_IS_STRAIGHT_LINE) &&
+               canSpliceStraightLineCallee(invokeMIR, calleeMethod)) {
+        return inlineStraightLineCallee(cUnit, calleeMethod, invokeMIR,
+                                        invokeBB, false, isRange);
     }
     return false;
 }
@@ -294,6 +724,10 @@ static bool tryInlineVirtualCallsite(CompilationUnit *cUnit,
     } else if (methodStats->attributes & METHOD_IS_SETTER) {
         return inlineSetter(cUnit, calleeMethod, invokeMIR, invokeBB, true,
                             isRange);
+    } else if ((methodStats->attributes & METHOD_IS_STRAIGHT_LINE) &&
+               canSpliceStraightLineCallee(invokeMIR, calleeMethod)) {
+        return inlineStraightLineCallee(cUnit, calleeMethod, invokeMIR,
+                                        invokeBB, true, isRange);
     }
     return false;
 }
@@ -398,6 +832,16 @@ void dvmCompilerInlineMIR(CompilationUnit *cUnit, JitTranslationInfo *info)
                 break;
         }
 
+        /*
+         * Don't guard on a single receiver class at call sites where the
+         * interpreter's inline cache keeps seeing different ones.
+         */
+        if (calleeMethod &&
+            dvmInlineCacheIsPolymorphic(cUnit->method->insns +
+                                        lastMIRInsn->offset)) {
+            calleeMethod = NULL;
+        }
+
         if (calleeMethod) {
             bool inlined = tryInlineVirtualCallsite(cUnit, calleeMethod,
                                                     lastMIRInsn, bb, isRange);
@@ -156,6 +156,28 @@ static Opcode negateOpcode(Opcode opcode)
     return (Opcode)-1;  // unreached
 }
 
+/*
+ * Returns true if the block ends with a conditional branch that tests the
+ * updated basic induction variable.
+ */
+static bool isBIVExitTest(const CompilationUnit *cUnit, const BasicBlock *bb)
+{
+    MIR *branch = bb->lastMIRInsn;
+    int i;
+
+    if (branch == NULL || branch->ssaRep == NULL) return false;
+    if (dexGetFlagsFromOpcode(branch->dalvikInsn.opcode) !=
+        (kInstrCanContinue|kInstrCanBranch)) {
+        return false;
+    }
+    for (i = 0; i < branch->ssaRep->numUses; i++) {
+        if (branch->ssaRep->uses[i] == cUnit->loopAnalysis->ssaBIV) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /*
  * A loop is considered optimizable if:
  * 1) It has one basic induction variable.
@@ -164,6 +186,7 @@ static Opcode negateOpcode(Opcode opcode)
  *    via the taken path.
  * 4) If it is a count-up loop, the condition is GE/GT. Otherwise it is
  *    LE/LT/LEZ/LTZ for a count-down loop.
+ * 5) Other exits from the loop may precede the BIV test.
  *
  * Return false for loops that fail the above tests.
  */
@@ -196,11 +219,20 @@ static bool isSimpleCountedLoop(CompilationUnit *cUnit)
         if (loopBackBlock == NULL) {
             return false;
         }
-        /* Unconditional goto - continue to trace up the predecessor chain */
-        if (loopBackBlock->taken == NULL) {
-            continue;
+        /*
+         * Unconditional goto, or an early exit that doesn't test the BIV (eg
+         * a search loop that breaks out when it finds a match) - continue to
+         * trace up the predecessor chain. Leaving the loop early only shrinks
+         * the iteration space, so the hoisted range checks stay valid.
+         */
+        if (loopBackBlock->taken != NULL &&
+            isBIVExitTest(cUnit, loopBackBlock)) {
+            break;
+        }
+        /* Back at the loop header without finding the BIV test */
+        if (loopBackBlock == cUnit->entryBlock->fallThrough) {
+            return false;
         }
-        break;
     }
 
     MIR *branch = loopBackBlock->lastMIRInsn;
@@ -511,6 +543,532 @@ static void genHoistedChecks(CompilationUnit *cUnit)
     }
 }
 
+/*
+ * Returns true if the static or instance field accessed by the non-quick
+ * get/put is volatile or unresolved.
+ */
+static bool isVolatileFieldAccess(const CompilationUnit *cUnit, const MIR *mir)
+{
+    const Method *method = (mir->OptimizationFlags & MIR_CALLEE) ?
+        mir->meta.calleeMethod : cUnit->method;
+    int dfAttributes = dvmCompilerDataFlowAttributes[mir->dalvikInsn.opcode];
+    /* Instance fields are referenced by vC and static fields by vB */
+    u4 fieldIdx = (dfAttributes & DF_UB) ? mir->dalvikInsn.vC :
+                                           mir->dalvikInsn.vB;
+    Field *fieldPtr = (Field *) method->clazz->pDvmDex->pResFields[fieldIdx];
+
+    return fieldPtr == NULL || dvmIsVolatileField(fieldPtr);
+}
+
+/*
+ * Returns true if heap loads cannot be moved across the instruction - it may
+ * write the heap, run arbitrary code, or order memory accesses.
+ */
+static bool isLoadBarrier(const CompilationUnit *cUnit, const MIR *mir)
+{
+    Opcode opcode = mir->dalvikInsn.opcode;
+
+    /* Phis and hoisted checks */
+    if ((int) opcode >= kNumPackedOpcodes) return false;
+
+    if ((dvmCompilerDataFlowAttributes[opcode] & DF_IS_SETTER) ||
+        (dexGetFlagsFromOpcode(opcode) & (kInstrInvoke | kInstrCanReturn))) {
+        return true;
+    }
+
+    switch (opcode) {
+        case OP_IGET:
+        case OP_IGET_WIDE:
+        case OP_IGET_OBJECT:
+        case OP_IGET_BOOLEAN:
+        case OP_IGET_BYTE:
+        case OP_IGET_CHAR:
+        case OP_IGET_SHORT:
+        case OP_SGET:
+        case OP_SGET_WIDE:
+        case OP_SGET_OBJECT:
+        case OP_SGET_BOOLEAN:
+        case OP_SGET_BYTE:
+        case OP_SGET_CHAR:
+        case OP_SGET_SHORT:
+            /* Volatile loads are not rewritten on uniprocessor builds */
+            return isVolatileFieldAccess(cUnit, mir);
+        case OP_MONITOR_ENTER:
+        case OP_MONITOR_EXIT:
+        case OP_NEW_INSTANCE:
+        case OP_NEW_ARRAY:
+        case OP_FILLED_NEW_ARRAY:
+        case OP_FILLED_NEW_ARRAY_RANGE:
+        case OP_FILL_ARRAY_DATA:
+        case OP_THROW:
+        case OP_EXECUTE_INLINE:
+        case OP_EXECUTE_INLINE_RANGE:
+        case OP_IGET_VOLATILE:
+        case OP_IPUT_VOLATILE:
+        case OP_SGET_VOLATILE:
+        case OP_SPUT_VOLATILE:
+        case OP_IGET_OBJECT_VOLATILE:
+        case OP_IGET_WIDE_VOLATILE:
+        case OP_IPUT_WIDE_VOLATILE:
+        case OP_SGET_WIDE_VOLATILE:
+        case OP_SPUT_WIDE_VOLATILE:
+        case OP_IPUT_OBJECT_VOLATILE:
+        case OP_SGET_OBJECT_VOLATILE:
+        case OP_SPUT_OBJECT_VOLATILE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Returns true if the instruction is a candidate for loop-invariant code
+ * motion. Heap loads qualify only if nothing in the loop can change the
+ * loaded value.
+ */
+static bool isHoistableInsn(const CompilationUnit *cUnit, const MIR *mir,
+                            bool heapIsInvariant)
+{
+    Opcode opcode = mir->dalvikInsn.opcode;
+
+    if ((int) opcode >= kNumPackedOpcodes) return false;
+
+    switch (opcode) {
+        case OP_IGET:
+        case OP_IGET_WIDE:
+        case OP_IGET_OBJECT:
+        case OP_IGET_BOOLEAN:
+        case OP_IGET_BYTE:
+        case OP_IGET_CHAR:
+        case OP_IGET_SHORT:
+        case OP_SGET:
+        case OP_SGET_WIDE:
+        case OP_SGET_OBJECT:
+        case OP_SGET_BOOLEAN:
+        case OP_SGET_BYTE:
+        case OP_SGET_CHAR:
+        case OP_SGET_SHORT:
+            return heapIsInvariant && !isVolatileFieldAccess(cUnit, mir);
+        case OP_IGET_QUICK:
+        case OP_IGET_WIDE_QUICK:
+        case OP_IGET_OBJECT_QUICK:
+        case OP_AGET:
+        case OP_AGET_WIDE:
+        case OP_AGET_OBJECT:
+        case OP_AGET_BOOLEAN:
+        case OP_AGET_BYTE:
+        case OP_AGET_CHAR:
+        case OP_AGET_SHORT:
+        case OP_ARRAY_LENGTH:
+            return heapIsInvariant;
+        /* Only throw on a zero divisor */
+        case OP_DIV_INT_LIT16:
+        case OP_REM_INT_LIT16:
+        case OP_DIV_INT_LIT8:
+        case OP_REM_INT_LIT8:
+            return mir->dalvikInsn.vC != 0;
+        default:
+            break;
+    }
+
+    if ((opcode >= OP_MOVE && opcode <= OP_MOVE_OBJECT_16) ||
+        (opcode >= OP_CONST_4 && opcode <= OP_CONST_WIDE_HIGH16)) {
+        return true;
+    }
+
+    /* Unary, binary, 2addr and literal arithmetic that cannot throw */
+    if (opcode >= OP_NEG_INT && opcode <= OP_USHR_INT_LIT8) {
+        return (dexGetFlagsFromOpcode(opcode) & kInstrCanThrow) == 0;
+    }
+    return false;
+}
+
+/*
+ * Loop-invariant code motion. Instructions in the loop header that compute
+ * the same value on every iteration are moved to the entry block, after the
+ * hoisted checks. An instruction is hoisted if:
+ *
+ * 1) its operands are not defined in the loop (ie SSA subscript 0) or are
+ *    defined by an instruction that has been hoisted already;
+ * 2) its result registers are defined nowhere else in the loop and the value
+ *    they carry around the back edge is never used, so the early write can't
+ *    be observed by the loop or by the code after it;
+ * 3) if it is a heap load, nothing in the loop can modify the heap.
+ *
+ * Hoisted instructions keep the Dalvik PC of the loop header, so if one of
+ * them throws, the interpreter restarts from the top of the loop and raises
+ * the exception at the original location. To keep the exception handlers
+ * from seeing a register written ahead of time, methods with try blocks are
+ * skipped.
+ */
+static void hoistLoopInvariants(CompilationUnit *cUnit)
+{
+    BasicBlock *entry = cUnit->entryBlock;
+    BasicBlock *loopHeader = entry->fallThrough;
+    GrowableListIterator iterator;
+    bool heapIsInvariant = true;
+    int numHoisted = 0;
+    MIR *mir;
+    int i;
+
+    /*
+     * The IA32 backend lowers each MIR from the bytecode at its Dalvik PC,
+     * which no longer matches the instruction once it is moved.
+     */
+#if defined(ARCH_IA32)
+    return;
+#endif
+
+    if (dvmGetMethodCode(cUnit->method)->triesSize != 0) {
+        return;
+    }
+
+    /* Per Dalvik register: number of definitions in the loop */
+    int *numLoopDefs = (int *)
+        dvmCompilerNew(sizeof(int) * cUnit->numDalvikRegisters, true);
+    /* SSA names read by the loop outside of phi nodes */
+    BitVector *loopUses =
+        dvmCompilerAllocBitVector(cUnit->numSSARegs, false);
+    /* SSA names whose definition has been hoisted */
+    BitVector *hoistedDefs =
+        dvmCompilerAllocBitVector(cUnit->numSSARegs, false);
+
+    dvmGrowableListIteratorInit(&cUnit->blockList, &iterator);
+    while (true) {
+        BasicBlock *bb = (BasicBlock *) dvmGrowableListIteratorNext(&iterator);
+        if (bb == NULL) break;
+        if (bb->hidden || bb->blockType != kDalvikByteCode) continue;
+
+        for (mir = bb->firstMIRInsn; mir; mir = mir->next) {
+            if ((int) mir->dalvikInsn.opcode == (int) kMirOpPhi) continue;
+            if (isLoadBarrier(cUnit, mir)) {
+                heapIsInvariant = false;
+            }
+            if (mir->ssaRep == NULL) continue;
+            for (i = 0; i < mir->ssaRep->numUses; i++) {
+                dvmCompilerSetBit(loopUses, mir->ssaRep->uses[i]);
+            }
+            for (i = 0; i < mir->ssaRep->numDefs; i++) {
+                int dalvikReg = DECODE_REG(
+                    dvmConvertSSARegToDalvik(cUnit, mir->ssaRep->defs[i]));
+                numLoopDefs[dalvikReg]++;
+            }
+        }
+    }
+
+    MIR *nextMIR;
+    for (mir = loopHeader->firstMIRInsn; mir; mir = nextMIR) {
+        nextMIR = mir->next;
+
+        if (mir->ssaRep == NULL || mir->ssaRep->numDefs == 0) continue;
+        /* Leave inlined callees alone - their MIRs are tied to the invoke */
+        if (mir->OptimizationFlags &
+            (MIR_INLINED | MIR_INLINED_PRED | MIR_CALLEE)) {
+            continue;
+        }
+        if (!isHoistableInsn(cUnit, mir, heapIsInvariant)) continue;
+
+        bool isInvariant = true;
+        for (i = 0; i < mir->ssaRep->numUses && isInvariant; i++) {
+            int use = mir->ssaRep->uses[i];
+            if (DECODE_SUB(dvmConvertSSARegToDalvik(cUnit, use)) != 0 &&
+                !dvmIsBitSet(hoistedDefs, use)) {
+                isInvariant = false;
+            }
+        }
+        for (i = 0; i < mir->ssaRep->numDefs && isInvariant; i++) {
+            int dalvikReg = DECODE_REG(
+                dvmConvertSSARegToDalvik(cUnit, mir->ssaRep->defs[i]));
+            if (numLoopDefs[dalvikReg] != 1) {
+                isInvariant = false;
+                break;
+            }
+            /* The value coming around the back edge must be dead */
+            MIR *phi;
+            for (phi = loopHeader->firstMIRInsn; phi; phi = phi->next) {
+                if ((int) phi->dalvikInsn.opcode != (int) kMirOpPhi) break;
+                if (DECODE_REG(dvmConvertSSARegToDalvik(cUnit,
+                        phi->ssaRep->defs[0])) == dalvikReg &&
+                    dvmIsBitSet(loopUses, phi->ssaRep->defs[0])) {
+                    isInvariant = false;
+                    break;
+                }
+            }
+        }
+        if (!isInvariant) continue;
+
+        /* Unlink from the loop header */
+        if (mir->prev) {
+            mir->prev->next = mir->next;
+        } else {
+            loopHeader->firstMIRInsn = mir->next;
+        }
+        if (mir->next) {
+            mir->next->prev = mir->prev;
+        } else {
+            loopHeader->lastMIRInsn = mir->prev;
+        }
+        mir->prev = mir->next = NULL;
+
+        /*
+         * Checks eliminated by earlier instructions in the loop are not
+         * covered in the entry block. Punt to the top of the loop if any of
+         * them fails.
+         */
+        mir->OptimizationFlags &=
+            ~(MIR_IGNORE_NULL_CHECK | MIR_IGNORE_RANGE_CHECK);
+        mir->offset = loopHeader->startOffset;
+        dvmCompilerAppendMIR(entry, mir);
+
+        for (i = 0; i < mir->ssaRep->numDefs; i++) {
+            dvmCompilerSetBit(hoistedDefs, mir->ssaRep->defs[i]);
+        }
+        numHoisted++;
+    }
+
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.loopInvariantsHoisted += numHoisted;
+#endif
+    if (cUnit->printMe && numHoisted) {
+        ALOGD("Loop invariant code motion: %d instructions hoisted",
+             numHoisted);
+    }
+}
+
+/* Longest loop body handed to the vectorizer */
+#define VECTOR_LOOP_MAX_INSNS   32
+
+/*
+ * Returns the number of vector registers the vectorized form of the
+ * instruction defines, or -1 if the instruction can't be executed lane-wise.
+ * Arithmetic with a literal needs a second register for the replicated
+ * constant, except for shifts which encode it in the instruction.
+ */
+static int getVectorValueCount(Opcode opcode)
+{
+    switch (opcode) {
+        case OP_MOVE:
+        case OP_MOVE_FROM16:
+        case OP_MOVE_16:
+        case OP_APUT:
+            return 0;
+        case OP_AGET:
+        case OP_CONST_4:
+        case OP_CONST_16:
+        case OP_CONST:
+        case OP_CONST_HIGH16:
+        case OP_ADD_INT:
+        case OP_SUB_INT:
+        case OP_AND_INT:
+        case OP_OR_INT:
+        case OP_XOR_INT:
+        case OP_ADD_INT_2ADDR:
+        case OP_SUB_INT_2ADDR:
+        case OP_AND_INT_2ADDR:
+        case OP_OR_INT_2ADDR:
+        case OP_XOR_INT_2ADDR:
+        case OP_ADD_FLOAT:
+        case OP_SUB_FLOAT:
+        case OP_MUL_FLOAT:
+        case OP_DIV_FLOAT:
+        case OP_ADD_FLOAT_2ADDR:
+        case OP_SUB_FLOAT_2ADDR:
+        case OP_MUL_FLOAT_2ADDR:
+        case OP_DIV_FLOAT_2ADDR:
+        case OP_SHL_INT_LIT8:
+        case OP_SHR_INT_LIT8:
+        case OP_USHR_INT_LIT8:
+            return 1;
+        case OP_ADD_INT_LIT16:
+        case OP_RSUB_INT:
+        case OP_AND_INT_LIT16:
+        case OP_OR_INT_LIT16:
+        case OP_XOR_INT_LIT16:
+        case OP_ADD_INT_LIT8:
+        case OP_RSUB_INT_LIT8:
+        case OP_AND_INT_LIT8:
+        case OP_OR_INT_LIT8:
+        case OP_XOR_INT_LIT8:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+/*
+ * Loop vectorization. A counted loop whose body only works on 32-bit array
+ * elements indexed by the basic induction variable is handed to the backend,
+ * which runs VECTOR_LOOP_LANES iterations at a time with SIMD instructions
+ * before entering the scalar loop. The loop qualifies if:
+ *
+ * 1) it counts up by one and the body is straight-line code ending with the
+ *    BIV exit test;
+ * 2) every array access uses the BIV as index on a loop-invariant array and
+ *    had its checks hoisted;
+ * 3) every other operand is loop invariant or computed earlier in the same
+ *    iteration - nothing is carried from one iteration to the next except
+ *    the BIV;
+ * 4) the body fits in VECTOR_LOOP_MAX_VALUES vector registers.
+ *
+ * Since iteration "i" only touches element "i" of each array, executing the
+ * iterations of a group lane by lane keeps every load and store in the same
+ * order relative to the other accesses of that element, even if two array
+ * registers refer to the same array.
+ */
+static void genVectorLoop(CompilationUnit *cUnit)
+{
+    LoopAnalysis *loopAnalysis = cUnit->loopAnalysis;
+    BasicBlock *loopHeader = cUnit->entryBlock->fallThrough;
+    BasicBlock *bb = loopHeader;
+    int basicSSAReg = -1;
+    int numBlocks = 0;
+    int numValues = 0;
+    int numInsns = 0;
+    bool hasStore = false;
+    unsigned int i;
+    int j;
+    MIR *mir;
+
+    /* Only the IA32 backend knows how to generate the vector loop */
+#if !defined(ARCH_IA32)
+    return;
+#endif
+
+    if (!loopAnalysis->isCountUpLoop) return;
+    for (i = 0; i < loopAnalysis->ivList->numUsed; i++) {
+        InductionVariableInfo *ivInfo =
+            GET_ELEM_N(loopAnalysis->ivList, InductionVariableInfo*, i);
+        if (ivInfo->ssaReg == ivInfo->basicSSAReg) {
+            if (ivInfo->inc != 1) return;
+            basicSSAReg = ivInfo->basicSSAReg;
+            break;
+        }
+    }
+    if (basicSSAReg == -1) return;
+
+    MIR **insns = (MIR **)
+        dvmCompilerNew(sizeof(MIR *) * VECTOR_LOOP_MAX_INSNS, false);
+    /* SSA names computed by the body before the current instruction */
+    BitVector *vectorDefs =
+        dvmCompilerAllocBitVector(cUnit->numSSARegs, false);
+    /* Loop invariant Dalvik registers replicated into a vector register */
+    BitVector *invariantRegs =
+        dvmCompilerAllocBitVector(cUnit->numDalvikRegisters, false);
+
+    while (true) {
+        bool loopClosed = false;
+
+        for (mir = bb->firstMIRInsn; mir; mir = mir->next) {
+            Opcode opcode = mir->dalvikInsn.opcode;
+            int flags;
+
+            if ((int) opcode == (int) kMirOpPhi) continue;
+            if ((int) opcode >= kNumPackedOpcodes) return;
+
+            flags = dexGetFlagsFromOpcode(opcode);
+            if (flags & kInstrCanBranch) {
+                if (mir != bb->lastMIRInsn) return;
+                /* A goto, or the exit test which has to close the loop */
+                if (flags & kInstrCanContinue) {
+                    if (!isBIVExitTest(cUnit, bb) ||
+                        (bb->taken != loopHeader &&
+                         bb->fallThrough != loopHeader)) {
+                        return;
+                    }
+                    for (j = 0; j < mir->ssaRep->numUses; j++) {
+                        int use = mir->ssaRep->uses[j];
+                        if (use != loopAnalysis->ssaBIV &&
+                            DECODE_SUB(dvmConvertSSARegToDalvik(cUnit,
+                                                                use)) != 0) {
+                            return;
+                        }
+                    }
+                    loopClosed = true;
+                }
+                continue;
+            }
+
+            /* The BIV update */
+            if (mir->ssaRep->numDefs == 1 &&
+                mir->ssaRep->defs[0] == loopAnalysis->ssaBIV) {
+                continue;
+            }
+
+            int numDefs = getVectorValueCount(opcode);
+            if (numDefs < 0 || numInsns == VECTOR_LOOP_MAX_INSNS) return;
+
+            for (j = 0; j < mir->ssaRep->numUses; j++) {
+                int use = mir->ssaRep->uses[j];
+                int dalvikReg = dvmConvertSSARegToDalvik(cUnit, use);
+                bool isArray = (opcode == OP_AGET && j == 0) ||
+                               (opcode == OP_APUT && j == 1);
+                bool isIndex = (opcode == OP_AGET && j == 1) ||
+                               (opcode == OP_APUT && j == 2);
+
+                if (isIndex) {
+                    if (use != basicSSAReg ||
+                        !(mir->OptimizationFlags & MIR_IGNORE_RANGE_CHECK)) {
+                        return;
+                    }
+                } else if (isArray) {
+                    if (DECODE_SUB(dalvikReg) != 0) return;
+                } else if (!dvmIsBitSet(vectorDefs, use)) {
+                    /* Loop-carried, or the BIV used as a value */
+                    if (DECODE_SUB(dalvikReg) != 0) return;
+                    if (!dvmIsBitSet(invariantRegs, DECODE_REG(dalvikReg))) {
+                        dvmCompilerSetBit(invariantRegs,
+                                          DECODE_REG(dalvikReg));
+                        numValues++;
+                    }
+                }
+            }
+            for (j = 0; j < mir->ssaRep->numDefs; j++) {
+                dvmCompilerSetBit(vectorDefs, mir->ssaRep->defs[j]);
+            }
+            if (opcode == OP_APUT) {
+                hasStore = true;
+            }
+            numValues += numDefs;
+            insns[numInsns++] = mir;
+        }
+
+        if (loopClosed) break;
+
+        /* Straight-line code - follow the only successor */
+        BasicBlock *nextBB = bb->taken ? bb->taken : bb->fallThrough;
+        if (nextBB == NULL || nextBB == loopHeader ||
+            nextBB->blockType != kDalvikByteCode ||
+            ++numBlocks > cUnit->numBlocks) {
+            return;
+        }
+        bb = nextBB;
+    }
+
+    if (!hasStore || numValues > VECTOR_LOOP_MAX_VALUES) return;
+
+    VectorLoopInfo *vectorLoopInfo =
+        (VectorLoopInfo *) dvmCompilerNew(sizeof(VectorLoopInfo), false);
+    vectorLoopInfo->insns = insns;
+    vectorLoopInfo->numInsns = numInsns;
+
+    MIR *vectorMIR = (MIR *)dvmCompilerNew(sizeof(MIR), true);
+    vectorMIR->dalvikInsn.opcode = (Opcode)kMirOpVectorLoop;
+    vectorMIR->dalvikInsn.vB =
+        DECODE_REG(dvmConvertSSARegToDalvik(cUnit, basicSSAReg));
+    vectorMIR->dalvikInsn.vC = loopAnalysis->endConditionReg;
+    vectorMIR->dalvikInsn.arg[2] = loopAnalysis->loopBranchOpcode;
+    vectorMIR->meta.vectorLoopInfo = vectorLoopInfo;
+    dvmCompilerAppendMIR(cUnit->entryBlock, vectorMIR);
+
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.loopsVectorized++;
+#endif
+    if (cUnit->printMe) {
+        ALOGD("Loop vectorization: %d instructions, %d vector values",
+             numInsns, numValues);
+    }
+}
+
 void resetBlockEdges(BasicBlock *bb)
 {
     bb->taken = NULL;
@@ -700,21 +1258,29 @@ bool dvmCompilerLoopOpt(CompilationUnit *cUnit)
     DEBUG_LOOP(dumpIVList(cUnit);)
 
     /* Only optimize array accesses for simple counted loop for now */
-    if (!isSimpleCountedLoop(cUnit))
-        return false;
+    bool isCountedLoop = isSimpleCountedLoop(cUnit);
+    if (isCountedLoop) {
+        loopAnalysis->arrayAccessInfo =
+            (GrowableList *)dvmCompilerNew(sizeof(GrowableList), true);
+        dvmInitGrowableList(loopAnalysis->arrayAccessInfo, 4);
+        loopAnalysis->bodyIsClean = doLoopBodyCodeMotion(cUnit);
+        DEBUG_LOOP(dumpHoistedChecks(cUnit);)
 
-    loopAnalysis->arrayAccessInfo =
-        (GrowableList *)dvmCompilerNew(sizeof(GrowableList), true);
-    dvmInitGrowableList(loopAnalysis->arrayAccessInfo, 4);
-    loopAnalysis->bodyIsClean = doLoopBodyCodeMotion(cUnit);
-    DEBUG_LOOP(dumpHoistedChecks(cUnit);)
+        /*
+         * Convert the array access information into extended MIR code in the
+         * loop header.
+         */
+        genHoistedChecks(cUnit);
 
-    /*
-     * Convert the array access information into extended MIR code in the loop
-     * header.
-     */
-    genHoistedChecks(cUnit);
-    return true;
+        if (!(gDvmJit.disableOpt & (1 << kLoopVectorization))) {
+            genVectorLoop(cUnit);
+        }
+    }
+
+    if (!(gDvmJit.disableOpt & (1 << kLoopInvariantCodeMotion))) {
+        hoistLoopInvariants(cUnit);
+    }
+    return isCountedLoop;
 }
 
 /*
@@ -728,13 +1294,21 @@ void dvmCompilerInsertBackwardChaining(CompilationUnit *cUnit)
      * code will be generated along the backward branch to honor the suspend
      * requests.
      */
-#ifndef ARCH_IA32
 #if !defined(WITH_SELF_VERIFICATION)
-    if (gDvmJit.profileMode != kTraceProfilingContinuous &&
-        gDvmJit.profileMode != kTraceProfilingPeriodicOn) {
+    bool directBackEdge = gDvmJit.profileMode != kTraceProfilingContinuous &&
+                          gDvmJit.profileMode != kTraceProfilingPeriodicOn;
+#if defined(ARCH_IA32)
+    /*
+     * x86 polls at the top of the loop header instead.  The direct branch
+     * is what lets VRs stay in registers across iterations, so keep the
+     * chaining cell when that allocation is disabled.
+     */
+    directBackEdge = directBackEdge &&
+        !(gDvmJit.disableOpt & (1 << kGlobalRegisterAllocation));
+#endif
+    if (directBackEdge) {
         return;
     }
-#endif
 #endif
 
     /*
@@ -35,6 +35,20 @@ typedef struct LoopAnalysis {
     bool branchesAdded;                 // Body and PCR branch added to LIR output
 } LoopAnalysis;
 
+/*
+ * Body of a loop whose iterations only touch array elements at the basic
+ * induction variable, so that consecutive iterations can be executed as the
+ * lanes of a SIMD instruction.
+ */
+typedef struct VectorLoopInfo {
+    MIR **insns;                        // body in program order
+    int numInsns;
+} VectorLoopInfo;
+
+/* 32-bit lanes per vector iteration and vector registers for the body */
+#define VECTOR_LOOP_LANES       4
+#define VECTOR_LOOP_MAX_VALUES  8
+
 bool dvmCompilerFilterLoopBlocks(CompilationUnit *cUnit);
 
 /*
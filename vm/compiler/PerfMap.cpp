@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Dalvik.h"
+#include "CompilerInternals.h"
+
+#include <unistd.h>
+
+/*
+ * Symbol map of the JIT code cache for the Linux perf tool.
+ *
+ * With -Xjitperfmap every translation installed in the code cache gets a
+ * line in /tmp/perf-<pid>.map, which is where perf looks for symbols of
+ * anonymous executable memory:
+ *
+ *   <start> <size> <method descriptor> <kind> [<first dex pc>-<end dex pc>]
+ *
+ * eg "4a2c11f0 1c4 LFoo;.bar(II)I trace [0x4-0x1e]".  The dex pc range is
+ * the span of the method's bytecode the translation was built from.
+ *
+ * The map format cannot retire an entry, so when the code cache is reset the
+ * file is truncated and restarted with the template entry.  Samples taken
+ * before the reset can then no longer be attributed, but stale entries won't
+ * shadow the new translations that reuse the same addresses.
+ *
+ * Called with gDvmJit.compilerLock held, or before the compiler thread
+ * starts.
+ */
+
+static FILE *perfMapFile;
+
+/* Describe the handler templates at the bottom of the code cache */
+static void addTemplateEntry(void)
+{
+    if (gDvmJit.templateSize != 0) {
+        fprintf(perfMapFile, "%lx %x dalvik-jit-templates\n",
+                (unsigned long) gDvmJit.codeCache, gDvmJit.templateSize);
+    }
+}
+
+/* Start a fresh map - at startup and whenever the code cache is wiped */
+void dvmCompilerPerfMapReset(void)
+{
+    char fileName[64];
+
+    if (!gDvmJit.perfMap)
+        return;
+
+    if (perfMapFile == NULL) {
+        snprintf(fileName, sizeof(fileName), "/tmp/perf-%d.map", getpid());
+        perfMapFile = fopen(fileName, "w");
+        if (perfMapFile == NULL) {
+            ALOGW("Jit: unable to open %s: %s", fileName, strerror(errno));
+            gDvmJit.perfMap = false;
+            return;
+        }
+    } else {
+        fflush(perfMapFile);
+        if (ftruncate(fileno(perfMapFile), 0) != 0) {
+            ALOGW("Jit: unable to truncate the perf map: %s",
+                  strerror(errno));
+        }
+        rewind(perfMapFile);
+        ALOGD("Jit: perf map restarted for code cache version %d",
+              gDvmJit.cacheVersion);
+    }
+
+    addTemplateEntry();
+    fflush(perfMapFile);
+}
+
+/* Record the code of a freshly installed trace or method */
+void dvmCompilerPerfMapAddTranslation(CompilationUnit *cUnit,
+                                      const void *codeStart, int codeSize)
+{
+    const Method *method = cUnit->method;
+    unsigned int firstOffset = ~0U;
+    unsigned int endOffset = 0;
+    GrowableListIterator iterator;
+    MIR *mir;
+
+    if (perfMapFile == NULL)
+        return;
+
+    /* Find the bytecode covered by the MIRs that were compiled */
+    dvmGrowableListIteratorInit(&cUnit->blockList, &iterator);
+    while (true) {
+        BasicBlock *bb = (BasicBlock *) dvmGrowableListIteratorNext(&iterator);
+        if (bb == NULL) break;
+        if (bb->blockType != kDalvikByteCode) continue;
+        for (mir = bb->firstMIRInsn; mir; mir = mir->next) {
+            /* Callee instructions carry the offset of the invoke */
+            if ((int) mir->dalvikInsn.opcode >= (int) kMirOpFirst ||
+                (mir->OptimizationFlags & MIR_CALLEE)) {
+                continue;
+            }
+            firstOffset = MIN(firstOffset, (unsigned int) mir->offset);
+            endOffset = MAX(endOffset, (unsigned int) mir->offset + mir->width);
+        }
+    }
+    if (firstOffset > endOffset) {
+        firstOffset = endOffset = 0;
+    }
+
+    char *signature = dexProtoCopyMethodDescriptor(&method->prototype);
+    fprintf(perfMapFile, "%lx %x %s.%s%s %s [%#x-%#x]\n",
+            (unsigned long) codeStart, codeSize,
+            method->clazz->descriptor, method->name,
+            signature ? signature : "",
+            cUnit->jitMode == kJitMethod ? "method" :
+                (cUnit->jitMode == kJitLoop ? "loop" : "trace"),
+            firstOffset, endOffset);
+    free(signature);
+    fflush(perfMapFile);
+}
+
+void dvmCompilerPerfMapShutdown(void)
+{
+    if (perfMapFile != NULL) {
+        fclose(perfMapFile);
+        perfMapFile = NULL;
+    }
+}
@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Dalvik.h"
+#include "CompilerInternals.h"
+
+/*
+ * Receiver profiling for the predicted chaining cells of invoke-virtual and
+ * invoke-interface.
+ *
+ * A predicted chaining cell caches a single (class, method) pair.  When the
+ * receiver does not match, the generated code dispatches through the vtable
+ * (or the interface cache) and, once the per-thread rechain counter expires,
+ * calls dvmJitToPatchPredictedChain to re-target the cell.  On a bimorphic
+ * site this ping-pongs the cell between the two classes, and since changing
+ * the branch target can only be done at a safe point every flip costs an IC
+ * patch work order.
+ *
+ * The profile below is consulted before each re-targeting request.  It keeps
+ * up to RECEIVER_PROFILE_ENTRIES receivers per site with the number of times
+ * each one was sampled on the miss path:
+ *
+ *   - a site with a single receiver is patched as before;
+ *   - a polymorphic site only moves its prediction to a receiver that has been
+ *     sampled more often than the currently predicted one, and only
+ *     RECEIVER_PROFILE_REPATCHES times;
+ *   - a site that sees more receivers than the profile holds is marked
+ *     megamorphic and is never re-targeted again.  Its receivers are served by
+ *     the vtable/itable fallback that follows the class check.
+ *
+ * The table is keyed by the cell address, so it has to be cleared whenever
+ * the code cache is reset.  Class and method pointers are only compared;
+ * the names shown by the dump are copied when a site or receiver is first
+ * recorded.  Updates are serialized by gDvmJit.compilerICPatchLock.  Sites
+ * whose cell is frozen are recognized without the lock: their requests are
+ * the ones that keep coming, and the fields involved only ever change once
+ * while mutators run (the table is cleared at a safe point).
+ */
+
+/* Give up looking for a free slot after this many probes */
+#define RECEIVER_PROFILE_PROBES     8
+
+static inline u4 receiverProfileHash(const PredictedChainingCell *cell)
+{
+    /* Cells are word aligned */
+    return (((u4) cell) >> 2) & (RECEIVER_PROFILE_TABLE_SIZE - 1);
+}
+
+/*
+ * Find the profile of the given cell or claim a free slot for it.  Returns
+ * NULL if the neighborhood of the hash slot is full.
+ */
+static ReceiverProfileSite *findOrAddSite(const PredictedChainingCell *cell)
+{
+    u4 idx = receiverProfileHash(cell);
+    int probes;
+
+    for (probes = 0; probes < RECEIVER_PROFILE_PROBES; probes++) {
+        ReceiverProfileSite *site = &gDvmJit.pReceiverProfiles[idx];
+        if (site->cell == cell) {
+            return site;
+        }
+        if (site->cell == NULL) {
+            site->cell = cell;
+            return site;
+        }
+        idx = (idx + 1) & (RECEIVER_PROFILE_TABLE_SIZE - 1);
+    }
+    return NULL;
+}
+
+/*
+ * Lock-free lookup of the profile of the given cell.  A racing update can
+ * at worst make us miss a site that was just added.
+ */
+static const ReceiverProfileSite *findSite(const ReceiverProfileSite *sites,
+                                           const PredictedChainingCell *cell)
+{
+    u4 idx = receiverProfileHash(cell);
+    int probes;
+
+    for (probes = 0; probes < RECEIVER_PROFILE_PROBES; probes++) {
+        const ReceiverProfileSite *site = &sites[idx];
+        if (site->cell == cell) {
+            return site;
+        }
+        if (site->cell == NULL) {
+            return NULL;
+        }
+        idx = (idx + 1) & (RECEIVER_PROFILE_TABLE_SIZE - 1);
+    }
+    return NULL;
+}
+
+/* Returns a malloc'd "Lclass;method" string, or NULL if out of memory */
+static char *copyMethodName(const Method *method)
+{
+    size_t len = strlen(method->clazz->descriptor) + strlen(method->name) + 1;
+    char *name = (char *) malloc(len);
+    if (name != NULL) {
+        snprintf(name, len, "%s%s", method->clazz->descriptor, method->name);
+    }
+    return name;
+}
+
+static ReceiverProfileEntry *findEntry(ReceiverProfileSite *site,
+                                       const ClassObject *clazz)
+{
+    int i;
+    for (i = 0; i < site->numEntries; i++) {
+        if (site->entries[i].clazz == clazz) {
+            return &site->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Answer a request for a site whose cell is not going to be re-targeted
+ * again, without taking the lock.  Returns kReceiverPatch if the site has
+ * to go through the full update.
+ */
+static ReceiverProfileAction frozenSiteAction(const PredictedChainingCell *cell,
+                                              const Method *method)
+{
+    const ReceiverProfileSite *sites = gDvmJit.pReceiverProfiles;
+    const ReceiverProfileSite *site;
+
+    if (sites == NULL || (site = findSite(sites, cell)) == NULL) {
+        return kReceiverPatch;
+    }
+    if (site->megamorphic) {
+        return kReceiverMegamorphic;
+    }
+    if (site->repatches >= RECEIVER_PROFILE_REPATCHES &&
+        cell->clazz != NULL && cell->method != method) {
+        return kReceiverKeep;
+    }
+    return kReceiverPatch;
+}
+
+static void countAction(ReceiverProfileAction action)
+{
+#if defined(WITH_JIT_TUNING)
+    if (action == kReceiverKeep) {
+        gDvmJit.icPatchKept++;
+    } else if (action == kReceiverMegamorphic) {
+        gDvmJit.icPatchMegamorphic++;
+    }
+#endif
+}
+
+/*
+ * Record that "clazz" missed the prediction of "cell" and decide whether the
+ * cell should be re-targeted to (clazz, method).  Called from
+ * dvmJitToPatchPredictedChain by mutator threads.
+ */
+ReceiverProfileAction dvmJitProfileReceiver(const PredictedChainingCell *cell,
+                                            const ClassObject *clazz,
+                                            const Method *method)
+{
+    ReceiverProfileAction action = frozenSiteAction(cell, method);
+    ReceiverProfileSite *site;
+    ReceiverProfileEntry *entry;
+    ReceiverProfileEntry *predicted;
+
+    if (action != kReceiverPatch) {
+        countAction(action);
+        return action;
+    }
+
+    dvmLockMutex(&gDvmJit.compilerICPatchLock);
+
+    if (gDvmJit.pReceiverProfiles == NULL) {
+        gDvmJit.pReceiverProfiles = (ReceiverProfileSite *)
+            calloc(RECEIVER_PROFILE_TABLE_SIZE, sizeof(ReceiverProfileSite));
+        /* Fall back to the unprofiled behavior */
+        if (gDvmJit.pReceiverProfiles == NULL) {
+            ALOGE("Jit: receiver profile table allocation failed");
+            goto done;
+        }
+    }
+
+    site = findOrAddSite(cell);
+    if (site == NULL) {
+#if defined(WITH_JIT_TUNING)
+        gDvmJit.icProfileOverflow++;
+#endif
+        goto done;
+    }
+
+    if (site->callee == NULL) {
+        site->callee = copyMethodName(method);
+    }
+    site->misses++;
+    if (site->megamorphic) {
+        action = kReceiverMegamorphic;
+        goto done;
+    }
+
+    entry = findEntry(site, clazz);
+    if (entry == NULL) {
+        if (site->numEntries == RECEIVER_PROFILE_ENTRIES) {
+            COMPILER_TRACE_CHAINING(
+                ALOGD("Jit Runtime: predicted chain %p to %s%s is megamorphic",
+                     cell, method->clazz->descriptor, method->name));
+            site->megamorphic = true;
+            action = kReceiverMegamorphic;
+            goto done;
+        }
+        entry = &site->entries[site->numEntries++];
+        entry->clazz = clazz;
+        entry->method = method;
+        entry->samples = 0;
+        entry->descriptor = strdup(clazz->descriptor);
+    }
+    entry->samples++;
+
+    /* Monomorphic so far - or the cell has not been initialized yet */
+    if (site->numEntries == 1 || cell->clazz == NULL) {
+        goto done;
+    }
+
+    /*
+     * Same implementation as the current prediction.  Only the class field
+     * needs to be updated, which is done without stopping the world.
+     */
+    if (cell->method == method) {
+        goto done;
+    }
+
+    predicted = findEntry(site, cell->clazz);
+    if ((predicted != NULL && predicted->samples >= entry->samples) ||
+        site->repatches >= RECEIVER_PROFILE_REPATCHES) {
+        action = kReceiverKeep;
+        goto done;
+    }
+    site->repatches++;
+
+done:
+    countAction(action);
+    dvmUnlockMutex(&gDvmJit.compilerICPatchLock);
+    return action;
+}
+
+/* Forget all profiles - called when the code cache is wiped */
+void dvmJitResetReceiverProfiles(void)
+{
+    dvmLockMutex(&gDvmJit.compilerICPatchLock);
+    if (gDvmJit.pReceiverProfiles != NULL) {
+        int i, j;
+        for (i = 0; i < RECEIVER_PROFILE_TABLE_SIZE; i++) {
+            ReceiverProfileSite *site = &gDvmJit.pReceiverProfiles[i];
+            free(site->callee);
+            for (j = 0; j < site->numEntries; j++) {
+                free(site->entries[j].descriptor);
+            }
+        }
+        memset(gDvmJit.pReceiverProfiles, 0,
+               RECEIVER_PROFILE_TABLE_SIZE * sizeof(ReceiverProfileSite));
+    }
+    dvmUnlockMutex(&gDvmJit.compilerICPatchLock);
+}
+
+/* Number of polymorphic and megamorphic sites listed individually */
+#define RECEIVER_PROFILE_DUMP_SITES      10
+
+static int compareSiteMisses(const void *a, const void *b)
+{
+    const ReceiverProfileSite *siteA = *(const ReceiverProfileSite **) a;
+    const ReceiverProfileSite *siteB = *(const ReceiverProfileSite **) b;
+    return (int) siteB->misses - (int) siteA->misses;
+}
+
+/* Summarize the receiver profiles and list the busiest call sites */
+void dvmJitDumpReceiverProfiles(void)
+{
+    ReceiverProfileSite **sorted;
+    int histogram[RECEIVER_PROFILE_ENTRIES + 1];
+    int numSorted = 0;
+    int numMegamorphic = 0;
+    int i, j;
+
+    memset(histogram, 0, sizeof(histogram));
+
+    dvmLockMutex(&gDvmJit.compilerICPatchLock);
+    if (gDvmJit.pReceiverProfiles == NULL) {
+        dvmUnlockMutex(&gDvmJit.compilerICPatchLock);
+        return;
+    }
+
+    sorted = (ReceiverProfileSite **)
+        malloc(RECEIVER_PROFILE_TABLE_SIZE * sizeof(ReceiverProfileSite *));
+    if (sorted == NULL) {
+        dvmUnlockMutex(&gDvmJit.compilerICPatchLock);
+        return;
+    }
+
+    for (i = 0; i < RECEIVER_PROFILE_TABLE_SIZE; i++) {
+        ReceiverProfileSite *site = &gDvmJit.pReceiverProfiles[i];
+        if (site->cell == NULL) continue;
+        if (site->megamorphic) {
+            numMegamorphic++;
+        } else {
+            histogram[site->numEntries]++;
+        }
+        if (site->megamorphic || site->numEntries > 1) {
+            sorted[numSorted++] = site;
+        }
+    }
+
+    ALOGD("JIT: IC sites: %d mono, %d bi, %d tri, %d quad, %d mega",
+         histogram[1], histogram[2], histogram[3], histogram[4],
+         numMegamorphic);
+
+    qsort(sorted, numSorted, sizeof(ReceiverProfileSite *), compareSiteMisses);
+    for (i = 0; i < numSorted && i < RECEIVER_PROFILE_DUMP_SITES; i++) {
+        ReceiverProfileSite *site = sorted[i];
+        ALOGD("JIT: IC site %p (%s): %d misses, %d repatches%s",
+             site->cell, site->callee != NULL ? site->callee : "?",
+             site->misses, site->repatches,
+             site->megamorphic ? ", megamorphic" : "");
+        for (j = 0; j < site->numEntries; j++) {
+            const char *descriptor = site->entries[j].descriptor;
+            ALOGD("JIT:   %s: %d", descriptor != NULL ? descriptor : "?",
+                 site->entries[j].samples);
+        }
+    }
+    dvmUnlockMutex(&gDvmJit.compilerICPatchLock);
+    free(sorted);
+}
@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Redundant load elimination over the SSA form of a trace.
+ *
+ * Values loaded by iget / iget-quick and array-length (and values stored by
+ * full-width iput) are numbered by (base object SSA name, field offset,
+ * load kind).  A later load of the same value is rewritten into a move from
+ * the Dalvik register that still holds it.  Because every backend reads the
+ * value back from that Dalvik register, an entry is only usable while its
+ * holder register has not been redefined.
+ *
+ * Availability flows along extended basic blocks: a block with a single,
+ * already processed predecessor starts with that predecessor's exit state.
+ *
+ * Memory effects are modeled conservatively:
+ *   - iput to offset X kills every entry for offset X (any base may alias)
+ *   - invokes, monitors, allocations, volatile accesses and any other
+ *     throwing instruction not known to be field-neutral kill all field
+ *     entries
+ *   - array lengths are immutable and only die with their holder register
+ */
+
+#include "Dalvik.h"
+#include "Dataflow.h"
+#include "libdex/DexOpcodes.h"
+
+/* Max number of available values tracked at a time */
+#define MAX_AVAILABLE_VALUES 32
+
+/* Offset used to number array-length values */
+#define ARRAY_LENGTH_OFFSET (-1)
+
+typedef enum LoadKind {
+    kLoadWord = 0,
+    kLoadWide,
+    kLoadObject,
+    kLoadBoolean,
+    kLoadByte,
+    kLoadChar,
+    kLoadShort,
+    kLoadArrayLength,
+} LoadKind;
+
+typedef struct AvailableValue {
+    int baseSReg;               // SSA name of the object or array
+    int offset;                 // Field offset or ARRAY_LENGTH_OFFSET
+    LoadKind kind;
+    int valueSReg[2];           // SSA name(s) of the value (2 if wide)
+    int holderReg;              // Dalvik register currently holding it
+} AvailableValue;
+
+typedef struct ValueTable {
+    int numValues;
+    AvailableValue values[MAX_AVAILABLE_VALUES];
+} ValueTable;
+
+static void removeValue(ValueTable *table, int idx)
+{
+    table->values[idx] = table->values[--table->numValues];
+}
+
+static void addValue(ValueTable *table, const AvailableValue *value)
+{
+    /* Drop the oldest entry if the table is full */
+    if (table->numValues == MAX_AVAILABLE_VALUES) {
+        removeValue(table, 0);
+    }
+    table->values[table->numValues++] = *value;
+}
+
+static AvailableValue *findValue(ValueTable *table, int baseSReg, int offset,
+                                 LoadKind kind)
+{
+    int i;
+    for (i = 0; i < table->numValues; i++) {
+        AvailableValue *value = &table->values[i];
+        if (value->baseSReg == baseSReg && value->offset == offset &&
+            value->kind == kind) {
+            return value;
+        }
+    }
+    return NULL;
+}
+
+/* The Dalvik register dalvikReg has been redefined */
+static void killHolder(ValueTable *table, int dalvikReg)
+{
+    int i = 0;
+    while (i < table->numValues) {
+        AvailableValue *value = &table->values[i];
+        if (value->holderReg == dalvikReg ||
+            (value->kind == kLoadWide && value->holderReg + 1 == dalvikReg)) {
+            removeValue(table, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+/* A store to the given field offset may have hit any object */
+static void killOffset(ValueTable *table, int offset)
+{
+    int i = 0;
+    while (i < table->numValues) {
+        if (table->values[i].offset == offset) {
+            removeValue(table, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+/* Unknown heap side effects - only immutable array lengths survive */
+static void killAllFields(ValueTable *table)
+{
+    int i = 0;
+    while (i < table->numValues) {
+        if (table->values[i].kind != kLoadArrayLength) {
+            removeValue(table, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+/*
+ * Classify a non-volatile instance field access.  Returns false if the
+ * opcode isn't one we number.  For non-quick forms the field has to be
+ * resolved so that accesses through different field indices (eg from an
+ * inlined callee) can be matched by offset.
+ */
+static bool getFieldAccessInfo(const CompilationUnit *cUnit, const MIR *mir,
+                               bool *isStore, LoadKind *kind, int *offset)
+{
+    Opcode opcode = mir->dalvikInsn.opcode;
+    bool isQuick = false;
+
+    switch (opcode) {
+        case OP_IGET_QUICK:
+            isQuick = true;
+            // NOTE: intentional fallthrough
+        case OP_IGET:
+            *isStore = false; *kind = kLoadWord; break;
+        case OP_IGET_WIDE_QUICK:
+            isQuick = true;
+            // NOTE: intentional fallthrough
+        case OP_IGET_WIDE:
+            *isStore = false; *kind = kLoadWide; break;
+        case OP_IGET_OBJECT_QUICK:
+            isQuick = true;
+            // NOTE: intentional fallthrough
+        case OP_IGET_OBJECT:
+            *isStore = false; *kind = kLoadObject; break;
+        case OP_IGET_BOOLEAN:
+            *isStore = false; *kind = kLoadBoolean; break;
+        case OP_IGET_BYTE:
+            *isStore = false; *kind = kLoadByte; break;
+        case OP_IGET_CHAR:
+            *isStore = false; *kind = kLoadChar; break;
+        case OP_IGET_SHORT:
+            *isStore = false; *kind = kLoadShort; break;
+        case OP_IPUT_QUICK:
+            isQuick = true;
+            // NOTE: intentional fallthrough
+        case OP_IPUT:
+            *isStore = true; *kind = kLoadWord; break;
+        case OP_IPUT_WIDE_QUICK:
+            isQuick = true;
+            // NOTE: intentional fallthrough
+        case OP_IPUT_WIDE:
+            *isStore = true; *kind = kLoadWide; break;
+        case OP_IPUT_OBJECT_QUICK:
+            isQuick = true;
+            // NOTE: intentional fallthrough
+        case OP_IPUT_OBJECT:
+            *isStore = true; *kind = kLoadObject; break;
+        case OP_IPUT_BOOLEAN:
+            *isStore = true; *kind = kLoadBoolean; break;
+        case OP_IPUT_BYTE:
+            *isStore = true; *kind = kLoadByte; break;
+        case OP_IPUT_CHAR:
+            *isStore = true; *kind = kLoadChar; break;
+        case OP_IPUT_SHORT:
+            *isStore = true; *kind = kLoadShort; break;
+        default:
+            return false;
+    }
+
+    if (isQuick) {
+        *offset = mir->dalvikInsn.vC;
+        return true;
+    }
+
+    const Method *method = (mir->OptimizationFlags & MIR_CALLEE) ?
+        mir->meta.calleeMethod : cUnit->method;
+    InstField *fieldPtr = (InstField *)
+        method->clazz->pDvmDex->pResFields[mir->dalvikInsn.vC];
+    if (fieldPtr == NULL || dvmIsVolatileField(fieldPtr)) {
+        return false;
+    }
+    *offset = fieldPtr->byteOffset;
+    return true;
+}
+
+/*
+ * Returns true if the instruction may throw but is known not to write any
+ * instance field or run arbitrary code.
+ */
+static bool isFieldNeutral(Opcode opcode)
+{
+    switch (opcode) {
+        case OP_AGET:
+        case OP_AGET_WIDE:
+        case OP_AGET_OBJECT:
+        case OP_AGET_BOOLEAN:
+        case OP_AGET_BYTE:
+        case OP_AGET_CHAR:
+        case OP_AGET_SHORT:
+        case OP_APUT:
+        case OP_APUT_WIDE:
+        case OP_APUT_OBJECT:
+        case OP_APUT_BOOLEAN:
+        case OP_APUT_BYTE:
+        case OP_APUT_CHAR:
+        case OP_APUT_SHORT:
+        case OP_SGET:
+        case OP_SGET_WIDE:
+        case OP_SGET_OBJECT:
+        case OP_SGET_BOOLEAN:
+        case OP_SGET_BYTE:
+        case OP_SGET_CHAR:
+        case OP_SGET_SHORT:
+        case OP_SPUT:
+        case OP_SPUT_WIDE:
+        case OP_SPUT_OBJECT:
+        case OP_SPUT_BOOLEAN:
+        case OP_SPUT_BYTE:
+        case OP_SPUT_CHAR:
+        case OP_SPUT_SHORT:
+        case OP_CHECK_CAST:
+        case OP_INSTANCE_OF:
+        case OP_CONST_STRING:
+        case OP_CONST_STRING_JUMBO:
+        case OP_CONST_CLASS:
+        case OP_DIV_INT:
+        case OP_REM_INT:
+        case OP_DIV_LONG:
+        case OP_REM_LONG:
+        case OP_DIV_INT_2ADDR:
+        case OP_REM_INT_2ADDR:
+        case OP_DIV_LONG_2ADDR:
+        case OP_REM_LONG_2ADDR:
+        case OP_DIV_INT_LIT16:
+        case OP_REM_INT_LIT16:
+        case OP_DIV_INT_LIT8:
+        case OP_REM_INT_LIT8:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Turn a redundant load into a move from the register holding the value.
+ * The 16-bit-register move forms are used since the holder can be any
+ * Dalvik register.
+ */
+static void convertToMove(MIR *mir, const AvailableValue *value)
+{
+    bool wide = (value->kind == kLoadWide);
+    int numUses = wide ? 2 : 1;
+    int i;
+
+    if (wide) {
+        mir->dalvikInsn.opcode = OP_MOVE_WIDE_16;
+    } else if (value->kind == kLoadObject) {
+        mir->dalvikInsn.opcode = OP_MOVE_OBJECT_16;
+    } else {
+        mir->dalvikInsn.opcode = OP_MOVE_16;
+    }
+    mir->dalvikInsn.vB = value->holderReg;
+    mir->dalvikInsn.vC = 0;
+
+    mir->ssaRep->numUses = numUses;
+    mir->ssaRep->uses = (int *)dvmCompilerNew(sizeof(int) * numUses, false);
+    mir->ssaRep->fpUse = (bool *)dvmCompilerNew(sizeof(bool) * numUses, true);
+    for (i = 0; i < numUses; i++) {
+        mir->ssaRep->uses[i] = value->valueSReg[i];
+    }
+}
+
+static int eliminateLoadsInBlock(CompilationUnit *cUnit, BasicBlock *bb,
+                                 ValueTable *table)
+{
+    int numEliminated = 0;
+    bool predictedCallee = false;
+    MIR *mir;
+
+    for (mir = bb->firstMIRInsn; mir; mir = mir->next) {
+        DecodedInstruction *dInsn = &mir->dalvikInsn;
+        int i;
+
+        /* Inlined invokes and their move-results are not executed */
+        if (mir->OptimizationFlags & MIR_INLINED) continue;
+
+        /*
+         * The callee body of a predicted inline only runs when the
+         * prediction holds, so it can neither supply nor reuse values.
+         */
+        if ((int)dInsn->opcode == (int)kMirOpCheckInlinePrediction) {
+            predictedCallee = true;
+        } else if (!(mir->OptimizationFlags & MIR_CALLEE)) {
+            predictedCallee = false;
+        }
+
+        if (mir->ssaRep == NULL) {
+            killAllFields(table);
+            continue;
+        }
+
+        AvailableValue newValue;
+        bool haveNewValue = false;
+
+        if ((int)dInsn->opcode >= (int)kMirOpFirst) {
+            /* Phis and hoisted checks touch no memory */
+        } else if (dInsn->opcode == OP_ARRAY_LENGTH && !predictedCallee) {
+            AvailableValue *value =
+                findValue(table, mir->ssaRep->uses[0], ARRAY_LENGTH_OFFSET,
+                          kLoadArrayLength);
+            if (value != NULL) {
+                convertToMove(mir, value);
+                numEliminated++;
+            } else {
+                newValue.baseSReg = mir->ssaRep->uses[0];
+                newValue.offset = ARRAY_LENGTH_OFFSET;
+                newValue.kind = kLoadArrayLength;
+                newValue.valueSReg[0] = mir->ssaRep->defs[0];
+                newValue.valueSReg[1] = INVALID_SREG;
+                newValue.holderReg = dInsn->vA;
+                haveNewValue = true;
+            }
+        } else {
+            bool isStore;
+            LoadKind kind;
+            int offset;
+            int flags = dexGetFlagsFromOpcode(dInsn->opcode);
+
+            if (getFieldAccessInfo(cUnit, mir, &isStore, &kind, &offset)) {
+                bool wide = (kind == kLoadWide);
+                if (isStore) {
+                    /* Value in uses[0] (and [1]), object after it */
+                    int baseSReg = mir->ssaRep->uses[wide ? 2 : 1];
+                    killOffset(table, offset);
+                    /*
+                     * Sub-word stores truncate, so only full-width values
+                     * can be forwarded to later loads.
+                     */
+                    if (!predictedCallee &&
+                        (kind == kLoadWord || kind == kLoadWide ||
+                         kind == kLoadObject)) {
+                        newValue.baseSReg = baseSReg;
+                        newValue.offset = offset;
+                        newValue.kind = kind;
+                        newValue.valueSReg[0] = mir->ssaRep->uses[0];
+                        newValue.valueSReg[1] =
+                            wide ? mir->ssaRep->uses[1] : INVALID_SREG;
+                        newValue.holderReg = dInsn->vA;
+                        haveNewValue = true;
+                    }
+                } else if (!predictedCallee) {
+                    int baseSReg = mir->ssaRep->uses[0];
+                    AvailableValue *value =
+                        findValue(table, baseSReg, offset, kind);
+                    if (value != NULL) {
+                        convertToMove(mir, value);
+                        numEliminated++;
+                    } else {
+                        newValue.baseSReg = baseSReg;
+                        newValue.offset = offset;
+                        newValue.kind = kind;
+                        newValue.valueSReg[0] = mir->ssaRep->defs[0];
+                        newValue.valueSReg[1] =
+                            wide ? mir->ssaRep->defs[1] : INVALID_SREG;
+                        newValue.holderReg = dInsn->vA;
+                        haveNewValue = true;
+                    }
+                }
+            } else if ((flags & kInstrCanThrow) &&
+                       !isFieldNeutral(dInsn->opcode)) {
+                killAllFields(table);
+            }
+        }
+
+        /* Redefined Dalvik registers no longer hold their old values */
+        for (i = 0; i < mir->ssaRep->numDefs; i++) {
+            int dalvikReg = DECODE_REG(
+                dvmConvertSSARegToDalvik(cUnit, mir->ssaRep->defs[i]));
+            killHolder(table, dalvikReg);
+        }
+
+        /*
+         * Record after the kill so that a load into its own base register
+         * (eg "iget v0, v0, ...") is still numbered by the old base name.
+         * A value whose holder overlaps the base is fine for the same
+         * reason - the key is an SSA name, not a register.
+         */
+        if (haveNewValue) {
+            addValue(table, &newValue);
+        }
+    }
+    return numEliminated;
+}
+
+/*
+ * Main entry point.  Runs on the SSA form of a trace or loop, before
+ * register allocation and code generation.
+ */
+void dvmCompilerRedundantLoadElimination(CompilationUnit *cUnit)
+{
+    /*
+     * The IA32 backend lowers each MIR from the bytecode at its Dalvik PC,
+     * so the loads rewritten into moves would still be done there.
+     */
+#if defined(ARCH_IA32)
+    return;
+#endif
+
+    ValueTable **exitTables = (ValueTable **)
+        dvmCompilerNew(sizeof(ValueTable *) * cUnit->numBlocks, true);
+    ValueTable *table = (ValueTable *) dvmCompilerNew(sizeof(ValueTable),
+                                                     false);
+    GrowableListIterator iterator;
+    int numEliminated = 0;
+
+    dvmGrowableListIteratorInit(&cUnit->blockList, &iterator);
+    while (true) {
+        BasicBlock *bb = (BasicBlock *) dvmGrowableListIteratorNext(&iterator);
+        if (bb == NULL) break;
+        if (bb->hidden == true) continue;
+        if (bb->blockType != kDalvikByteCode || bb->dataFlowInfo == NULL)
+            continue;
+
+        /* Continue an extended basic block if possible */
+        table->numValues = 0;
+        if (bb->predecessors != NULL &&
+            dvmCountSetBits(bb->predecessors) == 1) {
+            BitVectorIterator bvIterator;
+            dvmBitVectorIteratorInit(bb->predecessors, &bvIterator);
+            int predId = dvmBitVectorIteratorNext(&bvIterator);
+            if (predId >= 0 && predId < cUnit->numBlocks &&
+                exitTables[predId] != NULL) {
+                *table = *exitTables[predId];
+            }
+        }
+
+        numEliminated += eliminateLoadsInBlock(cUnit, bb, table);
+
+        /* Only keep the exit state if some successor could use it */
+        if (table->numValues != 0) {
+            exitTables[bb->id] = (ValueTable *)
+                dvmCompilerNew(sizeof(ValueTable), false);
+            *exitTables[bb->id] = *table;
+        }
+    }
+
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.redundantLoadsEliminated += numEliminated;
+#endif
+    if (cUnit->printMe && numEliminated) {
+        ALOGD("Redundant load elimination: %d loads removed", numEliminated);
+    }
+}
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Dalvik.h"
+#include "CompilerInternals.h"
+
+/*
+ * Exit profiling of the JIT traces (-Xjitexitprofile).
+ *
+ * A trace is compiled along the path seen when it was selected, and every
+ * branch that leaves that path ends in a normal chaining cell.  Once a cell is
+ * chained the exit costs nothing but it can no longer be observed, so a trace
+ * whose early side exit turns out to be the common path keeps bouncing
+ * through the side exit without anyone noticing.
+ *
+ * Each trace and loop installed in the code cache is registered here with the
+ * Dalvik PCs of its normal chaining cells, split into the exits at the end of
+ * the trace and the side exits taken from within it.  dvmJitToInterpNormal
+ * reports the exits through dvmJitTraceExit, and dvmJitChain leaves the
+ * cells of a trace unchained until TRACE_EXIT_PROFILE_WINDOW of them have been
+ * counted.  When the window closes, a side exit that was taken more often than
+ * all the exits at the end of the trace together is marked hot, and the next
+ * time it is taken a trace is started at its target.  The new trace gets
+ * chained to the side exit like any other, which extends the compiled code
+ * along the hot path.
+ *
+ * The original trace itself stays as is: once a JitTable entry has a code
+ * address it cannot be replaced without halting all threads, and the cold
+ * part of the trace costs little more than code cache space.
+ *
+ * Loop traces are counted but never re-formed, their exits leave the loop.
+ *
+ * The profiles are looked up by code address.  The code cache is filled
+ * bottom up, so registering the translations in the order they are installed
+ * keeps the list sorted.  All accesses are serialized by
+ * gDvmJit.traceExitLock.
+ */
+
+/* Find the profile of the translation containing "addr" */
+static TraceExitProfile *findProfile(const void *addr)
+{
+    int low = 0;
+    int high = gDvmJit.numTraceExitProfiles - 1;
+    const char *target = (const char *) addr;
+
+    while (low <= high) {
+        int mid = (low + high) >> 1;
+        TraceExitProfile *profile = gDvmJit.pTraceExitProfiles[mid];
+        if (target < profile->codeStart) {
+            high = mid - 1;
+        } else if (target >= profile->codeStart + profile->codeSize) {
+            low = mid + 1;
+        } else {
+            return profile;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Find the exit taken through "cell".  Cells are matched with their exits by
+ * target the first time they are taken.
+ */
+static TraceExit *findExit(TraceExitProfile *profile, const void *cell,
+                           const u2 *dPC)
+{
+    TraceExit *unclaimed = NULL;
+    int i;
+
+    for (i = 0; i < profile->numExits; i++) {
+        TraceExit *traceExit = &profile->exits[i];
+        if (traceExit->cell == cell) {
+            return traceExit;
+        }
+        if (traceExit->cell == NULL && traceExit->targetPC == dPC &&
+            unclaimed == NULL) {
+            unclaimed = traceExit;
+        }
+    }
+    if (unclaimed != NULL) {
+        unclaimed->cell = cell;
+    }
+    return unclaimed;
+}
+
+/*
+ * Close the profiling window of a trace and look for a side exit that is
+ * hotter than the end of the trace.
+ */
+static void settleProfile(TraceExitProfile *profile)
+{
+    TraceExit *hottest = NULL;
+    u4 mainCount = 0;
+    int i;
+
+    profile->settled = true;
+    if (profile->isLoop) {
+        return;
+    }
+
+    for (i = 0; i < profile->numExits; i++) {
+        TraceExit *traceExit = &profile->exits[i];
+        if (!traceExit->isSideExit) {
+            mainCount += traceExit->count;
+        } else if (hottest == NULL || traceExit->count > hottest->count) {
+            hottest = traceExit;
+        }
+    }
+
+    if (hottest != NULL && hottest->count > mainCount) {
+        hottest->isHot = true;
+        COMPILER_TRACE_CHAINING(
+            ALOGD("Jit Runtime: side exit to %#x of trace %s%s@%#x is hot",
+                 hottest->targetPC - profile->method->insns,
+                 profile->method->clazz->descriptor, profile->method->name,
+                 profile->headPC - profile->method->insns));
+    }
+}
+
+/*
+ * Start selecting a trace at the target of a hot side exit.  The thread is
+ * on its way back to the interpreter, which picks up the trace request when
+ * it resumes at dPC.
+ */
+static bool requestTrace(const u2 *dPC, Thread *self, const Method *method)
+{
+    if ((self->interpBreak.ctl.subMode &
+         (kSubModeJitTraceBuild | kSubModeJitSV)) != 0 ||
+        self->interpSave.method != method) {
+        return false;
+    }
+    self->interpSave.pc = dPC;
+    self->jitState = kJitTSelectRequestHot;
+    dvmJitCheckTraceRequest(self);
+    return self->jitState == kJitTSelect;
+}
+
+/*
+ * Account for an exit through the normal chaining cell "chainAddr" and look up
+ * the translation to continue with.  Called from dvmJitToInterpNormal in
+ * place of dvmJitGetTraceAddrThread.
+ */
+void* dvmJitTraceExit(const u2* dPC, Thread* self, const void* chainAddr)
+{
+    if (gDvmJit.exitProfile) {
+        const Method *method = NULL;
+        TraceExit *traceExit;
+
+        dvmLockMutex(&gDvmJit.traceExitLock);
+        TraceExitProfile *profile = findProfile(chainAddr);
+        traceExit = profile ? findExit(profile, chainAddr, dPC) : NULL;
+        if (traceExit != NULL) {
+            traceExit->count++;
+            if (!profile->settled &&
+                ++profile->samples >= TRACE_EXIT_PROFILE_WINDOW) {
+                settleProfile(profile);
+            }
+            if (traceExit->isHot && !traceExit->reformed) {
+                method = profile->method;
+            }
+        }
+        dvmUnlockMutex(&gDvmJit.traceExitLock);
+
+        if (method != NULL && requestTrace(dPC, self, method)) {
+            dvmLockMutex(&gDvmJit.traceExitLock);
+            traceExit->reformed = true;
+            dvmUnlockMutex(&gDvmJit.traceExitLock);
+        }
+    }
+    return dvmJitGetTraceAddrThread(dPC, self);
+}
+
+/*
+ * Keep the cells of a trace unchained while its exits are being counted.
+ * Called by dvmJitChain, always after dvmJitTraceExit has seen the cell.
+ */
+bool dvmJitTraceExitCanChain(const void *chainAddr)
+{
+    bool canChain = true;
+
+    if (!gDvmJit.exitProfile) {
+        return true;
+    }
+
+    dvmLockMutex(&gDvmJit.traceExitLock);
+    TraceExitProfile *profile = findProfile(chainAddr);
+    if (profile != NULL && !profile->settled) {
+        int i;
+        for (i = 0; i < profile->numExits; i++) {
+            if (profile->exits[i].cell == chainAddr) {
+                canChain = false;
+                break;
+            }
+        }
+    }
+    dvmUnlockMutex(&gDvmJit.traceExitLock);
+    return canChain;
+}
+
+/* Grow the profile list - returns false if out of memory */
+static bool growProfiles(void)
+{
+    int newMax = gDvmJit.maxTraceExitProfiles == 0 ?
+                     256 : gDvmJit.maxTraceExitProfiles * 2;
+    TraceExitProfile **newList = (TraceExitProfile **)
+        realloc(gDvmJit.pTraceExitProfiles,
+                newMax * sizeof(TraceExitProfile *));
+
+    if (newList == NULL) {
+        ALOGE("Jit: trace exit profile allocation failed");
+        return false;
+    }
+    gDvmJit.pTraceExitProfiles = newList;
+    gDvmJit.maxTraceExitProfiles = newMax;
+    return true;
+}
+
+/*
+ * Register the normal chaining cells of a freshly installed trace.  The exits
+ * from the last block of the trace are where the trace was expected to end;
+ * all others are side exits.  Cells without a predecessor are the case cells
+ * of a switch, which can only end a trace.
+ *
+ * Called with gDvmJit.compilerLock held.
+ */
+void dvmCompilerTraceExitAddTranslation(CompilationUnit *cUnit,
+                                        const void *codeStart, int codeSize)
+{
+    GrowableListIterator iterator;
+    BasicBlock *lastBlock = NULL;
+    int numExits = 0;
+
+    if (!gDvmJit.exitProfile || cUnit->jitMode == kJitMethod ||
+        cUnit->traceDesc == NULL) {
+        return;
+    }
+
+    dvmGrowableListIteratorInit(&cUnit->blockList, &iterator);
+    while (true) {
+        BasicBlock *bb = (BasicBlock *) dvmGrowableListIteratorNext(&iterator);
+        if (bb == NULL) break;
+        if (bb->blockType == kDalvikByteCode && bb->lastMIRInsn != NULL) {
+            lastBlock = bb;
+        } else if (bb->blockType == kChainingCellNormal) {
+            numExits++;
+        }
+    }
+    if (numExits == 0 || lastBlock == NULL) {
+        return;
+    }
+
+    TraceExitProfile *profile = (TraceExitProfile *)
+        calloc(1, sizeof(TraceExitProfile) + numExits * sizeof(TraceExit));
+    if (profile == NULL) {
+        ALOGE("Jit: trace exit profile allocation failed");
+        return;
+    }
+    profile->codeStart = (const char *) codeStart;
+    profile->codeSize = codeSize;
+    profile->method = cUnit->method;
+    profile->headPC = cUnit->method->insns +
+                      cUnit->traceDesc->trace[0].info.frag.startOffset;
+    profile->isLoop = cUnit->jitMode == kJitLoop;
+
+    dvmGrowableListIteratorInit(&cUnit->blockList, &iterator);
+    while (true) {
+        BasicBlock *bb = (BasicBlock *) dvmGrowableListIteratorNext(&iterator);
+        if (bb == NULL) break;
+        if (bb->blockType != kChainingCellNormal) continue;
+        TraceExit *traceExit = &profile->exits[profile->numExits++];
+        traceExit->targetPC = cUnit->method->insns + bb->startOffset;
+        traceExit->isSideExit = dvmCountSetBits(bb->predecessors) != 0 &&
+                           !dvmIsBitSet(bb->predecessors, lastBlock->id);
+    }
+
+    dvmLockMutex(&gDvmJit.traceExitLock);
+    if ((gDvmJit.numTraceExitProfiles < gDvmJit.maxTraceExitProfiles ||
+         growProfiles()) &&
+        (gDvmJit.numTraceExitProfiles == 0 ||
+         gDvmJit.pTraceExitProfiles[gDvmJit.numTraceExitProfiles - 1]->
+             codeStart < profile->codeStart)) {
+        gDvmJit.pTraceExitProfiles[gDvmJit.numTraceExitProfiles++] = profile;
+        profile = NULL;
+    }
+    dvmUnlockMutex(&gDvmJit.traceExitLock);
+
+    /* Not registered - the cells of the trace will be chained right away */
+    free(profile);
+}
+
+/* Forget all profiles - called when the code cache is wiped */
+void dvmJitResetTraceExits(void)
+{
+    int i;
+
+    dvmLockMutex(&gDvmJit.traceExitLock);
+    for (i = 0; i < gDvmJit.numTraceExitProfiles; i++) {
+        free(gDvmJit.pTraceExitProfiles[i]);
+    }
+    gDvmJit.numTraceExitProfiles = 0;
+    dvmUnlockMutex(&gDvmJit.traceExitLock);
+}
+
+/*
+ * Dump the trace exit graph: every profiled trace with the targets of its
+ * exits.  Exits are only counted while unchained, so the counts reflect the
+ * profiling window and the exits taken after the cells were unchained again.
+ */
+void dvmJitDumpTraceExits(void)
+{
+    int numSide = 0;
+    int numHot = 0;
+    int numReformed = 0;
+    int i, j;
+
+    dvmLockMutex(&gDvmJit.traceExitLock);
+    for (i = 0; i < gDvmJit.numTraceExitProfiles; i++) {
+        TraceExitProfile *profile = gDvmJit.pTraceExitProfiles[i];
+        const Method *method = profile->method;
+
+        ALOGD("JIT: %s %p %s%s@%#x: %d exits%s",
+             profile->isLoop ? "Loop" : "Trace", profile->codeStart,
+             method->clazz->descriptor, method->name,
+             profile->headPC - method->insns, profile->samples,
+             profile->settled ? "" : " (profiling)");
+        for (j = 0; j < profile->numExits; j++) {
+            TraceExit *traceExit = &profile->exits[j];
+            if (traceExit->isSideExit) numSide++;
+            if (traceExit->isHot) numHot++;
+            if (traceExit->reformed) numReformed++;
+            ALOGD("JIT:   -> %#x %s: %d%s%s%s",
+                 traceExit->targetPC - method->insns,
+                 traceExit->isSideExit ? "side" : "end",
+                 traceExit->count,
+                 traceExit->isHot ? ", hot" : "",
+                 traceExit->reformed ? ", re-formed" : "",
+                 dvmJitGetTraceAddr(traceExit->targetPC) != NULL ?
+                     ", compiled" : "");
+        }
+    }
+    ALOGD("JIT: Trace exits: %d traces, %d side exits, %d hot, %d re-formed",
+         gDvmJit.numTraceExitProfiles, numSide, numHot, numReformed);
+    dvmUnlockMutex(&gDvmJit.traceExitLock);
+}
@@ -31,6 +31,12 @@ enum optControlVector {
     kMethodInlining,
     kMethodJit,
     kShiftArithmetic,
+    kRedundantLoadElimination,
+    kLoopInvariantCodeMotion,
+    kEscapeAnalysis,
+    kLoopVectorization,
+    kGlobalRegisterAllocation,
+    kOnStackReplacement,
 };
 
 /* Forward declarations */
@@ -1540,6 +1540,9 @@ void dvmCompilerAssembleLIR(CompilationUnit *cUnit, JitTranslationInfo *info)
 
     PROTECT_CODE_CACHE(cUnit->baseAddr, offset);
 
+    dvmCompilerPerfMapAddTranslation(cUnit, cUnit->baseAddr, offset);
+    dvmCompilerTraceExitAddTranslation(cUnit, cUnit->baseAddr, offset);
+
     /* Translation cache update complete - release lock */
     dvmUnlockMutex(&gDvmJit.compilerLock);
 
@@ -1550,6 +1553,7 @@ void dvmCompilerAssembleLIR(CompilationUnit *cUnit, JitTranslationInfo *info)
         info->codeAddress = (char*)info->codeAddress + 1;
     /* transfer the size of the profiling code */
     info->profileCodeSize = cUnit->profileCodeSize;
+    info->traceCounter = cUnit->traceCounter;
 }
 
 /*
@@ -1601,10 +1605,12 @@ void* dvmJitChain(void* tgtAddr, u4* branchAddr)
 
     /*
      * Only chain translations when there is no urge to ask all threads to
-     * suspend themselves via the interpreter.
+     * suspend themselves via the interpreter, and not while the exits of the
+     * trace are being profiled.
      */
     if ((gDvmJit.pProfTable != NULL) && (gDvm.sumThreadSuspendCount == 0) &&
-        (gDvmJit.codeCacheFull == false)) {
+        (gDvmJit.codeCacheFull == false) &&
+        dvmJitTraceExitCanChain(branchAddr)) {
         assert((branchOffset >= -(1<<22)) && (branchOffset <= ((1<<22)-2)));
 
         gDvmJit.translationChains++;
@@ -1794,6 +1800,19 @@ const Method *dvmJitToPatchPredictedChain(const Method *method,
         goto done;
     }
 
+    /*
+     * Consult the receiver profile of the call site so that polymorphic sites
+     * don't thrash the cell and megamorphic ones are never re-targeted.
+     * The rechain counter is per thread, so it is left as is: backing it off
+     * for one megamorphic site would freeze every other cell of the thread.
+     */
+    if (dvmJitProfileReceiver(cell, clazz, method) != kReceiverPatch) {
+        COMPILER_TRACE_CHAINING(
+            ALOGD("Jit Runtime: predicted chain %p to method %s%s kept",
+                 cell, method->clazz->descriptor, method->name));
+        goto done;
+    }
+
     if (cell->clazz == NULL) {
         newRechainCount = self->icRechainCount;
     }
@@ -1964,6 +1983,7 @@ void dvmJitUnchainAll()
     if (gDvmJit.pJitEntryTable != NULL) {
         COMPILER_TRACE_CHAINING(LOGD("Jit Runtime: unchaining all"));
         dvmLockMutex(&gDvmJit.tableLock);
+        dvmJitFinishJitTableMigration();
 
         UNPROTECT_CODE_CACHE(gDvmJit.codeCache, gDvmJit.codeCacheByteUsed);
 
@@ -2126,6 +2146,7 @@ void dvmCompilerSortAndPrintTraceProfiles()
 
     /* Make sure that the table is not changing */
     dvmLockMutex(&gDvmJit.tableLock);
+    dvmJitFinishJitTableMigration();
 
     /* Sort the entries by descending order */
     sortedEntries = (JitEntry *)malloc(sizeof(JitEntry) * gDvmJit.jitTableSize);
@@ -2248,6 +2269,7 @@ void dvmJitScanAllClassPointers(void (*callback)(void *))
     if (gDvmJit.pJitEntryTable != NULL) {
         unsigned int traceIdx;
         dvmLockMutex(&gDvmJit.tableLock);
+        dvmJitFinishJitTableMigration();
         for (traceIdx = 0; traceIdx < gDvmJit.jitTableSize; traceIdx++) {
             const JitEntry *entry = &gDvmJit.pJitEntryTable[traceIdx];
             if (entry->dPC &&
@@ -46,7 +46,9 @@
 
 static int genTraceProfileEntry(CompilationUnit *cUnit)
 {
-    intptr_t addr = (intptr_t)dvmJitNextTraceCounter();
+    JitTraceCounter_t *counter = dvmJitNextTraceCounter();
+    intptr_t addr = (intptr_t)counter;
+    cUnit->traceCounter = counter;
     assert(__BYTE_ORDER == __LITTLE_ENDIAN);
     newLIR1(cUnit, kArm16BitData, addr & 0xffff);
     newLIR1(cUnit, kArm16BitData, (addr >> 16) & 0xffff);
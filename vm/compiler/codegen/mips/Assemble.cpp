@@ -914,6 +914,9 @@ void dvmCompilerAssembleLIR(CompilationUnit *cUnit, JitTranslationInfo *info)
 
     PROTECT_CODE_CACHE(cUnit->baseAddr, offset);
 
+    dvmCompilerPerfMapAddTranslation(cUnit, cUnit->baseAddr, offset);
+    dvmCompilerTraceExitAddTranslation(cUnit, cUnit->baseAddr, offset);
+
     /* Translation cache update complete - release lock */
     dvmUnlockMutex(&gDvmJit.compilerLock);
 
@@ -921,6 +924,7 @@ void dvmCompilerAssembleLIR(CompilationUnit *cUnit, JitTranslationInfo *info)
     info->codeAddress = (char*)cUnit->baseAddr + cUnit->headerSize;
     /* transfer the size of the profiling code */
     info->profileCodeSize = cUnit->profileCodeSize;
+    info->traceCounter = cUnit->traceCounter;
 }
 
 /*
@@ -953,10 +957,12 @@ void* dvmJitChain(void* tgtAddr, u4* branchAddr)
 
     /*
      * Only chain translations when there is no urge to ask all threads to
-     * suspend themselves via the interpreter.
+     * suspend themselves via the interpreter, and not while the exits of the
+     * trace are being profiled.
      */
     if ((gDvmJit.pProfTable != NULL) && (gDvm.sumThreadSuspendCount == 0) &&
         (gDvmJit.codeCacheFull == false) &&
+        dvmJitTraceExitCanChain(branchAddr) &&
         ((((int) tgtAddr) & 0xF0000000) == (((int) branchAddr+4) & 0xF0000000))) {
         gDvmJit.translationChains++;
 
@@ -1142,6 +1148,19 @@ const Method *dvmJitToPatchPredictedChain(const Method *method,
         goto done;
     }
 
+    /*
+     * Consult the receiver profile of the call site so that polymorphic sites
+     * don't thrash the cell and megamorphic ones are never re-targeted.
+     * The rechain counter is per thread, so it is left as is: backing it off
+     * for one megamorphic site would freeze every other cell of the thread.
+     */
+    if (dvmJitProfileReceiver(cell, clazz, method) != kReceiverPatch) {
+        COMPILER_TRACE_CHAINING(
+            ALOGD("Jit Runtime: predicted chain %p to method %s%s kept",
+                 cell, method->clazz->descriptor, method->name));
+        goto done;
+    }
+
     if (cell->clazz == NULL) {
         newRechainCount = self->icRechainCount;
     }
@@ -1328,6 +1347,7 @@ void dvmJitUnchainAll()
     if (gDvmJit.pJitEntryTable != NULL) {
         COMPILER_TRACE_CHAINING(ALOGD("Jit Runtime: unchaining all"));
         dvmLockMutex(&gDvmJit.tableLock);
+        dvmJitFinishJitTableMigration();
 
         UNPROTECT_CODE_CACHE(gDvmJit.codeCache, gDvmJit.codeCacheByteUsed);
 
@@ -1493,6 +1513,7 @@ void dvmCompilerSortAndPrintTraceProfiles()
 
     /* Make sure that the table is not changing */
     dvmLockMutex(&gDvmJit.tableLock);
+    dvmJitFinishJitTableMigration();
 
     /* Sort the entries by descending order */
     sortedEntries = (JitEntry *)malloc(sizeof(JitEntry) * gDvmJit.jitTableSize);
@@ -1615,6 +1636,7 @@ void dvmJitScanAllClassPointers(void (*callback)(void *))
     if (gDvmJit.pJitEntryTable != NULL) {
         unsigned int traceIdx;
         dvmLockMutex(&gDvmJit.tableLock);
+        dvmJitFinishJitTableMigration();
         for (traceIdx = 0; traceIdx < gDvmJit.jitTableSize; traceIdx++) {
             const JitEntry *entry = &gDvmJit.pJitEntryTable[traceIdx];
             if (entry->dPC &&
@@ -1544,10 +1544,6 @@ static bool handleFmt10t_Fmt20t_Fmt30t(CompilationUnit *cUnit, MIR *mir,
 static bool handleFmt10x(CompilationUnit *cUnit, MIR *mir)
 {
     Opcode dalvikOpcode = mir->dalvikInsn.opcode;
-    if ((dalvikOpcode >= OP_UNUSED_3E) && (dalvikOpcode <= OP_UNUSED_43)) {
-        ALOGE("Codegen: got unused opcode %#x",dalvikOpcode);
-        return true;
-    }
     switch (dalvikOpcode) {
         case OP_RETURN_VOID_BARRIER:
             dvmCompilerGenMemBarrier(cUnit, 0);
@@ -1555,7 +1551,6 @@ static bool handleFmt10x(CompilationUnit *cUnit, MIR *mir)
         case OP_RETURN_VOID:
             genReturnCommon(cUnit,mir);
             break;
-        case OP_UNUSED_73:
         case OP_UNUSED_79:
         case OP_UNUSED_7A:
         case OP_UNUSED_FF:
@@ -3959,6 +3954,8 @@ static const char *extendedMIROpNames[kMirOpLast - kMirOpFirst] = {
     "kMirOpLowerBound",
     "kMirOpPunt",
     "kMirOpCheckInlinePrediction",
+    "kMirOpMemBarrier",
+    "kMirOpVectorLoop",
 };
 
 /*
@@ -4227,6 +4224,10 @@ static void handleExtendedMIR(CompilationUnit *cUnit, MIR *mir)
             genValidationForPredictedInline(cUnit, mir);
             break;
         }
+        case kMirOpMemBarrier: {
+            dvmCompilerGenMemBarrier(cUnit, 0);
+            break;
+        }
         default:
             break;
     }
@@ -4608,8 +4609,10 @@ void dvmCompilerMIR2LIR(CompilationUnit *cUnit)
              * Eliminate redundant loads/stores and delay stores into later
              * slots
              */
-            dvmCompilerApplyLocalOptimizations(cUnit, (LIR *) headLIR,
-                                               cUnit->lastLIRInsn);
+            if (!cUnit->baselineTier) {
+                dvmCompilerApplyLocalOptimizations(cUnit, (LIR *) headLIR,
+                                                   cUnit->lastLIRInsn);
+            }
             /* Reset headLIR which is also the optimization boundary */
             headLIR = NULL;
         }
@@ -4695,7 +4698,9 @@ gen_fallthrough:
         opReg(cUnit, kOpBlx, r_A2);
     }
 
-    dvmCompilerApplyGlobalOptimizations(cUnit);
+    if (!cUnit->baselineTier) {
+        dvmCompilerApplyGlobalOptimizations(cUnit);
+    }
 
 #if defined(WITH_SELF_VERIFICATION)
     selfVerificationBranchInsertPass(cUnit);
@@ -4722,7 +4727,16 @@ bool dvmCompilerDoWork(CompilerWorkOrder *work)
             /* Start compilation with maximally allowed trace length */
             desc = (JitTraceDescription *)work->info;
             success = dvmCompileTrace(desc, JIT_MAX_TRACE_LEN, &work->result,
-                                        work->bailPtr, 0 /* no hints */);
+                                        work->bailPtr,
+                                        gDvmJit.tieredCompilation ?
+                                            JIT_OPT_BASELINE : 0);
+            break;
+        case kWorkOrderTraceOptimize:
+            isCompile = true;
+            /* Rebuild a hot baseline trace with all optimizations */
+            desc = (JitTraceDescription *)work->info;
+            success = dvmCompileTrace(desc, JIT_MAX_TRACE_LEN, &work->result,
+                                        work->bailPtr, JIT_OPT_RECOMPILE);
             break;
         case kWorkOrderTraceDebug: {
             bool oldPrintMe = gDvmJit.printMe;
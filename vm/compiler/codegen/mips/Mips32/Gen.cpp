@@ -48,7 +48,9 @@
  */
 static int genTraceProfileEntry(CompilationUnit *cUnit)
 {
-    intptr_t addr = (intptr_t)dvmJitNextTraceCounter();
+    JitTraceCounter_t *counter = dvmJitNextTraceCounter();
+    intptr_t addr = (intptr_t)counter;
+    cUnit->traceCounter = counter;
     assert(__BYTE_ORDER == __LITTLE_ENDIAN);
     MipsLIR *executionCount = newLIR1(cUnit, kMips32BitData, addr);
     cUnit->chainCellOffsetLIR =
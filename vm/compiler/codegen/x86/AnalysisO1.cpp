@@ -24,6 +24,8 @@
 #include "interp/InterpState.h"
 #include "interp/InterpDefs.h"
 #include "libdex/Leb128.h"
+#include "compiler/Dataflow.h"
+#include "compiler/codegen/Optimizer.h"
 
 /* compilation flags to turn on debug printout */
 //#define DEBUG_COMPILE_TABLE
@@ -405,9 +407,10 @@ void initializeRegStateOfBB(BasicBlock_O1* bb) {
     //for GLUE variables, do not exist
     int k;
     for(k = 0; k < num_compile_entries; k++) {
-        /* trace-based JIT: there is no VR with GG type */
+        /* trace-based JIT: only loop traces have GG VRs, which the entry block
+           loads before the first O1 basic block */
         if(isVirtualReg(compileTable[k].physicalType) && compileTable[k].gType == GLOBALTYPE_GG) {
-            if(bb->bb_index > 0) { //non-entry block
+            if(bb->bb_index > 0 || currentUnit->jitMode == kJitLoop) { //non-entry block
                 if(isFirstOfHandler(bb)) {
                     /* at the beginning of an exception handler, GG VR is in the interpreted stack */
                     compileTable[k].physicalReg = PhysicalReg_Null;
@@ -458,8 +461,10 @@ void initializeMemVRTable() {
     int k;
     for(k = 0; k < num_compile_entries; k++) {
         if(!isVirtualReg(compileTable[k].physicalType)) continue;
-        /* VRs in compileTable */
-        bool setToInMemory = (compileTable[k].physicalReg == PhysicalReg_Null);
+        /* VRs in compileTable
+           GG VRs are written through at end of each basic block, so the copy in memory is up to date */
+        bool setToInMemory = (compileTable[k].physicalReg == PhysicalReg_Null) ||
+                             (compileTable[k].gType == GLOBALTYPE_GG);
         int regNum = compileTable[k].regNum;
         OpndSize sizeVR = getRegSize(compileTable[k].physicalType);
         /* search memVRTable for the VR in compileTable */
@@ -535,14 +540,98 @@ void preprocessingBB(BasicBlock* bb) {
     currentBB = NULL;
 }
 
+//!physical registers that hold GG VRs in a loop trace
+
+//!both are callee-saved, so they survive calls to helper functions
+static const PhysicalReg loopGlobalRegs[] = {PhysicalReg_EBX, PhysicalReg_ESI};
+#define NUM_LOOP_GLOBAL_REGS (int)(sizeof(loopGlobalRegs) / sizeof(loopGlobalRegs[0]))
+
+//!sum of reference counts of a VR over the basic blocks of a trace
+
+//!returns -1 if the VR is not always accessed as a 32-bit gp value
+static int getRefCountOfGlobalVR(int regNum) {
+    int k, jj;
+    int refCount = 0;
+    for(k = 0; k < num_bbs_for_method; k++) {
+        for(jj = 0; jj < method_bbs_sorted[k]->num_regs; jj++) {
+            VirtualRegInfo* info = &method_bbs_sorted[k]->infoBasicBlock[jj];
+            if(info->regNum == regNum) {
+                if(info->physicalType != LowOpndRegType_gp) return -1;
+                refCount += info->refCount;
+            }
+            /* high half of a 64-bit VR */
+            if(info->regNum == regNum-1 && getRegSize(info->physicalType) == OpndSize_64)
+                return -1;
+        }
+    }
+    return refCount;
+}
+
+//!select GG VRs for a loop trace
+
+//!candidates are the VRs live into the loop header, which are carried around the back edge;
+//!the most referenced ones are assigned to loopGlobalRegs
+static void setGlobalTypeOfLoopVRs() {
+    BasicBlock* header = currentUnit->entryBlock->fallThrough;
+    if(header == NULL || header->dataFlowInfo == NULL) return;
+    int selected[NUM_LOOP_GLOBAL_REGS];
+    int selectedCount[NUM_LOOP_GLOBAL_REGS];
+    int num_selected = 0;
+    int k, jj, kk;
+    for(k = 0; k < num_bbs_for_method; k++) {
+        for(jj = 0; jj < method_bbs_sorted[k]->num_regs; jj++) {
+            int regNum = method_bbs_sorted[k]->infoBasicBlock[jj].regNum;
+            if(regNum >= currentUnit->numDalvikRegisters ||
+               !dvmIsBitSet(header->dataFlowInfo->liveInV, regNum)) continue;
+            for(kk = 0; kk < num_selected; kk++)
+                if(selected[kk] == regNum) break;
+            if(kk < num_selected) continue;
+            int refCount = getRefCountOfGlobalVR(regNum);
+            if(refCount <= 0) continue;
+            /* insertion into the list sorted by refCount */
+            for(kk = num_selected; kk > 0 && selectedCount[kk-1] < refCount; kk--) {
+                if(kk < NUM_LOOP_GLOBAL_REGS) {
+                    selected[kk] = selected[kk-1];
+                    selectedCount[kk] = selectedCount[kk-1];
+                }
+            }
+            if(kk >= NUM_LOOP_GLOBAL_REGS) continue;
+            selected[kk] = regNum;
+            selectedCount[kk] = refCount;
+            if(num_selected < NUM_LOOP_GLOBAL_REGS) num_selected++;
+        }
+    }
+    for(kk = 0; kk < num_selected; kk++) {
+        for(k = 0; k < num_bbs_for_method; k++) {
+            for(jj = 0; jj < method_bbs_sorted[k]->num_regs; jj++) {
+                VirtualRegInfo* info = &method_bbs_sorted[k]->infoBasicBlock[jj];
+                if(info->regNum != selected[kk]) continue;
+                info->gType = GLOBALTYPE_GG;
+                info->physicalReg_GG = loopGlobalRegs[kk];
+            }
+        }
+#ifdef DEBUG_GLOBALTYPE
+        ALOGI("loop VR %d with refCount %d is GG in physical register %d",
+              selected[kk], selectedCount[kk], loopGlobalRegs[kk]);
+#endif
+    }
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.loopGlobalVRs += num_selected;
+#endif
+}
+
 void preprocessingTrace() {
     int k, k2, k3, jj;
     /* this is a simplified verson of setTypeOfVR()
-        all VRs are assumed to be GL, no VR will be GG
+        all VRs are assumed to be GL; in a loop trace the VRs carried around the
+        back edge can be GG
     */
     for(k = 0; k < num_bbs_for_method; k++)
         for(jj = 0; jj < method_bbs_sorted[k]->num_regs; jj++)
             method_bbs_sorted[k]->infoBasicBlock[jj].gType = GLOBALTYPE_GL;
+    if(currentUnit->jitMode == kJitLoop &&
+       !(gDvmJit.disableOpt & (1 << kGlobalRegisterAllocation)))
+        setGlobalTypeOfLoopVRs();
 
     /* insert a glue-related register GLUE_DVMDEX to compileTable */
     insertGlueReg();
@@ -574,6 +663,17 @@ void preprocessingTrace() {
         offsetPC = offsetPC_back;
         num_compile_entries = compile_entries_old;
     }
+    /* GG VRs stay in compileTable for the whole trace, so their physical registers
+       are reserved even in basic blocks that do not access them */
+    for(k2 = 0; k2 < num_bbs_for_method; k2++) {
+        for(k3 = 0; k3 < method_bbs_sorted[k2]->num_regs; k3++) {
+            if(method_bbs_sorted[k2]->infoBasicBlock[k3].gType == GLOBALTYPE_GG)
+                insertFromVirtualInfo(method_bbs_sorted[k2], k3);
+        }
+    }
+    for(k = 0; k < num_compile_entries; k++)
+        if(isVirtualReg(compileTable[k].physicalType) &&
+           compileTable[k].gType == GLOBALTYPE_GG) compileTable[k].refCount = 0;
     /* initialize data structure allRegs */
     initializeAllRegs();
 #ifdef DEBUG_COMPILE_TABLE
@@ -675,7 +775,7 @@ int collectInfoOfBasicBlock(Method* method, BasicBlock_O1* bb) {
 #else
         if(mir->dalvikInsn.opcode >= kNumPackedOpcodes) continue;
 #endif
-        inst = FETCH(0);
+        inst = dexUnfuseCodeUnit(FETCH(0));
         u2 inst_op = INST_INST(inst);
         /* update bb->hasAccessToGlue */
         if((inst_op >= OP_MOVE_RESULT && inst_op <= OP_RETURN_OBJECT) ||
@@ -785,7 +885,7 @@ int codeGenBasicBlock(const Method* method, BasicBlock_O1* bb) {
             continue;
         }
 
-        inst = FETCH(0);
+        inst = dexUnfuseCodeUnit(FETCH(0));
         //before handling a bytecode, import info of temporary registers to compileTable including refCount
         num_temp_regs_per_bytecode = getTempRegInfo(infoByteCodeTemp);
         for(k = 0; k < num_temp_regs_per_bytecode; k++) {
@@ -1989,6 +2089,9 @@ void dumpToMem(int vrNum, LowOpndRegType type, int regAll) { //ss,gp,xmm
                                    4*vrNum, PhysicalReg_FP, true,
                                    MemoryAccess_VR, vrNum);
     setVRToMemory(vrNum, getRegSize(type));
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.vrSpillStores++;
+#endif
 }
 //! dump part of a 64-bit VR to memory and update inMemory
 
@@ -2716,6 +2819,9 @@ int spillLogicalReg(int spill_index, bool updateTable) {
             spillIndexUsed[k] = 1;
         saveToSpillRegion(getRegSize(compileTable[spill_index].physicalType),
                           compileTable[spill_index].physicalReg, 4*k);
+#if defined(WITH_JIT_TUNING)
+        gDvmJit.tempSpills++;
+#endif
     }
     //compileTable[spill_index].physicalReg_prev = compileTable[spill_index].physicalReg;
 #ifdef DEBUG_REGALLOC
@@ -3156,7 +3262,7 @@ void getDeadStmts() {
 #ifdef DEBUG_DSE
         ALOGI("DSE: offsetPC %x", offsetPC);
 #endif
-        inst = FETCH(0);
+        inst = dexUnfuseCodeUnit(FETCH(0));
         bool isDeadStmt = true;
         getVirtualRegInfo(infoByteCode);
         u2 inst_op = INST_INST(inst);
@@ -4595,6 +4701,14 @@ void globalVREndOfBB(const Method* method) {
 #endif
             spillLogicalReg(k, true); //the next section will load VR from memory to the specific reg
         }
+        //write through a GG VR that stays in its register: the trace may be left at the next BB
+        if(isVirtualReg(compileTable[k].physicalType) &&
+           compileTable[k].gType == GLOBALTYPE_GG &&
+           compileTable[k].physicalReg != PhysicalReg_Null) {
+            dumpToMem(compileTable[k].regNum,
+                      (LowOpndRegType)(compileTable[k].physicalType & MASK_FOR_TYPE),
+                      compileTable[k].physicalReg);
+        }
     }
     syncAllRegs();
     for(k = 0; k < num_compile_entries; k++) {
@@ -4622,6 +4736,22 @@ void globalVREndOfBB(const Method* method) {
     }
 }
 
+//!loads GG VRs to their physical registers at end of the entry block of a loop trace
+
+//!the entry block is not handled by O1, so nothing else is live at this point
+void globalVRStartOfTrace() {
+    int k;
+    for(k = 0; k < num_compile_entries; k++) {
+        if(isVirtualReg(compileTable[k].physicalType) &&
+           compileTable[k].gType == GLOBALTYPE_GG) {
+            get_virtual_reg_noalloc(compileTable[k].regNum,
+                                    getRegSize(compileTable[k].physicalType),
+                                    compileTable[k].physicalReg_prev,
+                                    true);
+        }
+    }
+}
+
 //! get ready for the next version of a hard-coded register
 
 //!set its physicalReg to Null and update its reference count
@@ -18,6 +18,8 @@
 #include "libdex/DexOpcodes.h"
 #include "compiler/Compiler.h"
 #include "compiler/CompilerIR.h"
+#include "compiler/Dataflow.h"
+#include "compiler/Loop.h"
 #include "interp/Jit.h"
 #include "libdex/DexFile.h"
 #include "Lower.h"
@@ -227,6 +229,7 @@ void dvmCompilerSortAndPrintTraceProfiles() //in Assemble.c
 
     /* Make sure that the table is not changing */
     dvmLockMutex(&gDvmJit.tableLock);
+    dvmJitFinishJitTableMigration();
 
     /* Sort the entries by descending order */
     sortedEntries = (JitEntry *)malloc(sizeof(JitEntry) * gDvmJit.jitTableSize);
@@ -450,6 +453,19 @@ const Method *dvmJitToPatchPredictedChain(const Method *method,
         goto done;
     }
 
+    /*
+     * Consult the receiver profile of the call site so that polymorphic sites
+     * don't thrash the cell and megamorphic ones are never re-targeted.
+     * The rechain counter is per thread, so it is left as is: backing it off
+     * for one megamorphic site would freeze every other cell of the thread.
+     */
+    if (dvmJitProfileReceiver(cell, clazz, method) != kReceiverPatch) {
+        COMPILER_TRACE_CHAINING(
+            ALOGI("Jit Runtime: predicted chain %p to method %s%s kept",
+                  cell, method->clazz->descriptor, method->name));
+        goto done;
+    }
+
     PredictedChainingCell newCell;
 
     if (cell->clazz == NULL) {
@@ -585,6 +601,7 @@ void dvmJitUnchainAll()
     if (gDvmJit.pJitEntryTable != NULL) {
         COMPILER_TRACE_CHAINING(ALOGI("Jit Runtime: unchaining all"));
         dvmLockMutex(&gDvmJit.tableLock);
+        dvmJitFinishJitTableMigration();
 
         UNPROTECT_CODE_CACHE(gDvmJit.codeCache, gDvmJit.codeCacheByteUsed);
 
@@ -857,6 +874,258 @@ static void genHoistedLowerBoundCheck(CompilationUnit *cUnit, MIR *mir)
 }
 #undef P_GPR_1
 
+/*
+ * Vector version of an element-wise counted loop, emitted in the loop entry
+ * block after the hoisted checks. It runs VECTOR_LOOP_LANES iterations at a
+ * time, always leaving at least one iteration to the scalar loop so that the
+ * temporaries of the body get their final values in the Dalvik frame.
+ *
+ * vB = idxReg (BIV)
+ * vC = endConditionReg
+ * arg[2] = loopBranchConditionCode
+ * meta.vectorLoopInfo = instructions of the body
+ */
+#define P_GPR_IDX   PhysicalReg_EAX
+#define P_GPR_ARRAY PhysicalReg_EBX
+#define P_GPR_LIMIT PhysicalReg_ECX
+static int vectorOperand(CompilationUnit *cUnit, int *xmmOfSSA, int *numXmm,
+                         int ssaReg)
+{
+    if (xmmOfSSA[ssaReg] == -1) {
+        /* Loop invariant - replicate it into all the lanes */
+        int xmm = PhysicalReg_XMM0 + (*numXmm)++;
+        get_virtual_reg(DECODE_REG(dvmConvertSSARegToDalvik(cUnit, ssaReg)),
+                        OpndSize_32, P_GPR_ARRAY, true);
+        broadcast_reg_to_xmm(P_GPR_ARRAY, true, xmm, true);
+        xmmOfSSA[ssaReg] = xmm;
+    }
+    return xmmOfSSA[ssaReg];
+}
+
+static void genVectorLoop(CompilationUnit *cUnit, MIR *mir)
+{
+    VectorLoopInfo *vectorLoopInfo = mir->meta.vectorLoopInfo;
+    int *xmmOfSSA = (int *)dvmCompilerNew(sizeof(int) * cUnit->numSSARegs,
+                                          false);
+    int *literalXmm = (int *)dvmCompilerNew(sizeof(int) *
+                                            vectorLoopInfo->numInsns, false);
+    int numXmm = 0;
+    int i, j;
+
+    memset(xmmOfSSA, -1, sizeof(int) * cUnit->numSSARegs);
+
+    get_virtual_reg(mir->dalvikInsn.vB, OpndSize_32, P_GPR_IDX, true);
+    get_virtual_reg(mir->dalvikInsn.vC, OpndSize_32, P_GPR_LIMIT, true);
+
+    /*
+     * The hoisted checks only cover the indices the loop would visit, so
+     * skip the vector loop if the index starts out negative or there are not
+     * enough iterations left for one group plus the scalar one. Testing the
+     * end first keeps the limit below from overflowing.
+     */
+    compare_imm_reg(OpndSize_32, 0, P_GPR_IDX, true);
+    char *skipNegIdx = stream;
+    conditional_jump_int(Condition_L, 0, OpndSize_32);
+    compare_imm_reg(OpndSize_32, 0, P_GPR_LIMIT, true);
+    char *skipNegEnd = stream;
+    conditional_jump_int(Condition_L, 0, OpndSize_32);
+    /* Last index at which a whole group can start */
+    alu_binary_imm_reg(OpndSize_32, sub_opc,
+                       VECTOR_LOOP_LANES + (mir->dalvikInsn.arg[2] == OP_IF_GE),
+                       P_GPR_LIMIT, true);
+    compare_reg_reg(P_GPR_LIMIT, true, P_GPR_IDX, true);
+    char *skipShort = stream;
+    conditional_jump_int(Condition_G, 0, OpndSize_32);
+
+    /* Replicate the literals outside of the loop */
+    for (i = 0; i < vectorLoopInfo->numInsns; i++) {
+        DecodedInstruction *dInsn = &vectorLoopInfo->insns[i]->dalvikInsn;
+        int value;
+
+        literalXmm[i] = -1;
+        switch (dInsn->opcode) {
+            case OP_CONST_4:
+            case OP_CONST_16:
+            case OP_CONST:
+                value = dInsn->vB;
+                break;
+            case OP_CONST_HIGH16:
+                value = dInsn->vB << 16;
+                break;
+            case OP_ADD_INT_LIT16:
+            case OP_RSUB_INT:
+            case OP_AND_INT_LIT16:
+            case OP_OR_INT_LIT16:
+            case OP_XOR_INT_LIT16:
+            case OP_ADD_INT_LIT8:
+            case OP_RSUB_INT_LIT8:
+            case OP_AND_INT_LIT8:
+            case OP_OR_INT_LIT8:
+            case OP_XOR_INT_LIT8:
+                value = dInsn->vC;
+                break;
+            default:
+                continue;
+        }
+        literalXmm[i] = PhysicalReg_XMM0 + numXmm++;
+        move_imm_to_reg(OpndSize_32, value, P_GPR_ARRAY, true);
+        broadcast_reg_to_xmm(P_GPR_ARRAY, true, literalXmm[i], true);
+    }
+    /* And the loop invariant operands */
+    for (i = 0; i < vectorLoopInfo->numInsns; i++) {
+        MIR *bodyMIR = vectorLoopInfo->insns[i];
+        Opcode opcode = bodyMIR->dalvikInsn.opcode;
+        for (j = 0; j < bodyMIR->ssaRep->numUses; j++) {
+            int ssaReg = bodyMIR->ssaRep->uses[j];
+            /* Array and index operands stay in the GPRs */
+            if ((opcode == OP_AGET && j < 2) || (opcode == OP_APUT && j > 0)) {
+                continue;
+            }
+            if (DECODE_SUB(dvmConvertSSARegToDalvik(cUnit, ssaReg)) == 0) {
+                vectorOperand(cUnit, xmmOfSSA, &numXmm, ssaReg);
+            }
+        }
+    }
+
+    char *loopTop = stream;
+    for (i = 0; i < vectorLoopInfo->numInsns; i++) {
+        MIR *bodyMIR = vectorLoopInfo->insns[i];
+        DecodedInstruction *dInsn = &bodyMIR->dalvikInsn;
+        int *uses = bodyMIR->ssaRep->uses;
+        int xmm = -1;
+        int src1 = -1, src2 = -1;
+        bool isFloat = false;
+        ALU_Opcode opc = add_opc;
+
+        switch (dInsn->opcode) {
+            case OP_AGET:
+                xmm = PhysicalReg_XMM0 + numXmm++;
+                get_virtual_reg(dInsn->vB, OpndSize_32, P_GPR_ARRAY, true);
+                move_dqu_mem_disp_scale_to_reg(P_GPR_ARRAY, true,
+                                               offArrayObject_contents,
+                                               P_GPR_IDX, true, 4, xmm, true);
+                break;
+            case OP_APUT:
+                get_virtual_reg(dInsn->vB, OpndSize_32, P_GPR_ARRAY, true);
+                move_dqu_reg_to_mem_disp_scale(xmmOfSSA[uses[0]], true,
+                                               P_GPR_ARRAY, true,
+                                               offArrayObject_contents,
+                                               P_GPR_IDX, true, 4);
+                continue;
+            case OP_MOVE:
+            case OP_MOVE_FROM16:
+            case OP_MOVE_16:
+                xmmOfSSA[bodyMIR->ssaRep->defs[0]] = xmmOfSSA[uses[0]];
+                continue;
+            case OP_CONST_4:
+            case OP_CONST_16:
+            case OP_CONST:
+            case OP_CONST_HIGH16:
+                xmmOfSSA[bodyMIR->ssaRep->defs[0]] = literalXmm[i];
+                continue;
+            case OP_RSUB_INT:
+            case OP_RSUB_INT_LIT8:
+                /* literal - vB */
+                src1 = literalXmm[i];
+                src2 = xmmOfSSA[uses[0]];
+                opc = sub_opc;
+                break;
+            case OP_SHL_INT_LIT8:
+            case OP_SHR_INT_LIT8:
+            case OP_USHR_INT_LIT8:
+                xmm = PhysicalReg_XMM0 + numXmm++;
+                move_dqu_reg_to_reg(xmmOfSSA[uses[0]], true, xmm, true);
+                alu_pi_shift_imm_reg(dInsn->opcode == OP_SHL_INT_LIT8 ? sll_opc :
+                                     (dInsn->opcode == OP_SHR_INT_LIT8 ?
+                                      sra_opc : srl_opc),
+                                     dInsn->vC & 0x1f, xmm, true);
+                break;
+            default:
+                src1 = xmmOfSSA[uses[0]];
+                src2 = (literalXmm[i] != -1) ? literalXmm[i] :
+                                               xmmOfSSA[uses[1]];
+                switch (dInsn->opcode) {
+                    case OP_SUB_INT:
+                    case OP_SUB_INT_2ADDR:
+                        opc = sub_opc;
+                        break;
+                    case OP_AND_INT:
+                    case OP_AND_INT_2ADDR:
+                    case OP_AND_INT_LIT16:
+                    case OP_AND_INT_LIT8:
+                        opc = and_opc;
+                        break;
+                    case OP_OR_INT:
+                    case OP_OR_INT_2ADDR:
+                    case OP_OR_INT_LIT16:
+                    case OP_OR_INT_LIT8:
+                        opc = or_opc;
+                        break;
+                    case OP_XOR_INT:
+                    case OP_XOR_INT_2ADDR:
+                    case OP_XOR_INT_LIT16:
+                    case OP_XOR_INT_LIT8:
+                        opc = xor_opc;
+                        break;
+                    case OP_ADD_FLOAT:
+                    case OP_ADD_FLOAT_2ADDR:
+                        isFloat = true;
+                        break;
+                    case OP_SUB_FLOAT:
+                    case OP_SUB_FLOAT_2ADDR:
+                        isFloat = true;
+                        opc = sub_opc;
+                        break;
+                    case OP_MUL_FLOAT:
+                    case OP_MUL_FLOAT_2ADDR:
+                        isFloat = true;
+                        opc = mul_opc;
+                        break;
+                    case OP_DIV_FLOAT:
+                    case OP_DIV_FLOAT_2ADDR:
+                        isFloat = true;
+                        opc = div_opc;
+                        break;
+                    default:
+                        /* add-int and its 2addr/literal forms */
+                        break;
+                }
+                break;
+        }
+        if (src1 != -1) {
+            /* Never clobber an operand - a move may still refer to it */
+            xmm = PhysicalReg_XMM0 + numXmm++;
+            move_dqu_reg_to_reg(src1, true, xmm, true);
+            if (isFloat) {
+                alu_ps_binary_reg_reg(opc, src2, true, xmm, true);
+            } else {
+                alu_pi_binary_reg_reg(opc, src2, true, xmm, true);
+            }
+        }
+        assert(numXmm <= VECTOR_LOOP_MAX_VALUES);
+        xmmOfSSA[bodyMIR->ssaRep->defs[0]] = xmm;
+    }
+
+    alu_binary_imm_reg(OpndSize_32, add_opc, VECTOR_LOOP_LANES, P_GPR_IDX, true);
+    compare_reg_reg(P_GPR_LIMIT, true, P_GPR_IDX, true);
+    int relOffset = loopTop - stream;
+    OpndSize immSize = estOpndSizeFromImm(relOffset);
+    relOffset -= getJmpCallInstSize(immSize, JmpCall_cond);
+    conditional_jump_int(Condition_LE, relOffset, immSize);
+    set_virtual_reg(mir->dalvikInsn.vB, OpndSize_32, P_GPR_IDX, true);
+
+    /* Patch the branches around the vector loop */
+    updateJumpInst(skipNegIdx, OpndSize_32,
+                   stream - skipNegIdx - getJmpCallInstSize(OpndSize_32, JmpCall_cond));
+    updateJumpInst(skipNegEnd, OpndSize_32,
+                   stream - skipNegEnd - getJmpCallInstSize(OpndSize_32, JmpCall_cond));
+    updateJumpInst(skipShort, OpndSize_32,
+                   stream - skipShort - getJmpCallInstSize(OpndSize_32, JmpCall_cond));
+}
+#undef P_GPR_IDX
+#undef P_GPR_ARRAY
+#undef P_GPR_LIMIT
+
 #ifdef WITH_JIT_INLINING
 static void genValidationForPredictedInline(CompilationUnit *cUnit, MIR *mir)
 {
@@ -907,6 +1176,10 @@ void handleExtendedMIR(CompilationUnit *cUnit, MIR *mir)
         case kMirOpPunt: {
             break;
         }
+        case kMirOpVectorLoop: {
+            genVectorLoop(cUnit, mir);
+            break;
+        }
 #ifdef WITH_JIT_INLINING
         case kMirOpCheckInlinePrediction: { //handled in ncg_o1_data.c
             genValidationForPredictedInline(cUnit, mir);
@@ -939,6 +1212,44 @@ static void setupLoopEntryBlock(CompilationUnit *cUnit, BasicBlock *entry,
 #endif
 }
 
+/* Whether the backward branch of a loop trace goes straight to the header */
+static bool loopHasDirectBackEdge(CompilationUnit *cUnit)
+{
+    BasicBlock *header = cUnit->entryBlock->fallThrough;
+    GrowableListIterator iterator;
+
+    dvmGrowableListIteratorInit(&cUnit->blockList, &iterator);
+    while (true) {
+        BasicBlock *bb = (BasicBlock *) dvmGrowableListIteratorNext(&iterator);
+        if (bb == NULL) break;
+        if (bb->blockType != kDalvikByteCode) continue;
+        if (bb->taken == header || bb->fallThrough == header) return true;
+    }
+    return false;
+}
+
+/*
+ * Without the backward chaining cell the loop never leaves the trace, so
+ * poll for suspend requests at the top of the header and punt to the
+ * interpreter at the header's Dalvik PC when one is pending.  VRs are in
+ * the frame at every block boundary, so no register state needs to be
+ * flushed here.
+ */
+static void genLoopSuspendPoll(CompilationUnit *cUnit, BasicBlock *header)
+{
+    get_self_pointer(PhysicalReg_ECX, true);
+    compare_imm_mem(OpndSize_8, 0,
+                    offsetof(Thread, interpBreak.ctl.breakFlags),
+                    PhysicalReg_ECX, true);
+    char *skipPunt = stream;
+    conditional_jump_int(Condition_E, 0, OpndSize_32);
+    rPC = (u2 *) cUnit->method->insns + header->startOffset;
+    export_pc();
+    jumpToBasicBlock(stream, cUnit->exceptionBlockId);
+    updateJumpInst(skipPunt, OpndSize_32,
+                   stream - skipPunt - getJmpCallInstSize(OpndSize_32, JmpCall_cond));
+}
+
 /* check whether we can merge the block at index i with its target block */
 bool mergeBlock(BasicBlock *bb) {
     if(bb->blockType == kDalvikByteCode &&
@@ -1129,6 +1440,7 @@ void dvmCompilerMIR2LIR(CompilationUnit *cUnit, JitTranslationInfo *info)
         if (bb->blockType == kEntryBlock) {
             labelList[i].lop.opCode2 = ATOM_PSEUDO_ENTRY_BLOCK;
             if (bb->firstMIRInsn == NULL) {
+                globalVRStartOfTrace();
                 continue;
             } else {
               setupLoopEntryBlock(cUnit, bb, bb->fallThrough->id);
@@ -1223,6 +1535,10 @@ void dvmCompilerMIR2LIR(CompilationUnit *cUnit, JitTranslationInfo *info)
         labelList[i].lop.generic.offset = (stream - streamMethodStart);
         ALOGV("get ready to handle JIT bb %d type %d hidden %d",
               bb->id, bb->blockType, bb->hidden);
+        if (cUnit->jitMode == kJitLoop && bb == cUnit->entryBlock->fallThrough &&
+            loopHasDirectBackEdge(cUnit)) {
+            genLoopSuspendPoll(cUnit, bb);
+        }
         for (BasicBlock *nextBB = bb; nextBB != NULL; nextBB = cUnit->nextCodegenBlock) {
             bb = nextBB;
             bb->visited = true;
@@ -1292,6 +1608,10 @@ void dvmCompilerMIR2LIR(CompilationUnit *cUnit, JitTranslationInfo *info)
                 break;
             }
         } // end for
+        /* Loop traces: load the VRs that stay in registers across the loop */
+        if (bb->blockType == kEntryBlock) {
+            globalVRStartOfTrace();
+        }
         } // end else //JIT + O0 code generator
         }
         } // end for
@@ -1423,6 +1743,14 @@ gen_fallthrough:
     PROTECT_CODE_CACHE(stream, unprotected_code_cache_bytes);
 
     gDvmJit.codeCacheByteUsed += (stream - streamStart);
+    if (gDvmJit.perfMap || gDvmJit.exitProfile) {
+        dvmLockMutex(&gDvmJit.compilerLock);
+        dvmCompilerPerfMapAddTranslation(cUnit, streamStart,
+                                         stream - streamStart);
+        dvmCompilerTraceExitAddTranslation(cUnit, streamStart,
+                                           stream - streamStart);
+        dvmUnlockMutex(&gDvmJit.compilerLock);
+    }
     if (cUnit->printMe) {
         unsigned char* codeBaseAddr = (unsigned char *) cUnit->baseAddr;
         unsigned char* codeBaseAddrNext = ((unsigned char *) gDvmJit.codeCache) + gDvmJit.codeCacheByteUsed;
@@ -1450,8 +1778,10 @@ void* dvmJitChain(void* tgtAddr, u4* branchAddr)
 #ifdef JIT_CHAIN
     int relOffset = (int) tgtAddr - (int)branchAddr;
 
+    /* Cells of a trace whose exits are being profiled are chained later */
     if ((gDvmJit.pProfTable != NULL) && (gDvm.sumThreadSuspendCount == 0) &&
-        (gDvmJit.codeCacheFull == false)) {
+        (gDvmJit.codeCacheFull == false) &&
+        dvmJitTraceExitCanChain(branchAddr)) {
 
         gDvmJit.translationChains++;
 
@@ -1497,7 +1827,16 @@ bool dvmCompilerDoWork(CompilerWorkOrder *work)
             /* Start compilation with maximally allowed trace length */
             desc = (JitTraceDescription *)work->info;
             success = dvmCompileTrace(desc, JIT_MAX_TRACE_LEN, &work->result,
-                                        work->bailPtr, 0 /* no hints */);
+                                        work->bailPtr,
+                                        gDvmJit.tieredCompilation ?
+                                            JIT_OPT_BASELINE : 0);
+            break;
+        case kWorkOrderTraceOptimize:
+            isCompile = true;
+            /* Rebuild a hot baseline trace with all optimizations */
+            desc = (JitTraceDescription *)work->info;
+            success = dvmCompileTrace(desc, JIT_MAX_TRACE_LEN, &work->result,
+                                        work->bailPtr, JIT_OPT_RECOMPILE);
             break;
         case kWorkOrderTraceDebug: {
             bool oldPrintMe = gDvmJit.printMe;
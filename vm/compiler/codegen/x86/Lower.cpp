@@ -410,7 +410,8 @@ ExecutionMode origMode;
 //when to update streamMethodStart
 bool lowerByteCodeJit(const Method* method, const u2* codePtr, MIR* mir) {
     rPC = (u2*)codePtr;
-    inst = FETCH(0);
+    /* Superinstructions are lowered as their two separate instructions */
+    inst = dexUnfuseCodeUnit(FETCH(0));
     traceCurrentMIR = mir;
     int retCode = lowerByteCode(method);
     traceCurrentMIR = NULL;
@@ -594,6 +594,7 @@ void rememberState(int);
 void goToState(int);
 void transferToState(int);
 void globalVREndOfBB(const Method*);
+void globalVRStartOfTrace();
 void constVREndOfBB();
 void startNativeCode(int num, int type);
 void endNativeCode();
@@ -708,6 +709,19 @@ void alu_ss_binary_reg_reg(ALU_Opcode opc, int reg, bool isPhysical,
                             int reg2, bool isPhysical2);
 void alu_sd_binary_reg_reg(ALU_Opcode opc, int reg, bool isPhysical,
                             int reg2, bool isPhysical2);
+void alu_ps_binary_reg_reg(ALU_Opcode opc, int reg, bool isPhysical,
+                            int reg2, bool isPhysical2);
+void alu_pi_binary_reg_reg(ALU_Opcode opc, int reg, bool isPhysical,
+                            int reg2, bool isPhysical2);
+void alu_pi_shift_imm_reg(ALU_Opcode opc, int imm, int reg, bool isPhysical);
+void move_dqu_reg_to_reg(int reg, bool isPhysical, int reg2, bool isPhysical2);
+void move_dqu_mem_disp_scale_to_reg(int base_reg, bool isBasePhysical, int disp,
+                            int index_reg, bool isIndexPhysical, int scale,
+                            int reg, bool isPhysical);
+void move_dqu_reg_to_mem_disp_scale(int reg, bool isPhysical,
+                            int base_reg, bool isBasePhysical, int disp,
+                            int index_reg, bool isIndexPhysical, int scale);
+void broadcast_reg_to_xmm(int reg, bool isPhysical, int reg2, bool isPhysical2);
 
 void push_mem_to_stack(OpndSize size, int disp, int base_reg, bool isBasePhysical);
 void push_reg_to_stack(OpndSize size, int reg, bool isPhysical);
@@ -1201,6 +1215,7 @@ LowOpLabel* dump_label(Mnemonic m, OpndSize size, int imm,
                const char* label, bool isLocal);
 
 unsigned getJmpCallInstSize(OpndSize size, JmpCall_type type);
+int updateJumpInst(char* jumpInst, OpndSize immSize, int relativeNCG);
 bool lowerByteCodeJit(const Method* method, const u2* codePtr, MIR* mir);
 void startOfBasicBlock(struct BasicBlock* bb);
 extern LowOpBlockLabel* traceLabelList;
@@ -102,6 +102,26 @@ const  Mnemonic map_of_64_opcode_2_mnemonic[] = {
     Mnemonic_Null,  Mnemonic_Null,  Mnemonic_PANDN,
     Mnemonic_Null
 };
+//!mnemonic for packed 32-bit integer SSE2
+const  Mnemonic map_of_packed_int_opcode_2_mnemonic[] = {
+    Mnemonic_PADDD, Mnemonic_POR,   Mnemonic_Null,  Mnemonic_Null,
+    Mnemonic_PAND,  Mnemonic_PSUBD, Mnemonic_PXOR,  Mnemonic_Null,
+    Mnemonic_Null,  Mnemonic_Null,  Mnemonic_Null,  Mnemonic_Null,
+    Mnemonic_PSLLD, Mnemonic_PSRLD, Mnemonic_PSRAD,
+    Mnemonic_Null,  Mnemonic_Null,  Mnemonic_Null,  Mnemonic_Null,
+    Mnemonic_Null,  Mnemonic_Null,  Mnemonic_PANDN,
+    Mnemonic_Null
+};
+//!mnemonic for packed single-precision SSE
+const  Mnemonic map_of_packed_sse_opcode_2_mnemonic[] = {
+    Mnemonic_ADDPS,  Mnemonic_Null,  Mnemonic_Null,  Mnemonic_Null,
+    Mnemonic_Null,   Mnemonic_SUBPS, Mnemonic_Null,  Mnemonic_Null,
+    Mnemonic_MULPS,  Mnemonic_Null,  Mnemonic_DIVPS, Mnemonic_Null,
+    Mnemonic_Null,   Mnemonic_Null,
+    Mnemonic_Null,   Mnemonic_Null,  Mnemonic_Null,  Mnemonic_Null,
+    Mnemonic_Null,   Mnemonic_Null,  Mnemonic_Null,
+    Mnemonic_Null
+};
 
 ////////////////////////////////////////////////
 //!update fields of LowOpndReg
@@ -599,9 +619,12 @@ LowOpRegMem* dump_mem_scale_reg(Mnemonic m, OpndSize size,
         int regAll = registerAlloc(isMovzs ? LowOpndRegType_gp : type, reg, isPhysical, true);
         endNativeCode();
         return lower_mem_scale_reg(m, size, baseAll, disp, indexAll, scale, regAll, type);
-    } else {
+    } else if(disp == 0) {
         stream = encoder_mem_scale_reg(m, size, base_reg, isBasePhysical, index_reg,
                                        isIndexPhysical, scale, reg, isPhysical, type, stream);
+    } else {
+        stream = encoder_mem_disp_scale_reg(m, size, base_reg, isBasePhysical, disp, index_reg,
+                                            isIndexPhysical, scale, reg, isPhysical, type, stream);
     }
     return NULL;
 }
@@ -633,9 +656,12 @@ LowOpMemReg* dump_reg_mem_scale(Mnemonic m, OpndSize size,
         int regAll = registerAlloc(type, reg, isPhysical, true);
         endNativeCode();
         return lower_reg_mem_scale(m, size, regAll, baseAll, disp, indexAll, scale, type);
-    } else {
+    } else if(disp == 0) {
         stream = encoder_reg_mem_scale(m, size, reg, isPhysical, base_reg, isBasePhysical,
                                        index_reg, isIndexPhysical, scale, type, stream);
+    } else {
+        stream = encoder_reg_mem_disp_scale(m, size, reg, isPhysical, base_reg, isBasePhysical,
+                                            disp, index_reg, isIndexPhysical, scale, type, stream);
     }
     return NULL;
 }
@@ -1412,6 +1438,58 @@ void alu_sd_binary_reg_reg(ALU_Opcode opc, int reg, bool isPhysical,
     Mnemonic m = map_of_sse_opcode_2_mnemonic[opc];
     dump_reg_reg(m, ATOM_NORMAL_ALU, OpndSize_64, reg, isPhysical, reg2, isPhysical2, LowOpndRegType_xmm);
 }
+//!SSE packed single-precision ALU on all four lanes
+
+//!
+void alu_ps_binary_reg_reg(ALU_Opcode opc, int reg, bool isPhysical,
+                int reg2, bool isPhysical2) {
+    Mnemonic m = map_of_packed_sse_opcode_2_mnemonic[opc];
+    dump_reg_reg(m, ATOM_NORMAL_ALU, OpndSize_64, reg, isPhysical, reg2, isPhysical2, LowOpndRegType_xmm);
+}
+//!SSE2 packed 32-bit integer ALU on all four lanes
+
+//!
+void alu_pi_binary_reg_reg(ALU_Opcode opc, int reg, bool isPhysical,
+                int reg2, bool isPhysical2) {
+    Mnemonic m = map_of_packed_int_opcode_2_mnemonic[opc];
+    dump_reg_reg(m, ATOM_NORMAL_ALU, OpndSize_64, reg, isPhysical, reg2, isPhysical2, LowOpndRegType_xmm);
+}
+//!SSE2 packed 32-bit integer shift by an immediate
+
+//!
+void alu_pi_shift_imm_reg(ALU_Opcode opc, int imm, int reg, bool isPhysical) {
+    Mnemonic m = map_of_packed_int_opcode_2_mnemonic[opc];
+    dump_imm_reg(m, ATOM_NORMAL_ALU, OpndSize_64, imm, reg, isPhysical, LowOpndRegType_xmm, false);
+}
+//!copy all four lanes of a xmm register
+
+//!
+void move_dqu_reg_to_reg(int reg, bool isPhysical, int reg2, bool isPhysical2) {
+    dump_reg_reg(Mnemonic_MOVDQU, ATOM_NORMAL, OpndSize_64, reg, isPhysical, reg2, isPhysical2, LowOpndRegType_xmm);
+}
+//!unaligned 128-bit load, eg four consecutive array elements
+
+//!
+void move_dqu_mem_disp_scale_to_reg(int base_reg, bool isBasePhysical, int disp,
+                int index_reg, bool isIndexPhysical, int scale, int reg, bool isPhysical) {
+    dump_mem_scale_reg(Mnemonic_MOVDQU, OpndSize_64, base_reg, isBasePhysical, disp, index_reg,
+                       isIndexPhysical, scale, reg, isPhysical, LowOpndRegType_xmm);
+}
+//!unaligned 128-bit store
+
+//!
+void move_dqu_reg_to_mem_disp_scale(int reg, bool isPhysical, int base_reg, bool isBasePhysical,
+                int disp, int index_reg, bool isIndexPhysical, int scale) {
+    dump_reg_mem_scale(Mnemonic_MOVDQU, OpndSize_64, reg, isPhysical, base_reg, isBasePhysical,
+                       disp, index_reg, isIndexPhysical, scale, LowOpndRegType_xmm);
+}
+//!replicate a 32-bit gp register into the four lanes of a xmm register
+
+//!
+void broadcast_reg_to_xmm(int reg, bool isPhysical, int reg2, bool isPhysical2) {
+    dump_reg_reg(Mnemonic_MOVD, ATOM_NORMAL, OpndSize_32, reg, isPhysical, reg2, isPhysical2, LowOpndRegType_xmm);
+    dump_imm_reg(Mnemonic_PSHUFD, ATOM_NORMAL, OpndSize_64, 0, reg2, isPhysical2, LowOpndRegType_xmm, false);
+}
 //!push reg to native stack
 
 //!
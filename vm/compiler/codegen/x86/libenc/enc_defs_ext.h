@@ -89,6 +89,7 @@ Mnemonic_ADC,                           // Add with Carry
 Mnemonic_ADD,                           // Add
 Mnemonic_ADDSD,                         // Add Scalar Double-Precision Floating-Point Values
 Mnemonic_ADDSS,                         // Add Scalar Single-Precision Floating-Point Values
+Mnemonic_ADDPS,                         // Add Packed Single-Precision Floating-Point Values
 Mnemonic_AND,                           // Logical AND
 
 Mnemonic_BSF,                           // Bit scan forward
@@ -148,6 +149,7 @@ Mnemonic_DEC,                           // Decrement by 1
 //Mnemonic_DIV,                         // Unsigned Divide
 Mnemonic_DIVSD,                         // Divide Scalar Double-Precision Floating-Point Values
 Mnemonic_DIVSS,                         // Divide Scalar Single-Precision Floating-Point Values
+Mnemonic_DIVPS,                         // Divide Packed Single-Precision Floating-Point Values
 
 #ifdef _HAVE_MMX_
 Mnemonic_EMMS,                          // Empty MMX Technology State
@@ -239,6 +241,7 @@ Mnemonic_LAHF,                          // Load Flags into AH
 Mnemonic_MOV,                           // Move
 Mnemonic_MOVD,                          // Move Double word
 Mnemonic_MOVQ,                          // Move Quadword
+Mnemonic_MOVDQU,                        // Move Unaligned Double Quadword
 /*Mnemonic_MOVS,                        // Move Data from String to String*/
 // MOVS is a special case: see encoding table for more details,
 Mnemonic_MOVS8, Mnemonic_MOVS16, Mnemonic_MOVS32, Mnemonic_MOVS64,
@@ -251,6 +254,7 @@ Mnemonic_MOVZX,                         // Move with Zero-Extend
 //Mnemonic_MUL,                         // Unsigned Multiply
 Mnemonic_MULSD,                         // Multiply Scalar Double-Precision Floating-Point Values
 Mnemonic_MULSS,                         // Multiply Scalar Single-Precision Floating-Point Values
+Mnemonic_MULPS,                         // Multiply Packed Single-Precision Floating-Point Values
 Mnemonic_NEG,                           // Two's Complement Negation
 Mnemonic_NOP,                           // No Operation
 Mnemonic_NOT,                           // One's Complement Negation
@@ -266,6 +270,12 @@ Mnemonic_PREFETCH,                      // prefetch
 Mnemonic_PANDN,
 Mnemonic_PSLLQ,
 Mnemonic_PSRLQ,
+Mnemonic_PADDD,                         // Add Packed Doubleword Integers
+Mnemonic_PSUBD,                         // Subtract Packed Doubleword Integers
+Mnemonic_PSHUFD,                        // Shuffle Packed Doublewords
+Mnemonic_PSLLD,                         // Shift Packed Doublewords Left Logical
+Mnemonic_PSRLD,                         // Shift Packed Doublewords Right Logical
+Mnemonic_PSRAD,                         // Shift Packed Doublewords Right Arithmetic
 Mnemonic_PXOR,                          // Logical Exclusive OR
 Mnemonic_POP,                           // Pop a Value from the Stack
 Mnemonic_POPFD,                         // Pop a Value of EFLAGS register from the Stack
@@ -305,6 +315,7 @@ Mnemonic_SBB,                           // Integer Subtraction with Borrow
 Mnemonic_SUB,                           // Subtract
 Mnemonic_SUBSD,                         // Subtract Scalar Double-Precision Floating-Point Values
 Mnemonic_SUBSS,                         // Subtract Scalar Single-Precision Floating-Point Values
+Mnemonic_SUBPS,                         // Subtract Packed Single-Precision Floating-Point Values
 
 Mnemonic_TEST,                          // Logical Compare
 
@@ -345,10 +345,13 @@ extern "C" ENCODER_DECLARE_EXPORT char * encoder_imm_reg(Mnemonic m, OpndSize si
                    int imm, int reg, bool isPhysical, LowOpndRegType type, char * stream) {
     EncoderBase::Operands args;
     add_r(args, reg, size); //dst
-    if(m == Mnemonic_IMUL) add_r(args, reg, size); //src CHECK
+    if(m == Mnemonic_IMUL || m == Mnemonic_PSHUFD) add_r(args, reg, size); //src CHECK
     if(m == Mnemonic_SAL || m == Mnemonic_SHR || m == Mnemonic_SHL
        || m == Mnemonic_SAR || m == Mnemonic_ROR)  //fix for shift opcodes
       add_imm(args, OpndSize_8, imm, true/*is_signed*/);
+    else if(m == Mnemonic_PSHUFD || m == Mnemonic_PSLLD
+            || m == Mnemonic_PSRLD || m == Mnemonic_PSRAD) //packed ops take imm8
+      add_imm(args, OpndSize_8, imm, false/*is_signed*/);
     else
       add_imm(args, size, imm, true/*is_signed*/);
     char* stream_start = stream;
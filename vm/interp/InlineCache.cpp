@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Interpreter inline cache for invoke-interface.
+ *
+ * Finding the target of an interface call means searching the receiver's
+ * iftable for the interface, on every call.  Most call sites only ever see
+ * one receiver class, so each site gets a slot in a direct-mapped side
+ * table, indexed by the address of the invoke, holding the last receiver
+ * class and its target method (see dvmFindInterfaceMethodAtCallSite).
+ * Sites that hash to the same slot just take it over from each other.
+ *
+ * The slots also count misses, which tells the JIT which call sites are
+ * polymorphic.  Hits are only counted up to INLINE_CACHE_HIT_LIMIT after
+ * each miss, so a call site that keeps hitting doesn't store to the shared
+ * table on every call; a full run of hits pays back older misses.
+ */
+#include "Dalvik.h"
+#include "interp/InterpDefs.h"
+#include "mterp/common/FindInterface.h"
+
+#define ATOMIC_LOCK_FLAG        (1 << 31)
+
+/*
+ * A site is treated as polymorphic once it has missed this often.  After
+ * the first call a site only misses when the receiver class changes.
+ */
+#define kInlineCachePolyMisses  8
+
+/* Each miss is forgiven after this many hits */
+#define kInlineCacheHitsPerMiss (INLINE_CACHE_HIT_LIMIT / kInlineCachePolyMisses)
+
+InlineCacheEntry gDvmInlineCache[INLINE_CACHE_SIZE];
+
+/*
+ * Do the full lookup and update the slot, following the same protocol as
+ * dvmUpdateAtomicCache.  If another thread is updating the slot we leave it
+ * alone; the next call will try again.
+ */
+Method* dvmInlineCacheMiss(ClassObject* thisClass, u4 methodIdx,
+    const Method* method, DvmDex* methodClassDex, const u2* pc,
+    u4 firstVersion)
+{
+    InlineCacheEntry* pEntry = dvmInlineCacheEntry(pc);
+    Method* methodToCall;
+
+    methodToCall = dvmFindInterfaceMethodInCache(thisClass, methodIdx, method,
+                        methodClassDex);
+    if (methodToCall == NULL)
+        return NULL;
+
+    if ((firstVersion & ATOMIC_LOCK_FLAG) != 0 ||
+        android_atomic_release_cas(
+                firstVersion, firstVersion | ATOMIC_LOCK_FLAG,
+                (volatile s4*) &pEntry->version) != 0)
+    {
+        return methodToCall;
+    }
+
+    u4 newVersion = (firstVersion | ATOMIC_LOCK_FLAG) + 1;
+    assert((newVersion & 0x01) == 1);
+    pEntry->version = newVersion;
+
+    if (pEntry->pc != pc) {
+        /* the slot changes hands, the old site's profile goes with it */
+        pEntry->misses = 0;
+    } else {
+        /* decay the misses by the hits seen since the last one */
+        u4 paid = pEntry->hits / kInlineCacheHitsPerMiss;
+        pEntry->misses = (pEntry->misses > paid) ? pEntry->misses - paid : 0;
+    }
+    if (pEntry->misses != kInlineCachePolyMisses)
+        pEntry->misses++;
+    pEntry->hits = 0;
+
+    android_atomic_release_store((int32_t) pc, (int32_t*) &pEntry->pc);
+    pEntry->clazz = thisClass;
+    pEntry->method = methodToCall;
+
+    newVersion++;
+    android_atomic_release_store(newVersion, (int32_t*) &pEntry->version);
+
+    if (android_atomic_release_cas(
+            newVersion, newVersion & ~ATOMIC_LOCK_FLAG,
+            (volatile s4*) &pEntry->version) != 0)
+    {
+        ALOGE("unable to reset the inline cache ownership");
+        dvmAbort();
+    }
+
+    return methodToCall;
+}
+
+/* Racy reads of the counts are fine, the answer is only a hint */
+static bool isPolymorphic(const InlineCacheEntry* pEntry)
+{
+    return pEntry->misses >= kInlineCachePolyMisses;
+}
+
+bool dvmInlineCacheIsPolymorphic(const u2* pc)
+{
+    const InlineCacheEntry* pEntry = dvmInlineCacheEntry(pc);
+
+    return pEntry->pc == pc && isPolymorphic(pEntry);
+}
+
+void dvmInlineCacheDumpStats(void)
+{
+    int sites = 0, polySites = 0, hits = 0, misses = 0;
+
+    for (int i = 0; i < INLINE_CACHE_SIZE; i++) {
+        const InlineCacheEntry* pEntry = &gDvmInlineCache[i];
+        if (pEntry->pc == NULL)
+            continue;
+        sites++;
+        hits += pEntry->hits;
+        misses += pEntry->misses;
+        if (isPolymorphic(pEntry))
+            polySites++;
+    }
+    ALOGD("Interp IC: %d call sites (%d polymorphic), %d recent hits, "
+          "%d recent misses", sites, polySites, hits, misses);
+}
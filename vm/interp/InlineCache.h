@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Interpreter inline cache for invoke-interface call sites.
+ */
+#ifndef DALVIK_INTERP_INLINECACHE_H_
+#define DALVIK_INTERP_INLINECACHE_H_
+
+/*
+ * One slot of the side table.  A slot belongs to the invoke instruction at
+ * "pc" and remembers the receiver class it saw last with the method that
+ * class dispatched to.  The fields are updated with the AtomicCache
+ * versioning protocol: "version" is odd while an update is in progress.
+ *
+ * The miss count is updated by the thread that owns the slot for the
+ * update.  The hit count only covers the hits since the last miss and
+ * stops at INLINE_CACHE_HIT_LIMIT, so a site that settles on one class
+ * stops writing to its slot.  Both are only used as a profile.
+ */
+struct InlineCacheEntry {
+    const u2*           pc;
+    const ClassObject*  clazz;
+    const Method*       method;
+    volatile u4         version;
+    u4                  hits;
+    u4                  misses;
+};
+
+/* Number of slots, must be a power of 2 */
+#define INLINE_CACHE_SIZE   1024
+
+/* Hits counted between two misses */
+#define INLINE_CACHE_HIT_LIMIT  64
+
+extern InlineCacheEntry gDvmInlineCache[INLINE_CACHE_SIZE];
+
+/*
+ * Slot used by the invoke at "pc".  Dex code is 2-byte aligned.
+ */
+INLINE InlineCacheEntry* dvmInlineCacheEntry(const u2* pc)
+{
+    return &gDvmInlineCache[((u4) pc >> 1) & (INLINE_CACHE_SIZE - 1)];
+}
+
+/*
+ * Do the full lookup for a call that missed the slot, and make the slot
+ * remember the result.  "firstVersion" is the version read before the
+ * slot was examined.
+ *
+ * Returns NULL with an exception raised on failure.
+ */
+Method* dvmInlineCacheMiss(ClassObject* thisClass, u4 methodIdx,
+    const Method* method, DvmDex* methodClassDex, const u2* pc,
+    u4 firstVersion);
+
+/*
+ * Returns "true" if the invoke at "pc" has been seen with a mix of receiver
+ * classes often enough that guarding on a single class would not pay off.
+ * Used by the JIT when deciding whether to inline the callee.
+ */
+bool dvmInlineCacheIsPolymorphic(const u2* pc);
+
+/*
+ * Log the number of call sites using the cache and their recent hits and
+ * misses.
+ */
+void dvmInlineCacheDumpStats(void);
+
+#endif  // DALVIK_INTERP_INLINECACHE_H_
@@ -267,7 +267,7 @@ void dvmCheckSelfVerification(const u2* pc, Thread* self)
     SelfVerificationState state = shadowSpace->selfVerificationState;
 
     DecodedInstruction decInsn;
-    dexDecodeInstruction(pc, &decInsn);
+    dexDecodeUnfusedInstruction(pc, &decInsn);
 
     //ALOGD("### DbgIntp(%d): PC: %#x endPC: %#x state: %d len: %d %s",
     //    self->threadId, (int)pc, (int)shadowSpace->endPC, state,
@@ -484,7 +484,7 @@ void dvmJitStats()
                     stubs++;
             } else
                 not_hit++;
-            if (gDvmJit.pJitEntryTable[i].u.info.chain != gDvmJit.jitTableSize)
+            if (gDvmJit.pJitEntryTable[i].u.info.chain != JIT_ENTRY_CHAIN_END)
                 chains++;
         }
         ALOGD("JIT: table size is %d, entries used is %d",
@@ -500,6 +500,19 @@ void dvmJitStats()
              gDvmJit.addrLookupsFound, gDvmJit.addrLookupsNotFound,
              gDvmJit.normalExit, gDvmJit.puntExit);
 
+        ALOGD("JIT: Lookup probes: %d x1, %d x2, %d x3, %d x4, %d x5, "
+             "%d x6, %d x7, %d x8+",
+             gDvmJit.addrLookupProbes[0], gDvmJit.addrLookupProbes[1],
+             gDvmJit.addrLookupProbes[2], gDvmJit.addrLookupProbes[3],
+             gDvmJit.addrLookupProbes[4], gDvmJit.addrLookupProbes[5],
+             gDvmJit.addrLookupProbes[6], gDvmJit.addrLookupProbes[7]);
+
+        ALOGD("JIT: Table resizes: %d, %d entries migrated, "
+             "%d old-table lookups%s",
+             gDvmJit.jitTableResizes, gDvmJit.jitTableEntriesMigrated,
+             gDvmJit.addrLookupsOldTable,
+             gDvmJit.pJitEntryTableOld ? " (migration in progress)" : "");
+
         ALOGD("JIT: ICHits: %d", gDvmICHitCount);
 
         ALOGD("JIT: noChainExit: %d IC miss, %d interp callsite, "
@@ -513,6 +526,12 @@ void dvmJitStats()
              gDvmJit.icPatchInit, gDvmJit.icPatchRejected,
              gDvmJit.icPatchLockFree, gDvmJit.icPatchQueued,
              gDvmJit.icPatchDropped);
+        ALOGD("JIT: ICPatch: %d kept polymorphic, %d megamorphic, "
+             "%d untracked sites",
+             gDvmJit.icPatchKept, gDvmJit.icPatchMegamorphic,
+             gDvmJit.icProfileOverflow);
+        dvmJitDumpReceiverProfiles();
+        dvmInlineCacheDumpStats();
 
         ALOGD("JIT: Invoke: %d mono, %d poly, %d native, %d return",
              gDvmJit.invokeMonomorphic, gDvmJit.invokePolymorphic,
@@ -520,6 +539,21 @@ void dvmJitStats()
         ALOGD("JIT: Inline: %d mgetter, %d msetter, %d pgetter, %d psetter",
              gDvmJit.invokeMonoGetterInlined, gDvmJit.invokeMonoSetterInlined,
              gDvmJit.invokePolyGetterInlined, gDvmJit.invokePolySetterInlined);
+        ALOGD("JIT: Inline: %d mstraight-line, %d pstraight-line, "
+             "%d constructor",
+             gDvmJit.invokeMonoStraightLineInlined,
+             gDvmJit.invokePolyStraightLineInlined,
+             gDvmJit.invokeConstructorInlined);
+        ALOGD("JIT: Redundant loads eliminated: %d",
+             gDvmJit.redundantLoadsEliminated);
+        ALOGD("JIT: Loop invariants hoisted: %d",
+             gDvmJit.loopInvariantsHoisted);
+        ALOGD("JIT: Allocations eliminated: %d",
+             gDvmJit.allocationsEliminated);
+        ALOGD("JIT: Loops vectorized: %d", gDvmJit.loopsVectorized);
+        ALOGD("JIT: Loop VRs kept in registers: %d", gDvmJit.loopGlobalVRs);
+        ALOGD("JIT: Spills: %d VR stores, %d temporaries",
+             gDvmJit.vrSpillStores, gDvmJit.tempSpills);
         ALOGD("JIT: Total compilation time: %llu ms", gDvmJit.jitTime / 1000);
         ALOGD("JIT: Avg unit compilation time: %llu us",
              gDvmJit.numCompilations == 0 ? 0 :
@@ -538,6 +572,12 @@ void dvmJitStats()
         if (gDvmJit.profileMode == kTraceProfilingContinuous) {
             dvmCompilerSortAndPrintTraceProfiles();
         }
+        if (gDvmJit.exitProfile) {
+            dvmJitDumpTraceExits();
+        }
+        if (gDvmJit.tieredCompilation || gDvmJit.compileBudget != 0) {
+            dvmCompilerDumpTierStats();
+        }
     }
 }
 
@@ -555,106 +595,194 @@ void dvmJitEndTraceSelect(Thread* self, const u2* dPC)
 }
 
 /*
- * Find an entry in the JitTable, creating if necessary.
- * Returns null if table is full.
+ * Walk a single JitTable bucket chain looking for dPC.  Lock-free.  The
+ * chain terminator is a size-independent constant, so even if "mask" is
+ * stale with respect to "table" the walk stays in bounds; the worst case
+ * is a spurious miss.  "probes" is bumped once per entry visited.
  */
-static JitEntry *lookupAndAdd(const u2* dPC, bool callerLocked,
-                              bool isMethodEntry)
+static inline JitEntry *probeJitTable(JitEntry *table, u4 mask,
+                                      const u2* dPC, bool isMethodEntry,
+                                      int *probes)
+{
+    u4 idx = dvmJitHashMask(dPC, mask);
+    while (true) {
+        (*probes)++;
+        if ((table[idx].dPC == dPC) &&
+            (table[idx].u.info.isMethodEntry == isMethodEntry))
+            return &table[idx];
+        if (table[idx].u.info.chain == JIT_ENTRY_CHAIN_END)
+            return NULL;
+        idx = table[idx].u.info.chain;
+    }
+}
+
+/*
+ * Lock-free lookup of dPC in the active JitTable and, if a resize is in
+ * flight, in the table being drained.  dvmJitResizeJitTable publishes a
+ * new table before its wider mask, so loading the mask first (with
+ * acquire semantics) guarantees it never exceeds the table we then read.
+ */
+static inline JitEntry *lookupEntry(const u2* dPC, bool isMethodEntry)
+{
+    int probes = 0;
+    u4 mask = android_atomic_acquire_load(
+                  (volatile int32_t *)(void *)&gDvmJit.jitTableMask);
+    JitEntry *entry = probeJitTable(gDvmJit.pJitEntryTable, mask, dPC,
+                                    isMethodEntry, &probes);
+    if (entry == NULL && gDvmJit.pJitEntryTableOld != NULL) {
+        /* Pairs with the barrier ahead of publishing the new table */
+        ANDROID_MEMBAR_FULL();
+        JitEntry *oldTable = gDvmJit.pJitEntryTableOld;
+        if (oldTable != NULL) {
+            entry = probeJitTable(oldTable, gDvmJit.jitTableMaskOld, dPC,
+                                  isMethodEntry, &probes);
+#if defined(WITH_JIT_TUNING)
+            gDvmJit.addrLookupsOldTable++;
+#endif
+        }
+    }
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.addrLookupProbes[MIN(probes, JIT_PROBE_HISTOGRAM_SIZE) - 1]++;
+#endif
+    return entry;
+}
+
+/*
+ * Claim a free slot for dPC in the active JitTable and make it live.
+ * If "src" is non-null its code address and info bits are carried over
+ * (used when migrating from the old table).  Caller must hold tableLock
+ * and must already have checked that dPC is not present.  Returns null if
+ * the table is full.
+ */
+static JitEntry *addEntryLocked(const u2* dPC, bool isMethodEntry,
+                                const JitEntry *src)
 {
-    u4 chainEndMarker = gDvmJit.jitTableSize;
+    JitEntry *table = gDvmJit.pJitEntryTable;
+    u4 size = gDvmJit.jitTableSize;
     u4 idx = dvmJitHash(dPC);
+    u4 prev = JIT_ENTRY_CHAIN_END;
+
+    if (table[idx].dPC != NULL) {
+        /* Find the tail of the bucket chain */
+        while (table[idx].u.info.chain != JIT_ENTRY_CHAIN_END) {
+            idx = table[idx].u.info.chain;
+        }
+        /* Linear walk to find a free cell to append */
+        prev = idx;
+        while (true) {
+            idx++;
+            if (idx == size)
+                idx = 0;  /* Wraparound */
+            if ((table[idx].dPC == NULL) || (idx == prev))
+                break;
+        }
+        if (idx == prev) {
+            /* Table is full */
+            return NULL;
+        }
+    }
 
     /*
-     * Walk the bucket chain to find an exact match for our PC and trace/method
-     * type
+     * Nobody can match the slot until dPC is set, but lock-free readers
+     * may still walk through it, so the info word (and with it the chain
+     * terminator) is written in one store.  codeAddress must be in place
+     * before dPC makes the entry live.
      */
-    while ((gDvmJit.pJitEntryTable[idx].u.info.chain != chainEndMarker) &&
-           ((gDvmJit.pJitEntryTable[idx].dPC != dPC) ||
-            (gDvmJit.pJitEntryTable[idx].u.info.isMethodEntry !=
-             isMethodEntry))) {
-        idx = gDvmJit.pJitEntryTable[idx].u.info.chain;
+    JitEntryInfoUnion info;
+    if (src != NULL) {
+        info = src->u;
+    } else {
+        info.infoWord = 0;
     }
-
-    if (gDvmJit.pJitEntryTable[idx].dPC != dPC ||
-        gDvmJit.pJitEntryTable[idx].u.info.isMethodEntry != isMethodEntry) {
+    info.info.isMethodEntry = isMethodEntry;
+    info.info.chain = JIT_ENTRY_CHAIN_END;
+    table[idx].u.infoWord = info.infoWord;
+    table[idx].codeAddress = (src != NULL) ? src->codeAddress : NULL;
+    ANDROID_MEMBAR_FULL();
+    table[idx].dPC = dPC;
+
+    if (prev != JIT_ENTRY_CHAIN_END) {
+        JitEntryInfoUnion oldValue;
+        JitEntryInfoUnion newValue;
         /*
-         * No match.  Aquire jitTableLock and find the last
-         * slot in the chain. Possibly continue the chain walk in case
-         * some other thread allocated the slot we were looking
-         * at previuosly (perhaps even the dPC we're trying to enter).
+         * Although we hold the lock so that noone else will
+         * be trying to update a chain field, the other fields
+         * packed into the word may be in use by other threads.
          */
-        if (!callerLocked)
-            dvmLockMutex(&gDvmJit.tableLock);
-        /*
-         * At this point, if .dPC is NULL, then the slot we're
-         * looking at is the target slot from the primary hash
-         * (the simple, and common case).  Otherwise we're going
-         * to have to find a free slot and chain it.
-         */
-        ANDROID_MEMBAR_FULL(); /* Make sure we reload [].dPC after lock */
-        if (gDvmJit.pJitEntryTable[idx].dPC != NULL) {
-            u4 prev;
-            while (gDvmJit.pJitEntryTable[idx].u.info.chain != chainEndMarker) {
-                if (gDvmJit.pJitEntryTable[idx].dPC == dPC &&
-                    gDvmJit.pJitEntryTable[idx].u.info.isMethodEntry ==
-                        isMethodEntry) {
-                    /* Another thread got there first for this dPC */
-                    if (!callerLocked)
-                        dvmUnlockMutex(&gDvmJit.tableLock);
-                    return &gDvmJit.pJitEntryTable[idx];
-                }
-                idx = gDvmJit.pJitEntryTable[idx].u.info.chain;
-            }
-            /* Here, idx should be pointing to the last cell of an
-             * active chain whose last member contains a valid dPC */
-            assert(gDvmJit.pJitEntryTable[idx].dPC != NULL);
-            /* Linear walk to find a free cell and add it to the end */
-            prev = idx;
-            while (true) {
-                idx++;
-                if (idx == chainEndMarker)
-                    idx = 0;  /* Wraparound */
-                if ((gDvmJit.pJitEntryTable[idx].dPC == NULL) ||
-                    (idx == prev))
-                    break;
-            }
-            if (idx != prev) {
-                JitEntryInfoUnion oldValue;
-                JitEntryInfoUnion newValue;
-                /*
-                 * Although we hold the lock so that noone else will
-                 * be trying to update a chain field, the other fields
-                 * packed into the word may be in use by other threads.
-                 */
-                do {
-                    oldValue = gDvmJit.pJitEntryTable[prev].u;
-                    newValue = oldValue;
-                    newValue.info.chain = idx;
-                } while (android_atomic_release_cas(oldValue.infoWord,
-                        newValue.infoWord,
-                        &gDvmJit.pJitEntryTable[prev].u.infoWord) != 0);
-            }
-        }
-        if (gDvmJit.pJitEntryTable[idx].dPC == NULL) {
-            gDvmJit.pJitEntryTable[idx].u.info.isMethodEntry = isMethodEntry;
-            /*
-             * Initialize codeAddress and allocate the slot.  Must
-             * happen in this order (since dPC is set, the entry is live.
-             */
-            android_atomic_release_store((int32_t)dPC,
-                 (volatile int32_t *)(void *)&gDvmJit.pJitEntryTable[idx].dPC);
-            /* for simulator mode, we need to initialized codeAddress to null */
-            gDvmJit.pJitEntryTable[idx].codeAddress = NULL;
-            gDvmJit.pJitEntryTable[idx].dPC = dPC;
-            gDvmJit.jitTableEntriesUsed++;
-        } else {
-            /* Table is full */
-            idx = chainEndMarker;
-        }
-        if (!callerLocked)
-            dvmUnlockMutex(&gDvmJit.tableLock);
+        do {
+            oldValue = table[prev].u;
+            newValue = oldValue;
+            newValue.info.chain = idx;
+        } while (android_atomic_release_cas(oldValue.infoWord,
+                newValue.infoWord, &table[prev].u.infoWord) != 0);
+    }
+    gDvmJit.jitTableEntriesUsed++;
+    return &table[idx];
+}
+
+/*
+ * Copy a live entry of the old table into the active one unless an
+ * earlier lookup already pulled it over.  Caller must hold tableLock.
+ */
+static JitEntry *migrateEntryLocked(const JitEntry *oldEntry)
+{
+    int probes = 0;
+    JitEntry *entry = probeJitTable(gDvmJit.pJitEntryTable,
+                                    gDvmJit.jitTableMask, oldEntry->dPC,
+                                    oldEntry->u.info.isMethodEntry, &probes);
+    if (entry == NULL) {
+        entry = addEntryLocked(oldEntry->dPC, oldEntry->u.info.isMethodEntry,
+                               oldEntry);
+#if defined(WITH_JIT_TUNING)
+        gDvmJit.jitTableEntriesMigrated++;
+#endif
+    }
+    return entry;
+}
+
+/*
+ * Find an entry in the JitTable, creating if necessary.
+ * Returns null if table is full.  The returned entry always lives in the
+ * active table: an entry still sitting in the table being drained by a
+ * resize is migrated first, so that later updates are not lost.
+ */
+static JitEntry *lookupAndAdd(const u2* dPC, bool callerLocked,
+                              bool isMethodEntry)
+{
+    JitEntry *entry;
+    int probes = 0;
+
+    if (!callerLocked) {
+        /* Fast path: already present in the active table */
+        u4 mask = android_atomic_acquire_load(
+                      (volatile int32_t *)(void *)&gDvmJit.jitTableMask);
+        entry = probeJitTable(gDvmJit.pJitEntryTable, mask, dPC,
+                              isMethodEntry, &probes);
+        if (entry != NULL)
+            return entry;
+        dvmLockMutex(&gDvmJit.tableLock);
     }
-    return (idx == chainEndMarker) ? NULL : &gDvmJit.pJitEntryTable[idx];
+
+    /*
+     * Table pointer and mask are stable while we hold the lock.  Redo
+     * the walk in case another thread allocated the slot (perhaps even
+     * for the dPC we're trying to enter) since we last looked.
+     */
+    entry = probeJitTable(gDvmJit.pJitEntryTable, gDvmJit.jitTableMask, dPC,
+                          isMethodEntry, &probes);
+    if (entry == NULL && gDvmJit.pJitEntryTableOld != NULL) {
+        JitEntry *oldEntry = probeJitTable(gDvmJit.pJitEntryTableOld,
+                                           gDvmJit.jitTableMaskOld, dPC,
+                                           isMethodEntry, &probes);
+        if (oldEntry != NULL)
+            entry = migrateEntryLocked(oldEntry);
+    }
+    if (entry == NULL)
+        entry = addEntryLocked(dPC, isMethodEntry, NULL);
+
+    if (!callerLocked)
+        dvmUnlockMutex(&gDvmJit.tableLock);
+    return entry;
 }
 
 /* Dump a trace description */
@@ -741,7 +869,7 @@ static void insertMoveResult(const u2 *lastPC, int len, int offset,
     DecodedInstruction nextDecInsn;
     const u2 *moveResultPC = lastPC + len;
 
-    dexDecodeInstruction(moveResultPC, &nextDecInsn);
+    dexDecodeUnfusedInstruction(moveResultPC, &nextDecInsn);
     if ((nextDecInsn.opcode != OP_MOVE_RESULT) &&
         (nextDecInsn.opcode != OP_MOVE_RESULT_WIDE) &&
         (nextDecInsn.opcode != OP_MOVE_RESULT_OBJECT))
@@ -760,6 +888,110 @@ static void insertMoveResult(const u2 *lastPC, int len, int offset,
     self->currRunLen = dexGetWidthFromInstruction(moveResultPC);
 }
 
+/* Longest run of instructions appended after a constructor call */
+#define MAX_INIT_CONTINUATION_LEN 16
+
+/*
+ * Can the instruction be compiled without anything having to be resolved at
+ * runtime?  Sets *endsRun if it has to be the last one of the run.
+ */
+static bool isContinuationInsn(const Method *method,
+                               const DecodedInstruction *insn, bool *endsRun)
+{
+    Opcode opcode = insn->opcode;
+
+    *endsRun = false;
+#if TRACE_OPCODE_FILTER
+    if (!dvmIsOpcodeSupportedByJit(opcode))
+        return false;
+#endif
+    if ((opcode >= OP_MOVE && opcode <= OP_MOVE_OBJECT_16) ||
+        (opcode >= OP_CONST_4 && opcode <= OP_CONST_WIDE_HIGH16) ||
+        (opcode >= OP_CMPL_FLOAT && opcode <= OP_CMP_LONG) ||
+        (opcode >= OP_AGET && opcode <= OP_APUT_SHORT) ||
+        (opcode >= OP_NEG_INT && opcode <= OP_USHR_INT_LIT8) ||
+        (opcode >= OP_IGET_QUICK && opcode <= OP_IPUT_OBJECT_QUICK) ||
+        opcode == OP_ARRAY_LENGTH) {
+        return true;
+    }
+    if (opcode >= OP_IGET && opcode <= OP_IPUT_SHORT) {
+        /* The trace compiler expects the field to be resolved */
+        return method->clazz->pDvmDex->pResFields[insn->vC] != NULL;
+    }
+    if ((opcode >= OP_IF_EQ && opcode <= OP_IF_LEZ) ||
+        (opcode >= OP_GOTO && opcode <= OP_GOTO_32) ||
+        (opcode >= OP_RETURN_VOID && opcode <= OP_RETURN_OBJECT) ||
+        opcode == OP_RETURN_VOID_BARRIER) {
+        *endsRun = true;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * If the invoke is a constructor call, add the straight-line code that
+ * follows it to the trace as well:
+ *
+ *  + trace run that ends with the invoke (existing entry)
+ *  + thisClass (existing entry)
+ *  + calleeMethod (existing entry)
+ *  + continuation (new)
+ *
+ * Without it the trace would end right after "new Foo(...)" and the new
+ * object would always escape into the interpreter before it is used, which
+ * leaves nothing for the compiler to work with once the constructor is
+ * inlined.  The run is built statically like the move-result above and stops
+ * at the first instruction that might need resolution or leave the trace.
+ *
+ * lastPC, len, offset are all from the preceding invoke instruction
+ */
+static void insertInitContinuation(const u2 *lastPC, int len, int offset,
+                                   const Method *calleeMethod, Thread *self)
+{
+    const Method *method = self->traceMethod;
+    const u2 *pc = lastPC + len;
+    const u2 *codeEnd = method->insns + dvmGetMethodInsnsSize(method);
+    int numInsts = 0;
+    int runLen = 0;
+    bool endsRun = false;
+
+    if (calleeMethod == NULL || !dvmIsConstructorMethod(calleeMethod) ||
+        dvmIsNativeMethod(calleeMethod)) {
+        return;
+    }
+
+    /* Leave room for the end-of-trace marker */
+    if (self->currTraceRun + 2 >= MAX_JIT_RUN_LEN)
+        return;
+
+    while (!endsRun && pc + runLen < codeEnd &&
+           numInsts < MAX_INIT_CONTINUATION_LEN &&
+           self->totalTraceLen + numInsts < JIT_MAX_TRACE_LEN) {
+        DecodedInstruction insn;
+
+        dexDecodeUnfusedInstruction(pc + runLen, &insn);
+        if (!isContinuationInsn(method, &insn, &endsRun))
+            break;
+        runLen += dexGetWidthFromInstruction(pc + runLen);
+        numInsts++;
+    }
+
+    if (numInsts == 0)
+        return;
+
+    /* We need to start a new trace run */
+    int currTraceRun = ++self->currTraceRun;
+    self->currRunHead = pc;
+    self->trace[currTraceRun].info.frag.startOffset = offset + len;
+    self->trace[currTraceRun].info.frag.numInsts = numInsts;
+    self->trace[currTraceRun].info.frag.runEnd = false;
+    self->trace[currTraceRun].info.frag.hint = kJitHintNone;
+    self->trace[currTraceRun].isCode = true;
+    self->totalTraceLen += numInsts;
+
+    self->currRunLen = runLen;
+}
+
 /*
  * Adds to the current trace request one instruction at a time, just
  * before that instruction is interpreted.  This is the primary trace
@@ -797,7 +1029,7 @@ void dvmCheckJit(const u2* pc, Thread* self)
             /* First instruction - just remember the PC and exit */
             if (lastPC == NULL) break;
             /* Grow the trace around the last PC if jitState is kJitTSelect */
-            dexDecodeInstruction(lastPC, &decInsn);
+            dexDecodeUnfusedInstruction(lastPC, &decInsn);
 #if TRACE_OPCODE_FILTER
             /* Only add JIT support opcode to trace. End the trace if
              * this opcode is not supported.
@@ -879,6 +1111,11 @@ void dvmCheckJit(const u2* pc, Thread* self)
                     insertClassMethodInfo(self, thisClass, curMethod,
                                           &decInsn);
                     insertMoveResult(lastPC, len, offset, self);
+                    if (decInsn.opcode == OP_INVOKE_DIRECT ||
+                        decInsn.opcode == OP_INVOKE_DIRECT_RANGE) {
+                        insertInitContinuation(lastPC, len, offset,
+                                               curMethod, self);
+                    }
                 }
             }
             /* Break on throw or self-loop */
@@ -1000,23 +1237,7 @@ void dvmCheckJit(const u2* pc, Thread* self)
 
 JitEntry *dvmJitFindEntry(const u2* pc, bool isMethodEntry)
 {
-    int idx = dvmJitHash(pc);
-
-    /* Expect a high hit rate on 1st shot */
-    if ((gDvmJit.pJitEntryTable[idx].dPC == pc) &&
-        (gDvmJit.pJitEntryTable[idx].u.info.isMethodEntry == isMethodEntry))
-        return &gDvmJit.pJitEntryTable[idx];
-    else {
-        int chainEndMarker = gDvmJit.jitTableSize;
-        while (gDvmJit.pJitEntryTable[idx].u.info.chain != chainEndMarker) {
-            idx = gDvmJit.pJitEntryTable[idx].u.info.chain;
-            if ((gDvmJit.pJitEntryTable[idx].dPC == pc) &&
-                (gDvmJit.pJitEntryTable[idx].u.info.isMethodEntry ==
-                isMethodEntry))
-                return &gDvmJit.pJitEntryTable[idx];
-        }
-    }
-    return NULL;
+    return lookupEntry(pc, isMethodEntry);
 }
 
 /*
@@ -1025,41 +1246,17 @@ JitEntry *dvmJitFindEntry(const u2* pc, bool isMethodEntry)
  */
 void* getCodeAddrCommon(const u2* dPC, bool methodEntry)
 {
-    int idx = dvmJitHash(dPC);
-    const u2* pc = gDvmJit.pJitEntryTable[idx].dPC;
-    if (pc != NULL) {
+    JitEntry *entry = lookupEntry(dPC, methodEntry);
+    if (entry != NULL) {
         bool hideTranslation = dvmJitHideTranslation();
-        if (pc == dPC &&
-            gDvmJit.pJitEntryTable[idx].u.info.isMethodEntry == methodEntry) {
-            int offset = (gDvmJit.profileMode >= kTraceProfilingContinuous) ?
-                 0 : gDvmJit.pJitEntryTable[idx].u.info.profileOffset;
-            intptr_t codeAddress =
-                (intptr_t)gDvmJit.pJitEntryTable[idx].codeAddress;
+        int offset = (gDvmJit.profileMode >= kTraceProfilingContinuous) ?
+             0 : entry->u.info.profileOffset;
+        intptr_t codeAddress = (intptr_t)entry->codeAddress;
 #if defined(WITH_JIT_TUNING)
-            gDvmJit.addrLookupsFound++;
+        gDvmJit.addrLookupsFound++;
 #endif
-            return hideTranslation || !codeAddress ?  NULL :
-                  (void *)(codeAddress + offset);
-        } else {
-            int chainEndMarker = gDvmJit.jitTableSize;
-            while (gDvmJit.pJitEntryTable[idx].u.info.chain != chainEndMarker) {
-                idx = gDvmJit.pJitEntryTable[idx].u.info.chain;
-                if (gDvmJit.pJitEntryTable[idx].dPC == dPC &&
-                    gDvmJit.pJitEntryTable[idx].u.info.isMethodEntry ==
-                        methodEntry) {
-                    int offset = (gDvmJit.profileMode >=
-                        kTraceProfilingContinuous) ? 0 :
-                        gDvmJit.pJitEntryTable[idx].u.info.profileOffset;
-                    intptr_t codeAddress =
-                        (intptr_t)gDvmJit.pJitEntryTable[idx].codeAddress;
-#if defined(WITH_JIT_TUNING)
-                    gDvmJit.addrLookupsFound++;
-#endif
-                    return hideTranslation || !codeAddress ? NULL :
-                        (void *)(codeAddress + offset);
-                }
-            }
-        }
+        return hideTranslation || !codeAddress ?  NULL :
+              (void *)(codeAddress + offset);
     }
 #if defined(WITH_JIT_TUNING)
     gDvmJit.addrLookupsNotFound++;
@@ -1123,14 +1320,17 @@ void dvmJitSetCodeAddr(const u2* dPC, void *nPC, JitInstructionSetType set,
 {
     JitEntryInfoUnion oldValue;
     JitEntryInfoUnion newValue;
+
+    dvmLockMutex(&gDvmJit.tableLock);
     /*
      * Get the JitTable slot for this dPC (or create one if JitTable
      * has been reset between the time the trace was requested and
-     * now.
+     * now.  Holding tableLock across the update keeps an incremental
+     * resize from copying the entry while it is being modified, and
+     * guarantees a trace entry still in the old table is migrated first.
      */
-    JitEntry *jitEntry = isMethodEntry ?
-        lookupAndAdd(dPC, false /* caller holds tableLock */, isMethodEntry) :
-                     dvmJitFindEntry(dPC, isMethodEntry);
+    JitEntry *jitEntry = lookupAndAdd(dPC, true /* caller holds tableLock */,
+                                      isMethodEntry);
     assert(jitEntry);
     /* Note: order of update is important */
     do {
@@ -1143,6 +1343,7 @@ void dvmJitSetCodeAddr(const u2* dPC, void *nPC, JitInstructionSetType set,
              oldValue.infoWord, newValue.infoWord,
              &jitEntry->u.infoWord) != 0);
     jitEntry->codeAddress = nPC;
+    dvmUnlockMutex(&gDvmJit.tableLock);
 }
 
 /*
@@ -1303,77 +1504,168 @@ void dvmJitCheckTraceRequest(Thread* self)
     }
 }
 
+/*
+ * Clear a JitTable to the unpopulated state.
+ */
+static void clearJitTable(JitEntry *table, unsigned int size)
+{
+    unsigned int i;
+
+    memset((void *) table, 0, sizeof(JitEntry) * size);
+    for (i=0; i < size; i++) {
+        table[i].u.info.chain = JIT_ENTRY_CHAIN_END;
+    }
+}
+
 /*
  * Resizes the JitTable.  Must be a power of 2, and returns true on failure.
- * Stops all threads, and thus is a heavyweight operation. May only be called
- * by the compiler thread.
+ * May only be called by the compiler thread.
+ *
+ * Nothing is copied here: the current table becomes the "old" table and
+ * lookups that miss in the new one fall back to it.  Its entries are then
+ * moved over a batch at a time by dvmJitMigrateJitTable, so mutator
+ * threads never have to be stopped.  A new resize cannot start until the
+ * previous old table has been drained and released at a safe point, and
+ * asking for one before then fails.
  */
 bool dvmJitResizeJitTable( unsigned int size )
 {
     JitEntry *pNewTable;
-    JitEntry *pOldTable;
-    JitEntry tempEntry;
-    unsigned int oldSize;
-    unsigned int i;
 
     assert(gDvmJit.pJitEntryTable != NULL);
     assert(size && !(size & (size - 1)));   /* Is power of 2? */
 
-    ALOGI("Jit: resizing JitTable from %d to %d", gDvmJit.jitTableSize, size);
-
     if (size <= gDvmJit.jitTableSize) {
         return true;
     }
 
     /* Make sure requested size is compatible with chain field width */
-    tempEntry.u.info.chain = size;
-    if (tempEntry.u.info.chain != size) {
+    if (size > JIT_ENTRY_CHAIN_END) {
         ALOGD("Jit: JitTable request of %d too big", size);
         return true;
     }
 
-    pNewTable = (JitEntry*)calloc(size, sizeof(*pNewTable));
-    if (pNewTable == NULL) {
+    if (gDvmJit.pJitEntryTableOld != NULL ||
+        gDvmJit.pJitEntryTableRetired != NULL) {
+        ALOGD("Jit: JitTable resize while the previous one is pending");
         return true;
     }
-    for (i=0; i< size; i++) {
-        pNewTable[i].u.info.chain = size;  /* Initialize chain termination */
-    }
 
-    /* Stop all other interpreting/jit'ng threads */
-    dvmSuspendAllThreads(SUSPEND_FOR_TBL_RESIZE);
+    ALOGI("Jit: resizing JitTable from %d to %d", gDvmJit.jitTableSize, size);
 
-    pOldTable = gDvmJit.pJitEntryTable;
-    oldSize = gDvmJit.jitTableSize;
+    pNewTable = (JitEntry*)malloc(size * sizeof(*pNewTable));
+    if (pNewTable == NULL) {
+        return true;
+    }
+    clearJitTable(pNewTable, size);
 
     dvmLockMutex(&gDvmJit.tableLock);
+
+    /*
+     * Publication order matters to the lock-free readers in lookupEntry:
+     *   1) old table geometry, then the old table pointer
+     *   2) the new table pointer
+     *   3) the new (wider) mask and size
+     * A reader that loads the mask first can thus pair a narrow mask with
+     * the new table (a harmless spurious miss), but never a wide mask with
+     * the old one.
+     */
+    gDvmJit.jitTableSizeOld = gDvmJit.jitTableSize;
+    gDvmJit.jitTableMaskOld = gDvmJit.jitTableMask;
+    gDvmJit.jitTableMigrateIndex = 0;
+    ANDROID_MEMBAR_FULL();
+    gDvmJit.pJitEntryTableOld = gDvmJit.pJitEntryTable;
+    ANDROID_MEMBAR_FULL();
     gDvmJit.pJitEntryTable = pNewTable;
+    ANDROID_MEMBAR_FULL();
     gDvmJit.jitTableSize = size;
     gDvmJit.jitTableMask = size - 1;
     gDvmJit.jitTableEntriesUsed = 0;
+#if defined(WITH_JIT_TUNING)
+    gDvmJit.jitTableResizes++;
+#endif
 
-    for (i=0; i < oldSize; i++) {
-        if (pOldTable[i].dPC) {
-            JitEntry *p;
-            u2 chain;
-            p = lookupAndAdd(pOldTable[i].dPC, true /* holds tableLock*/,
-                             pOldTable[i].u.info.isMethodEntry);
-            p->codeAddress = pOldTable[i].codeAddress;
-            /* We need to preserve the new chain field, but copy the rest */
-            chain = p->u.info.chain;
-            p->u = pOldTable[i].u;
-            p->u.info.chain = chain;
+    dvmUnlockMutex(&gDvmJit.tableLock);
+
+    return false;
+}
+
+/*
+ * Move up to "count" old-table slots into the active table.  Caller must
+ * hold tableLock.  Returns true once the whole old table has been copied.
+ */
+static bool migrateJitTableLocked(unsigned int count)
+{
+    JitEntry *oldTable = gDvmJit.pJitEntryTableOld;
+    unsigned int i = gDvmJit.jitTableMigrateIndex;
+    unsigned int end;
+
+    if (oldTable == NULL)
+        return true;
+
+    end = MIN(i + count, gDvmJit.jitTableSizeOld);
+    for (; i < end; i++) {
+        if ((oldTable[i].dPC != NULL) &&
+            (migrateEntryLocked(&oldTable[i]) == NULL)) {
+            /*
+             * Cannot happen unless the new table fills up before the old
+             * one is drained.  Stop here so the entry stays reachable
+             * through the old table.
+             */
+            ALOGD("JIT: JitTable full during migration");
+            break;
         }
     }
+    gDvmJit.jitTableMigrateIndex = i;
+    return i == gDvmJit.jitTableSizeOld;
+}
 
-    dvmUnlockMutex(&gDvmJit.tableLock);
+/*
+ * Perform one step of an in-progress incremental resize.  Once the old
+ * table has been fully copied it is retired, to be freed at the next safe
+ * point.  May only be called by the compiler thread.  Returns true if more
+ * work remains.
+ */
+bool dvmJitMigrateJitTable()
+{
+    bool done;
 
-    free(pOldTable);
+    if (gDvmJit.pJitEntryTableOld == NULL)
+        return false;
 
-    /* Restart the world */
-    dvmResumeAllThreads(SUSPEND_FOR_TBL_RESIZE);
+    dvmLockMutex(&gDvmJit.tableLock);
+    done = migrateJitTableLocked(JIT_TABLE_MIGRATE_BATCH);
+    if (done) {
+        gDvmJit.pJitEntryTableRetired = gDvmJit.pJitEntryTableOld;
+        gDvmJit.pJitEntryTableOld = NULL;
+    }
+    dvmUnlockMutex(&gDvmJit.tableLock);
+    return !done;
+}
 
-    return false;
+/*
+ * Copy whatever is left of the old table into the active one, so that a
+ * walk over pJitEntryTable sees every translation.  Caller must hold
+ * tableLock.  The old table itself is left in place for lock-free readers
+ * and is retired by the compiler thread's next migration step.
+ */
+void dvmJitFinishJitTableMigration()
+{
+    if (gDvmJit.pJitEntryTableOld != NULL) {
+        migrateJitTableLocked(gDvmJit.jitTableSizeOld);
+    }
+}
+
+/*
+ * Free a drained JitTable.  Must be called with all mutator threads
+ * suspended, so that no lock-free lookup can still be walking it.
+ */
+void dvmJitReleaseRetiredJitTable()
+{
+    dvmLockMutex(&gDvmJit.tableLock);
+    free(gDvmJit.pJitEntryTableRetired);
+    gDvmJit.pJitEntryTableRetired = NULL;
+    dvmUnlockMutex(&gDvmJit.tableLock);
 }
 
 /*
@@ -1381,8 +1673,6 @@ bool dvmJitResizeJitTable( unsigned int size )
  */
 void dvmJitResetTable()
 {
-    JitEntry *jitEntry = gDvmJit.pJitEntryTable;
-    unsigned int size = gDvmJit.jitTableSize;
     unsigned int i;
 
     dvmLockMutex(&gDvmJit.tableLock);
@@ -1397,9 +1687,14 @@ void dvmJitResetTable()
         gDvmJit.pJitTraceProfCounters->next = 0;
     }
 
-    memset((void *) jitEntry, 0, sizeof(JitEntry) * size);
-    for (i=0; i< size; i++) {
-        jitEntry[i].u.info.chain = size;  /* Initialize chain termination */
+    clearJitTable(gDvmJit.pJitEntryTable, gDvmJit.jitTableSize);
+    /*
+     * An old table still being drained is emptied too, leaving nothing
+     * to migrate.  It is retired by the compiler thread as usual.
+     */
+    if (gDvmJit.pJitEntryTableOld != NULL) {
+        clearJitTable(gDvmJit.pJitEntryTableOld, gDvmJit.jitTableSizeOld);
+        gDvmJit.jitTableMigrateIndex = gDvmJit.jitTableSizeOld;
     }
     gDvmJit.jitTableEntriesUsed = 0;
     dvmUnlockMutex(&gDvmJit.tableLock);
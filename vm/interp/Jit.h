@@ -104,6 +104,19 @@ static inline u4 dvmJitHash( const u2* p ) {
 #define JIT_ENTRY_CHAIN_WIDTH 2
 #define JIT_MAX_ENTRIES (1 << (JIT_ENTRY_CHAIN_WIDTH * 8))
 
+/*
+ * Chain field value that terminates a bucket chain.  It does not depend on
+ * the table size, so a lock-free reader racing with a resize can never
+ * follow a chain past the end of the table it is walking.
+ */
+#define JIT_ENTRY_CHAIN_END (JIT_MAX_ENTRIES - 1)
+
+/*
+ * Number of old-table slots moved into the new JitTable per step of an
+ * incremental resize.
+ */
+#define JIT_TABLE_MIGRATE_BATCH 256
+
 /*
  * The trace profiling counters are allocated in blocks and individual
  * counters must not move so long as any referencing trace exists.
@@ -151,6 +164,7 @@ void* dvmJitGetTraceAddr(const u2* dPC);
 void* dvmJitGetMethodAddr(const u2* dPC);
 void* dvmJitGetTraceAddrThread(const u2* dPC, Thread* self);
 void* dvmJitGetMethodAddrThread(const u2* dPC, Thread* self);
+void* dvmJitTraceExit(const u2* dPC, Thread* self, const void* chainAddr);
 void dvmJitCheckTraceRequest(Thread* self);
 void dvmJitStopTranslationRequests(void);
 #if defined(WITH_JIT_TUNING)
@@ -160,6 +174,9 @@ void dvmBumpPunt(int from);
 #endif
 void dvmJitStats(void);
 bool dvmJitResizeJitTable(unsigned int size);
+bool dvmJitMigrateJitTable(void);
+void dvmJitFinishJitTableMigration(void);
+void dvmJitReleaseRetiredJitTable(void);
 void dvmJitResetTable(void);
 JitEntry *dvmJitFindEntry(const u2* pc, bool isMethodEntry);
 s8 dvmJitd2l(double d);
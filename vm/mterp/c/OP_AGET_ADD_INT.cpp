@@ -0,0 +1,47 @@
+HANDLE_OPCODE(OP_AGET_ADD_INT /*vAA, vBB, vCC; add-int[/2addr]*/)
+    {
+        ArrayObject* arrayObj;
+        u2 arrayInfo;
+        EXPORT_PC();
+        vdst = INST_AA(inst);
+        arrayInfo = FETCH(1);
+        vsrc1 = arrayInfo & 0xff;    /* array ptr */
+        vsrc2 = arrayInfo >> 8;      /* index */
+        ILOGV("|aget v%d,v%d,v%d", vdst, vsrc1, vsrc2);
+        arrayObj = (ArrayObject*) GET_REGISTER(vsrc1);
+        if (!checkForNull((Object*) arrayObj))
+            GOTO_exceptionThrown();
+        if (GET_REGISTER(vsrc2) >= arrayObj->length) {
+            dvmThrowArrayIndexOutOfBoundsException(
+                arrayObj->length, GET_REGISTER(vsrc2));
+            GOTO_exceptionThrown();
+        }
+        SET_REGISTER(vdst,
+            ((s4*)(void*)arrayObj->contents)[GET_REGISTER(vsrc2)]);
+        ILOGV("+ AGET[%d]=%#x", GET_REGISTER(vsrc2), GET_REGISTER(vdst));
+        if (self->interpBreak.ctl.subMode != 0)
+            FINISH(2);
+
+        /* dexopt only fuses aget with add-int or add-int/2addr */
+        ADJUST_PC(2);
+        inst = FETCH(0);
+        if (INST_INST(inst) == OP_ADD_INT) {
+            u2 srcRegs;
+            vdst = INST_AA(inst);
+            srcRegs = FETCH(1);
+            vsrc1 = srcRegs & 0xff;
+            vsrc2 = srcRegs >> 8;
+            ILOGV("|add-int v%d,v%d", vdst, vsrc1);
+            SET_REGISTER(vdst,
+                (s4) GET_REGISTER(vsrc1) + (s4) GET_REGISTER(vsrc2));
+            FINISH(2);
+        } else {
+            vdst = INST_A(inst);
+            vsrc1 = INST_B(inst);
+            ILOGV("|add-int-2addr v%d,v%d", vdst, vsrc1);
+            SET_REGISTER(vdst,
+                (s4) GET_REGISTER(vdst) + (s4) GET_REGISTER(vsrc1));
+            FINISH(1);
+        }
+    }
+OP_END
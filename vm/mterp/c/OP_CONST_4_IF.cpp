@@ -0,0 +1,50 @@
+HANDLE_OPCODE(OP_CONST_4_IF /*vA, #+B; vA, vB, +CCCC*/)
+    {
+        s4 tmp;
+        bool taken;
+
+        vdst = INST_A(inst);
+        tmp = (s4) (INST_B(inst) << 28) >> 28;  // sign extend 4-bit value
+        ILOGV("|const/4 v%d,#0x%02x", vdst, (s4)tmp);
+        SET_REGISTER(vdst, tmp);
+        if (self->interpBreak.ctl.subMode != 0)
+            FINISH(1);
+
+        /* dexopt only fuses const/4 with a two-register if-test */
+        ADJUST_PC(1);
+        inst = FETCH(0);
+        vsrc1 = INST_A(inst);
+        vsrc2 = INST_B(inst);
+        switch (INST_INST(inst)) {
+        case OP_IF_EQ:
+            taken = (s4) GET_REGISTER(vsrc1) == (s4) GET_REGISTER(vsrc2);
+            break;
+        case OP_IF_NE:
+            taken = (s4) GET_REGISTER(vsrc1) != (s4) GET_REGISTER(vsrc2);
+            break;
+        case OP_IF_LT:
+            taken = (s4) GET_REGISTER(vsrc1) < (s4) GET_REGISTER(vsrc2);
+            break;
+        case OP_IF_GE:
+            taken = (s4) GET_REGISTER(vsrc1) >= (s4) GET_REGISTER(vsrc2);
+            break;
+        case OP_IF_GT:
+            taken = (s4) GET_REGISTER(vsrc1) > (s4) GET_REGISTER(vsrc2);
+            break;
+        default:    /* OP_IF_LE */
+            taken = (s4) GET_REGISTER(vsrc1) <= (s4) GET_REGISTER(vsrc2);
+            break;
+        }
+        if (taken) {
+            int branchOffset = (s2)FETCH(1);    /* sign-extended */
+            ILOGV("|if-cmp v%d,v%d,+0x%04x", vsrc1, vsrc2, branchOffset);
+            ILOGV("> branch taken");
+            if (branchOffset < 0)
+                PERIODIC_CHECKS(branchOffset);
+            FINISH(branchOffset);
+        } else {
+            ILOGV("|if-cmp v%d,v%d,-", vsrc1, vsrc2);
+            FINISH(2);
+        }
+    }
+OP_END
@@ -0,0 +1,2 @@
+HANDLE_IGET_QUICK_IF_XXZ(OP_IGET_QUICK_IF_EQZ, "eqz", ==)
+OP_END
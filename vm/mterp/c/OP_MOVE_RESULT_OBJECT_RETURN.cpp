@@ -0,0 +1 @@
+%include "c/OP_MOVE_RESULT_RETURN.cpp"
@@ -0,0 +1,14 @@
+HANDLE_OPCODE($opcode /*vAA; vAA*/)
+    vdst = INST_AA(inst);
+    ILOGV("|move-result%s v%d %s(v%d=0x%08x)",
+         (INST_INST(inst) == OP_MOVE_RESULT_RETURN) ? "" : "-object",
+         vdst, kSpacing+4, vdst,retval.i);
+    SET_REGISTER(vdst, retval.i);
+    if (self->interpBreak.ctl.subMode != 0)
+        FINISH(1);
+
+    /* the return hands back the value the move just copied out of retval */
+    ADJUST_PC(1);
+    ILOGV("|return v%d", vdst);
+    GOTO_returnFromMethod();
+OP_END
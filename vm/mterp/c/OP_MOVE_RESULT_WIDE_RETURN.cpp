@@ -0,0 +1,12 @@
+HANDLE_OPCODE(OP_MOVE_RESULT_WIDE_RETURN /*vAA; vAA*/)
+    vdst = INST_AA(inst);
+    ILOGV("|move-result-wide v%d %s(0x%08llx)", vdst, kSpacing, retval.j);
+    SET_REGISTER_WIDE(vdst, retval.j);
+    if (self->interpBreak.ctl.subMode != 0)
+        FINISH(1);
+
+    /* the return hands back the value the move just copied out of retval */
+    ADJUST_PC(1);
+    ILOGV("|return-wide v%d", vdst);
+    GOTO_returnFromMethod();
+OP_END
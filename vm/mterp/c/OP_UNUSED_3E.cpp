@@ -1,2 +0,0 @@
-HANDLE_OPCODE(OP_UNUSED_3E)
-OP_END
@@ -1,2 +0,0 @@
-HANDLE_OPCODE(OP_UNUSED_42)
-OP_END
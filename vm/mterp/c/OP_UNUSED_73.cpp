@@ -1,2 +0,0 @@
-HANDLE_OPCODE(OP_UNUSED_73)
-OP_END
@@ -39,4 +39,31 @@ INLINE Method* dvmFindInterfaceMethodInCache(ClassObject* thisClass,
 #undef ATOMIC_CACHE_CALC
 }
 
+/*
+ * Look up an interface method for the invoke at "pc", checking the call
+ * site's inline cache slot first.  The slot hits when the receiver class is
+ * the one the site saw last; anything else takes the full lookup, which
+ * then replaces the class and method in the slot.
+ */
+INLINE Method* dvmFindInterfaceMethodAtCallSite(ClassObject* thisClass,
+    u4 methodIdx, const Method* method, DvmDex* methodClassDex, const u2* pc)
+{
+    InlineCacheEntry* pEntry = dvmInlineCacheEntry(pc);
+    u4 firstVersion = android_atomic_acquire_load((int32_t*) &pEntry->version);
+
+    if (pEntry->pc == pc && pEntry->clazz == thisClass) {
+        Method* methodToCall = (Method*)
+            android_atomic_acquire_load((int32_t*) &pEntry->method);
+
+        /* an odd or changed version means we raced with an update */
+        if ((firstVersion & 0x01) == 0 && firstVersion == pEntry->version) {
+            if (pEntry->hits < INLINE_CACHE_HIT_LIMIT)
+                pEntry->hits++;
+            return methodToCall;
+        }
+    }
+    return dvmInlineCacheMiss(thisClass, methodIdx, method, methodClassDex,
+                pc, firstVersion);
+}
+
 }
@@ -1064,6 +1064,42 @@ GOTO_TARGET_DECL(exceptionThrown);
     }                                                                       \
     FINISH(2);
 
+/*
+ * Superinstruction: iget-quick followed by if-eqz/if-nez.  The second
+ * instruction is still in place after the fused one, so while anything is
+ * watching single instructions (debugger, profiler, trace selection) only
+ * the iget is done here and the branch is dispatched on its own.
+ */
+#define HANDLE_IGET_QUICK_IF_XXZ(_opcode, _opname, _cmp)                    \
+    HANDLE_OPCODE(_opcode /*vA, vB, field@CCCC; vAA, +BBBB*/)               \
+    {                                                                       \
+        Object* obj;                                                        \
+        vdst = INST_A(inst);                                                \
+        vsrc1 = INST_B(inst);   /* object ptr */                            \
+        ref = FETCH(1);         /* field offset */                          \
+        ILOGV("|iget-quick v%d,v%d,field@+%u", vdst, vsrc1, ref);           \
+        obj = (Object*) GET_REGISTER(vsrc1);                                \
+        if (!checkForNullExportPC(obj, fp, pc))                             \
+            GOTO_exceptionThrown();                                         \
+        SET_REGISTER(vdst, dvmGetFieldInt(obj, ref));                       \
+        if (self->interpBreak.ctl.subMode != 0)                             \
+            FINISH(2);                                                      \
+        ADJUST_PC(2);                                                       \
+        inst = FETCH(0);                                                    \
+        vsrc1 = INST_AA(inst);                                              \
+        if ((s4) GET_REGISTER(vsrc1) _cmp 0) {                              \
+            int branchOffset = (s2)FETCH(1);    /* sign-extended */         \
+            ILOGV("|if-%s v%d,+0x%04x", (_opname), vsrc1, branchOffset);    \
+            ILOGV("> branch taken");                                        \
+            if (branchOffset < 0)                                           \
+                PERIODIC_CHECKS(branchOffset);                              \
+            FINISH(branchOffset);                                           \
+        } else {                                                            \
+            ILOGV("|if-%s v%d,-", (_opname), vsrc1);                        \
+            FINISH(2);                                                      \
+        }                                                                   \
+    }
+
 #define HANDLE_IPUT_X(_opcode, _opname, _ftype, _regsize)                   \
     HANDLE_OPCODE(_opcode /*vA, vB, field@CCCC*/)                           \
     {                                                                       \
@@ -1963,30 +1999,114 @@ OP_END
 HANDLE_OP_IF_XXZ(OP_IF_LEZ, "lez", <=)
 OP_END
 
-/* File: c/OP_UNUSED_3E.cpp */
-HANDLE_OPCODE(OP_UNUSED_3E)
+/* File: c/OP_IGET_QUICK_IF_EQZ.cpp */
+HANDLE_IGET_QUICK_IF_XXZ(OP_IGET_QUICK_IF_EQZ, "eqz", ==)
 OP_END
 
-/* File: c/OP_UNUSED_3F.cpp */
-HANDLE_OPCODE(OP_UNUSED_3F)
+/* File: c/OP_IGET_QUICK_IF_NEZ.cpp */
+HANDLE_IGET_QUICK_IF_XXZ(OP_IGET_QUICK_IF_NEZ, "nez", !=)
 OP_END
 
-/* File: c/OP_UNUSED_40.cpp */
-HANDLE_OPCODE(OP_UNUSED_40)
+/* File: c/OP_CONST_4_IF.cpp */
+HANDLE_OPCODE(OP_CONST_4_IF /*vA, #+B; vA, vB, +CCCC*/)
+    {
+        s4 tmp;
+        bool taken;
+
+        vdst = INST_A(inst);
+        tmp = (s4) (INST_B(inst) << 28) >> 28;  // sign extend 4-bit value
+        ILOGV("|const/4 v%d,#0x%02x", vdst, (s4)tmp);
+        SET_REGISTER(vdst, tmp);
+        if (self->interpBreak.ctl.subMode != 0)
+            FINISH(1);
+
+        /* dexopt only fuses const/4 with a two-register if-test */
+        ADJUST_PC(1);
+        inst = FETCH(0);
+        vsrc1 = INST_A(inst);
+        vsrc2 = INST_B(inst);
+        switch (INST_INST(inst)) {
+        case OP_IF_EQ:
+            taken = (s4) GET_REGISTER(vsrc1) == (s4) GET_REGISTER(vsrc2);
+            break;
+        case OP_IF_NE:
+            taken = (s4) GET_REGISTER(vsrc1) != (s4) GET_REGISTER(vsrc2);
+            break;
+        case OP_IF_LT:
+            taken = (s4) GET_REGISTER(vsrc1) < (s4) GET_REGISTER(vsrc2);
+            break;
+        case OP_IF_GE:
+            taken = (s4) GET_REGISTER(vsrc1) >= (s4) GET_REGISTER(vsrc2);
+            break;
+        case OP_IF_GT:
+            taken = (s4) GET_REGISTER(vsrc1) > (s4) GET_REGISTER(vsrc2);
+            break;
+        default:    /* OP_IF_LE */
+            taken = (s4) GET_REGISTER(vsrc1) <= (s4) GET_REGISTER(vsrc2);
+            break;
+        }
+        if (taken) {
+            int branchOffset = (s2)FETCH(1);    /* sign-extended */
+            ILOGV("|if-cmp v%d,v%d,+0x%04x", vsrc1, vsrc2, branchOffset);
+            ILOGV("> branch taken");
+            if (branchOffset < 0)
+                PERIODIC_CHECKS(branchOffset);
+            FINISH(branchOffset);
+        } else {
+            ILOGV("|if-cmp v%d,v%d,-", vsrc1, vsrc2);
+            FINISH(2);
+        }
+    }
 OP_END
 
-/* File: c/OP_UNUSED_41.cpp */
-HANDLE_OPCODE(OP_UNUSED_41)
+/* File: c/OP_MOVE_RESULT_RETURN.cpp */
+HANDLE_OPCODE(OP_MOVE_RESULT_RETURN /*vAA; vAA*/)
+    vdst = INST_AA(inst);
+    ILOGV("|move-result%s v%d %s(v%d=0x%08x)",
+         (INST_INST(inst) == OP_MOVE_RESULT_RETURN) ? "" : "-object",
+         vdst, kSpacing+4, vdst,retval.i);
+    SET_REGISTER(vdst, retval.i);
+    if (self->interpBreak.ctl.subMode != 0)
+        FINISH(1);
+
+    /* the return hands back the value the move just copied out of retval */
+    ADJUST_PC(1);
+    ILOGV("|return v%d", vdst);
+    GOTO_returnFromMethod();
 OP_END
 
-/* File: c/OP_UNUSED_42.cpp */
-HANDLE_OPCODE(OP_UNUSED_42)
+/* File: c/OP_MOVE_RESULT_WIDE_RETURN.cpp */
+HANDLE_OPCODE(OP_MOVE_RESULT_WIDE_RETURN /*vAA; vAA*/)
+    vdst = INST_AA(inst);
+    ILOGV("|move-result-wide v%d %s(0x%08llx)", vdst, kSpacing, retval.j);
+    SET_REGISTER_WIDE(vdst, retval.j);
+    if (self->interpBreak.ctl.subMode != 0)
+        FINISH(1);
+
+    /* the return hands back the value the move just copied out of retval */
+    ADJUST_PC(1);
+    ILOGV("|return-wide v%d", vdst);
+    GOTO_returnFromMethod();
 OP_END
 
-/* File: c/OP_UNUSED_43.cpp */
-HANDLE_OPCODE(OP_UNUSED_43)
+/* File: c/OP_MOVE_RESULT_OBJECT_RETURN.cpp */
+/* File: c/OP_MOVE_RESULT_RETURN.cpp */
+HANDLE_OPCODE(OP_MOVE_RESULT_OBJECT_RETURN /*vAA; vAA*/)
+    vdst = INST_AA(inst);
+    ILOGV("|move-result%s v%d %s(v%d=0x%08x)",
+         (INST_INST(inst) == OP_MOVE_RESULT_RETURN) ? "" : "-object",
+         vdst, kSpacing+4, vdst,retval.i);
+    SET_REGISTER(vdst, retval.i);
+    if (self->interpBreak.ctl.subMode != 0)
+        FINISH(1);
+
+    /* the return hands back the value the move just copied out of retval */
+    ADJUST_PC(1);
+    ILOGV("|return v%d", vdst);
+    GOTO_returnFromMethod();
 OP_END
 
+
 /* File: c/OP_AGET.cpp */
 HANDLE_OP_AGET(OP_AGET, "", u4, )
 OP_END
@@ -2227,8 +2347,53 @@ HANDLE_OPCODE(OP_INVOKE_INTERFACE /*vB, {vD, vE, vF, vG, vA}, meth@CCCC*/)
     GOTO_invoke(invokeInterface, false);
 OP_END
 
-/* File: c/OP_UNUSED_73.cpp */
-HANDLE_OPCODE(OP_UNUSED_73)
+/* File: c/OP_AGET_ADD_INT.cpp */
+HANDLE_OPCODE(OP_AGET_ADD_INT /*vAA, vBB, vCC; add-int[/2addr]*/)
+    {
+        ArrayObject* arrayObj;
+        u2 arrayInfo;
+        EXPORT_PC();
+        vdst = INST_AA(inst);
+        arrayInfo = FETCH(1);
+        vsrc1 = arrayInfo & 0xff;    /* array ptr */
+        vsrc2 = arrayInfo >> 8;      /* index */
+        ILOGV("|aget v%d,v%d,v%d", vdst, vsrc1, vsrc2);
+        arrayObj = (ArrayObject*) GET_REGISTER(vsrc1);
+        if (!checkForNull((Object*) arrayObj))
+            GOTO_exceptionThrown();
+        if (GET_REGISTER(vsrc2) >= arrayObj->length) {
+            dvmThrowArrayIndexOutOfBoundsException(
+                arrayObj->length, GET_REGISTER(vsrc2));
+            GOTO_exceptionThrown();
+        }
+        SET_REGISTER(vdst,
+            ((s4*)(void*)arrayObj->contents)[GET_REGISTER(vsrc2)]);
+        ILOGV("+ AGET[%d]=%#x", GET_REGISTER(vsrc2), GET_REGISTER(vdst));
+        if (self->interpBreak.ctl.subMode != 0)
+            FINISH(2);
+
+        /* dexopt only fuses aget with add-int or add-int/2addr */
+        ADJUST_PC(2);
+        inst = FETCH(0);
+        if (INST_INST(inst) == OP_ADD_INT) {
+            u2 srcRegs;
+            vdst = INST_AA(inst);
+            srcRegs = FETCH(1);
+            vsrc1 = srcRegs & 0xff;
+            vsrc2 = srcRegs >> 8;
+            ILOGV("|add-int v%d,v%d", vdst, vsrc1);
+            SET_REGISTER(vdst,
+                (s4) GET_REGISTER(vsrc1) + (s4) GET_REGISTER(vsrc2));
+            FINISH(2);
+        } else {
+            vdst = INST_A(inst);
+            vsrc1 = INST_B(inst);
+            ILOGV("|add-int-2addr v%d,v%d", vdst, vsrc1);
+            SET_REGISTER(vdst,
+                (s4) GET_REGISTER(vdst) + (s4) GET_REGISTER(vsrc1));
+            FINISH(1);
+        }
+    }
 OP_END
 
 /* File: c/OP_INVOKE_VIRTUAL_RANGE.cpp */
@@ -3397,10 +3562,11 @@ GOTO_TARGET(invokeInterface, bool methodCallRange)
 
         /*
          * Given a class and a method index, find the Method* with the
-         * actual code we want to execute.
+         * actual code we want to execute.  The call site's inline cache
+         * slot answers if the receiver class is the one it saw last.
          */
-        methodToCall = dvmFindInterfaceMethodInCache(thisClass, ref, curMethod,
-                        methodClassDex);
+        methodToCall = dvmFindInterfaceMethodAtCallSite(thisClass, ref,
+                        curMethod, methodClassDex, pc);
 #if defined(WITH_JIT) && defined(MTERP_STUB)
         self->callsiteClass = thisClass;
         self->methodToCall = methodToCall;
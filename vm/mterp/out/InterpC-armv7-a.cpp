@@ -1064,6 +1064,42 @@ GOTO_TARGET_DECL(exceptionThrown);
     }                                                                       \
     FINISH(2);
 
+/*
+ * Superinstruction: iget-quick followed by if-eqz/if-nez.  The second
+ * instruction is still in place after the fused one, so while anything is
+ * watching single instructions (debugger, profiler, trace selection) only
+ * the iget is done here and the branch is dispatched on its own.
+ */
+#define HANDLE_IGET_QUICK_IF_XXZ(_opcode, _opname, _cmp)                    \
+    HANDLE_OPCODE(_opcode /*vA, vB, field@CCCC; vAA, +BBBB*/)               \
+    {                                                                       \
+        Object* obj;                                                        \
+        vdst = INST_A(inst);                                                \
+        vsrc1 = INST_B(inst);   /* object ptr */                            \
+        ref = FETCH(1);         /* field offset */                          \
+        ILOGV("|iget-quick v%d,v%d,field@+%u", vdst, vsrc1, ref);           \
+        obj = (Object*) GET_REGISTER(vsrc1);                                \
+        if (!checkForNullExportPC(obj, fp, pc))                             \
+            GOTO_exceptionThrown();                                         \
+        SET_REGISTER(vdst, dvmGetFieldInt(obj, ref));                       \
+        if (self->interpBreak.ctl.subMode != 0)                             \
+            FINISH(2);                                                      \
+        ADJUST_PC(2);                                                       \
+        inst = FETCH(0);                                                    \
+        vsrc1 = INST_AA(inst);                                              \
+        if ((s4) GET_REGISTER(vsrc1) _cmp 0) {                              \
+            int branchOffset = (s2)FETCH(1);    /* sign-extended */         \
+            ILOGV("|if-%s v%d,+0x%04x", (_opname), vsrc1, branchOffset);    \
+            ILOGV("> branch taken");                                        \
+            if (branchOffset < 0)                                           \
+                PERIODIC_CHECKS(branchOffset);                              \
+            FINISH(branchOffset);                                           \
+        } else {                                                            \
+            ILOGV("|if-%s v%d,-", (_opname), vsrc1);                        \
+            FINISH(2);                                                      \
+        }                                                                   \
+    }
+
 #define HANDLE_IPUT_X(_opcode, _opname, _ftype, _regsize)                   \
     HANDLE_OPCODE(_opcode /*vA, vB, field@CCCC*/)                           \
     {                                                                       \
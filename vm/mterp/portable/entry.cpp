@@ -23,8 +23,8 @@ void dvmInterpretPortable(Thread* self)
     const Method* methodToCall;
     bool methodCallRange;
 
-    /* static computed goto table */
-    DEFINE_GOTO_TABLE(handlerTable);
+    /* static computed goto table, as offsets from HANDLER_BASE */
+    DEFINE_GOTO_OFFSET_TABLE(handlerTable);
 
     /* copy state in */
     curMethod = self->interpSave.method;
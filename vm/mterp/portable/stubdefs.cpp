@@ -29,10 +29,16 @@
  * case/break, for a threaded implementation it's a goto label and an
  * instruction fetch/computed goto.
  *
+ * The goto table holds the offset of each handler from the nop handler
+ * rather than its address, so it is position-independent: nothing in it
+ * is relocated when libdvm is loaded, and on 64-bit hosts it takes 1KB
+ * instead of 2KB of data cache.
+ *
  * Assumes the existence of "const u2* pc" and (for threaded operation)
  * "u2 inst".
  */
-# define H(_op)             &&op_##_op
+# define HANDLER_BASE       ((const char*) &&op_OP_NOP)
+# define H(_op)             (int) ((const char*) &&op_##_op - HANDLER_BASE)
 # define HANDLE_OPCODE(_op) op_##_op:
 # define FINISH(_offset) {                                                  \
         ADJUST_PC(_offset);                                                 \
@@ -40,10 +46,10 @@
         if (self->interpBreak.ctl.subMode) {                                \
             dvmCheckBefore(pc, fp, self);                                   \
         }                                                                   \
-        goto *handlerTable[INST_INST(inst)];                                \
+        goto *(HANDLER_BASE + handlerTable[INST_INST(inst)]);               \
     }
 # define FINISH_BKPT(_opcode) {                                             \
-        goto *handlerTable[_opcode];                                        \
+        goto *(HANDLER_BASE + handlerTable[_opcode]);                       \
     }
 
 #define OP_END
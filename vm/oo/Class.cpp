@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #if LOG_CLASS_LOADING
 #include <unistd.h>
@@ -167,6 +168,12 @@ may not be worth the performance hit.
 
 #define CLASS_SFIELD_SLOTS 1
 
+/*
+ * Most helper threads we use to open bootstrap class path entries.  The
+ * work is mostly page faults and header reads, so more doesn't help.
+ */
+#define kMaxClassPathThreads 4
+
 static ClassPathEntry* processClassPath(const char* pathStr, bool isBootstrap);
 static void freeCpeArray(ClassPathEntry* cpe);
 
@@ -594,6 +601,18 @@ static void getFileNameSuffix(const char* fileName, char* suffixBuf, size_t suff
     strlcpy(suffixBuf, (lastDot == NULL) ? "<none>" : (lastDot + 1), suffixBufLen);
 }
 
+/*
+ * Returns "true" if the file name says it's a Zip archive.
+ */
+static bool isJarFileName(const char* fileName)
+{
+    char suffix[10];
+    getFileNameSuffix(fileName, suffix, sizeof(suffix));
+
+    return (strcmp(suffix, "jar") == 0) || (strcmp(suffix, "zip") == 0) ||
+            (strcmp(suffix, "apk") == 0);
+}
+
 /*
  * Prepare a ClassPathEntry struct, which at this point only has a valid
  * filename.  We need to figure out what kind of file it is, and for
@@ -616,8 +635,7 @@ static bool prepareCpe(ClassPathEntry* cpe, bool isBootstrap)
     char suffix[10];
     getFileNameSuffix(cpe->fileName, suffix, sizeof(suffix));
 
-    if ((strcmp(suffix, "jar") == 0) || (strcmp(suffix, "zip") == 0) ||
-            (strcmp(suffix, "apk") == 0)) {
+    if (isJarFileName(cpe->fileName)) {
         JarFile* pJarFile = NULL;
         if (dvmJarFileOpen(cpe->fileName, NULL, &pJarFile, isBootstrap) == 0) {
             cpe->kind = kCpeJar;
@@ -639,6 +657,184 @@ static bool prepareCpe(ClassPathEntry* cpe, bool isBootstrap)
     return false;
 }
 
+/*
+ * A bootstrap class path entry opened ahead of time by a helper thread.
+ */
+struct PreopenedCpe {
+    bool        done;
+    JarFile*    pJarFile;       /* NULL if it has to be opened the slow way */
+    u1*         depData;        /* for dvmCheckBootClassPathDeps() */
+    u4          depsLength;
+};
+
+/*
+ * State shared by processClassPath() and its helper threads.
+ */
+struct ClassPathOpenState {
+    char**          names;      /* the entries, in class path order */
+    int             count;
+    int             threads;    /* helpers started; 0 if we're on our own */
+    pthread_t       handles[kMaxClassPathThreads];
+
+    pthread_mutex_t lock;       /* guards everything below */
+    pthread_cond_t  cond;       /* signaled when an entry is done */
+    int             next;       /* next entry to claim */
+    PreopenedCpe*   entries;
+};
+
+/*
+ * Helper thread.  Claims entries in order and opens the ones whose
+ * optimized DEX is up to date, except for checking their dependencies.
+ * These threads aren't attached to the VM.
+ */
+static void* classPathOpenThreadStart(void* arg)
+{
+    ClassPathOpenState* pState = (ClassPathOpenState*) arg;
+
+    while (true) {
+        dvmLockMutex(&pState->lock);
+        int idx = pState->next;
+        if (idx < pState->count)
+            pState->next++;
+        dvmUnlockMutex(&pState->lock);
+        if (idx >= pState->count)
+            break;
+
+        JarFile* pJarFile = NULL;
+        u1* depData = NULL;
+        u4 depsLength = 0;
+        if (isJarFileName(pState->names[idx]) &&
+            dvmJarFileOpenDeferDeps(pState->names[idx], &pJarFile,
+                &depData, &depsLength) != 0)
+        {
+            pJarFile = NULL;
+        }
+
+        dvmLockMutex(&pState->lock);
+        PreopenedCpe* pEntry = &pState->entries[idx];
+        pEntry->pJarFile = pJarFile;
+        pEntry->depData = depData;
+        pEntry->depsLength = depsLength;
+        pEntry->done = true;
+        pthread_cond_broadcast(&pState->cond);
+        dvmUnlockMutex(&pState->lock);
+    }
+    return NULL;
+}
+
+/*
+ * Start helper threads to open the "count" bootstrap class path entries
+ * in "names" in parallel, if there's more than one and we're allowed
+ * more than one thread.  "names" may be NULL if there was no memory for
+ * it, in which case the caller opens everything itself.
+ */
+static void startClassPathOpeners(ClassPathOpenState* pState, char** names,
+    int count)
+{
+    memset(pState, 0, sizeof(*pState));
+    pState->names = names;
+    pState->count = count;
+    if (names == NULL)
+        return;
+
+    int threads = gDvm.bootClassPathThreads;
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int) cpus : 1;
+    }
+    threads = MIN(MIN(threads, kMaxClassPathThreads), count);
+    if (threads <= 1)
+        return;
+
+    pState->entries = (PreopenedCpe*) calloc(count, sizeof(PreopenedCpe));
+    if (pState->entries == NULL)
+        return;
+    dvmInitMutex(&pState->lock);
+    pthread_cond_init(&pState->cond, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pState->handles[pState->threads], NULL,
+                classPathOpenThreadStart, pState) != 0)
+        {
+            ALOGW("Unable to start class path thread: %s", strerror(errno));
+            break;
+        }
+        pState->threads++;
+    }
+    if (pState->threads == 0) {
+        /* do it all the slow way */
+        pthread_cond_destroy(&pState->cond);
+        dvmDestroyMutex(&pState->lock);
+        free(pState->entries);
+        pState->entries = NULL;
+    }
+}
+
+/*
+ * Fill out "cpe" with entry "idx" if a helper thread was able to open it
+ * and its dependencies match the entries before it.  Must be called in
+ * class path order, with the earlier entries in gDvm.bootClassPath.
+ *
+ * Returns "false" if the entry needs to be prepared the usual way.
+ */
+static bool usePreopenedCpe(ClassPathOpenState* pState, int idx,
+    ClassPathEntry* cpe)
+{
+    if (pState->threads == 0)
+        return false;
+
+    PreopenedCpe* pEntry = &pState->entries[idx];
+    ThreadStatus oldStatus = dvmChangeStatus(NULL, THREAD_VMWAIT);
+    dvmLockMutex(&pState->lock);
+    while (!pEntry->done)
+        pthread_cond_wait(&pState->cond, &pState->lock);
+    dvmUnlockMutex(&pState->lock);
+    dvmChangeStatus(NULL, oldStatus);
+
+    JarFile* pJarFile = pEntry->pJarFile;
+    bool result = false;
+
+    pEntry->pJarFile = NULL;
+    if (pJarFile != NULL) {
+        if (dvmCheckBootClassPathDeps(pEntry->depData, pEntry->depsLength)) {
+            cpe->kind = kCpeJar;
+            cpe->ptr = pJarFile;
+            result = true;
+        } else {
+            /* stale; the usual way will sort it out */
+            dvmJarFileFree(pJarFile);
+        }
+    }
+    free(pEntry->depData);
+    pEntry->depData = NULL;
+
+    return result;
+}
+
+/*
+ * Wait for the helper threads and clean up.
+ */
+static void finishClassPathOpeners(ClassPathOpenState* pState)
+{
+    if (pState->threads == 0)
+        return;
+
+    ThreadStatus oldStatus = dvmChangeStatus(NULL, THREAD_VMWAIT);
+    for (int i = 0; i < pState->threads; i++)
+        pthread_join(pState->handles[i], NULL);
+    dvmChangeStatus(NULL, oldStatus);
+
+    /* anything we didn't get to, e.g. because we bailed out early */
+    for (int i = 0; i < pState->count; i++) {
+        dvmJarFileFree(pState->entries[i].pJarFile);
+        free(pState->entries[i].depData);
+    }
+
+    pthread_cond_destroy(&pState->cond);
+    dvmDestroyMutex(&pState->lock);
+    free(pState->entries);
+}
+
 /*
  * Convert a colon-separated list of directories, Zip files, and DEX files
  * into an array of ClassPathEntry structs.
@@ -650,14 +846,23 @@ static bool prepareCpe(ClassPathEntry* cpe, bool isBootstrap)
  * If entries are added or removed from the bootstrap class path, the
  * dependencies in the DEX files will break, and everything except the
  * very first entry will need to be regenerated.
+ *
+ * Each entry's optimized DEX depends on the entries before it, so they
+ * are added to the list in order.  Helper threads get ahead by opening
+ * and mapping the entries that are already optimized; as each one's turn
+ * comes, we check its dependencies against the entries before it and
+ * take it, or fall back to preparing it here (e.g. to run dexopt).
  */
 static ClassPathEntry* processClassPath(const char* pathStr, bool isBootstrap)
 {
+    ClassPathOpenState state;
     ClassPathEntry* cpe = NULL;
+    char** names = NULL;
     char* mangle;
     char* cp;
     const char* end;
-    int idx, count;
+    int idx, count, numNames;
+    u8 startWhen;
 
     assert(pathStr != NULL);
 
@@ -683,6 +888,7 @@ static ClassPathEntry* processClassPath(const char* pathStr, bool isBootstrap)
      * Allocate storage.  We over-alloc by one so we can set an "end" marker.
      */
     cpe = (ClassPathEntry*) calloc(count+1, sizeof(ClassPathEntry));
+    names = (char**) malloc(count * sizeof(char*));
 
     /*
      * Set the global pointer so the DEX file dependency stuff can find it.
@@ -690,10 +896,12 @@ static ClassPathEntry* processClassPath(const char* pathStr, bool isBootstrap)
     gDvm.bootClassPath = cpe;
 
     /*
-     * Go through a second time, pulling stuff out.
+     * Go through a second time, checking the entries and collecting them
+     * for the helper threads.  If there's no memory for the list, we just
+     * open them all the slow way.
      */
     cp = mangle;
-    idx = 0;
+    numNames = 0;
     while (cp < end) {
         if (*cp == '\0') {
             /* leading, trailing, or doubled ':'; ignore it */
@@ -705,32 +913,57 @@ static ClassPathEntry* processClassPath(const char* pathStr, bool isBootstrap)
                 cpe = NULL;
                 goto bail;
             }
+            if (names != NULL)
+                names[numNames] = cp;
+            numNames++;
+        }
 
-            ClassPathEntry tmp;
-            tmp.kind = kCpeUnknown;
-            tmp.fileName = strdup(cp);
-            tmp.ptr = NULL;
+        cp += strlen(cp) +1;
+    }
 
-            /*
-             * Drop an end marker here so DEX loader can walk unfinished
-             * list.
-             */
-            cpe[idx].kind = kCpeLastEntry;
-            cpe[idx].fileName = NULL;
-            cpe[idx].ptr = NULL;
-
-            if (!prepareCpe(&tmp, isBootstrap)) {
-                /* drop from list and continue on */
-                free(tmp.fileName);
-            } else {
-                /* copy over, pointers and all */
-                cpe[idx] = tmp;
-                idx++;
-            }
-        }
+    startWhen = dvmGetRelativeTimeUsec();
+    startClassPathOpeners(&state, names, numNames);
 
+    /*
+     * Go through a third time, adding the entries in order.
+     */
+    cp = mangle;
+    idx = 0;
+    for (int i = 0; i < numNames; i++) {
+        while (*cp == '\0')    /* leading or doubled ':' */
+            cp++;
+
+        ClassPathEntry tmp;
+        tmp.kind = kCpeUnknown;
+        tmp.fileName = strdup(cp);
+        tmp.ptr = NULL;
         cp += strlen(cp) +1;
+
+        /*
+         * Drop an end marker here so DEX loader can walk unfinished
+         * list.
+         */
+        cpe[idx].kind = kCpeLastEntry;
+        cpe[idx].fileName = NULL;
+        cpe[idx].ptr = NULL;
+
+        if (!usePreopenedCpe(&state, i, &tmp) &&
+            !prepareCpe(&tmp, isBootstrap))
+        {
+            /* drop from list and continue on */
+            free(tmp.fileName);
+        } else {
+            /* copy over, pointers and all */
+            cpe[idx] = tmp;
+            idx++;
+        }
     }
+
+    finishClassPathOpeners(&state);
+    ALOGD("Opened %d of %d bootclasspath entries in %dms, %d helper threads",
+        idx, numNames, (int) ((dvmGetRelativeTimeUsec() - startWhen) / 1000),
+        state.threads);
+
     assert(idx <= count);
     if (idx == 0 && !gDvm.optimizing) {
         /*
@@ -752,6 +985,7 @@ static ClassPathEntry* processClassPath(const char* pathStr, bool isBootstrap)
     //dumpClassPath(cpe);
 
 bail:
+    free(names);
     free(mangle);
     gDvm.bootClassPath = cpe;
     return cpe;
@@ -1963,6 +2197,12 @@ static ClassObject* loadClassFromDex(DvmDex* pDvmDex,
             dexGetClassDescriptor(pDexFile, pClassDef));
     }
 
+    /* in-memory DEX data may not have had its class data checked yet */
+    if (!dexVerifyClassLazily(pDexFile, pClassDef)) {
+        dvmThrowClassFormatError(dexGetClassDescriptor(pDexFile, pClassDef));
+        return NULL;
+    }
+
     pEncodedData = dexGetClassData(pDexFile, pClassDef);
 
     if (pEncodedData != NULL) {